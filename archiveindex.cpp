@@ -0,0 +1,803 @@
+#include "archiveindex.h"
+#include "archivememberdevice.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimeZone>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+/**
+ * @file archiveindex.h
+ * @brief The ArchiveIndex class lets zip and tar archives be browsed like directories.
+ * A path below an archive file, e.g. /home/user/src.zip/docs, names a directory or member inside it. The member
+ * list is read once per archive, from the central directory of a zip or by a streaming scan over the headers of a
+ * tar, and cached together with the directory listings derived from it until the archive changes on disk.
+ * Members are read on demand through an ArchiveMemberDevice, so nothing is unpacked to disk.
+ */
+
+namespace
+{
+const int maxCachedMembers = 1000000;
+const qint64 zipEndRecordSize = 22;
+const qint64 zipMaxCommentSize = 0xFFFF;
+const qint64 zipCentralHeaderSize = 46;
+const qint64 zipLocalHeaderSize = 30;
+const qint64 maxCentralDirectorySize = 512 * 1024 * 1024;
+const qint64 tarBlockSize = 512;
+const qint64 maxTarNameSize = 64 * 1024;
+const quint32 zipEndSignature = 0x06054b50;
+const quint32 zip64LocatorSignature = 0x07064b50;
+const quint32 zip64EndSignature = 0x06064b50;
+const quint32 zipCentralSignature = 0x02014b50;
+const quint32 zipLocalSignature = 0x04034b50;
+const quint16 zipStored = 0;
+const quint16 zipDeflated = 8;
+const quint16 unreadableMethod = 0xFFFF;
+
+template <typename T>
+T readLittleEndian(const QByteArray &data, qsizetype position)
+{
+    return qFromLittleEndian<T>(data.constData() + position);
+}
+
+/**
+ * @brief Turns a member name into a relative path without empty, "." or trailing components.
+ * Returns an empty path for names escaping the archive with "..".
+ */
+QString normalizedMemberPath(QString name)
+{
+    name.replace('\\', '/');
+    QStringList parts;
+    const QStringList components = name.split('/', Qt::SkipEmptyParts);
+    for (const QString &component : components)
+    {
+        if (component == "..")
+        {
+            return QString();
+        }
+        if (component != ".")
+        {
+            parts << component;
+        }
+    }
+    return parts.join('/');
+}
+
+qint64 dosTimeToMs(quint16 time, quint16 date)
+{
+    const QDateTime dateTime(QDate(1980 + (date >> 9), (date >> 5) & 0x0F, date & 0x1F),
+                             QTime(time >> 11, (time >> 5) & 0x3F, (time & 0x1F) * 2));
+    return dateTime.isValid() ? dateTime.toMSecsSinceEpoch() : 0;
+}
+
+/**
+ * @brief Parses a numeric tar header field, octal text or the base-256 form used for large values.
+ */
+qint64 tarNumber(const char *field, int length)
+{
+    qint64 value = 0;
+    if (uchar(field[0]) & 0x80)
+    {
+        for (int i = 1; i < length; ++i)
+        {
+            value = (value << 8) | uchar(field[i]);
+        }
+        return value;
+    }
+
+    for (int i = 0; i < length && field[i] != '\0'; ++i)
+    {
+        if (field[i] >= '0' && field[i] <= '7')
+        {
+            value = (value << 3) | (field[i] - '0');
+        }
+    }
+    return value;
+}
+
+QString tarString(const char *field, int length)
+{
+    return QString::fromUtf8(field, qstrnlen(field, length));
+}
+
+bool isValidTarHeader(const char *header)
+{
+    qint64 sum = 0;
+    for (int i = 0; i < tarBlockSize; ++i)
+    {
+        sum += (i >= 148 && i < 156) ? ' ' : uchar(header[i]);
+    }
+    return sum == tarNumber(header + 148, 8);
+}
+
+/**
+ * @brief Applies the path and size records of a pax extended header.
+ */
+void parsePaxHeader(const QByteArray &records, QString &path, qint64 &size)
+{
+    qsizetype position = 0;
+    while (position < records.size())
+    {
+        const qsizetype space = records.indexOf(' ', position);
+        if (space < 0)
+        {
+            return;
+        }
+
+        const qsizetype length = records.mid(position, space - position).toLongLong();
+        if (length <= 0 || position + length > records.size())
+        {
+            return;
+        }
+
+        const QByteArray record = records.mid(space + 1, position + length - space - 2);
+        const qsizetype equals = record.indexOf('=');
+        if (equals > 0)
+        {
+            const QByteArray key = record.left(equals);
+            if (key == "path")
+            {
+                path = QString::fromUtf8(record.mid(equals + 1));
+            }
+            else if (key == "size")
+            {
+                size = record.mid(equals + 1).toLongLong();
+            }
+        }
+        position += length;
+    }
+}
+}
+
+ArchiveIndex::ArchiveIndex()
+{
+    cache.setMaxCost(maxCachedMembers);
+}
+
+ArchiveIndex::~ArchiveIndex()
+{
+}
+
+ArchiveIndex& ArchiveIndex::instance()
+{
+    static ArchiveIndex instance;
+    return instance;
+}
+
+/**
+ * @brief Returns the archive format a file name suggests. Compressed tars need zlib.
+ */
+ArchiveIndex::Format ArchiveIndex::formatForName(const QString &fileName)
+{
+    if (fileName.endsWith(".zip", Qt::CaseInsensitive))
+    {
+        return Zip;
+    }
+    if (fileName.endsWith(".tar", Qt::CaseInsensitive))
+    {
+        return Tar;
+    }
+    if ((fileName.endsWith(".tar.gz", Qt::CaseInsensitive) || fileName.endsWith(".tgz", Qt::CaseInsensitive))
+        && ArchiveMemberDevice::isEncodingSupported(ArchiveMemberDevice::Gzip))
+    {
+        return TarGz;
+    }
+    return NotAnArchive;
+}
+
+/**
+ * @brief Splits a path into the archive file it lies in and the path inside the archive.
+ * Only components named like an archive are checked on disk, so ordinary paths cost no file system access.
+ *
+ * @param path The path, e.g. /home/user/src.zip/docs.
+ * @param archivePath Receives the archive file, e.g. /home/user/src.zip.
+ * @param memberPath Receives the path inside the archive, e.g. docs; empty for the archive itself.
+ * @return True if the path is an archive or lies inside one.
+ */
+bool ArchiveIndex::splitPath(const QString &path, QString &archivePath, QString &memberPath)
+{
+    const QString cleanPath = QDir::cleanPath(path);
+    qsizetype start = 0;
+
+    while (true)
+    {
+        const qsizetype slash = cleanPath.indexOf('/', start);
+        const qsizetype end = slash < 0 ? cleanPath.size() : slash;
+
+        if (end > start)
+        {
+            const QString prefix = cleanPath.left(end);
+            if (formatForName(prefix) != NotAnArchive && QFileInfo(prefix).isFile())
+            {
+                archivePath = prefix;
+                memberPath = slash < 0 ? QString() : cleanPath.mid(slash + 1);
+                return true;
+            }
+        }
+
+        if (slash < 0)
+        {
+            return false;
+        }
+        start = slash + 1;
+    }
+}
+
+/**
+ * @brief Returns true if the path is an archive file or lies inside one.
+ */
+bool ArchiveIndex::isInsideArchive(const QString &path)
+{
+    QString archivePath;
+    QString memberPath;
+    return splitPath(path, archivePath, memberPath);
+}
+
+/**
+ * @brief Returns the directory on disk holding the archive of a path inside an archive, other paths unchanged.
+ */
+QString ArchiveIndex::diskDirectory(const QString &path)
+{
+    QString archivePath;
+    QString memberPath;
+    return splitPath(path, archivePath, memberPath) ? QFileInfo(archivePath).path() : path;
+}
+
+/**
+ * @brief Calls the visitor with the cached contents of an archive, reading them first if the archive is not cached
+ * or changed on disk. The archive is read without holding the lock.
+ *
+ * @return The result of the visitor, false if the archive cannot be read.
+ */
+template <typename Visitor>
+bool ArchiveIndex::visit(const QString &archivePath, Visitor visitor)
+{
+    const QFileInfo fileInfo(archivePath);
+    const qint64 size = fileInfo.size();
+    const qint64 modifiedMs = fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+
+    {
+        QMutexLocker locker(&mutex);
+        const Contents *cached = cache.object(archivePath);
+        if (cached != nullptr && cached->archiveSize == size && cached->archiveModifiedMs == modifiedMs)
+        {
+            return visitor(*cached);
+        }
+    }
+
+    auto contents = std::make_unique<Contents>();
+    contents->format = formatForName(archivePath);
+    contents->archiveSize = size;
+    contents->archiveModifiedMs = modifiedMs;
+
+    bool isRead = false;
+    if (contents->format == Zip)
+    {
+        isRead = readZip(archivePath, *contents);
+    }
+    else if (contents->format == Tar)
+    {
+        QFile file(archivePath);
+        isRead = file.open(QIODevice::ReadOnly) && readTar(file, *contents);
+    }
+    else if (contents->format == TarGz)
+    {
+        ArchiveMemberDevice device(archivePath, 0, -1, ArchiveMemberDevice::Gzip);
+        isRead = device.open(QIODevice::ReadOnly) && readTar(device, *contents);
+    }
+
+    if (!isRead)
+    {
+        return false;
+    }
+
+    buildDirectories(*contents);
+    const bool result = visitor(*contents);
+
+    QMutexLocker locker(&mutex);
+    const qsizetype cost = contents->members.size() + 1;
+    if (cost <= cache.maxCost())
+    {
+        cache.insert(archivePath, contents.release(), cost);
+    }
+    return result;
+}
+
+/**
+ * @brief Returns true if the archive of a path is cached and unchanged on disk, so it can be listed without reading it.
+ */
+bool ArchiveIndex::isCached(const QString &path)
+{
+    QString archivePath;
+    QString memberPath;
+    if (!splitPath(path, archivePath, memberPath))
+    {
+        return false;
+    }
+
+    const QFileInfo fileInfo(archivePath);
+    QMutexLocker locker(&mutex);
+    const Contents *cached = cache.object(archivePath);
+    return cached != nullptr && cached->archiveSize == fileInfo.size()
+           && cached->archiveModifiedMs == fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+}
+
+/**
+ * @brief Reads the archive of a path into the cache unless it is cached already. Meant to run on a worker thread
+ * before the archive is listed on the GUI thread.
+ *
+ * @return False if the path does not lie in a readable archive.
+ */
+bool ArchiveIndex::preload(const QString &path)
+{
+    QString archivePath;
+    QString memberPath;
+    return splitPath(path, archivePath, memberPath) && visit(archivePath, [](const Contents &) { return true; });
+}
+
+/**
+ * @brief Returns true if the path is a readable archive or a directory inside one.
+ */
+bool ArchiveIndex::isDirectory(const QString &path)
+{
+    QString archivePath;
+    QString memberPath;
+    return splitPath(path, archivePath, memberPath)
+           && visit(archivePath, [&memberPath](const Contents &contents) { return contents.directories.contains(memberPath); });
+}
+
+/**
+ * @brief Returns the sorted listing of the archive or of a directory inside it.
+ *
+ * @param path The archive or a directory inside it.
+ * @param listing Receives the listing.
+ * @return False if the path is not a directory in a readable archive.
+ */
+bool ArchiveIndex::listing(const QString &path, DirectoryListing &listing)
+{
+    QString archivePath;
+    QString memberPath;
+    return splitPath(path, archivePath, memberPath)
+           && visit(archivePath, [&memberPath, &listing](const Contents &contents)
+                    {
+                        const auto directory = contents.directories.constFind(memberPath);
+                        if (directory == contents.directories.constEnd())
+                        {
+                            return false;
+                        }
+                        listing = *directory;
+                        return true;
+                    });
+}
+
+/**
+ * @brief Returns all members of an archive, in archive order.
+ *
+ * @param archivePath The archive file.
+ * @param members Receives the members.
+ * @param format Receives the format of the archive.
+ * @return False if the archive cannot be read.
+ */
+bool ArchiveIndex::members(const QString &archivePath, QList<ArchiveMember> &members, Format &format)
+{
+    return visit(QDir::cleanPath(archivePath), [&members, &format](const Contents &contents)
+                 {
+                     members = contents.members;
+                     format = contents.format;
+                     return true;
+                 });
+}
+
+/**
+ * @brief Opens a member for streaming its content.
+ *
+ * @param path The path of a file inside an archive.
+ * @return The opened device owned by the caller, or nullptr if the member cannot be read.
+ */
+QIODevice* ArchiveIndex::openMember(const QString &path)
+{
+    QString archivePath;
+    QString memberPath;
+    ArchiveMember member;
+    Format format = NotAnArchive;
+
+    if (!splitPath(path, archivePath, memberPath)
+        || !visit(archivePath, [&](const Contents &contents)
+                  {
+                      const auto row = contents.memberRows.constFind(memberPath);
+                      if (row == contents.memberRows.constEnd())
+                      {
+                          return false;
+                      }
+                      member = contents.members.at(*row);
+                      format = contents.format;
+                      return true;
+                  })
+        )
+    {
+        return nullptr;
+    }
+
+    return openMember(archivePath, format, member);
+}
+
+/**
+ * @brief Opens a member listed by members() for streaming its content.
+ *
+ * @param archivePath The archive file.
+ * @param format The format of the archive.
+ * @param member The member, a file.
+ * @return The opened device owned by the caller, or nullptr if the member cannot be read.
+ */
+QIODevice* ArchiveIndex::openMember(const QString &archivePath, Format format, const ArchiveMember &member)
+{
+    if (member.isDir || member.isLink)
+    {
+        return nullptr;
+    }
+
+    std::unique_ptr<ArchiveMemberDevice> device;
+    if (format == Zip)
+    {
+        QFile file(archivePath);
+        if (member.method == unreadableMethod || !file.open(QIODevice::ReadOnly) || !file.seek(member.dataOffset))
+        {
+            return nullptr;
+        }
+
+        const QByteArray header = file.read(zipLocalHeaderSize);
+        if (header.size() != zipLocalHeaderSize || readLittleEndian<quint32>(header, 0) != zipLocalSignature)
+        {
+            return nullptr;
+        }
+
+        const qint64 dataStart = member.dataOffset + zipLocalHeaderSize
+                                 + readLittleEndian<quint16>(header, 26) + readLittleEndian<quint16>(header, 28);
+        const ArchiveMemberDevice::Encoding encoding = member.method == zipDeflated ? ArchiveMemberDevice::RawDeflate
+                                                                                    : ArchiveMemberDevice::Stored;
+        device = std::make_unique<ArchiveMemberDevice>(archivePath, dataStart, member.compressedSize, encoding, 0, member.size);
+    }
+    else if (format == Tar)
+    {
+        device = std::make_unique<ArchiveMemberDevice>(archivePath, member.dataOffset, member.size, ArchiveMemberDevice::Stored,
+                                                       0, member.size);
+    }
+    else
+    {
+        device = std::make_unique<ArchiveMemberDevice>(archivePath, 0, -1, ArchiveMemberDevice::Gzip, member.dataOffset, member.size);
+    }
+
+    if (!device->open(QIODevice::ReadOnly))
+    {
+        return nullptr;
+    }
+    return device.release();
+}
+
+/**
+ * @brief Reads the member list from the central directory at the end of a zip archive, including zip64 records.
+ */
+bool ArchiveIndex::readZip(const QString &archivePath, Contents &contents)
+{
+    QFile file(archivePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < zipEndRecordSize)
+    {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const qint64 tailSize = std::min(size, zipEndRecordSize + zipMaxCommentSize + 20);
+    if (!file.seek(size - tailSize))
+    {
+        return false;
+    }
+
+    const QByteArray tail = file.read(tailSize);
+    qsizetype endRecord = tail.size() - zipEndRecordSize;
+    while (endRecord >= 0 && readLittleEndian<quint32>(tail, endRecord) != zipEndSignature)
+    {
+        --endRecord;
+    }
+    if (endRecord < 0)
+    {
+        return false;
+    }
+
+    quint64 entryCount = readLittleEndian<quint16>(tail, endRecord + 10);
+    quint64 directorySize = readLittleEndian<quint32>(tail, endRecord + 12);
+    quint64 directoryOffset = readLittleEndian<quint32>(tail, endRecord + 16);
+
+    if ((entryCount == 0xFFFF || directorySize == 0xFFFFFFFF || directoryOffset == 0xFFFFFFFF)
+        && endRecord >= 20 && readLittleEndian<quint32>(tail, endRecord - 20) == zip64LocatorSignature)
+    {
+        const quint64 zip64EndOffset = readLittleEndian<quint64>(tail, endRecord - 20 + 8);
+        if (!file.seek(qint64(zip64EndOffset)))
+        {
+            return false;
+        }
+
+        const QByteArray zip64End = file.read(56);
+        if (zip64End.size() != 56 || readLittleEndian<quint32>(zip64End, 0) != zip64EndSignature)
+        {
+            return false;
+        }
+        entryCount = readLittleEndian<quint64>(zip64End, 32);
+        directorySize = readLittleEndian<quint64>(zip64End, 40);
+        directoryOffset = readLittleEndian<quint64>(zip64End, 48);
+    }
+
+    if (directorySize > quint64(maxCentralDirectorySize) || directoryOffset + directorySize > quint64(size)
+        || !file.seek(qint64(directoryOffset)))
+    {
+        return false;
+    }
+
+    const QByteArray directory = file.read(qint64(directorySize));
+    if (directory.size() != qsizetype(directorySize))
+    {
+        return false;
+    }
+
+    qsizetype position = 0;
+    contents.members.reserve(qsizetype(std::min<quint64>(entryCount, quint64(directorySize / zipCentralHeaderSize))));
+
+    for (quint64 i = 0; i < entryCount && position + zipCentralHeaderSize <= directory.size(); ++i)
+    {
+        if (readLittleEndian<quint32>(directory, position) != zipCentralSignature)
+        {
+            break;
+        }
+
+        const quint16 flags = readLittleEndian<quint16>(directory, position + 8);
+        const quint16 method = readLittleEndian<quint16>(directory, position + 10);
+        const quint16 time = readLittleEndian<quint16>(directory, position + 12);
+        const quint16 date = readLittleEndian<quint16>(directory, position + 14);
+        quint64 compressedSize = readLittleEndian<quint32>(directory, position + 20);
+        quint64 uncompressedSize = readLittleEndian<quint32>(directory, position + 24);
+        const quint16 nameLength = readLittleEndian<quint16>(directory, position + 28);
+        const quint16 extraLength = readLittleEndian<quint16>(directory, position + 30);
+        const quint16 commentLength = readLittleEndian<quint16>(directory, position + 32);
+        quint64 localHeaderOffset = readLittleEndian<quint32>(directory, position + 42);
+
+        const qsizetype nameStart = position + zipCentralHeaderSize;
+        const qsizetype extraStart = nameStart + nameLength;
+        const qsizetype next = extraStart + extraLength + commentLength;
+        if (next > directory.size())
+        {
+            break;
+        }
+
+        // Sizes and offsets that do not fit 32 bits are stored in the zip64 extra field, in this order.
+        qsizetype extra = extraStart;
+        while (extra + 4 <= extraStart + extraLength)
+        {
+            const quint16 id = readLittleEndian<quint16>(directory, extra);
+            const quint16 length = readLittleEndian<quint16>(directory, extra + 2);
+            qsizetype field = extra + 4;
+            const qsizetype fieldEnd = std::min<qsizetype>(field + length, extraStart + extraLength);
+
+            if (id == 0x0001)
+            {
+                for (quint64 *value : { &uncompressedSize, &compressedSize, &localHeaderOffset })
+                {
+                    if (*value == 0xFFFFFFFF && field + 8 <= fieldEnd)
+                    {
+                        *value = readLittleEndian<quint64>(directory, field);
+                        field += 8;
+                    }
+                }
+            }
+            extra += 4 + length;
+        }
+
+        const QString name = QString::fromUtf8(directory.constData() + nameStart, nameLength);
+        ArchiveMember member;
+        member.path = normalizedMemberPath(name);
+        member.isDir = name.endsWith('/') || name.endsWith('\\');
+        member.size = qint64(uncompressedSize);
+        member.compressedSize = qint64(compressedSize);
+        member.modifiedMs = dosTimeToMs(time, date);
+        member.dataOffset = qint64(localHeaderOffset);
+        member.method = ((flags & 0x0001) || (method != zipStored && method != zipDeflated)) ? unreadableMethod : method;
+
+        if (!member.path.isEmpty())
+        {
+            contents.members.append(member);
+        }
+        position = next;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Scans the headers of a tar stream and calls the visitor for every listed member. Understands ustar
+ * prefixes, GNU long names and pax path and size records.
+ *
+ * @param device The tar stream, positioned at the first header.
+ * @param visitor Called with the member and the stream positioned at its data. Returns how many data bytes it
+ * consumed, or a negative value to stop the scan; the rest of the data is skipped.
+ * @return False if the stream does not start with a tar header or the visitor stopped the scan.
+ */
+bool ArchiveIndex::scanTar(QIODevice &device, const TarVisitor &visitor)
+{
+    char header[tarBlockSize];
+    qint64 position = 0;
+    QString longName;
+    QString paxPath;
+    qint64 paxSize = -1;
+    bool isValid = false;
+
+    while (device.read(header, tarBlockSize) == tarBlockSize)
+    {
+        position += tarBlockSize;
+
+        if (std::all_of(header, header + tarBlockSize, [](char c) { return c == '\0'; }))
+        {
+            isValid = true;
+            break;
+        }
+        if (!isValidTarHeader(header))
+        {
+            break;
+        }
+        isValid = true;
+
+        const char type = header[156];
+        qint64 size = tarNumber(header + 124, 12);
+        const qint64 paddedSize = (size + tarBlockSize - 1) / tarBlockSize * tarBlockSize;
+
+        if (type == 'L' || type == 'x')
+        {
+            const QByteArray data = device.read(std::min(size, maxTarNameSize));
+            if (data.size() != std::min(size, maxTarNameSize) || device.skip(paddedSize - data.size()) != paddedSize - data.size())
+            {
+                break;
+            }
+            position += paddedSize;
+
+            if (type == 'L')
+            {
+                longName = QString::fromUtf8(data.constData(), qstrnlen(data.constData(), data.size()));
+            }
+            else
+            {
+                parsePaxHeader(data, paxPath, paxSize);
+            }
+            continue;
+        }
+
+        QString name = tarString(header, 100);
+        if (std::memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0')
+        {
+            name = tarString(header + 345, 155) + '/' + name;
+        }
+        if (!longName.isEmpty())
+        {
+            name = longName;
+        }
+        if (!paxPath.isEmpty())
+        {
+            name = paxPath;
+        }
+        if (paxSize >= 0)
+        {
+            size = paxSize;
+        }
+
+        const bool isLink = type == '1' || type == '2';
+        const qint64 dataSize = (isLink || type == '5') ? 0 : size;
+        const qint64 paddedDataSize = (dataSize + tarBlockSize - 1) / tarBlockSize * tarBlockSize;
+        const bool isListed = type == '0' || type == '\0' || type == '7' || type == '5' || isLink;
+
+        ArchiveMember member;
+        member.path = normalizedMemberPath(name);
+        member.isDir = type == '5' || name.endsWith('/');
+        member.isLink = isLink;
+        member.size = dataSize;
+        member.compressedSize = dataSize;
+        member.modifiedMs = tarNumber(header + 136, 12) * 1000;
+        member.dataOffset = position;
+
+        qint64 consumed = 0;
+        if (isListed && !member.path.isEmpty())
+        {
+            consumed = visitor(member, device);
+            if (consumed < 0)
+            {
+                return false;
+            }
+        }
+
+        const qint64 skippedSize = paddedDataSize - std::min(consumed, dataSize);
+        if (device.skip(skippedSize) != skippedSize)
+        {
+            break;
+        }
+        position += paddedDataSize;
+
+        longName.clear();
+        paxPath.clear();
+        paxSize = -1;
+    }
+
+    return isValid;
+}
+
+/**
+ * @brief Collects the members of a tar stream, skipping over their data.
+ */
+bool ArchiveIndex::readTar(QIODevice &device, Contents &contents)
+{
+    return scanTar(device, [&contents](const ArchiveMember &member, QIODevice &)
+                   {
+                       contents.members.append(member);
+                       return qint64(0);
+                   });
+}
+
+/**
+ * @brief Derives the listing of every directory in the archive, including directories that only appear as
+ * parents of members.
+ */
+void ArchiveIndex::buildDirectories(Contents &contents)
+{
+    QHash<QString, QHash<QString, DirectoryEntry>> entries;
+    entries.insert(QString(), {});
+
+    auto parentOf = [](const QString &path)
+    {
+        const qsizetype slash = path.lastIndexOf('/');
+        return slash < 0 ? QString() : path.left(slash);
+    };
+
+    for (int row = 0; row < contents.members.size(); ++row)
+    {
+        const ArchiveMember &member = contents.members.at(row);
+        contents.memberRows.insert(member.path, row);
+
+        if (member.isDir)
+        {
+            entries[member.path];
+        }
+
+        DirectoryEntry entry;
+        entry.name = member.path.mid(member.path.lastIndexOf('/') + 1);
+        entry.isDir = member.isDir;
+        entry.size = member.isDir ? 0 : member.size;
+        entry.modifiedMs = member.modifiedMs;
+        entries[parentOf(member.path)].insert(entry.name, entry);
+
+        // Register the parents that have no member of their own, up to the first one already known.
+        QString path = parentOf(member.path);
+        while (!path.isEmpty())
+        {
+            entries[path];
+
+            const QString parent = parentOf(path);
+            QHash<QString, DirectoryEntry> &siblings = entries[parent];
+            const QString name = path.mid(path.lastIndexOf('/') + 1);
+            if (siblings.contains(name))
+            {
+                break;
+            }
+
+            DirectoryEntry directory;
+            directory.name = name;
+            directory.isDir = true;
+            siblings.insert(name, directory);
+            path = parent;
+        }
+    }
+
+    for (auto directory = entries.cbegin(); directory != entries.cend(); ++directory)
+    {
+        DirectoryListing listing(directory->cbegin(), directory->cend());
+        std::sort(listing.begin(), listing.end(), DirectoryListingCache::entryLessThan);
+        contents.directories.insert(directory.key(), listing);
+    }
+}
@@ -0,0 +1,76 @@
+#ifndef ARCHIVEINDEX_H
+#define ARCHIVEINDEX_H
+
+#include "directorylistingcache.h"
+#include <QCache>
+#include <QHash>
+#include <QIODevice>
+#include <QMutex>
+#include <functional>
+
+struct ArchiveMember
+{
+    QString path;
+    bool isDir = false;
+    bool isLink = false;
+    qint64 size = 0;
+    qint64 compressedSize = 0;
+    qint64 modifiedMs = 0;
+    qint64 dataOffset = 0;
+    quint16 method = 0;
+};
+
+class ArchiveIndex
+{
+public:
+    enum Format
+    {
+        NotAnArchive,
+        Zip,
+        Tar,
+        TarGz
+    };
+
+    using TarVisitor = std::function<qint64(const ArchiveMember &member, QIODevice &data)>;
+
+    static ArchiveIndex& instance();
+
+    static Format formatForName(const QString &fileName);
+    static bool splitPath(const QString &path, QString &archivePath, QString &memberPath);
+    static bool isInsideArchive(const QString &path);
+    static QString diskDirectory(const QString &path);
+    static QIODevice* openMember(const QString &archivePath, Format format, const ArchiveMember &member);
+    static bool scanTar(QIODevice &device, const TarVisitor &visitor);
+
+    bool isCached(const QString &path);
+    bool preload(const QString &path);
+    bool isDirectory(const QString &path);
+    bool listing(const QString &path, DirectoryListing &listing);
+    bool members(const QString &archivePath, QList<ArchiveMember> &members, Format &format);
+    QIODevice* openMember(const QString &path);
+
+private:
+    ArchiveIndex();
+    ~ArchiveIndex();
+
+    struct Contents
+    {
+        Format format = NotAnArchive;
+        qint64 archiveSize = -1;
+        qint64 archiveModifiedMs = -1;
+        QList<ArchiveMember> members;
+        QHash<QString, int> memberRows;
+        QHash<QString, DirectoryListing> directories;
+    };
+
+    QCache<QString, Contents> cache;
+    QMutex mutex;
+
+    template <typename Visitor>
+    bool visit(const QString &archivePath, Visitor visitor);
+    static bool readZip(const QString &archivePath, Contents &contents);
+    static bool readTar(QIODevice &device, Contents &contents);
+    static void buildDirectories(Contents &contents);
+};
+
+#endif // ARCHIVEINDEX_H
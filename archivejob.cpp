@@ -0,0 +1,774 @@
+#include "archivejob.h"
+#include "archivememberdevice.h"
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QThread>
+#include <QTimeZone>
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/**
+ * @file archivejob.h
+ * @brief The ArchiveJob class packs files into a tar.gz archive or unpacks an archive, as a background job.
+ * Compression is a pipeline: the job thread walks the selection and cuts the tar stream into chunks, the worker
+ * pool compresses every chunk into an independent gzip member and a single writer appends the members in order.
+ * Concatenated gzip members are one valid gzip file, so any gzip reader can open the result. A semaphore bounds
+ * the chunks in flight, which keeps memory flat when the disk is slower than the compressors. Without zlib the
+ * same pipeline writes a plain tar.
+ * Zip members are extracted in parallel, one worker task each. A tar stream can only be decoded in order, so the
+ * job thread reads it and hands small files to the worker pool for writing. Links inside archives are not
+ * recreated, and a cancelled extraction removes the folder it created.
+ */
+
+namespace
+{
+const qint64 chunkSize = 1024 * 1024;
+const qint64 tarBlockSize = 512;
+const qint64 copyBufferSize = 256 * 1024;
+const qint64 smallFileSize = 1024 * 1024;
+const qsizetype maxTarLinkSize = 100;
+const int slotsPerThread = 2;
+const int slotWaitMs = 100;
+const int progressPollMs = 100;
+
+QString joinPath(const QString &directory, const QString &name)
+{
+    return directory.endsWith('/') ? directory + name : directory + '/' + name;
+}
+
+QString operationTitle(ArchiveJob::Operation operation, const QStringList &sources)
+{
+    if (operation == ArchiveJob::Compress)
+    {
+        return QObject::tr("Compressing %n item(s)", nullptr, int(sources.size()));
+    }
+    return QObject::tr("Extracting %1").arg(QFileInfo(sources.value(0)).fileName());
+}
+
+/**
+ * @brief Returns the archive name without its archive suffix, which names the folder it is extracted into.
+ */
+QString archiveBaseName(const QString &fileName)
+{
+    for (const char *suffix : { ".tar.gz", ".tgz", ".tar", ".zip" })
+    {
+        if (fileName.endsWith(QLatin1String(suffix), Qt::CaseInsensitive) && fileName.size() > qsizetype(std::strlen(suffix)))
+        {
+            return fileName.chopped(qsizetype(std::strlen(suffix)));
+        }
+    }
+    return QFileInfo(fileName).completeBaseName();
+}
+
+/**
+ * @brief Returns a path for a new entry in the directory, numbering the name if it is taken.
+ */
+QString uniquePath(const QString &directory, const QString &baseName, const QString &suffix)
+{
+    QString path = joinPath(directory, baseName + suffix);
+    for (int counter = 2; QFileInfo::exists(path); ++counter)
+    {
+        path = joinPath(directory, QString("%1 (%2)%3").arg(baseName).arg(counter).arg(suffix));
+    }
+    return path;
+}
+
+uint permissionsToMode(QFile::Permissions permissions)
+{
+    const uint bits = uint(permissions);
+    return (((bits >> 12) & 7) << 6) | (((bits >> 4) & 7) << 3) | (bits & 7);
+}
+
+/**
+ * @brief Writes a numeric tar header field as octal text, or in base-256 if the value does not fit.
+ */
+void writeTarNumber(char *field, int length, qint64 value)
+{
+    if (value < (qint64(1) << (3 * (length - 1))))
+    {
+        for (int i = length - 2; i >= 0; --i)
+        {
+            field[i] = char('0' + (value & 7));
+            value >>= 3;
+        }
+        field[length - 1] = '\0';
+        return;
+    }
+
+    for (int i = length - 1; i > 0; --i)
+    {
+        field[i] = char(value & 0xFF);
+        value >>= 8;
+    }
+    field[0] = char(0x80);
+}
+
+QByteArray tarHeader(const QByteArray &name, const QByteArray &prefix, char type, qint64 size, uint mode, qint64 modifiedSecs,
+                     const QByteArray &linkName)
+{
+    QByteArray header(tarBlockSize, '\0');
+    char *block = header.data();
+
+    std::memcpy(block, name.constData(), std::min<qsizetype>(name.size(), 100));
+    writeTarNumber(block + 100, 8, mode & 07777);
+    writeTarNumber(block + 108, 8, 0);
+    writeTarNumber(block + 116, 8, 0);
+    writeTarNumber(block + 124, 12, size);
+    writeTarNumber(block + 136, 12, std::max<qint64>(modifiedSecs, 0));
+    block[156] = type;
+    std::memcpy(block + 157, linkName.constData(), std::min<qsizetype>(linkName.size(), 100));
+    std::memcpy(block + 257, "ustar", 6);
+    std::memcpy(block + 263, "00", 2);
+    std::memcpy(block + 345, prefix.constData(), std::min<qsizetype>(prefix.size(), 155));
+
+    std::memset(block + 148, ' ', 8);
+    qint64 sum = 0;
+    for (int i = 0; i < tarBlockSize; ++i)
+    {
+        sum += uchar(block[i]);
+    }
+    writeTarNumber(block + 148, 7, sum);
+    return header;
+}
+
+/**
+ * @brief Appends the header of a member. Names longer than 100 bytes are split into the ustar prefix where
+ * possible, otherwise they are preceded by a GNU long name record.
+ */
+void appendTarHeader(QByteArray &output, const QString &path, char type, qint64 size, uint mode, qint64 modifiedSecs,
+                     const QByteArray &linkName)
+{
+    const QByteArray name = path.toUtf8();
+    if (name.size() <= 100)
+    {
+        output += tarHeader(name, QByteArray(), type, size, mode, modifiedSecs, linkName);
+        return;
+    }
+
+    const qsizetype slash = name.indexOf('/', name.size() - 101);
+    if (slash > 0 && slash <= 155 && slash < name.size() - 1)
+    {
+        output += tarHeader(name.mid(slash + 1), name.left(slash), type, size, mode, modifiedSecs, linkName);
+        return;
+    }
+
+    const qint64 recordSize = name.size() + 1;
+    output += tarHeader("././@LongLink", QByteArray(), 'L', recordSize, 0644, 0, QByteArray());
+    output += name;
+    output += QByteArray(recordSize % tarBlockSize == 0 ? 1 : 1 + tarBlockSize - recordSize % tarBlockSize, '\0');
+    output += tarHeader(name.left(100), QByteArray(), type, size, mode, modifiedSecs, linkName);
+}
+
+/**
+ * @brief Compresses a chunk into a complete gzip member.
+ *
+ * @return The member, or an empty array if zlib failed or is not available.
+ */
+QByteArray compressedChunk(const QByteArray &data)
+{
+#ifdef HAVE_ZLIB
+    z_stream stream = {};
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    {
+        return QByteArray();
+    }
+
+    QByteArray output(qsizetype(deflateBound(&stream, uLong(data.size()))), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = uInt(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(output.data());
+    stream.avail_out = uInt(output.size());
+
+    const int result = deflate(&stream, Z_FINISH);
+    output.resize(qsizetype(stream.total_out));
+    deflateEnd(&stream);
+    return result == Z_STREAM_END ? output : QByteArray();
+#else
+    Q_UNUSED(data);
+    return QByteArray();
+#endif
+}
+
+void setModificationTime(QFile &file, qint64 modifiedMs)
+{
+    if (modifiedMs > 0 && file.flush())
+    {
+        file.setFileTime(QDateTime::fromMSecsSinceEpoch(modifiedMs, QTimeZone::UTC), QFileDevice::FileModificationTime);
+    }
+}
+
+bool writeFile(const QString &path, const QByteArray &content, qint64 modifiedMs)
+{
+    QFile output(path);
+    if (!output.open(QIODevice::WriteOnly) || output.write(content) != content.size())
+    {
+        return false;
+    }
+    setModificationTime(output, modifiedMs);
+    return true;
+}
+
+/**
+ * @brief Streams a member into a new file.
+ *
+ * @return The number of bytes read from the input. isWritten is true if the whole member was written.
+ */
+qint64 copyToFile(QIODevice &input, qint64 size, const QString &path, qint64 modifiedMs, const BackgroundJob &job, bool &isWritten)
+{
+    isWritten = false;
+    QFile output(path);
+    if (!output.open(QIODevice::WriteOnly))
+    {
+        return 0;
+    }
+
+    QByteArray buffer(copyBufferSize, Qt::Uninitialized);
+    qint64 consumed = 0;
+    while (consumed < size && !job.isCancelled())
+    {
+        const qint64 count = input.read(buffer.data(), std::min(size - consumed, copyBufferSize));
+        if (count <= 0)
+        {
+            break;
+        }
+        consumed += count;
+        if (output.write(buffer.constData(), count) != count)
+        {
+            output.remove();
+            return consumed;
+        }
+    }
+
+    isWritten = consumed == size;
+    setModificationTime(output, modifiedMs);
+    return consumed;
+}
+}
+
+ArchiveJob::ArchiveJob(Operation operation, const QStringList &sources, const QString &target, QObject *parent)
+    : BackgroundJob(operationTitle(operation, sources), parent), archiveOperation(operation), sourcePaths(sources),
+      targetPath(target), freeSlots(slotsPerThread * QThread::idealThreadCount()), chunkCount(0), isReadingDone(false),
+      hasWriteError(false), bytesDone(0)
+{
+    workerPool.setMaxThreadCount(QThread::idealThreadCount());
+    writerPool.setMaxThreadCount(1);
+}
+
+/**
+ * @brief Creates a job packing the given files and directories into an archive. The archive is gzip compressed
+ * if its name ends in .tar.gz or .tgz.
+ */
+ArchiveJob* ArchiveJob::compressItems(const QStringList &paths, const QString &archivePath)
+{
+    return new ArchiveJob(Compress, paths, archivePath);
+}
+
+/**
+ * @brief Creates a job unpacking an archive into a new folder, named after the archive, in the destination directory.
+ */
+ArchiveJob* ArchiveJob::extractArchive(const QString &archivePath, const QString &destinationDirectory)
+{
+    return new ArchiveJob(Extract, { archivePath }, destinationDirectory);
+}
+
+/**
+ * @brief Returns an unused archive path next to the given items, named after the item if there is only one.
+ */
+QString ArchiveJob::defaultArchivePath(const QStringList &paths)
+{
+    const QFileInfo first(paths.value(0));
+    const QString directory = first.absolutePath();
+    QString baseName = paths.size() == 1 ? (first.isDir() ? first.fileName() : first.completeBaseName()) : QDir(directory).dirName();
+    if (baseName.isEmpty())
+    {
+        baseName = tr("Archive");
+    }
+
+    const bool isCompressed = ArchiveMemberDevice::isEncodingSupported(ArchiveMemberDevice::Gzip);
+    return uniquePath(directory, baseName, isCompressed ? ".tar.gz" : ".tar");
+}
+
+ArchiveJob::Operation ArchiveJob::operation() const
+{
+    return archiveOperation;
+}
+
+/**
+ * @brief Returns the archive or the folder the job created, or an empty path if it created nothing.
+ */
+QString ArchiveJob::createdPath() const
+{
+    return created;
+}
+
+QStringList ArchiveJob::failedPaths() const
+{
+    return failed;
+}
+
+void ArchiveJob::execute()
+{
+    if (archiveOperation == Compress)
+    {
+        compress();
+    }
+    else
+    {
+        extract();
+    }
+}
+
+/**
+ * @brief Reads the selection into tar chunks on the job thread, while the worker pool compresses them and the
+ * writer task saves them. The archive only replaces its target once every chunk was written.
+ */
+void ArchiveJob::compress()
+{
+    const bool isCompressed = ArchiveIndex::formatForName(targetPath) == ArchiveIndex::TarGz;
+    qint64 totalSize = 0;
+    const QList<SourceEntry> entries = collectSources(totalSize);
+
+    QSaveFile output(targetPath);
+    if (isCancelled() || !output.open(QIODevice::WriteOnly))
+    {
+        if (!isCancelled())
+        {
+            addFailure(targetPath);
+        }
+        return;
+    }
+
+    writerPool.start([this, &output]()
+                     {
+                         writeChunks(output);
+                     });
+
+    QByteArray chunk;
+    chunk.reserve(chunkSize + 4 * tarBlockSize);
+    qint64 bytesRead = 0;
+
+    for (const SourceEntry &entry : entries)
+    {
+        if (isCancelled() || hasWriteError)
+        {
+            break;
+        }
+
+        QFile file(entry.path);
+        const QByteArray linkName = entry.linkTarget.toUtf8();
+        if ((entry.type == '0' && !file.open(QIODevice::ReadOnly)) || linkName.size() > maxTarLinkSize)
+        {
+            addFailure(entry.path);
+            continue;
+        }
+
+        appendTarHeader(chunk, entry.name, entry.type, entry.size, entry.mode, entry.modifiedSecs, linkName);
+
+        bool isTruncated = false;
+        qint64 remaining = entry.size;
+        while (remaining > 0 && !isCancelled() && !hasWriteError)
+        {
+            if (chunk.size() >= chunkSize)
+            {
+                submitChunk(chunk, isCompressed);
+            }
+
+            const qint64 count = std::min(remaining, chunkSize - qint64(chunk.size()));
+            const qsizetype start = chunk.size();
+            chunk.resize(start + count);
+
+            const qint64 read = isTruncated ? 0 : std::max<qint64>(file.read(chunk.data() + start, count), 0);
+            if (read < count)
+            {
+                // The file shrank while it was read; pad it to the size in its header.
+                std::memset(chunk.data() + start + read, 0, size_t(count - read));
+                if (!isTruncated)
+                {
+                    addFailure(entry.path);
+                    isTruncated = true;
+                }
+            }
+
+            remaining -= count;
+            bytesRead += count;
+            reportProgress(bytesRead, totalSize);
+        }
+
+        chunk += QByteArray((tarBlockSize - entry.size % tarBlockSize) % tarBlockSize, '\0');
+        if (chunk.size() >= chunkSize)
+        {
+            submitChunk(chunk, isCompressed);
+        }
+    }
+
+    chunk += QByteArray(2 * tarBlockSize, '\0');
+    submitChunk(chunk, isCompressed);
+
+    {
+        QMutexLocker locker(&chunkMutex);
+        isReadingDone = true;
+    }
+    chunkReady.wakeAll();
+    workerPool.waitForDone();
+    writerPool.waitForDone();
+
+    if (isCancelled() || hasWriteError)
+    {
+        output.cancelWriting();
+        if (!isCancelled())
+        {
+            addFailure(targetPath);
+        }
+        return;
+    }
+
+    if (!output.commit())
+    {
+        addFailure(targetPath);
+        return;
+    }
+    created = targetPath;
+    reportProgress(totalSize, totalSize);
+}
+
+/**
+ * @brief Lists every entry below the selected items, including hidden ones. Symbolic links are stored as links,
+ * and other special files are skipped.
+ *
+ * @param totalSize Receives the size of all files, for the progress.
+ */
+QList<ArchiveJob::SourceEntry> ArchiveJob::collectSources(qint64 &totalSize)
+{
+    QList<SourceEntry> entries;
+    auto add = [&entries, &totalSize](const QFileInfo &fileInfo, const QString &name)
+    {
+        SourceEntry entry;
+        entry.path = fileInfo.filePath();
+        entry.name = name;
+        entry.modifiedSecs = fileInfo.lastModified(QTimeZone::UTC).toSecsSinceEpoch();
+        entry.mode = permissionsToMode(fileInfo.permissions());
+
+        if (fileInfo.isSymLink())
+        {
+            entry.type = '2';
+            entry.linkTarget = QDir(fileInfo.absolutePath()).relativeFilePath(fileInfo.symLinkTarget());
+        }
+        else if (fileInfo.isDir())
+        {
+            entry.type = '5';
+            entry.name += '/';
+        }
+        else if (fileInfo.isFile())
+        {
+            entry.size = fileInfo.size();
+            totalSize += entry.size;
+        }
+        else
+        {
+            return;
+        }
+        entries.append(entry);
+    };
+
+    for (const QString &sourcePath : std::as_const(sourcePaths))
+    {
+        const QFileInfo fileInfo(sourcePath);
+        if (!fileInfo.exists() && !fileInfo.isSymLink())
+        {
+            addFailure(sourcePath);
+            continue;
+        }
+
+        add(fileInfo, fileInfo.fileName());
+        if (!fileInfo.isDir() || fileInfo.isSymLink())
+        {
+            continue;
+        }
+
+        const QDir base = fileInfo.dir();
+        QDirIterator iterator(sourcePath, QDir::AllEntries | QDir::Hidden | QDir::System | QDir::NoDotAndDotDot,
+                              QDirIterator::Subdirectories);
+        while (iterator.hasNext() && !isCancelled())
+        {
+            const QFileInfo child = iterator.nextFileInfo();
+            add(child, base.relativeFilePath(child.filePath()));
+        }
+    }
+
+    return entries;
+}
+
+/**
+ * @brief Waits for room in the pipeline, giving up when the job is cancelled or writing failed.
+ */
+bool ArchiveJob::acquireSlot()
+{
+    while (!freeSlots.tryAcquire(1, slotWaitMs))
+    {
+        if (isCancelled() || hasWriteError)
+        {
+            return false;
+        }
+    }
+    return !isCancelled() && !hasWriteError;
+}
+
+/**
+ * @brief Hands a chunk of the tar stream to the worker pool and starts a new one.
+ */
+void ArchiveJob::submitChunk(QByteArray &chunk, bool isCompressed)
+{
+    if (!chunk.isEmpty() && acquireSlot())
+    {
+        const qint64 sequence = chunkCount++;
+        workerPool.start([this, sequence, data = chunk, isCompressed]()
+                         {
+                             const QByteArray output = isCompressed ? compressedChunk(data) : data;
+                             {
+                                 QMutexLocker locker(&chunkMutex);
+                                 finishedChunks.insert(sequence, output);
+                             }
+                             chunkReady.wakeAll();
+                         });
+    }
+
+    chunk = QByteArray();
+    chunk.reserve(chunkSize + 4 * tarBlockSize);
+}
+
+/**
+ * @brief Writes the finished chunks in sequence until the reader is done. Runs on the writer pool.
+ */
+void ArchiveJob::writeChunks(QIODevice &output)
+{
+    for (qint64 sequence = 0; ; ++sequence)
+    {
+        QByteArray data;
+        {
+            QMutexLocker locker(&chunkMutex);
+            while (!finishedChunks.contains(sequence) && !(isReadingDone && sequence >= chunkCount))
+            {
+                if (isCancelled() || hasWriteError)
+                {
+                    return;
+                }
+                chunkReady.wait(&chunkMutex, slotWaitMs);
+            }
+
+            if (!finishedChunks.contains(sequence))
+            {
+                return;
+            }
+            data = finishedChunks.take(sequence);
+        }
+
+        const bool isWritten = !data.isEmpty() && output.write(data) == data.size();
+        freeSlots.release();
+        if (!isWritten)
+        {
+            hasWriteError = true;
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Unpacks the archive into a new folder next to it. A cancelled extraction removes the folder again.
+ */
+void ArchiveJob::extract()
+{
+    const QString archivePath = sourcePaths.value(0);
+    const ArchiveIndex::Format format = ArchiveIndex::formatForName(QFileInfo(archivePath).fileName());
+    const QString root = uniquePath(targetPath, archiveBaseName(QFileInfo(archivePath).fileName()), QString());
+
+    if (format == ArchiveIndex::NotAnArchive || !QDir().mkpath(root))
+    {
+        addFailure(archivePath);
+        return;
+    }
+    created = root;
+
+    bool isComplete = false;
+    if (format == ArchiveIndex::Zip)
+    {
+        QList<ArchiveMember> members;
+        ArchiveIndex::Format listedFormat = ArchiveIndex::NotAnArchive;
+        isComplete = ArchiveIndex::instance().members(archivePath, members, listedFormat) && extractZip(archivePath, root, members);
+    }
+    else
+    {
+        isComplete = extractTar(archivePath, format, root);
+    }
+
+    if (isCancelled())
+    {
+        QDir(root).removeRecursively();
+        created.clear();
+        return;
+    }
+    if (!isComplete)
+    {
+        addFailure(archivePath);
+    }
+}
+
+/**
+ * @brief Creates the directories of a zip archive, then extracts its files in parallel on the worker pool.
+ */
+bool ArchiveJob::extractZip(const QString &archivePath, const QString &root, const QList<ArchiveMember> &members)
+{
+    qint64 totalSize = 0;
+    QSet<QString> directories;
+    for (const ArchiveMember &member : members)
+    {
+        const QString path = joinPath(root, member.path);
+        directories.insert(member.isDir ? path : QFileInfo(path).path());
+        totalSize += member.compressedSize;
+    }
+
+    for (const QString &directory : std::as_const(directories))
+    {
+        if (!QDir().mkpath(directory))
+        {
+            addFailure(directory);
+        }
+    }
+
+    for (const ArchiveMember &member : members)
+    {
+        if (member.isDir)
+        {
+            continue;
+        }
+
+        workerPool.start([this, archivePath, root, member]()
+                         {
+                             if (isCancelled())
+                             {
+                                 return;
+                             }
+
+                             const QString path = joinPath(root, member.path);
+                             std::unique_ptr<QIODevice> input(ArchiveIndex::openMember(archivePath, ArchiveIndex::Zip, member));
+                             bool isWritten = false;
+                             if (input)
+                             {
+                                 copyToFile(*input, member.size, path, member.modifiedMs, *this, isWritten);
+                             }
+                             if (!isWritten && !isCancelled())
+                             {
+                                 addFailure(path);
+                             }
+                             bytesDone += member.compressedSize;
+                         });
+    }
+
+    while (!workerPool.waitForDone(progressPollMs))
+    {
+        reportProgress(bytesDone, totalSize);
+    }
+    reportProgress(bytesDone, totalSize);
+    return true;
+}
+
+/**
+ * @brief Reads a tar or tar.gz archive in order. Small files are handed to the worker pool for writing, larger
+ * ones are streamed to disk by the job thread.
+ */
+bool ArchiveJob::extractTar(const QString &archivePath, ArchiveIndex::Format format, const QString &root)
+{
+    QFile file(archivePath);
+    ArchiveMemberDevice gzip(archivePath, 0, -1, ArchiveMemberDevice::Gzip);
+    QIODevice &input = format == ArchiveIndex::TarGz ? static_cast<QIODevice&>(gzip) : file;
+    if (!input.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 archiveSize = QFileInfo(archivePath).size();
+    QSet<QString> directories;
+    auto makeDirectory = [&directories](const QString &directory)
+    {
+        if (directories.contains(directory))
+        {
+            return true;
+        }
+        if (!QDir().mkpath(directory))
+        {
+            return false;
+        }
+        directories.insert(directory);
+        return true;
+    };
+
+    const bool isComplete = ArchiveIndex::scanTar(input, [&](const ArchiveMember &member, QIODevice &data) -> qint64
+    {
+        if (isCancelled())
+        {
+            return -1;
+        }
+        reportProgress(format == ArchiveIndex::TarGz ? gzip.sourcePosition() : file.pos(), archiveSize);
+
+        const QString path = joinPath(root, member.path);
+        if (member.isLink)
+        {
+            return 0;
+        }
+        if (!makeDirectory(member.isDir ? path : QFileInfo(path).path()))
+        {
+            addFailure(path);
+            return 0;
+        }
+        if (member.isDir)
+        {
+            return 0;
+        }
+
+        if (member.size <= smallFileSize)
+        {
+            const QByteArray content = data.read(member.size);
+            if (content.size() != member.size || !acquireSlot())
+            {
+                return -1;
+            }
+
+            workerPool.start([this, path, content, modifiedMs = member.modifiedMs]()
+                             {
+                                 if (!writeFile(path, content, modifiedMs))
+                                 {
+                                     addFailure(path);
+                                 }
+                                 freeSlots.release();
+                             });
+            return content.size();
+        }
+
+        bool isWritten = false;
+        const qint64 consumed = copyToFile(data, member.size, path, member.modifiedMs, *this, isWritten);
+        if (!isWritten && !isCancelled())
+        {
+            addFailure(path);
+        }
+        return consumed;
+    });
+
+    workerPool.waitForDone();
+    reportProgress(archiveSize, archiveSize);
+    return isComplete || isCancelled();
+}
+
+void ArchiveJob::addFailure(const QString &path)
+{
+    QMutexLocker locker(&failedMutex);
+    failed << path;
+}
@@ -0,0 +1,78 @@
+#ifndef ARCHIVEJOB_H
+#define ARCHIVEJOB_H
+
+#include "backgroundjob.h"
+#include "archiveindex.h"
+#include <QMap>
+#include <QMutex>
+#include <QSemaphore>
+#include <QStringList>
+#include <QThreadPool>
+#include <QWaitCondition>
+#include <atomic>
+
+class ArchiveJob : public BackgroundJob
+{
+    Q_OBJECT
+public:
+    enum Operation
+    {
+        Compress,
+        Extract
+    };
+
+    ArchiveJob(Operation operation, const QStringList &sources, const QString &target, QObject *parent = nullptr);
+
+    static ArchiveJob* compressItems(const QStringList &paths, const QString &archivePath);
+    static ArchiveJob* extractArchive(const QString &archivePath, const QString &destinationDirectory);
+    static QString defaultArchivePath(const QStringList &paths);
+
+    Operation operation() const;
+    QString createdPath() const;
+    QStringList failedPaths() const;
+
+protected:
+    void execute() override;
+
+private:
+    struct SourceEntry
+    {
+        QString path;
+        QString name;
+        char type = '0';
+        qint64 size = 0;
+        qint64 modifiedSecs = 0;
+        uint mode = 0644;
+        QString linkTarget;
+    };
+
+    Operation archiveOperation;
+    QStringList sourcePaths;
+    QString targetPath;
+    QString created;
+    QStringList failed;
+    QMutex failedMutex;
+
+    QThreadPool workerPool;
+    QThreadPool writerPool;
+    QSemaphore freeSlots;
+    QMutex chunkMutex;
+    QWaitCondition chunkReady;
+    QMap<qint64, QByteArray> finishedChunks;
+    qint64 chunkCount;
+    bool isReadingDone;
+    std::atomic_bool hasWriteError;
+    std::atomic<qint64> bytesDone;
+
+    void compress();
+    void extract();
+    bool extractZip(const QString &archivePath, const QString &root, const QList<ArchiveMember> &members);
+    bool extractTar(const QString &archivePath, ArchiveIndex::Format format, const QString &root);
+    QList<SourceEntry> collectSources(qint64 &totalSize);
+    bool acquireSlot();
+    void submitChunk(QByteArray &chunk, bool isCompressed);
+    void writeChunks(QIODevice &output);
+    void addFailure(const QString &path);
+};
+
+#endif // ARCHIVEJOB_H
@@ -0,0 +1,273 @@
+#include "archivememberdevice.h"
+#include <algorithm>
+#include <climits>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+/**
+ * @file archivememberdevice.h
+ * @brief The ArchiveMemberDevice class streams one member of an archive without unpacking anything to disk.
+ * It reads a byte range of the archive file, inflates it if the member is compressed, and can discard a number
+ * of leading decoded bytes, which is how a member of a compressed tar is reached. Concatenated gzip streams, as
+ * written by parallel compressors, are read as one. Compressed encodings need zlib (HAVE_ZLIB).
+ */
+
+namespace
+{
+const qint64 inputBufferSize = 64 * 1024;
+const qint64 discardBufferSize = 16 * 1024;
+}
+
+struct ArchiveMemberDevice::Inflater
+{
+#ifdef HAVE_ZLIB
+    z_stream stream = {};
+#endif
+    QByteArray input;
+    bool isStreamEnded = false;
+};
+
+/**
+ * @brief Creates a device for a byte range of an archive.
+ *
+ * @param archivePath The archive file.
+ * @param sourceOffset Where the encoded data starts in the archive.
+ * @param sourceSize The length of the encoded data, -1 up to the end of the file.
+ * @param encoding How the data is encoded.
+ * @param skippedBytes Decoded bytes discarded before the member starts.
+ * @param memberSize The decoded length of the member, -1 up to the end of the stream.
+ * @param parent The parent object.
+ */
+ArchiveMemberDevice::ArchiveMemberDevice(const QString &archivePath, qint64 sourceOffset, qint64 sourceSize, Encoding encoding,
+                                         qint64 skippedBytes, qint64 memberSize, QObject *parent)
+    : QIODevice(parent), archive(archivePath), offset(sourceOffset), sourceRemaining(sourceSize), sourceEncoding(encoding),
+      skipRemaining(skippedBytes), remaining(memberSize)
+{
+}
+
+ArchiveMemberDevice::~ArchiveMemberDevice()
+{
+    close();
+}
+
+/**
+ * @brief Returns false for compressed encodings when the application is built without zlib.
+ */
+bool ArchiveMemberDevice::isEncodingSupported(Encoding encoding)
+{
+#ifdef HAVE_ZLIB
+    Q_UNUSED(encoding);
+    return true;
+#else
+    return encoding == Stored;
+#endif
+}
+
+/**
+ * @brief Returns how far the archive file has been read, which tracks progress through a compressed stream.
+ */
+qint64 ArchiveMemberDevice::sourcePosition() const
+{
+    return archive.pos();
+}
+
+bool ArchiveMemberDevice::open(OpenMode mode)
+{
+    if ((mode & WriteOnly) || !isEncodingSupported(sourceEncoding))
+    {
+        setErrorString(tr("Unsupported archive encoding"));
+        return false;
+    }
+
+    if (!archive.open(QIODevice::ReadOnly) || !archive.seek(offset))
+    {
+        setErrorString(archive.errorString());
+        return false;
+    }
+
+    if (sourceEncoding != Stored)
+    {
+        inflater = std::make_unique<Inflater>();
+        inflater->input.resize(inputBufferSize);
+#ifdef HAVE_ZLIB
+        if (inflateInit2(&inflater->stream, sourceEncoding == RawDeflate ? -MAX_WBITS : 16 + MAX_WBITS) != Z_OK)
+        {
+            inflater.reset();
+            archive.close();
+            return false;
+        }
+#endif
+    }
+
+    isFinished = remaining == 0;
+    return QIODevice::open(QIODevice::ReadOnly);
+}
+
+void ArchiveMemberDevice::close()
+{
+    if (inflater)
+    {
+#ifdef HAVE_ZLIB
+        inflateEnd(&inflater->stream);
+#endif
+        inflater.reset();
+    }
+
+    archive.close();
+    if (isOpen())
+    {
+        QIODevice::close();
+    }
+}
+
+bool ArchiveMemberDevice::isSequential() const
+{
+    return true;
+}
+
+bool ArchiveMemberDevice::atEnd() const
+{
+    return !isOpen() || (isFinished && QIODevice::bytesAvailable() == 0);
+}
+
+qint64 ArchiveMemberDevice::bytesAvailable() const
+{
+    if (isFinished)
+    {
+        return QIODevice::bytesAvailable();
+    }
+    return QIODevice::bytesAvailable() + (remaining >= 0 ? remaining : 1);
+}
+
+qint64 ArchiveMemberDevice::readData(char *data, qint64 maxSize)
+{
+    if (isFinished)
+    {
+        return -1;
+    }
+
+    char discarded[discardBufferSize];
+    while (skipRemaining > 0)
+    {
+        const qint64 count = decode(discarded, std::min(skipRemaining, discardBufferSize));
+        if (count <= 0)
+        {
+            isFinished = true;
+            return -1;
+        }
+        skipRemaining -= count;
+    }
+
+    if (remaining >= 0)
+    {
+        maxSize = std::min(maxSize, remaining);
+    }
+
+    const qint64 count = decode(data, maxSize);
+    if (count <= 0)
+    {
+        isFinished = true;
+        return -1;
+    }
+
+    if (remaining >= 0)
+    {
+        remaining -= count;
+        isFinished = remaining == 0;
+    }
+    return count;
+}
+
+qint64 ArchiveMemberDevice::writeData(const char *data, qint64 maxSize)
+{
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+}
+
+/**
+ * @brief Decodes up to maxSize bytes. Fewer are only returned at the end of the stream, so readers asking for a
+ * fixed-size block, like tar headers, never see a short read in the middle of the data.
+ *
+ * @return The number of decoded bytes, 0 at the end of the stream or -1 on corrupt data.
+ */
+qint64 ArchiveMemberDevice::decode(char *data, qint64 maxSize)
+{
+    if (sourceEncoding == Stored)
+    {
+        return readSource(data, maxSize);
+    }
+
+#ifdef HAVE_ZLIB
+    z_stream &stream = inflater->stream;
+    const uInt outputSize = uInt(std::min<qint64>(maxSize, UINT_MAX));
+    stream.next_out = reinterpret_cast<Bytef*>(data);
+    stream.avail_out = outputSize;
+
+    auto refill = [this, &stream]()
+    {
+        const qint64 count = readSource(inflater->input.data(), inputBufferSize);
+        stream.next_in = reinterpret_cast<Bytef*>(inflater->input.data());
+        stream.avail_in = uInt(std::max<qint64>(count, 0));
+        return count > 0;
+    };
+
+    while (!inflater->isStreamEnded && stream.avail_out > 0)
+    {
+        if (stream.avail_in == 0 && !refill())
+        {
+            inflater->isStreamEnded = true;
+            break;
+        }
+
+        const int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+        {
+            // Parallel gzip writers concatenate independent streams; keep reading if more follow.
+            if (sourceEncoding == Gzip && (stream.avail_in > 0 || refill()))
+            {
+                inflateReset(&stream);
+            }
+            else
+            {
+                inflater->isStreamEnded = true;
+            }
+        }
+        else if (result != Z_OK && result != Z_BUF_ERROR)
+        {
+            setErrorString(tr("Corrupt compressed data"));
+            return -1;
+        }
+    }
+
+    return qint64(outputSize - stream.avail_out);
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(maxSize);
+    return -1;
+#endif
+}
+
+/**
+ * @brief Reads encoded bytes from the archive, at most up to the end of the member's byte range.
+ */
+qint64 ArchiveMemberDevice::readSource(char *data, qint64 maxSize)
+{
+    if (sourceRemaining == 0)
+    {
+        return 0;
+    }
+    if (sourceRemaining > 0)
+    {
+        maxSize = std::min(maxSize, sourceRemaining);
+    }
+
+    const qint64 count = archive.read(data, maxSize);
+    if (count > 0 && sourceRemaining > 0)
+    {
+        sourceRemaining -= count;
+    }
+    return std::max<qint64>(count, 0);
+}
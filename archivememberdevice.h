@@ -0,0 +1,53 @@
+#ifndef ARCHIVEMEMBERDEVICE_H
+#define ARCHIVEMEMBERDEVICE_H
+
+#include <QIODevice>
+#include <QFile>
+#include <memory>
+
+class ArchiveMemberDevice : public QIODevice
+{
+    Q_OBJECT
+public:
+    enum Encoding
+    {
+        Stored,
+        RawDeflate,
+        Gzip
+    };
+
+    ArchiveMemberDevice(const QString &archivePath, qint64 sourceOffset, qint64 sourceSize, Encoding encoding,
+                        qint64 skippedBytes = 0, qint64 memberSize = -1, QObject *parent = nullptr);
+    ~ArchiveMemberDevice();
+
+    static bool isEncodingSupported(Encoding encoding);
+
+    qint64 sourcePosition() const;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+    bool isSequential() const override;
+    bool atEnd() const override;
+    qint64 bytesAvailable() const override;
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+    qint64 writeData(const char *data, qint64 maxSize) override;
+
+private:
+    struct Inflater;
+
+    QFile archive;
+    qint64 offset;
+    qint64 sourceRemaining;
+    Encoding sourceEncoding;
+    qint64 skipRemaining;
+    qint64 remaining;
+    bool isFinished = false;
+    std::unique_ptr<Inflater> inflater;
+
+    qint64 decode(char *data, qint64 maxSize);
+    qint64 readSource(char *data, qint64 maxSize);
+};
+
+#endif // ARCHIVEMEMBERDEVICE_H
@@ -0,0 +1,69 @@
+#include "backgroundjob.h"
+
+/**
+ * @file backgroundjob.h
+ * @brief The BackgroundJob class is the base of long running operations executed by the JobQueue.
+ * Subclasses implement execute(), poll isCancelled() and report progress, which is throttled before it reaches the GUI.
+ */
+
+namespace
+{
+const int progressIntervalMs = 50;
+}
+
+BackgroundJob::BackgroundJob(const QString &title, QObject *parent) : QObject(parent), jobTitle(title), cancelled(false)
+{
+    setAutoDelete(false);
+}
+
+QString BackgroundJob::title() const
+{
+    return jobTitle;
+}
+
+/**
+ * @brief Requests the job to stop at its next cancellation point. Safe to call from any thread.
+ */
+void BackgroundJob::cancel()
+{
+    cancelled = true;
+}
+
+bool BackgroundJob::isCancelled() const
+{
+    return cancelled;
+}
+
+/**
+ * @brief Runs the job on a pool thread. Emits started() once a pool thread picks it up and finished() afterwards,
+ * also when cancelled.
+ */
+void BackgroundJob::run()
+{
+    progressTimer.start();
+    emit started();
+
+    if (!isCancelled())
+    {
+        execute();
+    }
+
+    emit finished();
+}
+
+/**
+ * @brief Reports progress, at most every few milliseconds unless the job is complete.
+ *
+ * @param done The amount of work done.
+ * @param total The total amount of work.
+ */
+void BackgroundJob::reportProgress(qint64 done, qint64 total)
+{
+    if (done < total && progressTimer.elapsed() < progressIntervalMs)
+    {
+        return;
+    }
+
+    progressTimer.restart();
+    emit progressChanged(done, total);
+}
@@ -0,0 +1,35 @@
+#ifndef BACKGROUNDJOB_H
+#define BACKGROUNDJOB_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <atomic>
+
+class BackgroundJob : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    explicit BackgroundJob(const QString &title, QObject *parent = nullptr);
+
+    QString title() const;
+    void cancel();
+    bool isCancelled() const;
+    void run() override;
+
+protected:
+    virtual void execute() = 0;
+    void reportProgress(qint64 done, qint64 total);
+
+private:
+    QString jobTitle;
+    std::atomic_bool cancelled;
+    QElapsedTimer progressTimer;
+
+signals:
+    void started();
+    void progressChanged(qint64 done, qint64 total);
+    void finished();
+};
+
+#endif // BACKGROUNDJOB_H
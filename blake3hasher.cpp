@@ -0,0 +1,245 @@
+#include "blake3hasher.h"
+#include <QtEndian>
+#include <algorithm>
+
+/**
+ * @file blake3hasher.h
+ * @brief The Blake3Hasher class is a portable implementation of the BLAKE3 hash (32 byte output, no key).
+ * BLAKE3 hashes 1 KiB chunks independently and combines them in a binary tree, so a large file can be split into
+ * segments of a power-of-two number of chunks that are hashed on different threads: every segment is hashed by a
+ * hasher started at its first chunk, its chainingValue() is taken, and combine() joins the values into the hash
+ * of the whole file. The result is the same as hashing the file in one go.
+ */
+
+namespace
+{
+const quint32 iv[8] = { 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+const int messagePermutation[16] = { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 };
+const quint32 chunkStart = 1 << 0;
+const quint32 chunkEnd = 1 << 1;
+const quint32 parent = 1 << 2;
+const quint32 root = 1 << 3;
+const quint32 blockSize = 64;
+
+inline quint32 rotateRight(quint32 value, int bits)
+{
+    return (value >> bits) | (value << (32 - bits));
+}
+
+inline void mix(quint32 *state, int a, int b, int c, int d, quint32 x, quint32 y)
+{
+    state[a] = state[a] + state[b] + x;
+    state[d] = rotateRight(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = rotateRight(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = rotateRight(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = rotateRight(state[b] ^ state[c], 7);
+}
+
+/**
+ * @brief The BLAKE3 compression function; fills all 16 output words.
+ */
+void compress(const quint32 *chainingValue, const quint32 *blockWords, quint64 counter, quint32 blockLength,
+              quint32 flags, quint32 *out)
+{
+    quint32 state[16] = {
+        chainingValue[0], chainingValue[1], chainingValue[2], chainingValue[3],
+        chainingValue[4], chainingValue[5], chainingValue[6], chainingValue[7],
+        iv[0], iv[1], iv[2], iv[3],
+        quint32(counter), quint32(counter >> 32), blockLength, flags
+    };
+    quint32 message[16];
+    std::copy(blockWords, blockWords + 16, message);
+
+    for (int round = 0; round < 7; ++round)
+    {
+        mix(state, 0, 4, 8, 12, message[0], message[1]);
+        mix(state, 1, 5, 9, 13, message[2], message[3]);
+        mix(state, 2, 6, 10, 14, message[4], message[5]);
+        mix(state, 3, 7, 11, 15, message[6], message[7]);
+        mix(state, 0, 5, 10, 15, message[8], message[9]);
+        mix(state, 1, 6, 11, 12, message[10], message[11]);
+        mix(state, 2, 7, 8, 13, message[12], message[13]);
+        mix(state, 3, 4, 9, 14, message[14], message[15]);
+
+        quint32 permuted[16];
+        for (int i = 0; i < 16; ++i)
+        {
+            permuted[i] = message[messagePermutation[i]];
+        }
+        std::copy(permuted, permuted + 16, message);
+    }
+
+    for (int i = 0; i < 8; ++i)
+    {
+        out[i] = state[i] ^ state[i + 8];
+        out[i + 8] = state[i + 8] ^ chainingValue[i];
+    }
+}
+
+void loadBlock(const quint8 *bytes, std::array<quint32, 16> &words)
+{
+    for (int i = 0; i < 16; ++i)
+    {
+        words[i] = qFromLittleEndian<quint32>(bytes + 4 * i);
+    }
+}
+}
+
+/**
+ * @brief Creates a hasher for data starting at the given chunk of the input, 0 for a whole file.
+ */
+Blake3Hasher::Blake3Hasher(quint64 firstChunk) : firstChunk(firstChunk)
+{
+    startChunk(firstChunk);
+}
+
+void Blake3Hasher::addData(const char *data, qint64 length)
+{
+    const quint8 *input = reinterpret_cast<const quint8*>(data);
+    while (length > 0)
+    {
+        // A full chunk is only finished once more data arrives, the last chunk has to be finalized differently.
+        if (blocksCompressed * blockSize + blockLength == chunkSize)
+        {
+            ChainingValue value = chunkOutput().chainingValue();
+            quint64 totalChunks = chunkCounter - firstChunk + 1;
+            while ((totalChunks & 1) == 0)
+            {
+                value = parentOutput(stack.back(), value).chainingValue();
+                stack.pop_back();
+                totalChunks >>= 1;
+            }
+            stack.push_back(value);
+            startChunk(chunkCounter + 1);
+        }
+
+        if (blockLength == blockSize)
+        {
+            std::array<quint32, 16> words;
+            loadBlock(block.data(), words);
+            quint32 out[16];
+            compress(chunkValue.data(), words.data(), chunkCounter, blockSize, blocksCompressed == 0 ? chunkStart : 0, out);
+            std::copy(out, out + 8, chunkValue.begin());
+            ++blocksCompressed;
+            blockLength = 0;
+        }
+
+        const quint32 chunkRoom = quint32(chunkSize) - blocksCompressed * blockSize - blockLength;
+        const quint32 take = quint32(std::min<qint64>(length, std::min(blockSize - blockLength, chunkRoom)));
+        std::copy(input, input + take, block.begin() + blockLength);
+        blockLength += take;
+        input += take;
+        length -= take;
+    }
+}
+
+/**
+ * @brief Returns the 32 byte hash of all data added.
+ */
+QByteArray Blake3Hasher::result() const
+{
+    return finalOutput().rootBytes();
+}
+
+/**
+ * @brief Returns the chaining value of the subtree formed by the data added, for combine().
+ */
+Blake3Hasher::ChainingValue Blake3Hasher::chainingValue() const
+{
+    return finalOutput().chainingValue();
+}
+
+/**
+ * @brief Returns the hash of an input from the chaining values of its consecutive segments. All segments but the
+ * last must hold the same power-of-two number of chunks, the last one at most as many; at least two are needed.
+ */
+QByteArray Blake3Hasher::combine(const std::vector<ChainingValue> &subtrees)
+{
+    size_t split = 1;
+    while (split * 2 < subtrees.size())
+    {
+        split *= 2;
+    }
+    return parentOutput(combineRange(subtrees, 0, split), combineRange(subtrees, split, subtrees.size())).rootBytes();
+}
+
+Blake3Hasher::ChainingValue Blake3Hasher::combineRange(const std::vector<ChainingValue> &subtrees, size_t first, size_t last)
+{
+    if (last - first == 1)
+    {
+        return subtrees[first];
+    }
+
+    size_t split = 1;
+    while (split * 2 < last - first)
+    {
+        split *= 2;
+    }
+    return parentOutput(combineRange(subtrees, first, first + split), combineRange(subtrees, first + split, last)).chainingValue();
+}
+
+Blake3Hasher::Output Blake3Hasher::chunkOutput() const
+{
+    Output output;
+    output.inputValue = chunkValue;
+    std::array<quint8, 64> padded = {};
+    std::copy(block.begin(), block.begin() + blockLength, padded.begin());
+    loadBlock(padded.data(), output.block);
+    output.counter = chunkCounter;
+    output.blockLength = blockLength;
+    output.flags = (blocksCompressed == 0 ? chunkStart : 0) | chunkEnd;
+    return output;
+}
+
+Blake3Hasher::Output Blake3Hasher::finalOutput() const
+{
+    Output output = chunkOutput();
+    for (auto value = stack.crbegin(); value != stack.crend(); ++value)
+    {
+        output = parentOutput(*value, output.chainingValue());
+    }
+    return output;
+}
+
+void Blake3Hasher::startChunk(quint64 counter)
+{
+    std::copy(iv, iv + 8, chunkValue.begin());
+    chunkCounter = counter;
+    blockLength = 0;
+    blocksCompressed = 0;
+}
+
+Blake3Hasher::Output Blake3Hasher::parentOutput(const ChainingValue &left, const ChainingValue &right)
+{
+    Output output;
+    std::copy(iv, iv + 8, output.inputValue.begin());
+    std::copy(left.begin(), left.end(), output.block.begin());
+    std::copy(right.begin(), right.end(), output.block.begin() + 8);
+    output.blockLength = blockSize;
+    output.flags = parent;
+    return output;
+}
+
+Blake3Hasher::ChainingValue Blake3Hasher::Output::chainingValue() const
+{
+    quint32 out[16];
+    compress(inputValue.data(), block.data(), counter, blockLength, flags, out);
+    ChainingValue value;
+    std::copy(out, out + 8, value.begin());
+    return value;
+}
+
+QByteArray Blake3Hasher::Output::rootBytes() const
+{
+    quint32 out[16];
+    compress(inputValue.data(), block.data(), 0, blockLength, flags | root, out);
+    QByteArray bytes(32, Qt::Uninitialized);
+    for (int i = 0; i < 8; ++i)
+    {
+        qToLittleEndian<quint32>(out[i], bytes.data() + 4 * i);
+    }
+    return bytes;
+}
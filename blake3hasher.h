@@ -0,0 +1,53 @@
+#ifndef BLAKE3HASHER_H
+#define BLAKE3HASHER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+#include <array>
+#include <vector>
+
+class Blake3Hasher
+{
+public:
+    using ChainingValue = std::array<quint32, 8>;
+
+    static const qint64 chunkSize = 1024;
+
+    explicit Blake3Hasher(quint64 firstChunk = 0);
+
+    void addData(const char *data, qint64 length);
+    QByteArray result() const;
+    ChainingValue chainingValue() const;
+
+    static QByteArray combine(const std::vector<ChainingValue> &subtrees);
+
+private:
+    struct Output
+    {
+        ChainingValue inputValue;
+        std::array<quint32, 16> block;
+        quint64 counter = 0;
+        quint32 blockLength = 0;
+        quint32 flags = 0;
+
+        ChainingValue chainingValue() const;
+        QByteArray rootBytes() const;
+    };
+
+    quint64 firstChunk;
+    ChainingValue chunkValue;
+    quint64 chunkCounter;
+    std::array<quint8, 64> block;
+    quint32 blockLength = 0;
+    quint32 blocksCompressed = 0;
+    std::vector<ChainingValue> stack;
+
+    Output chunkOutput() const;
+    Output finalOutput() const;
+    void startChunk(quint64 counter);
+
+    static Output parentOutput(const ChainingValue &left, const ChainingValue &right);
+    static ChainingValue combineRange(const std::vector<ChainingValue> &subtrees, size_t first, size_t last);
+};
+
+#endif // BLAKE3HASHER_H
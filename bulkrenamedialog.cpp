@@ -0,0 +1,174 @@
+#include "bulkrenamedialog.h"
+#include "ui_bulkrenamedialog.h"
+#include <QDir>
+#include <QHeaderView>
+#include <QMessageBox>
+
+/**
+ * @file bulkrenamedialog.h
+ * @brief The BulkRenameDialog class renames a selection of files with a find/replace rule, template tokens and a counter.
+ * The preview is planned on a worker thread whenever the rule changes, so it stays responsive for very large
+ * selections; a newer rule cancels the plan still being computed.
+ */
+
+namespace
+{
+const int previewDelayMs = 150;
+}
+
+BulkRenameDialog::BulkRenameDialog(const QString &directory, const QStringList &names, QWidget *parent)
+    : QDialog(parent), ui(new Ui::BulkRenameDialog), directoryPath(directory), fileNames(names), previewGeneration(0)
+{
+    ui->setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    previewModel = new RenamePreviewModel(fileNames, this);
+    ui->QTableView_Preview->setModel(previewModel);
+    ui->QTableView_Preview->horizontalHeader()->setSectionResizeMode(0, QHeaderView::Interactive);
+    ui->QTableView_Preview->horizontalHeader()->resizeSection(0, 280);
+    ui->QTableView_Preview->verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 4);
+
+    previewPool.setMaxThreadCount(1);
+    previewTimer.setSingleShot(true);
+    previewTimer.setInterval(previewDelayMs);
+    connect(&previewTimer, &QTimer::timeout, this, &BulkRenameDialog::computePreview);
+
+    connect(ui->QLineEdit_Find, &QLineEdit::textChanged, this, &BulkRenameDialog::schedulePreview);
+    connect(ui->QLineEdit_Replace, &QLineEdit::textChanged, this, &BulkRenameDialog::schedulePreview);
+    connect(ui->QCheckBox_Regex, &QCheckBox::toggled, this, &BulkRenameDialog::schedulePreview);
+    connect(ui->QCheckBox_CaseSensitive, &QCheckBox::toggled, this, &BulkRenameDialog::schedulePreview);
+    connect(ui->QSpinBox_CounterStart, &QSpinBox::valueChanged, this, &BulkRenameDialog::schedulePreview);
+    connect(ui->QSpinBox_CounterStep, &QSpinBox::valueChanged, this, &BulkRenameDialog::schedulePreview);
+    connect(ui->QSpinBox_CounterPadding, &QSpinBox::valueChanged, this, &BulkRenameDialog::schedulePreview);
+
+    ui->QLabel_Status->setText(tr("%n file(s) selected", nullptr, int(fileNames.size())));
+    ui->QPushButton_Accept->setEnabled(false);
+    ui->QLineEdit_Find->setFocus();
+}
+
+BulkRenameDialog::~BulkRenameDialog()
+{
+    ++previewGeneration;
+    previewPool.waitForDone();
+    delete ui;
+}
+
+/**
+ * \brief Restarts the preview delay after the rule was edited. The running plan, if any, is cancelled.
+ */
+void BulkRenameDialog::schedulePreview()
+{
+    ++previewGeneration;
+    ui->QPushButton_Accept->setEnabled(false);
+    previewTimer.start();
+}
+
+/**
+ * \brief Returns the rule described by the dialog fields.
+ */
+RenameRule BulkRenameDialog::currentRule() const
+{
+    RenameRule rule;
+    rule.find = ui->QLineEdit_Find->text();
+    rule.replace = ui->QLineEdit_Replace->text();
+    rule.useRegex = ui->QCheckBox_Regex->isChecked();
+    rule.caseSensitive = ui->QCheckBox_CaseSensitive->isChecked();
+    rule.counterStart = ui->QSpinBox_CounterStart->value();
+    rule.counterStep = ui->QSpinBox_CounterStep->value();
+    rule.counterPadding = ui->QSpinBox_CounterPadding->value();
+    return rule;
+}
+
+/**
+ * \brief Plans the renames for the current rule on the worker thread.
+ */
+void BulkRenameDialog::computePreview()
+{
+    const RenamePattern pattern(currentRule());
+    if (!pattern.isValid())
+    {
+        ui->QLabel_Status->setText(tr("Invalid expression: %1").arg(pattern.errorString()));
+        return;
+    }
+
+    const int generation = ++previewGeneration;
+    ui->QLabel_Status->setText(tr("Computing preview..."));
+
+    const QString directory = directoryPath;
+    const QStringList names = fileNames;
+
+    previewPool.start([this, pattern, directory, names, generation]()
+                      {
+                          // The cached listing leaves out hidden and system entries, which a rename still collides with.
+                          const QStringList entryNames = QDir(directory).entryList(QDir::AllEntries | QDir::Hidden | QDir::System
+                                                                                   | QDir::NoDotAndDotDot, QDir::NoSort);
+                          const QSet<QString> existingNames(entryNames.cbegin(), entryNames.cend());
+
+                          const RenamePlan plan = pattern.plan(directory, names, existingNames, [this, generation]()
+                                                               {
+                                                                   return previewGeneration != generation;
+                                                               });
+
+                          if (!plan.cancelled)
+                          {
+                              QMetaObject::invokeMethod(this, [this, plan, generation]()
+                                                        {
+                                                            applyPreview(plan, generation);
+                                                        }, Qt::QueuedConnection);
+                          }
+                      });
+}
+
+/**
+ * \brief Shows a finished plan unless the rule changed while it was computed.
+ *
+ * \param plan The computed plan.
+ * \param generation The preview generation the plan was computed for.
+ */
+void BulkRenameDialog::applyPreview(const RenamePlan &plan, int generation)
+{
+    if (generation != previewGeneration)
+    {
+        return;
+    }
+
+    previewModel->setPlan(plan);
+
+    QString status = tr("%n file(s) will be renamed", nullptr, int(plan.changedCount));
+    if (plan.conflictCount > 0)
+    {
+        status += tr(", %n conflict(s) will be skipped", nullptr, int(plan.conflictCount));
+    }
+    ui->QLabel_Status->setText(status);
+    ui->QPushButton_Accept->setEnabled(!plan.orderedRenames.isEmpty());
+}
+
+/**
+ * \brief Slot triggered on 'Cancel' button click.
+ */
+void BulkRenameDialog::on_QPushButton_Cancel_clicked()
+{
+    close();
+}
+
+/**
+ * \brief Slot triggered on 'Accept' button click. Hands the ordered renames of the shown plan to the caller.
+ */
+void BulkRenameDialog::on_QPushButton_Accept_clicked()
+{
+    const RenamePlan &plan = previewModel->plan();
+    if (plan.orderedRenames.isEmpty())
+    {
+        return;
+    }
+
+    if (plan.conflictCount > 0
+        && QMessageBox::question(this, tr("Rename"), tr("%n file(s) cannot be renamed and will be skipped. Continue?", nullptr, int(plan.conflictCount)))
+               != QMessageBox::Yes)
+    {
+        return;
+    }
+
+    emit renameRequested(plan.orderedRenames);
+    close();
+}
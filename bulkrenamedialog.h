@@ -0,0 +1,45 @@
+#ifndef BULKRENAMEDIALOG_H
+#define BULKRENAMEDIALOG_H
+
+#include "renamepattern.h"
+#include "renamepreviewmodel.h"
+#include <QDialog>
+#include <QTimer>
+#include <QThreadPool>
+#include <atomic>
+
+namespace Ui {
+class BulkRenameDialog;
+}
+
+class BulkRenameDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit BulkRenameDialog(const QString &directory, const QStringList &names, QWidget *parent = nullptr);
+    ~BulkRenameDialog();
+
+signals:
+    void renameRequested(const QList<QPair<QString, QString>> &renames);
+
+private slots:
+    void on_QPushButton_Cancel_clicked();
+    void on_QPushButton_Accept_clicked();
+    void schedulePreview();
+
+private:
+    Ui::BulkRenameDialog *ui;
+    QString directoryPath;
+    QStringList fileNames;
+    RenamePreviewModel *previewModel;
+    QTimer previewTimer;
+    QThreadPool previewPool;
+    std::atomic<int> previewGeneration;
+
+    RenameRule currentRule() const;
+    void computePreview();
+    void applyPreview(const RenamePlan &plan, int generation);
+};
+
+#endif // BULKRENAMEDIALOG_H
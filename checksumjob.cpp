@@ -0,0 +1,704 @@
+#include "checksumjob.h"
+#include "xxhash64hasher.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QMap>
+#include <QSaveFile>
+#include <QThread>
+#include <algorithm>
+#include <cctype>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+/**
+ * @file checksumjob.h
+ * @brief The ChecksumJob class creates or verifies SHA-256, BLAKE3 and xxHash64 checksums of many files as a
+ * background job. Manifests are the sidecar files written by sha256sum, b3sum and xxhsum (SHA256SUMS, B3SUMS,
+ * XXH64SUMS) and can be checked with those tools. Small files are hashed in batches on a worker pool, so many
+ * files are read at once. SHA-256 and xxHash64 have to read a file in order, but a BLAKE3 file larger than one
+ * segment is split into segments hashed by different workers and joined as subtrees, so a single big file is
+ * hashed at the speed of the disk as well.
+ */
+
+namespace
+{
+const qint64 readBufferSize = 1024 * 1024;
+const qint64 segmentSize = 64 * 1024 * 1024;
+const qint64 batchSize = 8 * 1024 * 1024;
+const size_t maxBatchFiles = 256;
+const int progressPollMs = 100;
+
+QString joinPath(const QString &directory, const QString &name)
+{
+    return directory.endsWith('/') ? directory + name : directory + '/' + name;
+}
+
+QString operationTitle(ChecksumJob::Operation operation, const QStringList &paths, ChecksumJob::Algorithm algorithm)
+{
+    if (operation == ChecksumJob::Create)
+    {
+        return QObject::tr("Creating %1 checksums of %n item(s)", nullptr, int(paths.size())).arg(ChecksumJob::algorithmName(algorithm));
+    }
+    return QObject::tr("Verifying checksums in %n item(s)", nullptr, int(paths.size()));
+}
+
+/**
+ * @brief Detects the algorithm of a manifest from its name, as used by the coreutils style tools.
+ */
+bool algorithmForManifest(const QString &fileName, ChecksumJob::Algorithm &algorithm)
+{
+    const QString name = fileName.toUpper();
+    if (name.startsWith("SHA256SUM") || name.endsWith(".SHA256"))
+    {
+        algorithm = ChecksumJob::Sha256;
+    }
+    else if (name.startsWith("B3SUM") || name.startsWith("BLAKE3SUM") || name.endsWith(".B3") || name.endsWith(".BLAKE3"))
+    {
+        algorithm = ChecksumJob::Blake3;
+    }
+    else if (name.startsWith("XXH64SUM") || name.startsWith("XXHSUM") || name.endsWith(".XXH64"))
+    {
+        algorithm = ChecksumJob::XxHash64;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+bool algorithmForTag(const QByteArray &tag, ChecksumJob::Algorithm &algorithm)
+{
+    if (tag == "SHA256")
+    {
+        algorithm = ChecksumJob::Sha256;
+    }
+    else if (tag == "BLAKE3")
+    {
+        algorithm = ChecksumJob::Blake3;
+    }
+    else if (tag == "XXH64")
+    {
+        algorithm = ChecksumJob::XxHash64;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+qsizetype digestLength(ChecksumJob::Algorithm algorithm)
+{
+    return algorithm == ChecksumJob::XxHash64 ? 16 : 64;
+}
+
+bool isHexDigest(const QByteArray &digest)
+{
+    return !digest.isEmpty() && std::all_of(digest.begin(), digest.end(), [](char c) { return std::isxdigit(uchar(c)); });
+}
+
+/**
+ * @brief Formats a manifest line. Names with a backslash or a line break are escaped and the line starts with a
+ * backslash, like sha256sum does.
+ */
+QByteArray manifestLine(const QByteArray &hexDigest, const QString &name)
+{
+    QByteArray encodedName = name.toUtf8();
+    const bool isEscaped = encodedName.contains('\\') || encodedName.contains('\n') || encodedName.contains('\r');
+    if (isEscaped)
+    {
+        encodedName.replace("\\", "\\\\").replace("\n", "\\n").replace("\r", "\\r");
+    }
+    return (isEscaped ? "\\" : "") + hexDigest + "  " + encodedName + '\n';
+}
+
+QByteArray unescapedName(const QByteArray &name)
+{
+    QByteArray result;
+    result.reserve(name.size());
+    for (qsizetype i = 0; i < name.size(); ++i)
+    {
+        if (name.at(i) == '\\' && i + 1 < name.size())
+        {
+            const char next = name.at(++i);
+            result += next == 'n' ? '\n' : next == 'r' ? '\r' : next;
+        }
+        else
+        {
+            result += name.at(i);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Parses a manifest line in the GNU format ("digest  name", "digest *name") or the BSD tag format
+ * ("TAG (name) = digest").
+ *
+ * @param tag Receives the algorithm tag of a BSD line, or an empty array.
+ * @return False if the line is not a checksum line.
+ */
+bool parseManifestLine(QByteArray line, QByteArray &digest, QString &name, QByteArray &tag)
+{
+    while (line.endsWith('\n') || line.endsWith('\r'))
+    {
+        line.chop(1);
+    }
+    const bool isEscaped = line.startsWith('\\');
+    if (isEscaped)
+    {
+        line.remove(0, 1);
+    }
+
+    QByteArray encodedName;
+    const qsizetype open = line.indexOf(" (");
+    const qsizetype close = line.lastIndexOf(") = ");
+    if (open > 0 && close > open && !line.left(open).contains(' ') && isHexDigest(line.mid(close + 4)))
+    {
+        tag = line.left(open);
+        encodedName = line.mid(open + 2, close - open - 2);
+        digest = line.mid(close + 4);
+    }
+    else
+    {
+        const qsizetype space = line.indexOf(' ');
+        if (space <= 0 || space + 2 > line.size() || (line.at(space + 1) != ' ' && line.at(space + 1) != '*'))
+        {
+            return false;
+        }
+        tag.clear();
+        digest = line.left(space);
+        encodedName = line.mid(space + 2);
+    }
+
+    if (!isHexDigest(digest) || encodedName.isEmpty())
+    {
+        return false;
+    }
+    digest = digest.toLower();
+    name = QString::fromUtf8(isEscaped ? unescapedName(encodedName) : encodedName);
+    return true;
+}
+}
+
+ChecksumJob::ChecksumJob(Operation operation, const QStringList &paths, Algorithm algorithm, QObject *parent)
+    : BackgroundJob(operationTitle(operation, paths, algorithm), parent), checksumOperation(operation), sourcePaths(paths),
+      manifestAlgorithm(algorithm), verified(0), bytesDone(0)
+{
+    workerPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+/**
+ * @brief Creates a job hashing the given files and everything below the given directories into a manifest next
+ * to them. Entries of an existing manifest for other files are kept.
+ */
+ChecksumJob* ChecksumJob::createManifest(const QStringList &paths, Algorithm algorithm)
+{
+    return new ChecksumJob(Create, paths, algorithm);
+}
+
+/**
+ * @brief Creates a job checking the given manifests, and all manifests found below the given directories.
+ */
+ChecksumJob* ChecksumJob::verifyManifests(const QStringList &paths)
+{
+    return new ChecksumJob(Verify, paths, Sha256);
+}
+
+QString ChecksumJob::algorithmName(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Sha256:
+        return QStringLiteral("SHA-256");
+    case Blake3:
+        return QStringLiteral("BLAKE3");
+    case XxHash64:
+        return QStringLiteral("xxHash64");
+    }
+    return QString();
+}
+
+/**
+ * @brief Returns the file name of the manifest written for an algorithm.
+ */
+QString ChecksumJob::manifestName(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Sha256:
+        return QStringLiteral("SHA256SUMS");
+    case Blake3:
+        return QStringLiteral("B3SUMS");
+    case XxHash64:
+        return QStringLiteral("XXH64SUMS");
+    }
+    return QString();
+}
+
+bool ChecksumJob::isManifest(const QString &path)
+{
+    Algorithm algorithm;
+    return algorithmForManifest(QFileInfo(path).fileName(), algorithm);
+}
+
+ChecksumJob::Operation ChecksumJob::operation() const
+{
+    return checksumOperation;
+}
+
+/**
+ * @brief Returns the manifest the job wrote, or an empty path if it wrote none.
+ */
+QString ChecksumJob::createdPath() const
+{
+    return created;
+}
+
+/**
+ * @brief Returns the files that could not be read and the manifests that could not be read or written.
+ */
+QStringList ChecksumJob::failedPaths() const
+{
+    return failed;
+}
+
+/**
+ * @brief Returns the files whose content does not match their manifest entry.
+ */
+QStringList ChecksumJob::mismatchedPaths() const
+{
+    return mismatched;
+}
+
+qsizetype ChecksumJob::verifiedCount() const
+{
+    return verified;
+}
+
+void ChecksumJob::execute()
+{
+    if (sourcePaths.isEmpty())
+    {
+        return;
+    }
+
+    const QString manifestDirectory = QFileInfo(sourcePaths.first()).absolutePath();
+    if (checksumOperation == Create)
+    {
+        collectFiles(manifestDirectory);
+    }
+    else
+    {
+        for (const QString &path : std::as_const(sourcePaths))
+        {
+            if (!QFileInfo(path).isDir())
+            {
+                readManifest(path);
+                continue;
+            }
+
+            QDirIterator iterator(path, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+            while (iterator.hasNext() && !isCancelled())
+            {
+                const QString manifestPath = iterator.next();
+                if (isManifest(manifestPath))
+                {
+                    readManifest(manifestPath);
+                }
+            }
+        }
+    }
+
+    hashFiles();
+    if (isCancelled())
+    {
+        return;
+    }
+
+    if (checksumOperation == Create)
+    {
+        for (const FileEntry &entry : files)
+        {
+            if (entry.digest.isEmpty())
+            {
+                addFailure(entry.path);
+            }
+        }
+        writeManifest(joinPath(manifestDirectory, manifestName(manifestAlgorithm)));
+        return;
+    }
+
+    for (const FileEntry &entry : files)
+    {
+        if (entry.digest.isEmpty())
+        {
+            addFailure(entry.path);
+        }
+        else if (entry.digest.toHex() != entry.expected)
+        {
+            mismatched << entry.path;
+        }
+        else
+        {
+            ++verified;
+        }
+    }
+}
+
+/**
+ * @brief Lists the regular files among and below the selected items, named relative to the manifest directory.
+ * Existing manifests are not hashed.
+ */
+void ChecksumJob::collectFiles(const QString &manifestDirectory)
+{
+    const QDir base(manifestDirectory);
+    auto add = [this, &base](const QFileInfo &fileInfo)
+    {
+        if (!isManifest(fileInfo.fileName()))
+        {
+            FileEntry entry;
+            entry.path = fileInfo.filePath();
+            entry.name = base.relativeFilePath(fileInfo.absoluteFilePath());
+            entry.size = fileInfo.size();
+            entry.algorithm = manifestAlgorithm;
+            files.push_back(entry);
+        }
+    };
+
+    for (const QString &sourcePath : std::as_const(sourcePaths))
+    {
+        const QFileInfo fileInfo(sourcePath);
+        if (fileInfo.isFile())
+        {
+            add(fileInfo);
+            continue;
+        }
+        if (!fileInfo.isDir())
+        {
+            addFailure(sourcePath);
+            continue;
+        }
+
+        QDirIterator iterator(sourcePath, QDir::Files | QDir::Hidden, QDirIterator::Subdirectories);
+        while (iterator.hasNext() && !isCancelled())
+        {
+            add(iterator.nextFileInfo());
+        }
+    }
+}
+
+/**
+ * @brief Adds the entries of a manifest to the files to hash. Names are relative to the directory of the manifest.
+ * A manifest with lines that are not checksum lines is reported as failed, its valid lines are still checked.
+ */
+void ChecksumJob::readManifest(const QString &manifestPath)
+{
+    QFile manifest(manifestPath);
+    Algorithm defaultAlgorithm = Sha256;
+    const bool hasNamedAlgorithm = algorithmForManifest(QFileInfo(manifestPath).fileName(), defaultAlgorithm);
+    if (!manifest.open(QIODevice::ReadOnly))
+    {
+        addFailure(manifestPath);
+        return;
+    }
+
+    const QString directory = QFileInfo(manifestPath).absolutePath();
+    bool isValid = true;
+    while (!manifest.atEnd() && !isCancelled())
+    {
+        const QByteArray line = manifest.readLine();
+        if (line.trimmed().isEmpty() || line.startsWith('#'))
+        {
+            continue;
+        }
+
+        FileEntry entry;
+        QByteArray tag;
+        if (!parseManifestLine(line, entry.expected, entry.name, tag))
+        {
+            isValid = false;
+            continue;
+        }
+
+        if (!tag.isEmpty())
+        {
+            isValid = algorithmForTag(tag, entry.algorithm) && isValid;
+        }
+        else if (hasNamedAlgorithm)
+        {
+            entry.algorithm = defaultAlgorithm;
+        }
+        else
+        {
+            entry.algorithm = entry.expected.size() == digestLength(XxHash64) ? XxHash64 : Sha256;
+        }
+        if (entry.expected.size() != digestLength(entry.algorithm))
+        {
+            isValid = false;
+            continue;
+        }
+
+        entry.path = QDir::cleanPath(QDir::isAbsolutePath(entry.name) ? entry.name : joinPath(directory, entry.name));
+        const QFileInfo fileInfo(entry.path);
+        entry.isReadable = fileInfo.isFile();
+        entry.size = entry.isReadable ? fileInfo.size() : 0;
+        files.push_back(entry);
+    }
+
+    if (!isValid)
+    {
+        addFailure(manifestPath);
+    }
+}
+
+/**
+ * @brief Hashes all files on the worker pool. Segments of large BLAKE3 files are queued first, the remaining
+ * files follow in batches in the order they were listed, which keeps the files of a directory together.
+ */
+void ChecksumJob::hashFiles()
+{
+    qint64 totalSize = 0;
+    for (size_t i = 0; i < files.size() && !isCancelled(); ++i)
+    {
+        FileEntry &entry = files[i];
+        if (!entry.isReadable || entry.algorithm != Blake3 || entry.size <= segmentSize)
+        {
+            continue;
+        }
+
+        const qint64 segmentCount = (entry.size + segmentSize - 1) / segmentSize;
+        entry.segments.resize(size_t(segmentCount));
+        entry.pendingSegments = segmentCount;
+        totalSize += entry.size;
+        for (qint64 segment = 0; segment < segmentCount; ++segment)
+        {
+            workerPool.start([this, i, segment]()
+                             {
+                                 hashSegment(i, segment);
+                             });
+        }
+    }
+
+    size_t first = 0;
+    size_t count = 0;
+    qint64 batchBytes = 0;
+    for (size_t i = 0; i <= files.size() && !isCancelled(); ++i)
+    {
+        const bool isLast = i == files.size();
+        if (count > 0 && (isLast || count == maxBatchFiles || batchBytes >= batchSize))
+        {
+            workerPool.start([this, first, count]()
+                             {
+                                 hashBatch(first, count);
+                             });
+            count = 0;
+            batchBytes = 0;
+        }
+        if (isLast || !files[i].segments.empty() || !files[i].isReadable)
+        {
+            continue;
+        }
+
+        if (count == 0)
+        {
+            first = i;
+        }
+        ++count;
+        batchBytes += files[i].size;
+        totalSize += files[i].size;
+    }
+
+    while (!workerPool.waitForDone(progressPollMs))
+    {
+        reportProgress(bytesDone, totalSize);
+    }
+    reportProgress(totalSize, totalSize);
+}
+
+/**
+ * @brief Hashes consecutive files, skipping the unreadable ones and the ones hashed in segments. Runs on the
+ * worker pool.
+ */
+void ChecksumJob::hashBatch(size_t first, size_t count)
+{
+    QByteArray buffer(readBufferSize, Qt::Uninitialized);
+    for (size_t i = first; i < first + count && !isCancelled(); ++i)
+    {
+        FileEntry &entry = files[i];
+        if (!entry.isReadable || !entry.segments.empty())
+        {
+            continue;
+        }
+
+        switch (entry.algorithm)
+        {
+        case Sha256:
+        {
+            QCryptographicHash hash(QCryptographicHash::Sha256);
+            entry.isReadable = readFile(entry.path, 0, -1, buffer, [&hash](const char *data, qint64 length)
+                                        {
+                                            hash.addData(QByteArrayView(data, length));
+                                        });
+            entry.digest = entry.isReadable ? hash.result() : QByteArray();
+            break;
+        }
+        case Blake3:
+        {
+            Blake3Hasher hasher;
+            entry.isReadable = readFile(entry.path, 0, -1, buffer, [&hasher](const char *data, qint64 length)
+                                        {
+                                            hasher.addData(data, length);
+                                        });
+            entry.digest = entry.isReadable ? hasher.result() : QByteArray();
+            break;
+        }
+        case XxHash64:
+        {
+            XxHash64Hasher hasher;
+            entry.isReadable = readFile(entry.path, 0, -1, buffer, [&hasher](const char *data, qint64 length)
+                                        {
+                                            hasher.addData(data, length);
+                                        });
+            entry.digest = entry.isReadable ? hasher.result() : QByteArray();
+            break;
+        }
+        }
+    }
+}
+
+/**
+ * @brief Hashes one segment of a large BLAKE3 file. The worker finishing the last segment joins the subtrees
+ * into the hash of the file. Runs on the worker pool.
+ */
+void ChecksumJob::hashSegment(size_t index, qint64 segment)
+{
+    FileEntry &entry = files[index];
+    const qint64 offset = segment * segmentSize;
+    Blake3Hasher hasher(quint64(offset / Blake3Hasher::chunkSize));
+
+    QByteArray buffer(readBufferSize, Qt::Uninitialized);
+    const bool isRead = readFile(entry.path, offset, std::min(segmentSize, entry.size - offset), buffer,
+                                 [&hasher](const char *data, qint64 length)
+                                 {
+                                     hasher.addData(data, length);
+                                 });
+
+    QMutexLocker locker(&segmentMutex);
+    entry.isReadable = entry.isReadable && isRead;
+    entry.segments[size_t(segment)] = hasher.chainingValue();
+    if (--entry.pendingSegments == 0 && entry.isReadable)
+    {
+        entry.digest = Blake3Hasher::combine(entry.segments);
+    }
+}
+
+/**
+ * @brief Reads part of a file and passes it on in buffer sized pieces.
+ *
+ * @param length The number of bytes to read, or -1 to read to the end of the file.
+ * @return False if the file could not be read, was shorter than expected or the job was cancelled.
+ */
+bool ChecksumJob::readFile(const QString &path, qint64 offset, qint64 length, QByteArray &buffer,
+                           const std::function<void(const char*, qint64)> &consume)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || (offset > 0 && !file.seek(offset)))
+    {
+        return false;
+    }
+#ifdef Q_OS_LINUX
+    posix_fadvise(file.handle(), offset, length < 0 ? 0 : length, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    qint64 remaining = length;
+    while (length < 0 || remaining > 0)
+    {
+        if (isCancelled())
+        {
+            return false;
+        }
+
+        const qint64 count = file.read(buffer.data(), length < 0 ? buffer.size() : std::min<qint64>(remaining, buffer.size()));
+        if (count < 0)
+        {
+            return false;
+        }
+        if (count == 0)
+        {
+            break;
+        }
+        consume(buffer.constData(), count);
+        bytesDone += count;
+        remaining -= count;
+    }
+    return length < 0 || remaining == 0;
+}
+
+/**
+ * @brief Writes the hashed files into the manifest, sorted by name, together with the entries of an existing
+ * manifest for files that were not hashed now.
+ */
+void ChecksumJob::writeManifest(const QString &manifestPath)
+{
+    QMap<QString, QByteArray> entries;
+    QFile existing(manifestPath);
+    if (existing.open(QIODevice::ReadOnly))
+    {
+        while (!existing.atEnd())
+        {
+            QByteArray digest;
+            QString name;
+            QByteArray tag;
+            if (parseManifestLine(existing.readLine(), digest, name, tag) && tag.isEmpty()
+                && digest.size() == digestLength(manifestAlgorithm))
+            {
+                entries.insert(name, digest);
+            }
+        }
+        existing.close();
+    }
+
+    bool hasNewEntries = false;
+    for (const FileEntry &entry : files)
+    {
+        if (!entry.digest.isEmpty())
+        {
+            entries.insert(entry.name, entry.digest.toHex());
+            hasNewEntries = true;
+        }
+    }
+    if (!hasNewEntries)
+    {
+        return;
+    }
+
+    QSaveFile output(manifestPath);
+    if (!output.open(QIODevice::WriteOnly))
+    {
+        addFailure(manifestPath);
+        return;
+    }
+    for (auto entry = entries.cbegin(); entry != entries.cend(); ++entry)
+    {
+        output.write(manifestLine(entry.value(), entry.key()));
+    }
+    if (!output.commit())
+    {
+        addFailure(manifestPath);
+        return;
+    }
+    created = manifestPath;
+}
+
+void ChecksumJob::addFailure(const QString &path)
+{
+    QMutexLocker locker(&failedMutex);
+    failed << path;
+}
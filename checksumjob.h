@@ -0,0 +1,86 @@
+#ifndef CHECKSUMJOB_H
+#define CHECKSUMJOB_H
+
+#include "backgroundjob.h"
+#include "blake3hasher.h"
+#include <QMutex>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class ChecksumJob : public BackgroundJob
+{
+    Q_OBJECT
+public:
+    enum Algorithm
+    {
+        Sha256,
+        Blake3,
+        XxHash64
+    };
+
+    enum Operation
+    {
+        Create,
+        Verify
+    };
+
+    ChecksumJob(Operation operation, const QStringList &paths, Algorithm algorithm, QObject *parent = nullptr);
+
+    static ChecksumJob* createManifest(const QStringList &paths, Algorithm algorithm);
+    static ChecksumJob* verifyManifests(const QStringList &paths);
+    static QString algorithmName(Algorithm algorithm);
+    static QString manifestName(Algorithm algorithm);
+    static bool isManifest(const QString &path);
+
+    Operation operation() const;
+    QString createdPath() const;
+    QStringList failedPaths() const;
+    QStringList mismatchedPaths() const;
+    qsizetype verifiedCount() const;
+
+protected:
+    void execute() override;
+
+private:
+    struct FileEntry
+    {
+        QString path;
+        QString name;
+        qint64 size = 0;
+        Algorithm algorithm = Sha256;
+        QByteArray expected;
+        QByteArray digest;
+        std::vector<Blake3Hasher::ChainingValue> segments;
+        qsizetype pendingSegments = 0;
+        bool isReadable = true;
+    };
+
+    Operation checksumOperation;
+    QStringList sourcePaths;
+    Algorithm manifestAlgorithm;
+    QString created;
+    QStringList failed;
+    QStringList mismatched;
+    qsizetype verified;
+    QMutex failedMutex;
+
+    std::vector<FileEntry> files;
+    QThreadPool workerPool;
+    QMutex segmentMutex;
+    std::atomic<qint64> bytesDone;
+
+    void collectFiles(const QString &manifestDirectory);
+    void readManifest(const QString &manifestPath);
+    void hashFiles();
+    void hashBatch(size_t first, size_t count);
+    void hashSegment(size_t index, qint64 segment);
+    bool readFile(const QString &path, qint64 offset, qint64 length, QByteArray &buffer,
+                  const std::function<void(const char*, qint64)> &consume);
+    void writeManifest(const QString &manifestPath);
+    void addFailure(const QString &path);
+};
+
+#endif // CHECKSUMJOB_H
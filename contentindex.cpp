@@ -0,0 +1,1076 @@
+#include "contentindex.h"
+#include "contentindexjob.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimeZone>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+/**
+ * @file contentindex.h
+ * @brief The ContentIndex class keeps a trigram index over the file contents of one chosen directory tree, so
+ * content searches below it only need to verify the files that contain every trigram of the searched text.
+ * Every file is a document; every trigram (three bytes, ASCII letters folded to lower case) owns a posting list of
+ * the ids of the documents containing it, stored as varint encoded deltas. Documents get increasing ids, so a
+ * changed file is indexed as a new document and its old one becomes dead until the index is compacted.
+ * The index is built and refreshed by ContentIndexJob, which only reads files whose size or modification time
+ * changed. Indexed directories are watched and their changes are applied incrementally. Files edited in place do
+ * not always change their directory, so a slice of the indexed files is compared with the disk periodically; what
+ * changed is marked stale until its directory was indexed again. The complete index is persisted and refreshed in
+ * the background on the next start.
+ */
+
+namespace
+{
+const char indexMagic[4] = { 'F', 'X', 'C', 'I' };
+const quint32 indexVersion = 1;
+const quint32 trigramSpace = 1 << 24;
+const int maxWatchedDirectories = 8192;
+const int updateDelayMs = 500;
+const int refreshIntervalMs = 30000;
+const qsizetype refreshBatchSize = 2000;
+
+inline char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c | 0x20) : c;
+}
+
+/**
+ * @brief Returns true if the path is the directory itself or lies below it.
+ */
+bool isUnder(const QString &path, const QString &directory)
+{
+    if (directory.isEmpty() || !path.startsWith(directory))
+    {
+        return false;
+    }
+    return path.size() == directory.size() || directory.endsWith('/') || path.at(directory.size()) == '/';
+}
+
+void appendVarint(QByteArray &data, quint32 value)
+{
+    while (value >= 0x80)
+    {
+        data.append(char(value | 0x80));
+        value >>= 7;
+    }
+    data.append(char(value));
+}
+
+class PostingReader
+{
+public:
+    explicit PostingReader(const QByteArray &data)
+        : position(reinterpret_cast<const uchar*>(data.constData())), end(position + data.size()) {}
+
+    /**
+     * @brief Decodes the next document id, returns false at the end of the list.
+     */
+    bool next(quint32 &document)
+    {
+        quint32 delta = 0;
+        int shift = 0;
+        while (position < end)
+        {
+            const uchar byte = *position++;
+            delta |= quint32(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                current += delta;
+                document = current;
+                return true;
+            }
+            shift += 7;
+        }
+        return false;
+    }
+
+private:
+    const uchar *position;
+    const uchar *end;
+    quint32 current = 0;
+};
+
+/**
+ * @brief Returns true if a persisted posting list decodes completely into ascending ids below the document count,
+ * ending with its recorded last id after the recorded number of ids.
+ */
+bool isValidPostingList(const QByteArray &data, quint32 count, quint32 lastDocument, quint32 documentCount)
+{
+    const uchar *position = reinterpret_cast<const uchar*>(data.constData());
+    const uchar *end = position + data.size();
+    quint64 current = 0;
+    quint32 decoded = 0;
+
+    while (position < end)
+    {
+        quint64 delta = 0;
+        int shift = 0;
+        for (;;)
+        {
+            if (position == end || shift > 28)
+            {
+                return false;
+            }
+
+            const uchar byte = *position++;
+            delta |= quint64(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                break;
+            }
+            shift += 7;
+        }
+
+        // Only the first id may repeat the starting value 0.
+        if (decoded > 0 && delta == 0)
+        {
+            return false;
+        }
+
+        current += delta;
+        if (current >= documentCount)
+        {
+            return false;
+        }
+        ++decoded;
+    }
+
+    return decoded == count && (decoded == 0 || current == lastDocument);
+}
+
+class IndexReader
+{
+public:
+    IndexReader(const uchar *data, qint64 size) : data(data), size(size) {}
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (position + qint64(sizeof(T)) > size)
+        {
+            return false;
+        }
+
+        value = qFromLittleEndian<T>(data + position);
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readBytes(qint64 length, QByteArray &value)
+    {
+        if (length < 0 || position + length > size)
+        {
+            return false;
+        }
+
+        value = QByteArray(reinterpret_cast<const char*>(data + position), length);
+        position += length;
+        return true;
+    }
+
+private:
+    const uchar *data;
+    qint64 size;
+    qint64 position = 0;
+};
+
+template <typename T>
+void appendValue(QByteArray &buffer, T value)
+{
+    const T littleEndian = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char*>(&littleEndian), sizeof(T));
+}
+}
+
+ContentIndex::ContentIndex()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    indexFilePath = directory + "/content.idx";
+
+    updatePool.setMaxThreadCount(1);
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(updateDelayMs);
+
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &ContentIndex::scheduleUpdate);
+    connect(&updateTimer, &QTimer::timeout, this, [this]()
+            {
+                startUpdate(QStringList(pendingDirectories.cbegin(), pendingDirectories.cend()), false);
+                pendingDirectories.clear();
+            });
+
+    // Skipped while an update runs, which compares its directories with the disk anyway.
+    refreshTimer.setInterval(refreshIntervalMs);
+    connect(&refreshTimer, &QTimer::timeout, this, [this]()
+            {
+                if (updatePool.activeThreadCount() == 0)
+                {
+                    updatePool.start([this]() { refreshDocuments(); });
+                }
+            });
+    refreshTimer.start();
+}
+
+ContentIndex::~ContentIndex()
+{
+    updatePool.clear();
+    updatePool.waitForDone();
+}
+
+ContentIndex& ContentIndex::instance()
+{
+    static ContentIndex instance;
+    return instance;
+}
+
+QString ContentIndex::rootDirectory() const
+{
+    QReadLocker locker(&lock);
+    return root;
+}
+
+/**
+ * @brief Returns true once the tree has been walked completely, before that queries are not answered.
+ */
+bool ContentIndex::isReady() const
+{
+    QReadLocker locker(&lock);
+    return ready;
+}
+
+/**
+ * @brief Returns true if queries for the directory can be answered by the index.
+ */
+bool ContentIndex::covers(const QString &directory) const
+{
+    QReadLocker locker(&lock);
+    return ready && isUnder(QDir::cleanPath(directory), root);
+}
+
+qsizetype ContentIndex::documentCount() const
+{
+    QReadLocker locker(&lock);
+    return documentIds.size();
+}
+
+/**
+ * @brief Returns the files below a directory that contain every trigram of a literal, and what else the search
+ * has to look at because the index may be behind the file system.
+ * The candidates are a superset of the files containing the literal as they were indexed, so every candidate still
+ * has to be verified. The other files known to have changed since they were indexed are returned as stale, with
+ * their indexed size and modification time to be compared against the disk. Directories the watcher does not
+ * cover may have changed arbitrarily; their subtrees are returned to be walked and none of their files are part of
+ * the other two lists.
+ *
+ * @param literal The text every match contains, at least three bytes.
+ * @param directory The searched directory, below the indexed root.
+ * @param result Receives the candidates, the stale files and the unwatched subtrees.
+ * @return False if the index cannot answer the query and the directory has to be scanned.
+ */
+bool ContentIndex::query(const QByteArray &literal, const QString &directory, ContentIndexQuery &result) const
+{
+    result = ContentIndexQuery();
+
+    std::vector<quint32> trigrams;
+    extractTrigrams(literal.constData(), literal.size(), trigrams);
+    if (trigrams.empty())
+    {
+        return false;
+    }
+
+    const QString searchedDirectory = QDir::cleanPath(directory);
+
+    QReadLocker locker(&lock);
+    if (!ready || !isUnder(searchedDirectory, root))
+    {
+        return false;
+    }
+
+    std::vector<const PostingList*> lists;
+    lists.reserve(trigrams.size());
+    for (quint32 trigram : trigrams)
+    {
+        const auto list = postings.constFind(trigram);
+        if (list == postings.constEnd())
+        {
+            lists.clear();
+            break;
+        }
+        lists.push_back(&*list);
+    }
+
+    std::vector<quint32> matches;
+    if (!lists.empty())
+    {
+        std::sort(lists.begin(), lists.end(), [](const PostingList *a, const PostingList *b) { return a->count < b->count; });
+
+        matches = decode(*lists.front());
+        std::vector<quint32> intersection;
+        for (size_t i = 1; i < lists.size() && !matches.empty(); ++i)
+        {
+            intersection.clear();
+            PostingReader reader(lists[i]->data);
+            quint32 document = 0;
+            auto position = matches.cbegin();
+
+            while (position != matches.cend() && reader.next(document))
+            {
+                while (position != matches.cend() && *position < document)
+                {
+                    ++position;
+                }
+                if (position != matches.cend() && *position == document)
+                {
+                    intersection.push_back(document);
+                    ++position;
+                }
+            }
+            matches.swap(intersection);
+        }
+    }
+
+    // Directories are watched shallowest first, so everything below an unwatched directory is unwatched as well.
+    QSet<QString> unwatched;
+    for (auto indexed = directories.cbegin(); indexed != directories.cend(); ++indexed)
+    {
+        if (!watchedDirectories.contains(indexed.key()) && isUnder(indexed.key(), searchedDirectory))
+        {
+            unwatched.insert(indexed.key());
+        }
+    }
+    for (const QString &path : std::as_const(unwatched))
+    {
+        const QString parent = QFileInfo(path).path();
+        if (path == searchedDirectory || !unwatched.contains(parent))
+        {
+            result.unwatchedDirectories << path;
+        }
+    }
+
+    auto match = matches.cbegin();
+    for (size_t id = 0; id < documents.size(); ++id)
+    {
+        const bool isMatch = match != matches.cend() && *match == quint32(id);
+        if (isMatch)
+        {
+            ++match;
+        }
+
+        const Document &document = documents[id];
+        if (!document.isLive || !isUnder(document.path, searchedDirectory)
+            || unwatched.contains(document.path.left(document.path.lastIndexOf('/'))))
+        {
+            continue;
+        }
+
+        if (isMatch)
+        {
+            result.candidates << document.path;
+        }
+        else if (document.isStale)
+        {
+            result.staleFiles.append({ document.path, document.size, document.modifiedMs });
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Loads the persisted index in the background and refreshes it against the file system afterwards.
+ * A damaged index is rebuilt from scratch for the root it was recorded for.
+ */
+void ContentIndex::restore()
+{
+    updatePool.start([this]()
+                     {
+                         QString storedRoot;
+                         const bool isLoaded = load(storedRoot);
+                         if (isLoaded || !storedRoot.isEmpty())
+                         {
+                             QMetaObject::invokeMethod(this, [this, isLoaded, storedRoot]()
+                                 {
+                                     if (!isLoaded)
+                                     {
+                                         setRootDirectory(storedRoot);
+                                     }
+                                     startUpdate({ rootDirectory() }, true);
+                                     emit stateChanged();
+                                 }, Qt::QueuedConnection);
+                         }
+                     });
+}
+
+/**
+ * @brief Makes the directory the root of the index. A different root drops the current index; the tree is indexed
+ * by running a ContentIndexJob over it.
+ */
+void ContentIndex::setRootDirectory(const QString &directory)
+{
+    const QString cleanDirectory = QDir::cleanPath(directory);
+    {
+        QWriteLocker locker(&lock);
+        if (root == cleanDirectory)
+        {
+            return;
+        }
+
+        clear();
+        root = cleanDirectory;
+    }
+
+    updateWatchedDirectories();
+    emit stateChanged();
+}
+
+/**
+ * @brief Drops the index and its persisted file.
+ */
+void ContentIndex::remove()
+{
+    {
+        QWriteLocker locker(&lock);
+        clear();
+        root.clear();
+    }
+
+    pendingDirectories.clear();
+    updateTimer.stop();
+    updateWatchedDirectories();
+    QFile::remove(indexFilePath);
+    emit stateChanged();
+}
+
+/**
+ * @brief Re-indexes a changed directory shortly, changes arriving in the meantime are applied together. Until then
+ * the files of the directory are stale and queries return them to be compared with the disk.
+ */
+void ContentIndex::scheduleUpdate(const QString &directory)
+{
+    const QString cleanDirectory = QDir::cleanPath(directory);
+    {
+        QWriteLocker locker(&lock);
+        const auto indexed = directories.constFind(cleanDirectory);
+        if (indexed == directories.constEnd())
+        {
+            return;
+        }
+
+        for (const QString &path : indexed->files)
+        {
+            const auto id = documentIds.constFind(path);
+            if (id != documentIds.constEnd())
+            {
+                documents[*id].isStale = true;
+            }
+        }
+    }
+
+    pendingDirectories.insert(cleanDirectory);
+    updateTimer.start();
+}
+
+bool ContentIndex::hasDirectory(const QString &directory) const
+{
+    QReadLocker locker(&lock);
+    return directories.contains(directory);
+}
+
+/**
+ * @brief Returns true if the file is indexed with the given size and modification time and needs no re-reading.
+ */
+bool ContentIndex::isCurrent(const QString &path, qint64 size, qint64 modifiedMs) const
+{
+    QReadLocker locker(&lock);
+    const auto id = documentIds.constFind(path);
+    if (id == documentIds.constEnd())
+    {
+        return false;
+    }
+
+    const Document &document = documents[*id];
+    return document.size == size && document.modifiedMs == modifiedMs;
+}
+
+/**
+ * @brief Indexes the content of a file as a new document, replacing its previous one.
+ *
+ * @param path The file path.
+ * @param size The size the content was read with.
+ * @param modifiedMs The modification time the content was read with.
+ * @param trigrams The distinct trigrams of the content, empty for binary files.
+ */
+void ContentIndex::addDocument(const QString &path, qint64 size, qint64 modifiedMs, const std::vector<quint32> &trigrams)
+{
+    QWriteLocker locker(&lock);
+    if (!isUnder(path, root) || documents.size() >= std::numeric_limits<quint32>::max())
+    {
+        return;
+    }
+
+    removeDocument(path);
+
+    const quint32 id = quint32(documents.size());
+    documents.push_back({ path, size, modifiedMs, true });
+    documentIds.insert(path, id);
+
+    for (quint32 trigram : trigrams)
+    {
+        PostingList &list = postings[trigram];
+        appendVarint(list.data, id - list.lastDocument);
+        list.lastDocument = id;
+        ++list.count;
+    }
+
+    const QString directory = QFileInfo(path).path();
+    registerDirectory(directory);
+    directories[directory].files.insert(path);
+    dirty = true;
+}
+
+/**
+ * @brief Records the current entries of a scanned directory and drops the files and subdirectories that are gone.
+ * The remaining files were compared with the disk by the scan and are no longer stale.
+ *
+ * @param directory The scanned directory.
+ * @param filePaths All files the directory contains now.
+ * @param subdirectoryPaths All subdirectories the directory contains now.
+ */
+void ContentIndex::commitDirectory(const QString &directory, const QStringList &filePaths, const QStringList &subdirectoryPaths)
+{
+    QWriteLocker locker(&lock);
+    if (!isUnder(directory, root))
+    {
+        return;
+    }
+
+    registerDirectory(directory);
+    const IndexedDirectory previous = directories.value(directory);
+    const QSet<QString> files(filePaths.cbegin(), filePaths.cend());
+    const QSet<QString> subdirectories(subdirectoryPaths.cbegin(), subdirectoryPaths.cend());
+
+    for (const QString &path : previous.files)
+    {
+        if (!files.contains(path))
+        {
+            removeDocument(path);
+        }
+    }
+
+    QSet<QString> keptSubdirectories;
+    for (const QString &path : previous.subdirectories)
+    {
+        if (subdirectories.contains(path))
+        {
+            keptSubdirectories.insert(path);
+        }
+        else
+        {
+            removeDirectoryTree(path);
+        }
+    }
+
+    for (const QString &path : filePaths)
+    {
+        const auto id = documentIds.constFind(path);
+        if (id != documentIds.constEnd())
+        {
+            documents[*id].isStale = false;
+        }
+    }
+
+    IndexedDirectory &indexed = directories[directory];
+    indexed.files = files;
+    indexed.subdirectories = keptSubdirectories;
+}
+
+/**
+ * @brief Ends an update. A complete walk makes the index ready and persists it, compacted, if it changed.
+ * Called by ContentIndexJob on its thread.
+ */
+void ContentIndex::finishUpdate(bool isCompleteWalk)
+{
+    bool shouldSave = false;
+    {
+        QWriteLocker locker(&lock);
+        if (isCompleteWalk && !root.isEmpty())
+        {
+            ready = true;
+            shouldSave = dirty;
+            if (shouldSave)
+            {
+                compact();
+            }
+        }
+    }
+
+    if (shouldSave)
+    {
+        save();
+    }
+
+    QMetaObject::invokeMethod(this, [this]()
+        {
+            updateWatchedDirectories();
+            emit stateChanged();
+        }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief Collects the distinct trigrams of a text. ASCII letters are folded to lower case, so the index serves
+ * case-sensitive and case-insensitive searches alike.
+ *
+ * @param data The text.
+ * @param size The length of the text.
+ * @param trigrams Receives the trigrams in the order of their first occurrence.
+ */
+void ContentIndex::extractTrigrams(const char *data, qint64 size, std::vector<quint32> &trigrams)
+{
+    thread_local std::vector<quint64> seen(trigramSpace / 64);
+
+    trigrams.clear();
+    quint32 trigram = 0;
+
+    for (qint64 i = 0; i < size; ++i)
+    {
+        trigram = ((trigram << 8) | uchar(fold(data[i]))) & (trigramSpace - 1);
+        if (i < 2)
+        {
+            continue;
+        }
+
+        quint64 &word = seen[trigram >> 6];
+        const quint64 bit = quint64(1) << (trigram & 63);
+        if ((word & bit) == 0)
+        {
+            word |= bit;
+            trigrams.push_back(trigram);
+        }
+    }
+
+    for (quint32 found : trigrams)
+    {
+        seen[found >> 6] = 0;
+    }
+}
+
+/**
+ * @brief Drops all documents, postings and directories. The lock must be held for writing.
+ */
+void ContentIndex::clear()
+{
+    ready = false;
+    dirty = false;
+    documents.clear();
+    documents.shrink_to_fit();
+    deadDocumentCount = 0;
+    documentIds.clear();
+    postings.clear();
+    directories.clear();
+    watchedDirectories.clear();
+}
+
+/**
+ * @brief Marks the document of a file as dead. The lock must be held for writing.
+ */
+void ContentIndex::removeDocument(const QString &path)
+{
+    const auto id = documentIds.constFind(path);
+    if (id == documentIds.constEnd())
+    {
+        return;
+    }
+
+    Document &document = documents[*id];
+    document.isLive = false;
+    document.path.clear();
+    documentIds.erase(id);
+    ++deadDocumentCount;
+    dirty = true;
+}
+
+/**
+ * @brief Drops a directory with all its files and subdirectories. The lock must be held for writing.
+ */
+void ContentIndex::removeDirectoryTree(const QString &directory)
+{
+    const IndexedDirectory removed = directories.take(directory);
+    for (const QString &path : removed.files)
+    {
+        removeDocument(path);
+    }
+    for (const QString &subdirectory : removed.subdirectories)
+    {
+        removeDirectoryTree(subdirectory);
+    }
+    dirty = true;
+}
+
+/**
+ * @brief Adds a directory and links it into its parents up to the root. The lock must be held for writing.
+ */
+void ContentIndex::registerDirectory(const QString &directory)
+{
+    if (directories.contains(directory))
+    {
+        return;
+    }
+
+    directories.insert(directory, IndexedDirectory());
+
+    const QString parent = QFileInfo(directory).path();
+    if (directory != root && parent != directory && isUnder(parent, root))
+    {
+        registerDirectory(parent);
+        directories[parent].subdirectories.insert(directory);
+    }
+}
+
+/**
+ * @brief Renumbers the live documents and drops the dead ones from all posting lists.
+ * The lock must be held for writing.
+ */
+void ContentIndex::compact()
+{
+    if (deadDocumentCount == 0)
+    {
+        return;
+    }
+
+    std::vector<quint32> newIds(documents.size(), 0);
+    std::vector<Document> liveDocuments;
+    liveDocuments.reserve(documentIds.size());
+
+    for (size_t id = 0; id < documents.size(); ++id)
+    {
+        if (documents[id].isLive)
+        {
+            newIds[id] = quint32(liveDocuments.size());
+            liveDocuments.push_back(std::move(documents[id]));
+        }
+    }
+
+    for (auto list = postings.begin(); list != postings.end();)
+    {
+        PostingList compacted;
+        PostingReader reader(list->data);
+        quint32 id = 0;
+
+        while (reader.next(id))
+        {
+            if (documents[id].isLive)
+            {
+                const quint32 newId = newIds[id];
+                appendVarint(compacted.data, newId - compacted.lastDocument);
+                compacted.lastDocument = newId;
+                ++compacted.count;
+            }
+        }
+
+        if (compacted.count == 0)
+        {
+            list = postings.erase(list);
+        }
+        else
+        {
+            compacted.data.squeeze();
+            *list = std::move(compacted);
+            ++list;
+        }
+    }
+
+    documents.swap(liveDocuments);
+    deadDocumentCount = 0;
+
+    documentIds.clear();
+    documentIds.reserve(qsizetype(documents.size()));
+    for (size_t id = 0; id < documents.size(); ++id)
+    {
+        documentIds.insert(documents[id].path, quint32(id));
+    }
+}
+
+/**
+ * @brief Writes the compacted index to disk.
+ */
+void ContentIndex::save()
+{
+    QByteArray buffer;
+    {
+        QReadLocker locker(&lock);
+        if (root.isEmpty() || deadDocumentCount != 0)
+        {
+            return;
+        }
+
+        const QByteArray rootBytes = root.toUtf8();
+        buffer.append(indexMagic, sizeof(indexMagic));
+        appendValue<quint32>(buffer, indexVersion);
+        appendValue<quint32>(buffer, quint32(documents.size()));
+        appendValue<quint32>(buffer, quint32(postings.size()));
+        appendValue<quint32>(buffer, quint32(rootBytes.size()));
+        buffer.append(rootBytes);
+
+        for (const Document &document : documents)
+        {
+            const QByteArray pathBytes = document.path.toUtf8();
+            appendValue<quint32>(buffer, quint32(pathBytes.size()));
+            buffer.append(pathBytes);
+            appendValue<qint64>(buffer, document.size);
+            appendValue<qint64>(buffer, document.modifiedMs);
+        }
+
+        for (auto list = postings.cbegin(); list != postings.cend(); ++list)
+        {
+            appendValue<quint32>(buffer, list.key());
+            appendValue<quint32>(buffer, list->count);
+            appendValue<quint32>(buffer, list->lastDocument);
+            appendValue<quint32>(buffer, quint32(list->data.size()));
+            buffer.append(list->data);
+        }
+    }
+
+    QSaveFile file(indexFilePath);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(buffer);
+        if (file.commit())
+        {
+            QWriteLocker locker(&lock);
+            dirty = false;
+        }
+    }
+}
+
+/**
+ * @brief Reads the persisted index. Runs on the update pool. A damaged index is rejected as a whole, e.g. a posting
+ * list pointing past the documents or ending inside a varint.
+ *
+ * @param storedRoot Receives the root recorded in the file as soon as it was read, so a damaged index can be rebuilt.
+ * @return True if an index was loaded.
+ */
+bool ContentIndex::load(QString &storedRoot)
+{
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (data == nullptr || size < qint64(sizeof(indexMagic)) || std::memcmp(data, indexMagic, sizeof(indexMagic)) != 0)
+    {
+        return false;
+    }
+
+    IndexReader reader(data + sizeof(indexMagic), size - qint64(sizeof(indexMagic)));
+    quint32 version = 0;
+    quint32 documentTotal = 0;
+    quint32 postingTotal = 0;
+    quint32 rootLength = 0;
+    QByteArray rootBytes;
+
+    if (!reader.read(version) || version != indexVersion || !reader.read(documentTotal) || !reader.read(postingTotal)
+        || !reader.read(rootLength) || !reader.readBytes(rootLength, rootBytes))
+    {
+        return false;
+    }
+    storedRoot = QString::fromUtf8(rootBytes);
+
+    std::vector<Document> loadedDocuments;
+    loadedDocuments.reserve(std::min<quint32>(documentTotal, quint32(size / 20)));
+    for (quint32 i = 0; i < documentTotal; ++i)
+    {
+        quint32 pathLength = 0;
+        QByteArray pathBytes;
+        Document document;
+        if (!reader.read(pathLength) || !reader.readBytes(pathLength, pathBytes)
+            || !reader.read(document.size) || !reader.read(document.modifiedMs))
+        {
+            return false;
+        }
+        document.path = QString::fromUtf8(pathBytes);
+        loadedDocuments.push_back(std::move(document));
+    }
+
+    QHash<quint32, PostingList> loadedPostings;
+    loadedPostings.reserve(std::min<quint32>(postingTotal, trigramSpace));
+    for (quint32 i = 0; i < postingTotal; ++i)
+    {
+        quint32 trigram = 0;
+        quint32 dataLength = 0;
+        PostingList list;
+        if (!reader.read(trigram) || !reader.read(list.count) || !reader.read(list.lastDocument)
+            || !reader.read(dataLength) || !reader.readBytes(dataLength, list.data)
+            || !isValidPostingList(list.data, list.count, list.lastDocument, documentTotal))
+        {
+            return false;
+        }
+        loadedPostings.insert(trigram, std::move(list));
+    }
+
+    QWriteLocker locker(&lock);
+    clear();
+    root = QString::fromUtf8(rootBytes);
+    documents.swap(loadedDocuments);
+    postings.swap(loadedPostings);
+
+    for (size_t id = 0; id < documents.size(); ++id)
+    {
+        const QString &path = documents[id].path;
+        const QString directory = QFileInfo(path).path();
+        documentIds.insert(path, quint32(id));
+        registerDirectory(directory);
+        directories[directory].files.insert(path);
+    }
+
+    ready = true;
+    return true;
+}
+
+/**
+ * @brief Runs a ContentIndexJob over directories on the update pool.
+ */
+void ContentIndex::startUpdate(const QStringList &directoriesToScan, bool isRecursive)
+{
+    if (directoriesToScan.isEmpty() || rootDirectory().isEmpty())
+    {
+        return;
+    }
+
+    ContentIndexJob *job = new ContentIndexJob(directoriesToScan, isRecursive);
+    connect(job, &BackgroundJob::finished, job, &QObject::deleteLater);
+    updatePool.start(job);
+}
+
+/**
+ * @brief Compares the next slice of the indexed files with the disk and re-indexes the directories of the changed
+ * ones, so a search only has to look at the files marked stale. Runs on the update pool.
+ */
+void ContentIndex::refreshDocuments()
+{
+    QList<IndexedFile> slice;
+    {
+        QWriteLocker locker(&lock);
+        if (!ready)
+        {
+            return;
+        }
+
+        size_t id = refreshCursor < documents.size() ? refreshCursor : 0;
+        for (; id < documents.size() && slice.size() < refreshBatchSize; ++id)
+        {
+            const Document &document = documents[id];
+            if (document.isLive && !document.isStale)
+            {
+                slice.append({ document.path, document.size, document.modifiedMs });
+            }
+        }
+        refreshCursor = id;
+    }
+
+    QSet<QString> changedDirectories;
+    for (const IndexedFile &indexedFile : std::as_const(slice))
+    {
+        const QFileInfo fileInfo(indexedFile.path);
+        if (!fileInfo.exists() || fileInfo.size() != indexedFile.size
+            || fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch() != indexedFile.modifiedMs)
+        {
+            changedDirectories.insert(fileInfo.path());
+        }
+    }
+
+    if (!changedDirectories.isEmpty())
+    {
+        QMetaObject::invokeMethod(this, [this, changedDirectories]()
+            {
+                for (const QString &directory : changedDirectories)
+                {
+                    scheduleUpdate(directory);
+                }
+            }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Watches the indexed directories, the shallowest first if there are more than the watcher limit.
+ * Queries walk the unwatched directories instead of trusting the index, and the refresh on the next start picks
+ * up their changes.
+ */
+void ContentIndex::updateWatchedDirectories()
+{
+    QStringList wanted;
+    {
+        QReadLocker locker(&lock);
+        wanted = directories.keys();
+    }
+
+    if (wanted.size() > maxWatchedDirectories)
+    {
+        std::partial_sort(wanted.begin(), wanted.begin() + maxWatchedDirectories, wanted.end(),
+                          [](const QString &a, const QString &b) { return a.count('/') < b.count('/'); });
+        wanted.resize(maxWatchedDirectories);
+    }
+
+    const QSet<QString> wantedSet(wanted.cbegin(), wanted.cend());
+    const QStringList watched = watcher.directories();
+    const QSet<QString> watchedSet(watched.cbegin(), watched.cend());
+
+    QStringList unwanted;
+    for (const QString &path : watched)
+    {
+        if (!wantedSet.contains(path))
+        {
+            unwanted << path;
+        }
+    }
+    if (!unwanted.isEmpty())
+    {
+        watcher.removePaths(unwanted);
+    }
+
+    QStringList added;
+    for (const QString &path : std::as_const(wanted))
+    {
+        if (!watchedSet.contains(path))
+        {
+            added << path;
+        }
+    }
+    QSet<QString> watchedNow = wantedSet;
+    if (!added.isEmpty())
+    {
+        const QStringList failed = watcher.addPaths(added);
+        for (const QString &path : failed)
+        {
+            watchedNow.remove(path);
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    watchedDirectories.swap(watchedNow);
+}
+
+/**
+ * @brief Decodes a posting list into document ids. The lock must be held.
+ */
+std::vector<quint32> ContentIndex::decode(const PostingList &list) const
+{
+    std::vector<quint32> ids;
+    ids.reserve(list.count);
+
+    PostingReader reader(list.data);
+    quint32 id = 0;
+    while (reader.next(id))
+    {
+        ids.push_back(id);
+    }
+    return ids;
+}
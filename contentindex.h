@@ -0,0 +1,114 @@
+#ifndef CONTENTINDEX_H
+#define CONTENTINDEX_H
+
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <vector>
+
+struct IndexedFile
+{
+    QString path;
+    qint64 size = 0;
+    qint64 modifiedMs = 0;
+};
+
+struct ContentIndexQuery
+{
+    QStringList candidates;
+    QList<IndexedFile> staleFiles;
+    QStringList unwatchedDirectories;
+};
+
+class ContentIndex : public QObject
+{
+    Q_OBJECT
+public:
+    static ContentIndex& instance();
+
+    QString rootDirectory() const;
+    bool isReady() const;
+    bool covers(const QString &directory) const;
+    qsizetype documentCount() const;
+    bool query(const QByteArray &literal, const QString &directory, ContentIndexQuery &result) const;
+
+    void restore();
+    void setRootDirectory(const QString &root);
+    void remove();
+    void scheduleUpdate(const QString &directory);
+
+    bool hasDirectory(const QString &directory) const;
+    bool isCurrent(const QString &path, qint64 size, qint64 modifiedMs) const;
+    void addDocument(const QString &path, qint64 size, qint64 modifiedMs, const std::vector<quint32> &trigrams);
+    void commitDirectory(const QString &directory, const QStringList &filePaths, const QStringList &subdirectoryPaths);
+    void finishUpdate(bool isCompleteWalk);
+
+    static void extractTrigrams(const char *data, qint64 size, std::vector<quint32> &trigrams);
+
+private:
+    ContentIndex();
+    ~ContentIndex();
+
+    struct Document
+    {
+        QString path;
+        qint64 size = 0;
+        qint64 modifiedMs = 0;
+        bool isLive = true;
+        bool isStale = false;
+    };
+
+    struct PostingList
+    {
+        QByteArray data;
+        quint32 lastDocument = 0;
+        quint32 count = 0;
+    };
+
+    struct IndexedDirectory
+    {
+        QSet<QString> files;
+        QSet<QString> subdirectories;
+    };
+
+    mutable QReadWriteLock lock;
+    QString root;
+    bool ready = false;
+    bool dirty = false;
+    std::vector<Document> documents;
+    qsizetype deadDocumentCount = 0;
+    QHash<QString, quint32> documentIds;
+    QHash<quint32, PostingList> postings;
+    QHash<QString, IndexedDirectory> directories;
+    QSet<QString> watchedDirectories;
+
+    QString indexFilePath;
+    QThreadPool updatePool;
+    QFileSystemWatcher watcher;
+    QTimer updateTimer;
+    QSet<QString> pendingDirectories;
+    QTimer refreshTimer;
+    size_t refreshCursor = 0;
+
+    void clear();
+    void removeDocument(const QString &path);
+    void removeDirectoryTree(const QString &directory);
+    void registerDirectory(const QString &directory);
+    void compact();
+    void save();
+    bool load(QString &storedRoot);
+    void startUpdate(const QStringList &directoriesToScan, bool isRecursive);
+    void updateWatchedDirectories();
+    void refreshDocuments();
+    std::vector<quint32> decode(const PostingList &list) const;
+
+signals:
+    void stateChanged();
+};
+
+#endif // CONTENTINDEX_H
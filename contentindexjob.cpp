@@ -0,0 +1,174 @@
+#include "contentindexjob.h"
+#include "contentindex.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QThread>
+#include <QTimeZone>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @file contentindexjob.h
+ * @brief The ContentIndexJob class brings the ContentIndex up to date with directories on disk.
+ * Every directory is walked by its own pool task; files whose size and modification time match their indexed
+ * document are skipped, the others are read and their trigrams added. A recursive job walks whole trees and
+ * builds or refreshes the index, a non-recursive one applies the changes reported for single directories and only
+ * descends into subdirectories the index does not know yet.
+ */
+
+namespace
+{
+const qint64 binarySniffSize = 8192;
+const qint64 readThreshold = 64 * 1024;
+const qint64 maxFileSize = 256 * 1024 * 1024;
+const int progressPollMs = 100;
+}
+
+ContentIndexJob::ContentIndexJob(const QStringList &directories, bool isRecursive, QObject *parent)
+    : BackgroundJob(tr("Indexing contents of %1").arg(QDir::toNativeSeparators(directories.value(0))), parent),
+      scannedDirectories(directories), recursive(isRecursive), filesFound(0), filesChecked(0), filesIndexed(0)
+{
+    indexPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+/**
+ * @brief Returns how many files were (re-)read, files that did not change are not counted.
+ */
+qint64 ContentIndexJob::indexedFileCount() const
+{
+    return filesIndexed;
+}
+
+/**
+ * @brief Walks the directories on the index pool and reports progress until every directory task finished.
+ */
+void ContentIndexJob::execute()
+{
+    for (const QString &directory : std::as_const(scannedDirectories))
+    {
+        const QString cleanDirectory = QDir::cleanPath(directory);
+        indexPool.start([this, cleanDirectory]()
+                        {
+                            indexDirectory(cleanDirectory, recursive);
+                        });
+    }
+
+    while (!indexPool.waitForDone(progressPollMs))
+    {
+        reportProgress(filesChecked, filesFound);
+    }
+    reportProgress(filesChecked, filesFound);
+
+    ContentIndex::instance().finishUpdate(recursive && !isCancelled());
+}
+
+/**
+ * @brief Indexes the changed files of a directory and commits its entries. Runs on the index pool.
+ * Hidden entries are skipped and symbolic links to directories are not followed, like in a content search.
+ *
+ * @param directory The directory.
+ * @param isRecursive Walks all subdirectories, otherwise only the ones missing from the index.
+ */
+void ContentIndexJob::indexDirectory(const QString &directory, bool isRecursive)
+{
+    // A removed directory is dropped by the update of its parent.
+    if (isCancelled() || !QFileInfo(directory).isDir())
+    {
+        return;
+    }
+
+    ContentIndex &index = ContentIndex::instance();
+    QList<QFileInfo> files;
+    QStringList filePaths;
+    QStringList subdirectoryPaths;
+
+    QDirIterator iterator(directory, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    while (iterator.hasNext())
+    {
+        const QFileInfo fileInfo = iterator.nextFileInfo();
+        if (fileInfo.isDir())
+        {
+            if (!fileInfo.isSymLink())
+            {
+                const QString subdirectory = fileInfo.filePath();
+                subdirectoryPaths << subdirectory;
+                if (isRecursive || !index.hasDirectory(subdirectory))
+                {
+                    indexPool.start([this, subdirectory]()
+                                    {
+                                        indexDirectory(subdirectory, true);
+                                    });
+                }
+            }
+        }
+        else
+        {
+            files << fileInfo;
+            filePaths << fileInfo.filePath();
+        }
+    }
+    filesFound += files.size();
+
+    for (const QFileInfo &fileInfo : std::as_const(files))
+    {
+        if (isCancelled())
+        {
+            return;
+        }
+
+        const qint64 modifiedMs = fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+        if (!index.isCurrent(fileInfo.filePath(), fileInfo.size(), modifiedMs))
+        {
+            indexFile(fileInfo.filePath(), fileInfo.size(), modifiedMs);
+            ++filesIndexed;
+        }
+        ++filesChecked;
+    }
+
+    index.commitDirectory(directory, filePaths, subdirectoryPaths);
+}
+
+/**
+ * @brief Reads a file and adds its trigrams to the index. Binary and very large files are indexed without
+ * trigrams, so they are remembered as unchanged but never returned as candidates.
+ */
+void ContentIndexJob::indexFile(const QString &path, qint64 size, qint64 modifiedMs)
+{
+    std::vector<quint32> trigrams;
+    QFile file(path);
+
+    if (size > 0 && size <= maxFileSize && file.open(QIODevice::ReadOnly))
+    {
+        QByteArray content;
+        const char *data = nullptr;
+        uchar *mapped = nullptr;
+        qint64 length = size;
+
+        if (size <= readThreshold)
+        {
+            content = file.read(size);
+            data = content.constData();
+            length = content.size();
+        }
+        else
+        {
+            mapped = file.map(0, size);
+            data = reinterpret_cast<const char*>(mapped);
+        }
+
+        if (data != nullptr && std::memchr(data, '\0', std::min(length, binarySniffSize)) == nullptr)
+        {
+            ContentIndex::extractTrigrams(data, length, trigrams);
+        }
+
+        if (mapped != nullptr)
+        {
+            file.unmap(mapped);
+        }
+    }
+
+    ContentIndex::instance().addDocument(path, size, modifiedMs, trigrams);
+}
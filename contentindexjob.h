@@ -0,0 +1,33 @@
+#ifndef CONTENTINDEXJOB_H
+#define CONTENTINDEXJOB_H
+
+#include "backgroundjob.h"
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+
+class ContentIndexJob : public BackgroundJob
+{
+    Q_OBJECT
+public:
+    ContentIndexJob(const QStringList &directories, bool isRecursive, QObject *parent = nullptr);
+
+    qint64 indexedFileCount() const;
+
+protected:
+    void execute() override;
+
+private:
+    QStringList scannedDirectories;
+    bool recursive;
+
+    QThreadPool indexPool;
+    std::atomic<qint64> filesFound;
+    std::atomic<qint64> filesChecked;
+    std::atomic<qint64> filesIndexed;
+
+    void indexDirectory(const QString &directory, bool isRecursive);
+    void indexFile(const QString &path, qint64 size, qint64 modifiedMs);
+};
+
+#endif // CONTENTINDEXJOB_H
@@ -0,0 +1,122 @@
+#include "contentsearchdialog.h"
+#include "ui_contentsearchdialog.h"
+#include <QDir>
+#include <QHeaderView>
+#include <QMessageBox>
+
+/**
+ * @file contentsearchdialog.h
+ * @brief The ContentSearchDialog class searches the content of all files below a directory.
+ * The search runs as a ContentSearchJob on the job queue, so it shows its progress in the status bar and can be
+ * cancelled there; matching lines are listed while the search is still running.
+ */
+
+ContentSearchDialog::ContentSearchDialog(const QString &rootDirectory, JobQueue *jobQueue, QWidget *parent)
+    : QDialog(parent), ui(new Ui::ContentSearchDialog), root(rootDirectory), queue(jobQueue)
+{
+    ui->setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    resultsModel = new ContentSearchResultsModel(this);
+    resultsModel->setRootDirectory(root);
+    ui->QTableView_Results->setModel(resultsModel);
+    ui->QTableView_Results->horizontalHeader()->resizeSection(0, 260);
+    ui->QTableView_Results->horizontalHeader()->resizeSection(1, 60);
+    ui->QTableView_Results->verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 4);
+
+    connect(ui->QTableView_Results, &QTableView::activated, this, &ContentSearchDialog::onResultActivated);
+
+    ui->QLabel_Root->setText(tr("Search in %1").arg(QDir::toNativeSeparators(root)));
+    ui->QLineEdit_Pattern->setFocus();
+}
+
+ContentSearchDialog::~ContentSearchDialog()
+{
+    cancelSearch();
+    delete ui;
+}
+
+/**
+ * \brief Slot triggered on 'Search' button click. Cancels the running search and starts a new one.
+ */
+void ContentSearchDialog::on_QPushButton_Search_clicked()
+{
+    cancelSearch();
+    resultsModel->clear();
+
+    ContentSearchJob *job = new ContentSearchJob(root, ui->QLineEdit_Pattern->text(), ui->QCheckBox_Regex->isChecked(),
+                                                 ui->QCheckBox_CaseSensitive->isChecked());
+    if (!job->isValid())
+    {
+        const QString error = job->errorString();
+        delete job;
+        ui->QLabel_Status->setText(error.isEmpty() ? tr("Enter a text to search for") : tr("Invalid expression: %1").arg(error));
+        return;
+    }
+
+    searchJob = job;
+    connect(job, &ContentSearchJob::matchesFound, this, &ContentSearchDialog::onMatchesFound);
+    connect(job, &BackgroundJob::finished, this, &ContentSearchDialog::onSearchFinished);
+
+    ui->QLabel_Status->setText(tr("Searching..."));
+    searchTimer.start();
+    queue->enqueue(job);
+}
+
+/**
+ * \brief Appends a batch of matches of the running search.
+ */
+void ContentSearchDialog::onMatchesFound(const QList<ContentMatch> &matches)
+{
+    if (sender() != searchJob)
+    {
+        return;
+    }
+
+    resultsModel->appendMatches(matches);
+    ui->QLabel_Status->setText(tr("Searching... %n match(es)", nullptr, resultsModel->rowCount()));
+}
+
+/**
+ * \brief Shows the summary of the finished search.
+ */
+void ContentSearchDialog::onSearchFinished()
+{
+    if (sender() != searchJob)
+    {
+        return;
+    }
+
+    const QString summary = tr("%n match(es)", nullptr, resultsModel->rowCount())
+                            + tr(" in %n file(s)", nullptr, int(searchJob->scannedFileCount()))
+                            + tr(", %1 ms").arg(searchTimer.elapsed())
+                            + (searchJob->usedIndex() ? tr(", using the content index") : QString());
+    ui->QLabel_Status->setText(searchJob->isCancelled() ? tr("Cancelled, ") + summary : summary);
+    searchJob = nullptr;
+}
+
+/**
+ * \brief Hands the file and line of the activated match to the caller.
+ */
+void ContentSearchDialog::onResultActivated(const QModelIndex &index)
+{
+    if (!index.isValid())
+    {
+        return;
+    }
+
+    const ContentMatch &match = resultsModel->match(index.row());
+    emit matchActivated(match.path, match.lineNumber);
+}
+
+/**
+ * \brief Stops the running search, its remaining matches are ignored.
+ */
+void ContentSearchDialog::cancelSearch()
+{
+    if (searchJob)
+    {
+        searchJob->cancel();
+        searchJob = nullptr;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef CONTENTSEARCHDIALOG_H
+#define CONTENTSEARCHDIALOG_H
+
+#include "contentsearchjob.h"
+#include "contentsearchresultsmodel.h"
+#include "jobqueue.h"
+#include <QDialog>
+#include <QPointer>
+#include <QElapsedTimer>
+
+namespace Ui {
+class ContentSearchDialog;
+}
+
+class ContentSearchDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit ContentSearchDialog(const QString &rootDirectory, JobQueue *jobQueue, QWidget *parent = nullptr);
+    ~ContentSearchDialog();
+
+signals:
+    void matchActivated(const QString &path, int lineNumber);
+
+private slots:
+    void on_QPushButton_Search_clicked();
+    void onMatchesFound(const QList<ContentMatch> &matches);
+    void onSearchFinished();
+    void onResultActivated(const QModelIndex &index);
+
+private:
+    Ui::ContentSearchDialog *ui;
+    QString root;
+    JobQueue *queue;
+    ContentSearchResultsModel *resultsModel;
+    QPointer<ContentSearchJob> searchJob;
+    QElapsedTimer searchTimer;
+
+    void cancelSearch();
+};
+
+#endif // CONTENTSEARCHDIALOG_H
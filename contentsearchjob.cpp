@@ -0,0 +1,600 @@
+#include "contentsearchjob.h"
+#include "contentindex.h"
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSet>
+#include <QThread>
+#include <QTimeZone>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @file contentsearchjob.h
+ * @brief The ContentSearchJob class finds the lines containing a text or regular expression in every file of a subtree.
+ * Every directory is walked by its own pool task, which queues its subdirectories and then scans its files, so both
+ * walking and scanning run on all cores. Files are memory-mapped (small ones are read), files with a NUL byte in
+ * their first kilobytes are skipped as binary, and the text is located with memchr on its rarest byte before
+ * it is compared. A regular expression is only evaluated on lines containing the literal text it requires.
+ * Below the root of the ContentIndex only the files containing all trigrams of that literal are scanned, plus the
+ * indexed files whose size or modification time changed since and the subtrees the index does not watch.
+ * Matches are collected per directory and streamed to the GUI in batches.
+ */
+
+namespace
+{
+const qint64 binarySniffSize = 8192;
+const qint64 readThreshold = 64 * 1024;
+const qint64 maxFileSize = 256 * 1024 * 1024;
+const int maxMatchesPerFile = 1000;
+const qint64 maxTotalMatches = 100000;
+const int maxLineTextLength = 300;
+const int flushIntervalMs = 100;
+const int flushMatchCount = 256;
+const int progressPollMs = 100;
+const int indexedFilesPerTask = 64;
+
+inline char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c | 0x20) : c;
+}
+
+/**
+ * @brief Ranks how common a byte is in text files, lower is more common. Used to pick the byte searched with memchr.
+ */
+int byteFrequencyRank(char c)
+{
+    static const char commonBytes[] = " etaoinsrhldcumfpgwybvkxjqz\n0123456789_.,;()=\"'-/";
+    const char *found = std::strchr(commonBytes, fold(c));
+    return (found != nullptr && c != '\0') ? int(found - commonBytes) : int(sizeof(commonBytes));
+}
+
+class LiteralFinder
+{
+public:
+    LiteralFinder(const QByteArray &needle, bool caseSensitive) : caseSensitive(caseSensitive)
+    {
+        pattern = needle;
+        if (!caseSensitive)
+        {
+            for (char &c : pattern)
+            {
+                c = fold(c);
+            }
+        }
+
+        anchor = 0;
+        for (int i = 1; i < pattern.size(); ++i)
+        {
+            if (byteFrequencyRank(pattern.at(i)) > byteFrequencyRank(pattern.at(anchor)))
+            {
+                anchor = i;
+            }
+        }
+
+        if (!pattern.isEmpty())
+        {
+            anchorLower = pattern.at(anchor);
+            anchorUpper = (!caseSensitive && anchorLower >= 'a' && anchorLower <= 'z') ? char(anchorLower & ~0x20) : anchorLower;
+        }
+    }
+
+    /**
+     * @brief Returns the start of the first occurrence in [begin, end), or nullptr.
+     */
+    const char* find(const char *begin, const char *end) const
+    {
+        const qsizetype length = pattern.size();
+        if (end - begin < length)
+        {
+            return nullptr;
+        }
+
+        const char *position = begin + anchor;
+        const char *limit = end - (length - 1 - anchor);
+        const char *nextLower = nullptr;
+        const char *nextUpper = nullptr;
+
+        while (position < limit)
+        {
+            if (nextLower < position)
+            {
+                nextLower = static_cast<const char*>(std::memchr(position, anchorLower, limit - position));
+                if (nextLower == nullptr)
+                {
+                    nextLower = limit;
+                }
+            }
+            if (anchorUpper != anchorLower && nextUpper < position)
+            {
+                nextUpper = static_cast<const char*>(std::memchr(position, anchorUpper, limit - position));
+                if (nextUpper == nullptr)
+                {
+                    nextUpper = limit;
+                }
+            }
+
+            const char *hit = (anchorUpper != anchorLower) ? std::min(nextLower, nextUpper) : nextLower;
+            if (hit >= limit)
+            {
+                return nullptr;
+            }
+
+            const char *start = hit - anchor;
+            if (matchesAt(start))
+            {
+                return start;
+            }
+            position = hit + 1;
+        }
+
+        return nullptr;
+    }
+
+private:
+    QByteArray pattern;
+    bool caseSensitive;
+    int anchor = 0;
+    char anchorLower = 0;
+    char anchorUpper = 0;
+
+    bool matchesAt(const char *start) const
+    {
+        if (caseSensitive)
+        {
+            return std::memcmp(start, pattern.constData(), pattern.size()) == 0;
+        }
+
+        for (int i = 0; i < pattern.size(); ++i)
+        {
+            if (fold(start[i]) != pattern.at(i))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+}
+
+ContentSearchJob::ContentSearchJob(const QString &rootDirectory, const QString &pattern, bool isRegex, bool isCaseSensitive, QObject *parent)
+    : BackgroundJob(tr("Searching for \"%1\"").arg(pattern), parent), root(rootDirectory), useRegex(isRegex), caseSensitive(isCaseSensitive),
+      filesFound(0), filesScanned(0), matchTotal(0)
+{
+    if (useRegex)
+    {
+        regex.setPattern(pattern);
+        regex.setPatternOptions(caseSensitive ? QRegularExpression::NoPatternOption : QRegularExpression::CaseInsensitiveOption);
+        regex.optimize();
+        literal = requiredLiteral(pattern);
+
+        // The prefilter only folds ASCII letters, a non-ASCII literal could miss case-insensitive matches.
+        if (!caseSensitive && std::any_of(literal.cbegin(), literal.cend(), [](char c) { return uchar(c) >= 0x80; }))
+        {
+            literal.clear();
+        }
+    }
+    else
+    {
+        literal = pattern.toUtf8();
+    }
+
+    scanPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+/**
+ * @brief Returns false if the pattern is empty or not a valid regular expression.
+ */
+bool ContentSearchJob::isValid() const
+{
+    return useRegex ? (regex.isValid() && !regex.pattern().isEmpty()) : !literal.isEmpty();
+}
+
+QString ContentSearchJob::errorString() const
+{
+    return useRegex ? regex.errorString() : QString();
+}
+
+QString ContentSearchJob::rootDirectory() const
+{
+    return root;
+}
+
+qint64 ContentSearchJob::scannedFileCount() const
+{
+    return filesScanned;
+}
+
+qint64 ContentSearchJob::matchCount() const
+{
+    return matchTotal;
+}
+
+/**
+ * @brief Returns true if the candidate files came from the content index instead of walking the subtree.
+ */
+bool ContentSearchJob::usedIndex() const
+{
+    return isIndexed;
+}
+
+/**
+ * @brief Extracts the longest run of plain characters every match of a regular expression must contain.
+ * Returns an empty literal for alternations, where no single run is required, and for inline options such as (?i).
+ *
+ * @param pattern The regular expression.
+ * @return The required literal, in the pattern's case.
+ */
+QByteArray ContentSearchJob::requiredLiteral(const QString &pattern)
+{
+    if (pattern.contains("(?"))
+    {
+        return QByteArray();
+    }
+
+    QString best;
+    QString current;
+    int depth = 0;
+
+    auto endRun = [&]()
+    {
+        if (depth == 0 && current.size() > best.size())
+        {
+            best = current;
+        }
+        current.clear();
+    };
+
+    for (qsizetype i = 0; i < pattern.size(); ++i)
+    {
+        const QChar c = pattern.at(i);
+
+        if (c == '|')
+        {
+            return QByteArray();
+        }
+
+        if (c == '\\' && i + 1 < pattern.size())
+        {
+            const QChar escaped = pattern.at(++i);
+            if (escaped.isLetterOrNumber())
+            {
+                endRun();
+            }
+            else
+            {
+                current += escaped;
+            }
+            continue;
+        }
+
+        if (c == '*' || c == '?' || c == '{')
+        {
+            // The preceding character is optional.
+            current.chop(1);
+            endRun();
+            if (c == '{')
+            {
+                while (i < pattern.size() && pattern.at(i) != '}')
+                {
+                    ++i;
+                }
+            }
+            continue;
+        }
+
+        if (c == '+')
+        {
+            endRun();
+            continue;
+        }
+
+        if (c == '[')
+        {
+            endRun();
+            while (i < pattern.size() && pattern.at(i) != ']')
+            {
+                i += pattern.at(i) == '\\' ? 2 : 1;
+            }
+            continue;
+        }
+
+        if (c == '(')
+        {
+            endRun();
+            ++depth;
+            continue;
+        }
+
+        if (c == ')')
+        {
+            endRun();
+            --depth;
+            continue;
+        }
+
+        if (c == '.' || c == '^' || c == '$')
+        {
+            endRun();
+            continue;
+        }
+
+        current += c;
+    }
+
+    endRun();
+    return best.toUtf8();
+}
+
+/**
+ * @brief Scans the candidate files of the content index, or walks the subtree, on the scan pool and reports
+ * progress until every task finished.
+ */
+void ContentSearchJob::execute()
+{
+    flushTimer.start();
+
+    ContentIndexQuery indexQuery;
+    isIndexed = ContentIndex::instance().query(literal, root, indexQuery);
+
+    if (isIndexed)
+    {
+        filesFound = indexQuery.candidates.size();
+        for (qsizetype i = 0; i < indexQuery.candidates.size(); i += indexedFilesPerTask)
+        {
+            const QStringList files = indexQuery.candidates.mid(i, indexedFilesPerTask);
+            scanPool.start([this, files]()
+                           {
+                               scanFiles(files);
+                           });
+        }
+        for (qsizetype i = 0; i < indexQuery.staleFiles.size(); i += indexedFilesPerTask)
+        {
+            const QList<IndexedFile> files = indexQuery.staleFiles.mid(i, indexedFilesPerTask);
+            scanPool.start([this, files]()
+                           {
+                               scanChangedFiles(files);
+                           });
+        }
+        for (const QString &directory : std::as_const(indexQuery.unwatchedDirectories))
+        {
+            scanPool.start([this, directory]()
+                           {
+                               scanDirectory(directory);
+                           });
+        }
+    }
+    else
+    {
+        const QString rootPath = root;
+        scanPool.start([this, rootPath]()
+                       {
+                           scanDirectory(rootPath);
+                       });
+    }
+
+    while (!scanPool.waitForDone(progressPollMs))
+    {
+        reportProgress(filesScanned, filesFound);
+    }
+
+    QList<ContentMatch> noMatches;
+    collect(noMatches, true);
+    reportProgress(filesScanned, filesFound);
+}
+
+/**
+ * @brief Queues a task for every subdirectory and scans the files of the directory. Runs on the scan pool.
+ * Hidden entries are skipped and symbolic links to directories are not followed.
+ */
+void ContentSearchJob::scanDirectory(const QString &directory)
+{
+    if (isCancelled() || matchTotal >= maxTotalMatches)
+    {
+        return;
+    }
+
+    QStringList files;
+    QDirIterator iterator(directory, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+    while (iterator.hasNext())
+    {
+        const QFileInfo fileInfo = iterator.nextFileInfo();
+        if (fileInfo.isDir())
+        {
+            if (!fileInfo.isSymLink())
+            {
+                const QString subdirectory = fileInfo.filePath();
+                scanPool.start([this, subdirectory]()
+                               {
+                                   scanDirectory(subdirectory);
+                               });
+            }
+        }
+        else if (fileInfo.size() > 0 && fileInfo.size() <= maxFileSize)
+        {
+            files << fileInfo.filePath();
+        }
+    }
+    filesFound += files.size();
+
+    scanFiles(files);
+}
+
+/**
+ * @brief Scans the stale indexed files that are no candidates but changed on disk since they were indexed, and asks
+ * the index to re-read their directories. Runs on the scan pool.
+ */
+void ContentSearchJob::scanChangedFiles(const QList<IndexedFile> &indexedFiles)
+{
+    QStringList files;
+    QSet<QString> directories;
+    for (const IndexedFile &indexedFile : indexedFiles)
+    {
+        if (isCancelled())
+        {
+            return;
+        }
+
+        const QFileInfo fileInfo(indexedFile.path);
+        if (fileInfo.exists() && (fileInfo.size() != indexedFile.size
+                                  || fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch() != indexedFile.modifiedMs))
+        {
+            if (fileInfo.size() > 0 && fileInfo.size() <= maxFileSize)
+            {
+                files << indexedFile.path;
+            }
+            directories.insert(fileInfo.path());
+        }
+    }
+
+    for (const QString &directory : std::as_const(directories))
+    {
+        QMetaObject::invokeMethod(&ContentIndex::instance(), [directory]()
+                                  {
+                                      ContentIndex::instance().scheduleUpdate(directory);
+                                  }, Qt::QueuedConnection);
+    }
+
+    filesFound += files.size();
+    scanFiles(files);
+}
+
+/**
+ * @brief Scans files and collects their matches. Runs on the scan pool.
+ */
+void ContentSearchJob::scanFiles(const QStringList &files)
+{
+    QList<ContentMatch> matches;
+    for (const QString &path : files)
+    {
+        if (isCancelled() || matchTotal >= maxTotalMatches)
+        {
+            break;
+        }
+
+        scanFile(path, matches);
+        ++filesScanned;
+
+        if (matches.size() >= flushMatchCount)
+        {
+            collect(matches, false);
+        }
+    }
+
+    collect(matches, false);
+}
+
+/**
+ * @brief Reads small files and maps large ones, then scans their content.
+ */
+void ContentSearchJob::scanFile(const QString &path, QList<ContentMatch> &matches)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    const qint64 size = file.size();
+    if (size <= readThreshold)
+    {
+        const QByteArray content = file.read(size);
+        scanBuffer(path, content.constData(), content.size(), matches);
+        return;
+    }
+
+    uchar *data = file.map(0, size);
+    if (data != nullptr)
+    {
+        scanBuffer(path, reinterpret_cast<const char*>(data), size, matches);
+        file.unmap(data);
+    }
+}
+
+/**
+ * @brief Finds the matching lines of one file, unless it looks binary.
+ */
+void ContentSearchJob::scanBuffer(const QString &path, const char *data, qint64 size, QList<ContentMatch> &matches)
+{
+    if (std::memchr(data, '\0', std::min(size, binarySniffSize)) != nullptr)
+    {
+        return;
+    }
+
+    const LiteralFinder finder(literal, caseSensitive);
+    const char *end = data + size;
+    const char *position = data;
+    const char *counted = data;
+    int lineNumber = 1;
+    int fileMatches = 0;
+
+    while (position < end && fileMatches < maxMatchesPerFile)
+    {
+        const char *hit = literal.isEmpty() ? position : finder.find(position, end);
+        if (hit == nullptr)
+        {
+            break;
+        }
+
+        const char *lineStart = hit;
+        while (lineStart > position && lineStart[-1] != '\n')
+        {
+            --lineStart;
+        }
+        const char *lineEnd = static_cast<const char*>(std::memchr(hit, '\n', end - hit));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+
+        lineNumber += int(std::count(counted, lineStart, '\n'));
+        counted = lineStart;
+
+        qsizetype lineLength = lineEnd - lineStart;
+        if (lineLength > 0 && lineStart[lineLength - 1] == '\r')
+        {
+            --lineLength;
+        }
+
+        if (!useRegex || regex.match(QString::fromUtf8(lineStart, lineLength)).hasMatch())
+        {
+            ContentMatch match;
+            match.path = path;
+            match.lineNumber = lineNumber;
+            match.lineText = QString::fromUtf8(lineStart, std::min<qsizetype>(lineLength, maxLineTextLength)).trimmed();
+            matches << match;
+            ++fileMatches;
+        }
+
+        position = lineEnd + 1;
+    }
+}
+
+/**
+ * @brief Moves matches to the shared batch and streams the batch to the GUI when it is large or old enough.
+ *
+ * @param matches The matches of one task, emptied by this call.
+ * @param force Streams the batch regardless of its size, used when the search ends.
+ */
+void ContentSearchJob::collect(QList<ContentMatch> &matches, bool force)
+{
+    QList<ContentMatch> batch;
+    {
+        QMutexLocker locker(&pendingMutex);
+        matchTotal += matches.size();
+        pendingMatches.append(std::move(matches));
+        matches.clear();
+
+        if (pendingMatches.isEmpty()
+            || (!force && pendingMatches.size() < flushMatchCount && flushTimer.elapsed() < flushIntervalMs))
+        {
+            return;
+        }
+
+        batch.swap(pendingMatches);
+        flushTimer.restart();
+    }
+
+    emit matchesFound(batch);
+}
@@ -0,0 +1,65 @@
+#ifndef CONTENTSEARCHJOB_H
+#define CONTENTSEARCHJOB_H
+
+#include "backgroundjob.h"
+#include "contentindex.h"
+#include <QList>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <atomic>
+
+struct ContentMatch
+{
+    QString path;
+    int lineNumber = 0;
+    QString lineText;
+};
+
+class ContentSearchJob : public BackgroundJob
+{
+    Q_OBJECT
+public:
+    ContentSearchJob(const QString &rootDirectory, const QString &pattern, bool isRegex, bool isCaseSensitive, QObject *parent = nullptr);
+
+    bool isValid() const;
+    QString errorString() const;
+    QString rootDirectory() const;
+    qint64 scannedFileCount() const;
+    qint64 matchCount() const;
+    bool usedIndex() const;
+
+    static QByteArray requiredLiteral(const QString &pattern);
+
+protected:
+    void execute() override;
+
+private:
+    QString root;
+    QByteArray literal;
+    QRegularExpression regex;
+    bool useRegex;
+    bool caseSensitive;
+    bool isIndexed = false;
+
+    QThreadPool scanPool;
+    std::atomic<qint64> filesFound;
+    std::atomic<qint64> filesScanned;
+    std::atomic<qint64> matchTotal;
+
+    QMutex pendingMutex;
+    QList<ContentMatch> pendingMatches;
+    QElapsedTimer flushTimer;
+
+    void scanDirectory(const QString &directory);
+    void scanChangedFiles(const QList<IndexedFile> &indexedFiles);
+    void scanFiles(const QStringList &files);
+    void scanFile(const QString &path, QList<ContentMatch> &matches);
+    void scanBuffer(const QString &path, const char *data, qint64 size, QList<ContentMatch> &matches);
+    void collect(QList<ContentMatch> &matches, bool force);
+
+signals:
+    void matchesFound(const QList<ContentMatch> &matches);
+};
+
+#endif // CONTENTSEARCHJOB_H
@@ -0,0 +1,113 @@
+#include "contentsearchresultsmodel.h"
+#include <QDir>
+
+/**
+ * @file contentsearchresultsmodel.h
+ * @brief The ContentSearchResultsModel class lists the matching lines of a content search: file, line number and text.
+ * Matches arrive in batches while the search runs and are appended as one row insertion per batch.
+ */
+
+ContentSearchResultsModel::ContentSearchResultsModel(QObject *parent) : QAbstractTableModel(parent)
+{
+}
+
+/**
+ * @brief Sets the directory the file column is shown relative to.
+ */
+void ContentSearchResultsModel::setRootDirectory(const QString &directory)
+{
+    rootDirectory = directory;
+}
+
+/**
+ * @brief Appends a batch of matches.
+ */
+void ContentSearchResultsModel::appendMatches(const QList<ContentMatch> &newMatches)
+{
+    if (newMatches.isEmpty())
+    {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), int(matches.size()), int(matches.size() + newMatches.size()) - 1);
+    matches.append(newMatches);
+    endInsertRows();
+}
+
+void ContentSearchResultsModel::clear()
+{
+    beginResetModel();
+    matches.clear();
+    endResetModel();
+}
+
+const ContentMatch& ContentSearchResultsModel::match(int row) const
+{
+    return matches.at(row);
+}
+
+int ContentSearchResultsModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(matches.size());
+}
+
+int ContentSearchResultsModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+/**
+ * @brief Returns the file relative to the searched directory, the line number and the line text. The full path is the tooltip.
+ */
+QVariant ContentSearchResultsModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= matches.size())
+    {
+        return QVariant();
+    }
+
+    const ContentMatch &contentMatch = matches.at(index.row());
+
+    if (role == Qt::DisplayRole)
+    {
+        switch (index.column())
+        {
+        case 0:
+            return QDir(rootDirectory).relativeFilePath(contentMatch.path);
+        case 1:
+            return contentMatch.lineNumber;
+        default:
+            return contentMatch.lineText;
+        }
+    }
+
+    if (role == Qt::ToolTipRole && index.column() == 0)
+    {
+        return QDir::toNativeSeparators(contentMatch.path);
+    }
+
+    if (role == Qt::TextAlignmentRole && index.column() == 1)
+    {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
+    return QVariant();
+}
+
+QVariant ContentSearchResultsModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case 0:
+        return tr("File");
+    case 1:
+        return tr("Line");
+    default:
+        return tr("Text");
+    }
+}
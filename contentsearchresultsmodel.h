@@ -0,0 +1,28 @@
+#ifndef CONTENTSEARCHRESULTSMODEL_H
+#define CONTENTSEARCHRESULTSMODEL_H
+
+#include "contentsearchjob.h"
+#include <QAbstractTableModel>
+
+class ContentSearchResultsModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit ContentSearchResultsModel(QObject *parent = nullptr);
+
+    void setRootDirectory(const QString &directory);
+    void appendMatches(const QList<ContentMatch> &newMatches);
+    void clear();
+    const ContentMatch& match(int row) const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    QString rootDirectory;
+    QList<ContentMatch> matches;
+};
+
+#endif // CONTENTSEARCHRESULTSMODEL_H
@@ -0,0 +1,143 @@
+#include "directorycomparedialog.h"
+#include "ui_directorycomparedialog.h"
+#include <QDir>
+#include <QHeaderView>
+#include <QMessageBox>
+
+/**
+ * @file directorycomparedialog.h
+ * @brief The DirectoryCompareDialog class compares two directory trees and synchronizes them.
+ * The comparison runs as a DirectoryCompareJob on the job queue, so it shows its progress in the status bar and can
+ * be cancelled there; differences are listed while it is still running. Synchronizing hands the planned trash and
+ * copy operations to the caller, which runs them as file operation jobs.
+ */
+
+DirectoryCompareDialog::DirectoryCompareDialog(const QString &leftRoot, const QString &rightRoot, JobQueue *jobQueue, QWidget *parent)
+    : QDialog(parent), ui(new Ui::DirectoryCompareDialog), left(leftRoot), right(rightRoot), queue(jobQueue)
+{
+    ui->setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    differencesModel = new DirectoryCompareModel(this);
+    ui->QTableView_Differences->setModel(differencesModel);
+    ui->QTableView_Differences->horizontalHeader()->resizeSection(0, 300);
+    ui->QTableView_Differences->horizontalHeader()->resizeSection(1, 200);
+    ui->QTableView_Differences->horizontalHeader()->resizeSection(2, 120);
+    ui->QTableView_Differences->verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 4);
+
+    connect(ui->QComboBox_SyncMode, &QComboBox::currentIndexChanged, this, [this](int index)
+            {
+                ui->QCheckBox_DeleteExtraItems->setEnabled(index != DirectoryCompareJob::TwoWay);
+            });
+
+    ui->QLabel_Roots->setText(tr("Left: %1\nRight: %2").arg(QDir::toNativeSeparators(left), QDir::toNativeSeparators(right)));
+    on_QPushButton_Compare_clicked();
+}
+
+DirectoryCompareDialog::~DirectoryCompareDialog()
+{
+    cancelCompare();
+    delete ui;
+}
+
+/**
+ * \brief Slot triggered on 'Compare' button click. Cancels the running comparison and starts a new one.
+ */
+void DirectoryCompareDialog::on_QPushButton_Compare_clicked()
+{
+    cancelCompare();
+    differencesModel->clear();
+    ui->QPushButton_Sync->setEnabled(false);
+
+    DirectoryCompareJob *job = new DirectoryCompareJob(left, right, ui->QCheckBox_CompareContents->isChecked());
+    compareJob = job;
+    connect(job, &DirectoryCompareJob::differencesFound, this, &DirectoryCompareDialog::onDifferencesFound);
+    connect(job, &BackgroundJob::finished, this, &DirectoryCompareDialog::onCompareFinished);
+
+    ui->QLabel_Status->setText(tr("Comparing..."));
+    compareTimer.start();
+    queue->enqueue(job);
+}
+
+/**
+ * \brief Asks for confirmation and hands the plan for the chosen direction to the caller.
+ */
+void DirectoryCompareDialog::on_QPushButton_Sync_clicked()
+{
+    const auto mode = DirectoryCompareJob::SyncMode(ui->QComboBox_SyncMode->currentIndex());
+    const SyncPlan plan = DirectoryCompareJob::syncPlan(differencesModel->allDifferences(), left, right, mode,
+                                                        ui->QCheckBox_DeleteExtraItems->isChecked());
+    if (plan.copies.isEmpty() && plan.trashPaths.isEmpty())
+    {
+        ui->QLabel_Status->setText(plan.conflictCount > 0 ? tr("Nothing to synchronize, %n conflict(s)", nullptr, int(plan.conflictCount))
+                                                          : tr("Nothing to synchronize"));
+        return;
+    }
+
+    QString summary = tr("%n item(s) will be copied.", nullptr, int(plan.copies.size()));
+    if (!plan.trashPaths.isEmpty())
+    {
+        summary += "\n" + tr("%n item(s) will be replaced or removed and moved to the trash.", nullptr, int(plan.trashPaths.size()));
+    }
+    if (plan.conflictCount > 0)
+    {
+        summary += "\n" + tr("%n item(s) differ on both sides and are skipped.", nullptr, int(plan.conflictCount));
+    }
+    if (QMessageBox::question(this, tr("Synchronize"), summary) != QMessageBox::Yes)
+    {
+        return;
+    }
+
+    emit syncRequested(plan);
+    close();
+}
+
+/**
+ * \brief Appends a batch of differences of the running comparison.
+ */
+void DirectoryCompareDialog::onDifferencesFound(const QList<DirectoryDifference> &differences)
+{
+    if (sender() != compareJob)
+    {
+        return;
+    }
+
+    differencesModel->appendDifferences(differences);
+    ui->QLabel_Status->setText(tr("Comparing... %n difference(s)", nullptr, differencesModel->rowCount()));
+}
+
+/**
+ * \brief Shows the summary of the finished comparison. Only a complete comparison can be synchronized.
+ */
+void DirectoryCompareDialog::onCompareFinished()
+{
+    if (sender() != compareJob)
+    {
+        return;
+    }
+
+    QString summary = tr("%n difference(s)", nullptr, differencesModel->rowCount())
+                      + tr(", %n identical file(s)", nullptr, int(compareJob->identicalFileCount()))
+                      + tr(", %1 ms").arg(compareTimer.elapsed());
+    if (!compareJob->failedPaths().isEmpty())
+    {
+        summary += tr(", %n item(s) could not be read", nullptr, int(compareJob->failedPaths().size()));
+    }
+
+    const bool isComplete = !compareJob->isCancelled() && compareJob->failedPaths().isEmpty();
+    ui->QLabel_Status->setText(compareJob->isCancelled() ? tr("Cancelled, ") + summary : summary);
+    ui->QPushButton_Sync->setEnabled(isComplete && differencesModel->rowCount() > 0);
+    compareJob = nullptr;
+}
+
+/**
+ * \brief Stops the running comparison, its remaining differences are ignored.
+ */
+void DirectoryCompareDialog::cancelCompare()
+{
+    if (compareJob)
+    {
+        compareJob->cancel();
+        compareJob = nullptr;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef DIRECTORYCOMPAREDIALOG_H
+#define DIRECTORYCOMPAREDIALOG_H
+
+#include "directorycomparejob.h"
+#include "directorycomparemodel.h"
+#include "jobqueue.h"
+#include <QDialog>
+#include <QPointer>
+#include <QElapsedTimer>
+
+namespace Ui {
+class DirectoryCompareDialog;
+}
+
+class DirectoryCompareDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit DirectoryCompareDialog(const QString &leftRoot, const QString &rightRoot, JobQueue *jobQueue, QWidget *parent = nullptr);
+    ~DirectoryCompareDialog();
+
+signals:
+    void syncRequested(const SyncPlan &plan);
+
+private slots:
+    void on_QPushButton_Compare_clicked();
+    void on_QPushButton_Sync_clicked();
+    void onDifferencesFound(const QList<DirectoryDifference> &differences);
+    void onCompareFinished();
+
+private:
+    Ui::DirectoryCompareDialog *ui;
+    QString left;
+    QString right;
+    JobQueue *queue;
+    DirectoryCompareModel *differencesModel;
+    QPointer<DirectoryCompareJob> compareJob;
+    QElapsedTimer compareTimer;
+
+    void cancelCompare();
+};
+
+#endif // DIRECTORYCOMPAREDIALOG_H
@@ -0,0 +1,405 @@
+#include "directorycomparejob.h"
+#include "directorylistingcache.h"
+#include "filestatusreader.h"
+#include "xxhash64hasher.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QThread>
+#include <algorithm>
+
+/**
+ * @file directorycomparejob.h
+ * @brief The DirectoryCompareJob class lists the differences between two directory trees.
+ * Every pair of directories is compared by its own pool task: both sides are read with one readdir pass and a
+ * batch of statx calls, sorted by name and walked in a single merge, and every subdirectory present on both sides
+ * queues a new task, so large trees are compared on all cores. Files match if their size is equal and their
+ * modification times are within two seconds (the FAT resolution); when contents are compared, files of equal
+ * size are hashed with XXH64 instead. An entry that exists on one side only is reported once, its children are not
+ * walked. Differences are collected per directory and streamed to the GUI in batches.
+ * syncPlan() turns the differences into the items to move to the trash and to copy for a one-way or two-way sync.
+ */
+
+namespace
+{
+const qint64 modifiedToleranceMs = 2000;
+const qint64 readBufferSize = 1024 * 1024;
+const int flushIntervalMs = 100;
+const int flushDifferenceCount = 256;
+const int progressPollMs = 100;
+
+/**
+ * @brief Joins a directory and a relative path, an empty relative path stands for the directory itself.
+ */
+QString joinPath(const QString &directory, const QString &name)
+{
+    if (name.isEmpty())
+    {
+        return directory;
+    }
+    return directory.endsWith('/') ? directory + name : directory + '/' + name;
+}
+
+bool nameLessThan(const DirectoryEntry &a, const DirectoryEntry &b)
+{
+    return a.name < b.name;
+}
+
+/**
+ * @brief Classifies two files by their metadata.
+ *
+ * @return False if the files are considered identical.
+ */
+bool differsByMetadata(DirectoryDifference &difference)
+{
+    const qint64 modifiedDelta = difference.leftModifiedMs - difference.rightModifiedMs;
+    if (modifiedDelta > modifiedToleranceMs)
+    {
+        difference.kind = DirectoryDifference::LeftNewer;
+    }
+    else if (modifiedDelta < -modifiedToleranceMs)
+    {
+        difference.kind = DirectoryDifference::RightNewer;
+    }
+    else if (difference.leftSize != difference.rightSize)
+    {
+        difference.kind = DirectoryDifference::ContentDiffers;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+}
+
+DirectoryCompareJob::DirectoryCompareJob(const QString &leftRoot, const QString &rightRoot, bool comparesContents, QObject *parent)
+    : BackgroundJob(tr("Comparing %1 and %2").arg(QDir(leftRoot).dirName(), QDir(rightRoot).dirName()), parent),
+      left(QDir::cleanPath(leftRoot)), right(QDir::cleanPath(rightRoot)), hashesContents(comparesContents), directoriesFound(0),
+      directoriesCompared(0), filesCompared(0), filesIdentical(0)
+{
+    comparePool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+QString DirectoryCompareJob::leftRoot() const
+{
+    return left;
+}
+
+QString DirectoryCompareJob::rightRoot() const
+{
+    return right;
+}
+
+/**
+ * @brief Returns the number of files found on both sides.
+ */
+qint64 DirectoryCompareJob::comparedFileCount() const
+{
+    return filesCompared;
+}
+
+qint64 DirectoryCompareJob::identicalFileCount() const
+{
+    return filesIdentical;
+}
+
+/**
+ * @brief Returns the roots that are not directories and the files that could not be read for comparing contents.
+ */
+QStringList DirectoryCompareJob::failedPaths() const
+{
+    return failed;
+}
+
+/**
+ * @brief Plans a synchronization. Replaced items and, if asked for, items missing from the source side of a
+ * one-way sync are moved to the trash; the copies must only start once that finished. A two-way sync copies
+ * missing items both ways and lets the newer file win, items that differ without one being newer are conflicts
+ * and left alone.
+ *
+ * @param differences The differences found by a DirectoryCompareJob.
+ * @param deletesExtraItems Removes items that only exist on the target side of a one-way sync.
+ */
+SyncPlan DirectoryCompareJob::syncPlan(const QList<DirectoryDifference> &differences, const QString &leftRoot,
+                                       const QString &rightRoot, SyncMode mode, bool deletesExtraItems)
+{
+    SyncPlan plan;
+    for (const DirectoryDifference &difference : differences)
+    {
+        const QString leftPath = joinPath(leftRoot, difference.relativePath);
+        const QString rightPath = joinPath(rightRoot, difference.relativePath);
+        const bool isLeftSource = mode == LeftToRight
+                                  || (mode == TwoWay && (difference.kind == DirectoryDifference::LeftOnly
+                                                         || difference.kind == DirectoryDifference::LeftNewer));
+        const QString &sourcePath = isLeftSource ? leftPath : rightPath;
+        const QString &targetPath = isLeftSource ? rightPath : leftPath;
+        const bool isMissingFromSource = difference.kind == (isLeftSource ? DirectoryDifference::RightOnly
+                                                                          : DirectoryDifference::LeftOnly);
+        const bool isMissingFromTarget = difference.kind == (isLeftSource ? DirectoryDifference::LeftOnly
+                                                                          : DirectoryDifference::RightOnly);
+
+        if (isMissingFromTarget)
+        {
+            plan.copies.append({ sourcePath, targetPath });
+        }
+        else if (isMissingFromSource)
+        {
+            if (mode != TwoWay && deletesExtraItems)
+            {
+                plan.trashPaths << targetPath;
+            }
+        }
+        else if (mode == TwoWay && (difference.kind == DirectoryDifference::ContentDiffers
+                                    || difference.kind == DirectoryDifference::TypeDiffers))
+        {
+            ++plan.conflictCount;
+        }
+        else
+        {
+            plan.trashPaths << targetPath;
+            plan.copies.append({ sourcePath, targetPath });
+        }
+    }
+    return plan;
+}
+
+void DirectoryCompareJob::execute()
+{
+    flushTimer.start();
+
+    if (!QFileInfo(left).isDir() || !QFileInfo(right).isDir())
+    {
+        for (const QString &root : { left, right })
+        {
+            if (!QFileInfo(root).isDir())
+            {
+                addFailure(root);
+            }
+        }
+        return;
+    }
+
+    directoriesFound = 1;
+    comparePool.start([this]()
+                      {
+                          compareDirectory(QString());
+                      });
+
+    while (!comparePool.waitForDone(progressPollMs))
+    {
+        reportProgress(directoriesCompared, directoriesFound);
+    }
+
+    QList<DirectoryDifference> noDifferences;
+    collect(noDifferences, true);
+    reportProgress(directoriesCompared, directoriesFound);
+}
+
+/**
+ * @brief Compares a directory present on both sides and queues a task for every common subdirectory. Runs on the
+ * compare pool. Hidden entries are included, symbolic links to directories are not followed.
+ *
+ * @param relativePath The directory relative to both roots, empty for the roots themselves.
+ */
+void DirectoryCompareJob::compareDirectory(const QString &relativePath)
+{
+    if (isCancelled())
+    {
+        return;
+    }
+
+    const QString leftDirectory = joinPath(left, relativePath);
+    const QString rightDirectory = joinPath(right, relativePath);
+    DirectoryListing leftEntries = DirectoryListingCache::readDirectory(leftDirectory, true);
+    DirectoryListing rightEntries = DirectoryListingCache::readDirectory(rightDirectory, true);
+    FileStatusReader::read(leftDirectory, leftEntries);
+    FileStatusReader::read(rightDirectory, rightEntries);
+    std::sort(leftEntries.begin(), leftEntries.end(), nameLessThan);
+    std::sort(rightEntries.begin(), rightEntries.end(), nameLessThan);
+
+    QList<DirectoryDifference> differences;
+    QList<DirectoryDifference> contentCandidates;
+    qsizetype leftIndex = 0;
+    qsizetype rightIndex = 0;
+
+    while (leftIndex < leftEntries.size() || rightIndex < rightEntries.size())
+    {
+        const DirectoryEntry *leftEntry = leftIndex < leftEntries.size() ? &leftEntries.at(leftIndex) : nullptr;
+        const DirectoryEntry *rightEntry = rightIndex < rightEntries.size() ? &rightEntries.at(rightIndex) : nullptr;
+        if (leftEntry != nullptr && rightEntry != nullptr)
+        {
+            // Only the entry sorting first is consumed if the names differ.
+            if (leftEntry->name < rightEntry->name)
+            {
+                rightEntry = nullptr;
+            }
+            else if (rightEntry->name < leftEntry->name)
+            {
+                leftEntry = nullptr;
+            }
+        }
+
+        const QString &name = (leftEntry != nullptr ? leftEntry : rightEntry)->name;
+        DirectoryDifference difference;
+        difference.relativePath = relativePath.isEmpty() ? name : relativePath + '/' + name;
+        if (leftEntry != nullptr)
+        {
+            difference.isLeftDir = leftEntry->isDir;
+            difference.leftSize = leftEntry->size;
+            difference.leftModifiedMs = leftEntry->modifiedMs;
+            ++leftIndex;
+        }
+        if (rightEntry != nullptr)
+        {
+            difference.isRightDir = rightEntry->isDir;
+            difference.rightSize = rightEntry->size;
+            difference.rightModifiedMs = rightEntry->modifiedMs;
+            ++rightIndex;
+        }
+
+        if (rightEntry == nullptr || leftEntry == nullptr)
+        {
+            difference.kind = leftEntry != nullptr ? DirectoryDifference::LeftOnly : DirectoryDifference::RightOnly;
+            differences.append(difference);
+        }
+        else if (difference.isLeftDir != difference.isRightDir)
+        {
+            difference.kind = DirectoryDifference::TypeDiffers;
+            differences.append(difference);
+        }
+        else if (difference.isLeftDir)
+        {
+            if (!QFileInfo(joinPath(left, difference.relativePath)).isSymLink()
+                && !QFileInfo(joinPath(right, difference.relativePath)).isSymLink())
+            {
+                ++directoriesFound;
+                const QString subdirectory = difference.relativePath;
+                comparePool.start([this, subdirectory]()
+                                  {
+                                      compareDirectory(subdirectory);
+                                  });
+            }
+        }
+        else
+        {
+            ++filesCompared;
+            if (hashesContents && difference.leftSize == difference.rightSize)
+            {
+                contentCandidates.append(difference);
+            }
+            else if (differsByMetadata(difference))
+            {
+                differences.append(difference);
+            }
+            else
+            {
+                ++filesIdentical;
+            }
+        }
+    }
+
+    compareContents(contentCandidates, differences);
+    ++directoriesCompared;
+    collect(differences, false);
+}
+
+/**
+ * @brief Hashes both sides of files with equal sizes. Files with equal contents are identical whatever their
+ * modification times, the others are classified by their times.
+ */
+void DirectoryCompareJob::compareContents(const QList<DirectoryDifference> &candidates, QList<DirectoryDifference> &differences)
+{
+    QByteArray buffer;
+    for (DirectoryDifference difference : candidates)
+    {
+        if (isCancelled())
+        {
+            return;
+        }
+        if (buffer.isEmpty())
+        {
+            buffer.resize(readBufferSize);
+        }
+
+        QByteArray leftDigest;
+        QByteArray rightDigest;
+        const QString leftPath = joinPath(left, difference.relativePath);
+        const QString rightPath = joinPath(right, difference.relativePath);
+        if (!hashFile(leftPath, leftDigest, buffer) || !hashFile(rightPath, rightDigest, buffer))
+        {
+            addFailure(leftDigest.isEmpty() ? leftPath : rightPath);
+            continue;
+        }
+
+        if (leftDigest == rightDigest)
+        {
+            ++filesIdentical;
+            continue;
+        }
+        if (!differsByMetadata(difference))
+        {
+            difference.kind = DirectoryDifference::ContentDiffers;
+        }
+        differences.append(difference);
+    }
+}
+
+bool DirectoryCompareJob::hashFile(const QString &path, QByteArray &digest, QByteArray &buffer) const
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    XxHash64Hasher hasher;
+    while (!isCancelled())
+    {
+        const qint64 count = file.read(buffer.data(), buffer.size());
+        if (count < 0)
+        {
+            return false;
+        }
+        if (count == 0)
+        {
+            digest = hasher.result();
+            return true;
+        }
+        hasher.addData(buffer.constData(), count);
+    }
+    return false;
+}
+
+/**
+ * @brief Moves differences to the shared batch and streams the batch to the GUI when it is large or old enough.
+ *
+ * @param differences The differences of one task, emptied by this call.
+ * @param force Streams the batch regardless of its size, used when the comparison ends.
+ */
+void DirectoryCompareJob::collect(QList<DirectoryDifference> &differences, bool force)
+{
+    QList<DirectoryDifference> batch;
+    {
+        QMutexLocker locker(&pendingMutex);
+        pendingDifferences.append(std::move(differences));
+        differences.clear();
+
+        if (pendingDifferences.isEmpty()
+            || (!force && pendingDifferences.size() < flushDifferenceCount && flushTimer.elapsed() < flushIntervalMs))
+        {
+            return;
+        }
+
+        batch.swap(pendingDifferences);
+        flushTimer.restart();
+    }
+
+    emit differencesFound(batch);
+}
+
+void DirectoryCompareJob::addFailure(const QString &path)
+{
+    QMutexLocker locker(&failedMutex);
+    failed << path;
+}
@@ -0,0 +1,94 @@
+#ifndef DIRECTORYCOMPAREJOB_H
+#define DIRECTORYCOMPAREJOB_H
+
+#include "backgroundjob.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QStringList>
+#include <QThreadPool>
+#include <atomic>
+
+struct DirectoryDifference
+{
+    enum Kind
+    {
+        LeftOnly,
+        RightOnly,
+        LeftNewer,
+        RightNewer,
+        ContentDiffers,
+        TypeDiffers
+    };
+
+    QString relativePath;
+    Kind kind = LeftOnly;
+    bool isLeftDir = false;
+    bool isRightDir = false;
+    qint64 leftSize = 0;
+    qint64 rightSize = 0;
+    qint64 leftModifiedMs = 0;
+    qint64 rightModifiedMs = 0;
+};
+
+struct SyncPlan
+{
+    QStringList trashPaths;
+    QList<QPair<QString, QString>> copies;
+    qsizetype conflictCount = 0;
+};
+
+class DirectoryCompareJob : public BackgroundJob
+{
+    Q_OBJECT
+public:
+    enum SyncMode
+    {
+        LeftToRight,
+        RightToLeft,
+        TwoWay
+    };
+
+    DirectoryCompareJob(const QString &leftRoot, const QString &rightRoot, bool comparesContents, QObject *parent = nullptr);
+
+    QString leftRoot() const;
+    QString rightRoot() const;
+    qint64 comparedFileCount() const;
+    qint64 identicalFileCount() const;
+    QStringList failedPaths() const;
+
+    static SyncPlan syncPlan(const QList<DirectoryDifference> &differences, const QString &leftRoot, const QString &rightRoot,
+                             SyncMode mode, bool deletesExtraItems);
+
+protected:
+    void execute() override;
+
+private:
+    QString left;
+    QString right;
+    bool hashesContents;
+
+    QThreadPool comparePool;
+    std::atomic<qint64> directoriesFound;
+    std::atomic<qint64> directoriesCompared;
+    std::atomic<qint64> filesCompared;
+    std::atomic<qint64> filesIdentical;
+
+    QMutex pendingMutex;
+    QList<DirectoryDifference> pendingDifferences;
+    QElapsedTimer flushTimer;
+    QStringList failed;
+    QMutex failedMutex;
+
+    void compareDirectory(const QString &relativePath);
+    void compareContents(const QList<DirectoryDifference> &candidates, QList<DirectoryDifference> &differences);
+    bool hashFile(const QString &path, QByteArray &digest, QByteArray &buffer) const;
+    void collect(QList<DirectoryDifference> &differences, bool force);
+    void addFailure(const QString &path);
+
+signals:
+    void differencesFound(const QList<DirectoryDifference> &differences);
+};
+
+#endif // DIRECTORYCOMPAREJOB_H
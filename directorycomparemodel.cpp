@@ -0,0 +1,135 @@
+#include "directorycomparemodel.h"
+#include <QDateTime>
+#include <QDir>
+#include <QLocale>
+
+/**
+ * @file directorycomparemodel.h
+ * @brief The DirectoryCompareModel class lists the differences between two directory trees: the relative path,
+ * both sides and how they differ. Differences arrive in batches while the comparison runs and are appended as one
+ * row insertion per batch.
+ */
+
+DirectoryCompareModel::DirectoryCompareModel(QObject *parent) : QAbstractTableModel(parent)
+{
+}
+
+/**
+ * @brief Appends a batch of differences.
+ */
+void DirectoryCompareModel::appendDifferences(const QList<DirectoryDifference> &newDifferences)
+{
+    if (newDifferences.isEmpty())
+    {
+        return;
+    }
+
+    beginInsertRows(QModelIndex(), int(differences.size()), int(differences.size() + newDifferences.size()) - 1);
+    differences.append(newDifferences);
+    endInsertRows();
+}
+
+void DirectoryCompareModel::clear()
+{
+    beginResetModel();
+    differences.clear();
+    endResetModel();
+}
+
+const QList<DirectoryDifference>& DirectoryCompareModel::allDifferences() const
+{
+    return differences;
+}
+
+int DirectoryCompareModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(differences.size());
+}
+
+int DirectoryCompareModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 4;
+}
+
+/**
+ * @brief Returns the relative path, the size and time of the left item, the kind of difference and the size and
+ * time of the right item.
+ */
+QVariant DirectoryCompareModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= differences.size() || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    const DirectoryDifference &difference = differences.at(index.row());
+    const bool isDir = difference.kind == DirectoryDifference::RightOnly ? difference.isRightDir : difference.isLeftDir;
+
+    switch (index.column())
+    {
+    case 0:
+        return QDir::toNativeSeparators(difference.relativePath) + (isDir && difference.kind != DirectoryDifference::TypeDiffers ? "/" : "");
+    case 1:
+        return sideText(difference.kind != DirectoryDifference::RightOnly, difference.isLeftDir, difference.leftSize,
+                        difference.leftModifiedMs);
+    case 2:
+        return kindText(difference.kind);
+    default:
+        return sideText(difference.kind != DirectoryDifference::LeftOnly, difference.isRightDir, difference.rightSize,
+                        difference.rightModifiedMs);
+    }
+}
+
+QVariant DirectoryCompareModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+    {
+        return QVariant();
+    }
+
+    switch (section)
+    {
+    case 0:
+        return tr("Item");
+    case 1:
+        return tr("Left");
+    case 2:
+        return tr("Difference");
+    default:
+        return tr("Right");
+    }
+}
+
+QString DirectoryCompareModel::sideText(bool exists, bool isDir, qint64 size, qint64 modifiedMs)
+{
+    if (!exists)
+    {
+        return QString();
+    }
+    if (isDir)
+    {
+        return tr("Folder");
+    }
+    return QLocale().formattedDataSize(size) + "  "
+           + QLocale().toString(QDateTime::fromMSecsSinceEpoch(modifiedMs), QLocale::ShortFormat);
+}
+
+QString DirectoryCompareModel::kindText(DirectoryDifference::Kind kind)
+{
+    switch (kind)
+    {
+    case DirectoryDifference::LeftOnly:
+        return tr("Only left");
+    case DirectoryDifference::RightOnly:
+        return tr("Only right");
+    case DirectoryDifference::LeftNewer:
+        return tr("Left is newer");
+    case DirectoryDifference::RightNewer:
+        return tr("Right is newer");
+    case DirectoryDifference::ContentDiffers:
+        return tr("Contents differ");
+    case DirectoryDifference::TypeDiffers:
+        return tr("File and folder");
+    }
+    return QString();
+}
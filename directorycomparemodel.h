@@ -0,0 +1,29 @@
+#ifndef DIRECTORYCOMPAREMODEL_H
+#define DIRECTORYCOMPAREMODEL_H
+
+#include "directorycomparejob.h"
+#include <QAbstractTableModel>
+
+class DirectoryCompareModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit DirectoryCompareModel(QObject *parent = nullptr);
+
+    void appendDifferences(const QList<DirectoryDifference> &newDifferences);
+    void clear();
+    const QList<DirectoryDifference>& allDifferences() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    QList<DirectoryDifference> differences;
+
+    static QString sideText(bool exists, bool isDir, qint64 size, qint64 modifiedMs);
+    static QString kindText(DirectoryDifference::Kind kind);
+};
+
+#endif // DIRECTORYCOMPAREMODEL_H
@@ -0,0 +1,307 @@
+#include "directorylistingcache.h"
+#include "pathcompletiontrie.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutexLocker>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * @file directorylistingcache.h
+ * @brief The DirectoryListingCache class keeps the most recently used directory listings in memory.
+ * Cached listings are revalidated with a single stat of the directory (modification time and inode).
+ * The cache is shared by all panes, so panes browsing overlapping trees read every directory only once.
+ */
+
+namespace
+{
+const int maxCachedEntryCount = 200000;
+}
+
+DirectoryListingCache::DirectoryListingCache()
+{
+    entries.setMaxCost(maxCachedEntryCount);
+}
+
+DirectoryListingCache::~DirectoryListingCache()
+{}
+
+DirectoryListingCache& DirectoryListingCache::instance()
+{
+    static DirectoryListingCache instance;
+    return instance;
+}
+
+/**
+ * @brief Returns the listing of the directory, served from the cache when the directory did not change since it was read.
+ *
+ * @param path The directory path.
+ * @param stamp Optionally receives the stamp the listing was validated against.
+ * @return The sorted directory listing.
+ */
+DirectoryListing DirectoryListingCache::listing(const QString &path, DirectoryStamp *stamp)
+{
+    const DirectoryStamp currentStamp = stampForPath(path);
+    if (stamp != nullptr)
+    {
+        *stamp = currentStamp;
+    }
+
+    DirectoryListing result;
+    if (cachedListing(path, currentStamp, result))
+    {
+        return result;
+    }
+
+    result = readDirectory(path);
+    insert(path, currentStamp, result);
+    return result;
+}
+
+/**
+ * @brief Looks up a still valid cached listing without reading the directory on a miss.
+ *
+ * @param path The directory path.
+ * @param listing Receives the cached listing.
+ * @param stamp Optionally receives the current stamp of the directory.
+ * @return True if a valid cached listing was found.
+ */
+bool DirectoryListingCache::lookup(const QString &path, DirectoryListing &listing, DirectoryStamp *stamp)
+{
+    const DirectoryStamp currentStamp = stampForPath(path);
+    if (stamp != nullptr)
+    {
+        *stamp = currentStamp;
+    }
+
+    return cachedListing(path, currentStamp, listing);
+}
+
+/**
+ * @brief Removes the cached listing of the directory.
+ *
+ * @param path The directory path.
+ */
+void DirectoryListingCache::invalidate(const QString &path)
+{
+    QMutexLocker locker(&mutex);
+    entries.remove(QDir::cleanPath(path));
+}
+
+/**
+ * @brief Makes sure a valid listing of the directory is cached. Safe to call from worker threads.
+ * A directory that is already being read by another thread is skipped instead of being read twice.
+ *
+ * @param path The directory path.
+ * @return True if the directory was read by this call.
+ */
+bool DirectoryListingCache::ensureCached(const QString &path)
+{
+    const QString key = QDir::cleanPath(path);
+    const DirectoryStamp stamp = stampForPath(key);
+
+    DirectoryListing listing;
+    if (!stamp.isValid() || cachedListing(key, stamp, listing))
+    {
+        return false;
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        if (pathsBeingRead.contains(key))
+        {
+            return false;
+        }
+        pathsBeingRead.insert(key);
+    }
+
+    listing = readDirectory(key);
+    insert(key, stamp, listing);
+
+    {
+        QMutexLocker locker(&mutex);
+        pathsBeingRead.remove(key);
+    }
+
+    emit listingPrefetched(key);
+    return true;
+}
+
+/**
+ * @brief Returns the cheap validation stamp of a directory.
+ *
+ * @param path The directory path.
+ * @return The stamp, invalid if the directory could not be stat'ed.
+ */
+DirectoryStamp DirectoryListingCache::stampForPath(const QString &path)
+{
+    DirectoryStamp stamp;
+
+#ifdef Q_OS_UNIX
+    struct stat status;
+    if (::stat(QFile::encodeName(path).constData(), &status) == 0)
+    {
+        stamp.inode = status.st_ino;
+#ifdef Q_OS_LINUX
+        stamp.modifiedNs = qint64(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#else
+        stamp.modifiedNs = qint64(status.st_mtime) * 1000000000;
+#endif
+    }
+#else
+    QFileInfo fileInfo(path);
+    if (fileInfo.exists())
+    {
+        stamp.modifiedNs = fileInfo.lastModified().toMSecsSinceEpoch() * 1000000;
+    }
+#endif
+
+    return stamp;
+}
+
+/**
+ * @brief Lists the directory from disk. Only names and types are read; on Unix the type comes from the directory
+ * entry itself and a file is only stat'ed if it is a link or its type is unknown. Sizes, times and the other
+ * metadata are filled in later by FileStatusReader.
+ * Directories are prioritized first, followed by files sorted by name in a case-insensitive manner.
+ *
+ * @param path The directory path.
+ * @param includeHidden Also lists hidden entries, which the views leave out.
+ * @return The sorted directory listing.
+ */
+DirectoryListing DirectoryListingCache::readDirectory(const QString &path, bool includeHidden)
+{
+    DirectoryListing listing;
+
+#ifdef Q_OS_UNIX
+    DIR *directory = ::opendir(QFile::encodeName(path).constData());
+    if (directory == nullptr)
+    {
+        return listing;
+    }
+
+    while (const dirent *item = ::readdir(directory))
+    {
+        // The . and .. entries are not listed, and neither are hidden files unless they were asked for.
+        if (item->d_name[0] == '.'
+            && (!includeHidden || item->d_name[1] == '\0' || (item->d_name[1] == '.' && item->d_name[2] == '\0')))
+        {
+            continue;
+        }
+
+        DirectoryEntry entry;
+        bool isListed = true;
+        bool needsStatus = true;
+#ifdef _DIRENT_HAVE_D_TYPE
+        needsStatus = item->d_type == DT_LNK || item->d_type == DT_UNKNOWN;
+        entry.isDir = item->d_type == DT_DIR;
+        isListed = needsStatus || item->d_type == DT_DIR || item->d_type == DT_REG;
+#endif
+        if (needsStatus)
+        {
+            // Like QDir without QDir::System, broken links, devices, FIFOs and sockets are left out.
+            struct stat status;
+            isListed = ::fstatat(::dirfd(directory), item->d_name, &status, 0) == 0
+                       && (S_ISDIR(status.st_mode) || S_ISREG(status.st_mode));
+            entry.isDir = isListed && S_ISDIR(status.st_mode);
+        }
+
+        if (isListed)
+        {
+            entry.name = QFile::decodeName(item->d_name);
+            listing.append(entry);
+        }
+    }
+    ::closedir(directory);
+#else
+    QDir::Filters filters = QDir::AllEntries | QDir::NoDotAndDotDot;
+    if (includeHidden)
+    {
+        filters |= QDir::Hidden;
+    }
+    QDirIterator iterator(path, filters);
+    while (iterator.hasNext())
+    {
+        const QFileInfo fileInfo = iterator.nextFileInfo();
+
+        DirectoryEntry entry;
+        entry.name = fileInfo.fileName();
+        entry.isDir = fileInfo.isDir();
+        listing.append(entry);
+    }
+#endif
+
+    sortListing(listing);
+    return listing;
+}
+
+/**
+ * @brief Sorts the listing, directories first and then by name in a case-insensitive manner.
+ *
+ * @param listing The listing to sort in place.
+ */
+void DirectoryListingCache::sortListing(DirectoryListing &listing)
+{
+    std::sort(listing.begin(), listing.end(), entryLessThan);
+}
+
+/**
+ * @brief The listing order: directories first, then by name in a case-insensitive manner.
+ */
+bool DirectoryListingCache::entryLessThan(const DirectoryEntry &a, const DirectoryEntry &b)
+{
+    if (a.isDir != b.isDir)
+    {
+        return a.isDir;
+    }
+
+    return QString::compare(a.name, b.name, Qt::CaseInsensitive) < 0;
+}
+
+/**
+ * @brief Returns the cached listing if its stamp still matches the directory on disk.
+ */
+bool DirectoryListingCache::cachedListing(const QString &path, const DirectoryStamp &stamp, DirectoryListing &listing)
+{
+    if (!stamp.isValid())
+    {
+        return false;
+    }
+
+    QMutexLocker locker(&mutex);
+    const CacheEntry *entry = entries.object(QDir::cleanPath(path));
+    if (entry == nullptr || entry->stamp != stamp)
+    {
+        return false;
+    }
+
+    listing = entry->listing;
+    return true;
+}
+
+/**
+ * @brief Stores a listing together with the stamp taken before it was read, and hands its subdirectories to path completion.
+ */
+void DirectoryListingCache::insert(const QString &path, const DirectoryStamp &stamp, const DirectoryListing &listing)
+{
+    if (!stamp.isValid())
+    {
+        return;
+    }
+
+    CacheEntry *entry = new CacheEntry;
+    entry->stamp = stamp;
+    entry->listing = listing;
+
+    {
+        QMutexLocker locker(&mutex);
+        entries.insert(QDir::cleanPath(path), entry, int(qMin<qsizetype>(listing.size() + 1, maxCachedEntryCount)));
+    }
+
+    PathCompletionTrie::instance().insertListing(path, listing);
+}
@@ -0,0 +1,71 @@
+#ifndef DIRECTORYLISTINGCACHE_H
+#define DIRECTORYLISTINGCACHE_H
+
+#include <QObject>
+#include <QCache>
+#include <QMutex>
+#include <QSet>
+#include <QList>
+
+struct DirectoryEntry
+{
+    QString name;
+    bool isDir = false;
+    bool hasStatus = false;
+    qint64 size = 0;
+    qint64 modifiedMs = 0;
+    quint32 mode = 0;
+    quint32 ownerId = 0;
+    quint64 inode = 0;
+};
+
+using DirectoryListing = QList<DirectoryEntry>;
+
+struct DirectoryStamp
+{
+    qint64 modifiedNs = -1;
+    quint64 inode = 0;
+
+    bool isValid() const { return modifiedNs >= 0; }
+    bool operator==(const DirectoryStamp &other) const { return modifiedNs == other.modifiedNs && inode == other.inode; }
+    bool operator!=(const DirectoryStamp &other) const { return !(*this == other); }
+};
+
+class DirectoryListingCache : public QObject
+{
+    Q_OBJECT
+public:
+    static DirectoryListingCache& instance();
+
+    DirectoryListing listing(const QString &path, DirectoryStamp *stamp = nullptr);
+    bool lookup(const QString &path, DirectoryListing &listing, DirectoryStamp *stamp = nullptr);
+    bool ensureCached(const QString &path);
+    void invalidate(const QString &path);
+
+    static DirectoryStamp stampForPath(const QString &path);
+    static DirectoryListing readDirectory(const QString &path, bool includeHidden = false);
+    static bool entryLessThan(const DirectoryEntry &a, const DirectoryEntry &b);
+
+private:
+    DirectoryListingCache();
+    ~DirectoryListingCache();
+
+    struct CacheEntry
+    {
+        DirectoryStamp stamp;
+        DirectoryListing listing;
+    };
+
+    QCache<QString, CacheEntry> entries;
+    QSet<QString> pathsBeingRead;
+    QMutex mutex;
+
+    bool cachedListing(const QString &path, const DirectoryStamp &stamp, DirectoryListing &listing);
+    void insert(const QString &path, const DirectoryStamp &stamp, const DirectoryListing &listing);
+    static void sortListing(DirectoryListing &listing);
+
+signals:
+    void listingPrefetched(const QString &path);
+};
+
+#endif // DIRECTORYLISTINGCACHE_H
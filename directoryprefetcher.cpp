@@ -0,0 +1,157 @@
+#include "directoryprefetcher.h"
+#include "directorylistingcache.h"
+#include "archiveindex.h"
+#include <QDir>
+
+/**
+ * @file directoryprefetcher.h
+ * @brief The DirectoryPrefetcher class speculatively lists the neighbours of the directory shown in one pane.
+ * Every pane owns its prefetcher and worker thread, while the listings end up in the shared DirectoryListingCache.
+ */
+
+namespace
+{
+const int idlePrefetchDelayMs = 400;
+const int maxPrefetchedDirectories = 32;
+}
+
+DirectoryPrefetcher::DirectoryPrefetcher(QObject *parent) : QObject(parent), prefetchGeneration(0)
+{
+    prefetchPool.setMaxThreadCount(1);
+    revalidationPool.setMaxThreadCount(1);
+
+    // A directory another thread was still reading is announced by that reader.
+    connect(&DirectoryListingCache::instance(), &DirectoryListingCache::listingPrefetched, this, &DirectoryPrefetcher::finishRevalidation);
+
+    idleTimer.setSingleShot(true);
+    idleTimer.setInterval(idlePrefetchDelayMs);
+    connect(&idleTimer, &QTimer::timeout, this, &DirectoryPrefetcher::prefetchNeighbours);
+}
+
+DirectoryPrefetcher::~DirectoryPrefetcher()
+{
+    cancel();
+    prefetchPool.waitForDone();
+    revalidationPool.waitForDone();
+}
+
+/**
+ * @brief Restarts the idle timer after which the parent and subdirectories of the path are listed in the background.
+ *
+ * @param path The directory currently shown to the user.
+ */
+void DirectoryPrefetcher::scheduleNeighbourPrefetch(const QString &path)
+{
+    cancel();
+
+    prefetchOrigin = path;
+    idleTimer.start();
+}
+
+/**
+ * @brief Lists the directory on the worker thread right away and emits revalidated() once the cache holds it.
+ * Used for directories that were shown from the metadata index and for archives that were not read yet. Revalidations have their own pool, so cancelling
+ * the neighbour prefetch does not drop them.
+ *
+ * @param path The directory currently shown to the user.
+ */
+void DirectoryPrefetcher::revalidate(const QString &path)
+{
+    const QString key = QDir::cleanPath(path);
+    pendingRevalidations.insert(key);
+    revalidationPool.start([this, key]()
+                           {
+                               bool isReady = true;
+                               if (ArchiveIndex::isInsideArchive(key))
+                               {
+                                   // An unreadable archive is reported as well, it is shown empty then.
+                                   ArchiveIndex::instance().preload(key);
+                               }
+                               else
+                               {
+                                   // ensureCached() also returns false while another thread reads the directory;
+                                   // the listing is only ready once it can be looked up.
+                                   DirectoryListing listing;
+                                   isReady = DirectoryListingCache::instance().ensureCached(key)
+                                             || !DirectoryListingCache::stampForPath(key).isValid()
+                                             || DirectoryListingCache::instance().lookup(key, listing);
+                               }
+
+                               if (isReady)
+                               {
+                                   QMetaObject::invokeMethod(this, [this, key]()
+                                                             {
+                                                                 finishRevalidation(key);
+                                                             }, Qt::QueuedConnection);
+                               }
+                           });
+}
+
+/**
+ * @brief Drops queued prefetch jobs and makes running ones stop before reading.
+ */
+void DirectoryPrefetcher::cancel()
+{
+    ++prefetchGeneration;
+    idleTimer.stop();
+    prefetchPool.clear();
+}
+
+/**
+ * @brief Lists the parent and the subdirectories of the current directory on the prefetch pool.
+ * Jobs belonging to an earlier directory are skipped as soon as the user navigates again.
+ */
+void DirectoryPrefetcher::prefetchNeighbours()
+{
+    const QString origin = prefetchOrigin;
+    if (origin.isEmpty())
+    {
+        return;
+    }
+
+    QStringList candidates;
+
+    QDir parentDirectory(origin);
+    if (parentDirectory.cdUp())
+    {
+        candidates << parentDirectory.absolutePath();
+    }
+
+    DirectoryListing originListing;
+    if (DirectoryListingCache::instance().lookup(origin, originListing))
+    {
+        const QDir originDirectory(origin);
+        for (const DirectoryEntry &entry : std::as_const(originListing))
+        {
+            if (!entry.isDir || candidates.size() >= maxPrefetchedDirectories)
+            {
+                break;
+            }
+
+            candidates << originDirectory.filePath(entry.name);
+        }
+    }
+
+    const int generation = prefetchGeneration;
+    for (const QString &candidate : std::as_const(candidates))
+    {
+        prefetchPool.start([this, candidate, generation]()
+                           {
+                               if (generation == prefetchGeneration)
+                               {
+                                   DirectoryListingCache::instance().ensureCached(candidate);
+                               }
+                           });
+    }
+}
+
+/**
+ * @brief Emits revalidated() for a directory waiting for it, once per call to revalidate().
+ */
+void DirectoryPrefetcher::finishRevalidation(const QString &path)
+{
+    if (pendingRevalidations.remove(path))
+    {
+        emit revalidated(path);
+    }
+}
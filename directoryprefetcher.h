@@ -0,0 +1,36 @@
+#ifndef DIRECTORYPREFETCHER_H
+#define DIRECTORYPREFETCHER_H
+
+#include <QObject>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+
+class DirectoryPrefetcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit DirectoryPrefetcher(QObject *parent = nullptr);
+    ~DirectoryPrefetcher();
+
+    void scheduleNeighbourPrefetch(const QString &path);
+    void revalidate(const QString &path);
+    void cancel();
+
+private:
+    QThreadPool prefetchPool;
+    QThreadPool revalidationPool;
+    QSet<QString> pendingRevalidations;
+    QTimer idleTimer;
+    QString prefetchOrigin;
+    std::atomic<int> prefetchGeneration;
+
+    void prefetchNeighbours();
+    void finishRevalidation(const QString &path);
+
+signals:
+    void revalidated(const QString &path);
+};
+
+#endif // DIRECTORYPREFETCHER_H
@@ -0,0 +1,161 @@
+#include "filebrowserpane.h"
+#include "longclickhandler.h"
+#include <QVBoxLayout>
+#include <QDir>
+#include <QEvent>
+
+/**
+ * @file filebrowserpane.h
+ * @brief The FileBrowserPane class is one tab of the file viewer.
+ * Each pane owns its list view, model, navigation history and prefetch worker, so several panes can browse independently.
+ */
+
+FileBrowserPane::FileBrowserPane(QWidget *parent) : QWidget(parent)
+{
+    fileListView = new QListView(this);
+    fileListView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    fileListView->setWordWrap(true);
+    fileListView->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    fileListView->setContextMenuPolicy(Qt::CustomContextMenu);
+    fileListView->setStyleSheet("background-color: #f7ead0 ;");
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(fileListView);
+
+    manager = new ListViewManager(fileListView, this);
+    history = new NavigationHistory(this);
+
+    LongClickHandler *longClickHandler = new LongClickHandler(fileListView, this);
+    connect(longClickHandler, &LongClickHandler::longClicked, manager, &ListViewManager::onListViewItemLongClicked);
+    connect(fileListView, &QListView::doubleClicked, manager, &ListViewManager::onListViewItemDoubleClicked);
+
+    fileListView->installEventFilter(this);
+    fileListView->viewport()->installEventFilter(this);
+}
+
+QListView* FileBrowserPane::listView() const
+{
+    return fileListView;
+}
+
+ListViewManager* FileBrowserPane::listViewManager() const
+{
+    return manager;
+}
+
+NavigationHistory* FileBrowserPane::navigationHistory() const
+{
+    return history;
+}
+
+QString FileBrowserPane::currentPath() const
+{
+    return directoryPath;
+}
+
+/**
+ * @brief Shows the directory in this pane and records the directory being left in the history.
+ *
+ * @param path The directory to show.
+ */
+void FileBrowserPane::navigateTo(const QString &path)
+{
+    if (path.isEmpty())
+    {
+        return;
+    }
+
+    if (!directoryPath.isEmpty() && QDir::cleanPath(path) != QDir::cleanPath(directoryPath))
+    {
+        history->visit(manager->captureViewState(directoryPath));
+    }
+
+    directoryPath = path;
+    manager->setModelForListView(path);
+    watchCurrentItem();
+
+    emit pathChanged(this, path);
+}
+
+/**
+ * @brief Goes back to the previously visited directory, restoring its scroll position and selection.
+ */
+void FileBrowserPane::navigateBack()
+{
+    if (history->canGoBack())
+    {
+        restoreNavigationEntry(history->back(manager->captureViewState(directoryPath)));
+    }
+}
+
+/**
+ * @brief Goes forward to the directory left by navigateBack().
+ */
+void FileBrowserPane::navigateForward()
+{
+    if (history->canGoForward())
+    {
+        restoreNavigationEntry(history->forward(manager->captureViewState(directoryPath)));
+    }
+}
+
+/**
+ * @brief Lists the current directory again. Unchanged directories are served from the listing cache.
+ */
+void FileBrowserPane::refresh()
+{
+    if (!directoryPath.isEmpty())
+    {
+        manager->setModelForListView(directoryPath);
+    }
+}
+
+/**
+ * @brief Shows a directory from the navigation history without recording a new history entry.
+ *
+ * @param entry The history entry to restore.
+ */
+void FileBrowserPane::restoreNavigationEntry(const NavigationEntry &entry)
+{
+    if (entry.path.isEmpty())
+    {
+        return;
+    }
+
+    directoryPath = entry.path;
+    manager->restoreViewState(entry);
+    watchCurrentItem();
+
+    emit pathChanged(this, entry.path);
+}
+
+/**
+ * @brief Follows the current item of the list view. The selection model only exists once the model is set.
+ */
+void FileBrowserPane::watchCurrentItem()
+{
+    if (fileListView->selectionModel())
+    {
+        connect(fileListView->selectionModel(), &QItemSelectionModel::currentChanged, this,
+                &FileBrowserPane::onCurrentItemChanged, Qt::UniqueConnection);
+    }
+}
+
+void FileBrowserPane::onCurrentItemChanged(const QModelIndex &current)
+{
+    emit currentItemChanged(this, manager->listViewSelectedItemPath(current));
+}
+
+/**
+ * @brief Marks the pane as active when its list view gets focus or is clicked.
+ */
+bool FileBrowserPane::eventFilter(QObject *obj, QEvent *event)
+{
+    if (event->type() == QEvent::FocusIn || event->type() == QEvent::MouseButtonPress)
+    {
+        emit activated(this);
+    }
+
+    return QWidget::eventFilter(obj, event);
+}
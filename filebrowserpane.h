@@ -0,0 +1,46 @@
+#ifndef FILEBROWSERPANE_H
+#define FILEBROWSERPANE_H
+
+#include "listviewmanager.h"
+#include "navigationhistory.h"
+#include <QWidget>
+#include <QListView>
+
+class FileBrowserPane : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FileBrowserPane(QWidget *parent = nullptr);
+
+    QListView* listView() const;
+    ListViewManager* listViewManager() const;
+    NavigationHistory* navigationHistory() const;
+    QString currentPath() const;
+
+    void navigateTo(const QString &path);
+    void navigateBack();
+    void navigateForward();
+    void refresh();
+
+protected:
+    bool eventFilter(QObject *obj, QEvent *event) override;
+
+private:
+    QListView *fileListView;
+    ListViewManager *manager;
+    NavigationHistory *history;
+    QString directoryPath;
+
+    void restoreNavigationEntry(const NavigationEntry &entry);
+    void watchCurrentItem();
+
+private slots:
+    void onCurrentItemChanged(const QModelIndex &current);
+
+signals:
+    void activated(FileBrowserPane *pane);
+    void pathChanged(FileBrowserPane *pane, const QString &path);
+    void currentItemChanged(FileBrowserPane *pane, const QString &path);
+};
+
+#endif // FILEBROWSERPANE_H
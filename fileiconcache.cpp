@@ -0,0 +1,63 @@
+#include "fileiconcache.h"
+#include <QFileInfo>
+
+/**
+ * @file fileiconcache.h
+ * @brief The FileIconCache class shares file type icons between all panes and models.
+ * Icons are resolved once per file type instead of once per item and pane.
+ */
+
+FileIconCache::FileIconCache() {}
+
+FileIconCache::~FileIconCache() {}
+
+FileIconCache& FileIconCache::instance()
+{
+    static FileIconCache instance;
+    return instance;
+}
+
+/**
+ * @brief Returns the icon for a file or directory. Must be called from the GUI thread.
+ *
+ * @param filePath The absolute path of the item.
+ * @param isDir Whether the item is a directory.
+ * @return The icon shared by all items of the same type.
+ */
+QIcon FileIconCache::icon(const QString &filePath, bool isDir)
+{
+    const QFileInfo fileInfo(filePath);
+
+    if (isDir)
+    {
+        auto it = iconsByType.constFind(QStringLiteral("/"));
+        if (it == iconsByType.cend())
+        {
+            it = iconsByType.insert(QStringLiteral("/"), iconProvider.icon(QFileIconProvider::Folder));
+        }
+        return it.value();
+    }
+
+    const QString suffix = fileInfo.suffix().toLower();
+    if (hasPerFileIcon(suffix))
+    {
+        return iconProvider.icon(fileInfo);
+    }
+
+    auto it = iconsByType.constFind(suffix);
+    if (it == iconsByType.cend())
+    {
+        it = iconsByType.insert(suffix, iconProvider.icon(fileInfo));
+    }
+    return it.value();
+}
+
+/**
+ * @brief Tells whether files with the suffix carry their own embedded icon and thus cannot share one.
+ */
+bool FileIconCache::hasPerFileIcon(const QString &suffix)
+{
+    return suffix == QLatin1String("exe") || suffix == QLatin1String("lnk")
+           || suffix == QLatin1String("ico") || suffix == QLatin1String("url")
+           || suffix == QLatin1String("desktop") || suffix == QLatin1String("app");
+}
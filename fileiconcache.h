@@ -0,0 +1,24 @@
+#ifndef FILEICONCACHE_H
+#define FILEICONCACHE_H
+
+#include <QIcon>
+#include <QHash>
+#include <QFileIconProvider>
+
+class FileIconCache
+{
+public:
+    static FileIconCache& instance();
+    QIcon icon(const QString &filePath, bool isDir);
+
+private:
+    FileIconCache();
+    ~FileIconCache();
+
+    QFileIconProvider iconProvider;
+    QHash<QString, QIcon> iconsByType;
+
+    static bool hasPerFileIcon(const QString &suffix);
+};
+
+#endif // FILEICONCACHE_H
@@ -0,0 +1,541 @@
+#include "fileoperationjob.h"
+#include "operationjournal.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QTimeZone>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <climits>
+#include <cstdio>
+#include <cerrno>
+#endif
+
+/**
+ * @file fileoperationjob.h
+ * @brief The FileOperationJob class deletes, copies, moves or renames many files as a single background job.
+ * Items are grouped by source and target directory, so on Unix every group opens its directories once and works
+ * with unlinkat/renameat relative to those descriptors. The job collects the removed and added paths, which lets
+ * the list models apply one incremental update when it is finished.
+ */
+
+namespace
+{
+const int maxTrashNameLength = 200;
+
+QString joinPath(const QString &directory, const QString &name)
+{
+    return directory.endsWith('/') ? directory + name : directory + '/' + name;
+}
+
+/**
+ * @brief Gives the copy the times of its source. An invalid access time leaves the one of the copy.
+ */
+void setFileTimes(const QString &destination, const QDateTime &accessed, const QDateTime &modified)
+{
+#ifdef Q_OS_UNIX
+    const auto toTimespec = [](const QDateTime &time)
+    {
+        const qint64 ms = time.toMSecsSinceEpoch();
+        return time.isValid() ? timespec{ time_t(ms / 1000), long(ms % 1000) * 1000000 } : timespec{ 0, UTIME_OMIT };
+    };
+    const struct timespec times[2] = { toTimespec(accessed), toTimespec(modified) };
+    ::utimensat(AT_FDCWD, QFile::encodeName(destination).constData(), times, 0);
+#else
+    QFile target(destination);
+    if (target.open(QIODevice::ReadWrite))
+    {
+        if (accessed.isValid())
+        {
+            target.setFileTime(accessed, QFileDevice::FileAccessTime);
+        }
+        target.setFileTime(modified, QFileDevice::FileModificationTime);
+    }
+#endif
+}
+
+/**
+ * @brief Creates a symbolic link with the target of another one, so a link is copied as a link, also when it
+ * points to a directory or nowhere, and a relative target stays relative.
+ */
+bool copySymLink(const QString &source, const QString &destination)
+{
+#ifdef Q_OS_UNIX
+    QByteArray target(PATH_MAX, '\0');
+    const ssize_t length = ::readlink(QFile::encodeName(source).constData(), target.data(), target.size());
+    if (length < 0 || length >= target.size())
+    {
+        return false;
+    }
+    target.truncate(length);
+    return ::symlink(target.constData(), QFile::encodeName(destination).constData()) == 0;
+#else
+    return QFile::link(QFileInfo(source).symLinkTarget(), destination);
+#endif
+}
+
+QString operationTitle(FileOperationJob::Operation operation, qsizetype count)
+{
+    switch (operation)
+    {
+    case FileOperationJob::Delete:
+        return QObject::tr("Deleting %n item(s)", nullptr, int(count));
+    case FileOperationJob::Copy:
+        return QObject::tr("Copying %n item(s)", nullptr, int(count));
+    case FileOperationJob::Move:
+        return QObject::tr("Moving %n item(s)", nullptr, int(count));
+    case FileOperationJob::Rename:
+        return QObject::tr("Renaming %n item(s)", nullptr, int(count));
+    case FileOperationJob::Trash:
+        return QObject::tr("Moving %n item(s) to trash", nullptr, int(count));
+    }
+    return QString();
+}
+}
+
+FileOperationJob::FileOperationJob(Operation operation, const QList<QPair<QString, QString>> &items, QObject *parent)
+    : BackgroundJob(operationTitle(operation, items.size()), parent), fileOperation(operation), operationItems(items),
+      recordedInJournal(operation != Delete), preservesModificationTimes(false)
+{
+}
+
+/**
+ * @brief Creates a job deleting the given files and directories.
+ */
+FileOperationJob* FileOperationJob::deleteItems(const QStringList &paths)
+{
+    QList<QPair<QString, QString>> items;
+    for (const QString &path : paths)
+    {
+        items.append({ path, QString() });
+    }
+    return new FileOperationJob(Delete, items);
+}
+
+/**
+ * @brief Creates a job moving the given files and directories into the trash directory of their volume,
+ * so they can be restored by undoing the operation.
+ */
+FileOperationJob* FileOperationJob::trashItems(const QStringList &paths)
+{
+    QHash<QString, QString> trashDirectories;
+    QList<QPair<QString, QString>> items;
+    const QString stamp = QString::number(QDateTime::currentMSecsSinceEpoch(), 36);
+
+    for (int i = 0; i < paths.size(); ++i)
+    {
+        const QFileInfo fileInfo(paths.at(i));
+        const QString parentDirectory = fileInfo.absolutePath();
+
+        auto trashDirectory = trashDirectories.constFind(parentDirectory);
+        if (trashDirectory == trashDirectories.constEnd())
+        {
+            trashDirectory = trashDirectories.insert(parentDirectory, OperationJournal::trashDirectoryFor(parentDirectory));
+        }
+
+        const QString trashName = QString("%1-%2-%3").arg(stamp).arg(i, 0, 36).arg(fileInfo.fileName().left(maxTrashNameLength));
+        items.append({ paths.at(i), joinPath(*trashDirectory, trashName) });
+    }
+
+    return new FileOperationJob(Trash, items);
+}
+
+/**
+ * @brief Creates a job copying the given files and directories into the destination directory.
+ */
+FileOperationJob* FileOperationJob::copyItems(const QStringList &paths, const QString &destinationDirectory)
+{
+    QList<QPair<QString, QString>> items;
+    for (const QString &path : paths)
+    {
+        items.append({ path, joinPath(destinationDirectory, QFileInfo(path).fileName()) });
+    }
+    return new FileOperationJob(Copy, items);
+}
+
+/**
+ * @brief Creates a job copying every source path to its paired target path.
+ */
+FileOperationJob* FileOperationJob::copyItems(const QList<QPair<QString, QString>> &items)
+{
+    return new FileOperationJob(Copy, items);
+}
+
+/**
+ * @brief Creates a job moving the given files and directories into the destination directory.
+ */
+FileOperationJob* FileOperationJob::moveItems(const QStringList &paths, const QString &destinationDirectory)
+{
+    QList<QPair<QString, QString>> items;
+    for (const QString &path : paths)
+    {
+        items.append({ path, joinPath(destinationDirectory, QFileInfo(path).fileName()) });
+    }
+    return new FileOperationJob(Move, items);
+}
+
+/**
+ * @brief Creates a job renaming every source path to its paired target path.
+ */
+FileOperationJob* FileOperationJob::renameItems(const QList<QPair<QString, QString>> &renames)
+{
+    return new FileOperationJob(Rename, renames);
+}
+
+FileOperationJob::Operation FileOperationJob::operation() const
+{
+    return fileOperation;
+}
+
+QSet<QString> FileOperationJob::removedPaths() const
+{
+    return removed;
+}
+
+QHash<QString, bool> FileOperationJob::addedPaths() const
+{
+    return added;
+}
+
+QStringList FileOperationJob::failedPaths() const
+{
+    return failed;
+}
+
+QSet<QString> FileOperationJob::affectedDirectories() const
+{
+    return directories;
+}
+
+/**
+ * @brief Returns the source and target of every item that succeeded, in the order they were processed.
+ */
+QList<QPair<QString, QString>> FileOperationJob::completedItems() const
+{
+    return completed;
+}
+
+/**
+ * @brief Tells whether the finished job should be committed to the operation journal.
+ */
+bool FileOperationJob::isRecordedInJournal() const
+{
+    return recordedInJournal;
+}
+
+/**
+ * @brief Jobs replaying the journal (undo and redo) must not be recorded again.
+ */
+void FileOperationJob::setRecordedInJournal(bool recorded)
+{
+    recordedInJournal = recorded;
+}
+
+/**
+ * @brief Lets copies keep the modification time of their sources, which folder synchronization relies on.
+ */
+void FileOperationJob::setPreservesModificationTimes(bool preserves)
+{
+    preservesModificationTimes = preserves;
+}
+
+/**
+ * @brief Groups consecutive items with the same source and target directory and processes the groups in order.
+ * Keeping the order matters for planned renames and for undoing a batch.
+ */
+void FileOperationJob::execute()
+{
+    QString groupSource;
+    QString groupTarget;
+    QList<QPair<QString, QString>> groupNames;
+    qint64 done = 0;
+
+    for (const QPair<QString, QString> &item : std::as_const(operationItems))
+    {
+        if (isCancelled())
+        {
+            break;
+        }
+
+        const QFileInfo source(item.first);
+        QString targetDirectory;
+        QString targetName;
+
+        if (!item.second.isEmpty())
+        {
+            const QFileInfo target(item.second);
+            targetDirectory = target.absolutePath();
+            targetName = target.fileName();
+        }
+
+        if (!groupNames.isEmpty() && (source.absolutePath() != groupSource || targetDirectory != groupTarget))
+        {
+            processGroup(groupSource, groupTarget, groupNames, done);
+            groupNames.clear();
+        }
+
+        groupSource = source.absolutePath();
+        groupTarget = targetDirectory;
+        groupNames.append({ source.fileName(), targetName });
+    }
+
+    if (!groupNames.isEmpty() && !isCancelled())
+    {
+        processGroup(groupSource, groupTarget, groupNames, done);
+    }
+
+    reportProgress(operationItems.size(), operationItems.size());
+}
+
+/**
+ * @brief Processes all items sharing the same source and target directory.
+ *
+ * @param sourceDirectory The directory containing the source items.
+ * @param targetDirectory The directory receiving the items, empty for deletions.
+ * @param names Pairs of source and target names.
+ * @param done Running count of processed items, used for progress.
+ * @return True if every item of the group succeeded.
+ */
+bool FileOperationJob::processGroup(const QString &sourceDirectory, const QString &targetDirectory, const QList<QPair<QString, QString>> &names, qint64 &done)
+{
+    directories.insert(sourceDirectory);
+    if (!targetDirectory.isEmpty())
+    {
+        directories.insert(targetDirectory);
+    }
+
+#ifdef Q_OS_UNIX
+    const int sourceFd = ::open(QFile::encodeName(sourceDirectory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int targetFd = -1;
+    if (!targetDirectory.isEmpty())
+    {
+        targetFd = targetDirectory == sourceDirectory ? sourceFd
+                                                      : ::open(QFile::encodeName(targetDirectory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+#endif
+
+    bool allSucceeded = true;
+
+    for (const QPair<QString, QString> &name : names)
+    {
+        if (isCancelled())
+        {
+            break;
+        }
+
+        const QString sourcePath = joinPath(sourceDirectory, name.first);
+        QString targetPath = targetDirectory.isEmpty() ? QString() : joinPath(targetDirectory, name.second);
+        bool succeeded = false;
+
+#ifdef Q_OS_UNIX
+        const QByteArray sourceName = QFile::encodeName(name.first);
+        bool isDir = false;
+        struct stat status;
+        if (sourceFd >= 0 && ::fstatat(sourceFd, sourceName.constData(), &status, AT_SYMLINK_NOFOLLOW) == 0)
+        {
+            isDir = S_ISDIR(status.st_mode);
+        }
+        else
+        {
+            isDir = isRealDirectory(sourcePath);
+        }
+#else
+        const bool isDir = isRealDirectory(sourcePath);
+#endif
+
+        if (fileOperation == Delete)
+        {
+            if (isDir)
+            {
+                succeeded = QDir(sourcePath).removeRecursively();
+            }
+            else
+            {
+#ifdef Q_OS_UNIX
+                succeeded = sourceFd >= 0 ? ::unlinkat(sourceFd, sourceName.constData(), 0) == 0 : QFile::remove(sourcePath);
+#else
+                succeeded = QFile::remove(sourcePath);
+#endif
+            }
+        }
+        else if (fileOperation == Copy)
+        {
+            targetPath = joinPath(targetDirectory, uniqueTargetName(targetDirectory, name.second));
+            succeeded = copyRecursively(sourcePath, targetPath, preservesModificationTimes ? ModificationTime : NoTimes);
+        }
+        else
+        {
+#ifdef Q_OS_UNIX
+            const QByteArray targetName = QFile::encodeName(name.second);
+            int result = -1;
+            int error = 0;
+
+            if (sourceFd >= 0 && targetFd >= 0)
+            {
+#if defined(Q_OS_LINUX) && defined(RENAME_NOREPLACE)
+                result = ::renameat2(sourceFd, sourceName.constData(), targetFd, targetName.constData(), RENAME_NOREPLACE);
+                error = result == 0 ? 0 : errno;
+                if (result != 0 && error == EINVAL)
+#endif
+                {
+                    struct stat targetStatus;
+                    if (::fstatat(targetFd, targetName.constData(), &targetStatus, AT_SYMLINK_NOFOLLOW) == 0)
+                    {
+                        error = EEXIST;
+                    }
+                    else
+                    {
+                        result = ::renameat(sourceFd, sourceName.constData(), targetFd, targetName.constData());
+                        error = result == 0 ? 0 : errno;
+                    }
+                }
+            }
+
+            succeeded = result == 0;
+            if (!succeeded && error == EXDEV)
+            {
+                succeeded = copyRecursively(sourcePath, targetPath, AllTimes)
+                            && (isDir ? QDir(sourcePath).removeRecursively() : QFile::remove(sourcePath));
+            }
+#else
+            succeeded = QDir().rename(sourcePath, targetPath);
+            if (!succeeded && !QFileInfo::exists(targetPath))
+            {
+                succeeded = copyRecursively(sourcePath, targetPath, AllTimes)
+                            && (isDir ? QDir(sourcePath).removeRecursively() : QFile::remove(sourcePath));
+            }
+#endif
+        }
+
+        if (succeeded)
+        {
+            if (fileOperation != Copy)
+            {
+                // A source created earlier by this job (e.g. a temporary name) never reached the models.
+                added.remove(sourcePath);
+                removed.insert(sourcePath);
+            }
+            if (fileOperation != Delete)
+            {
+                added.insert(targetPath, isDir || QFileInfo(targetPath).isDir());
+            }
+            completed.append({ sourcePath, targetPath });
+        }
+        else
+        {
+            failed << sourcePath;
+            allSucceeded = false;
+        }
+
+        reportProgress(++done, operationItems.size());
+    }
+
+#ifdef Q_OS_UNIX
+    if (targetFd >= 0 && targetFd != sourceFd)
+    {
+        ::close(targetFd);
+    }
+    if (sourceFd >= 0)
+    {
+        ::close(sourceFd);
+    }
+#endif
+
+    return allSucceeded;
+}
+
+/**
+ * @brief Tells whether the path is a directory and not a symbolic link to one.
+ */
+bool FileOperationJob::isRealDirectory(const QString &path)
+{
+    const QFileInfo fileInfo(path);
+    return fileInfo.isDir() && !fileInfo.isSymLink();
+}
+
+/**
+ * @brief Copies a file or a directory tree. Symbolic links are copied as links.
+ *
+ * @param source The file or directory to copy.
+ * @param destination The path of the copy.
+ * @param copiedTimes The times of its source every copied file and directory gets; a move across devices keeps
+ * the access times as well.
+ * @return True if everything was copied.
+ */
+bool FileOperationJob::copyRecursively(const QString &source, const QString &destination, CopiedTimes copiedTimes)
+{
+    const QFileInfo sourceInfo(source);
+    if (sourceInfo.isSymLink())
+    {
+        return copySymLink(source, destination);
+    }
+
+    // Taken before copying, reading the source may update its access time.
+    const QDateTime accessed = copiedTimes == AllTimes ? sourceInfo.lastRead(QTimeZone::UTC) : QDateTime();
+    const QDateTime modified = sourceInfo.lastModified(QTimeZone::UTC);
+
+    if (!sourceInfo.isDir())
+    {
+        if (!QFile::copy(source, destination))
+        {
+            return false;
+        }
+        if (copiedTimes != NoTimes)
+        {
+            setFileTimes(destination, accessed, modified);
+        }
+        return true;
+    }
+
+    if (QDir::cleanPath(destination).startsWith(QDir::cleanPath(source) + '/') || !QDir().mkpath(destination))
+    {
+        return false;
+    }
+
+    QDirIterator iterator(source, QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden | QDir::System);
+    while (iterator.hasNext())
+    {
+        const QString childPath = iterator.next();
+        if (!copyRecursively(childPath, joinPath(destination, iterator.fileName()), copiedTimes))
+        {
+            return false;
+        }
+    }
+
+    // Set last, creating the children changed it.
+    if (copiedTimes != NoTimes)
+    {
+        setFileTimes(destination, accessed, modified);
+    }
+    return true;
+}
+
+/**
+ * @brief Returns a name that does not exist yet in the directory, appending " - Copy" and a counter if needed.
+ */
+QString FileOperationJob::uniqueTargetName(const QString &directory, const QString &name)
+{
+    if (!QFileInfo::exists(joinPath(directory, name)))
+    {
+        return name;
+    }
+
+    const QFileInfo fileInfo(name);
+    const QString baseName = fileInfo.completeBaseName().isEmpty() ? name : fileInfo.completeBaseName();
+    const QString suffix = fileInfo.completeBaseName().isEmpty() || fileInfo.suffix().isEmpty() ? QString() : "." + fileInfo.suffix();
+
+    for (int counter = 1; ; ++counter)
+    {
+        const QString candidate = counter == 1 ? QString("%1 - Copy%2").arg(baseName, suffix)
+                                               : QString("%1 - Copy (%2)%3").arg(baseName).arg(counter).arg(suffix);
+        if (!QFileInfo::exists(joinPath(directory, candidate)))
+        {
+            return candidate;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+#ifndef FILEOPERATIONJOB_H
+#define FILEOPERATIONJOB_H
+
+#include "backgroundjob.h"
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+
+class FileOperationJob : public BackgroundJob
+{
+    Q_OBJECT
+public:
+    enum Operation
+    {
+        Delete,
+        Copy,
+        Move,
+        Rename,
+        Trash
+    };
+
+    FileOperationJob(Operation operation, const QList<QPair<QString, QString>> &items, QObject *parent = nullptr);
+
+    static FileOperationJob* deleteItems(const QStringList &paths);
+    static FileOperationJob* trashItems(const QStringList &paths);
+    static FileOperationJob* copyItems(const QStringList &paths, const QString &destinationDirectory);
+    static FileOperationJob* copyItems(const QList<QPair<QString, QString>> &items);
+    static FileOperationJob* moveItems(const QStringList &paths, const QString &destinationDirectory);
+    static FileOperationJob* renameItems(const QList<QPair<QString, QString>> &renames);
+
+    Operation operation() const;
+    QSet<QString> removedPaths() const;
+    QHash<QString, bool> addedPaths() const;
+    QStringList failedPaths() const;
+    QSet<QString> affectedDirectories() const;
+    QList<QPair<QString, QString>> completedItems() const;
+    bool isRecordedInJournal() const;
+    void setRecordedInJournal(bool recorded);
+    void setPreservesModificationTimes(bool preserves);
+
+protected:
+    void execute() override;
+
+private:
+    enum CopiedTimes
+    {
+        NoTimes,
+        ModificationTime,
+        AllTimes
+    };
+
+    Operation fileOperation;
+    QList<QPair<QString, QString>> operationItems;
+
+    QSet<QString> removed;
+    QHash<QString, bool> added;
+    QStringList failed;
+    QSet<QString> directories;
+    QList<QPair<QString, QString>> completed;
+    bool recordedInJournal;
+    bool preservesModificationTimes;
+
+    bool processGroup(const QString &sourceDirectory, const QString &targetDirectory, const QList<QPair<QString, QString>> &names, qint64 &done);
+    static bool isRealDirectory(const QString &path);
+    static bool copyRecursively(const QString &source, const QString &destination, CopiedTimes copiedTimes = NoTimes);
+    static QString uniqueTargetName(const QString &directory, const QString &name);
+};
+
+#endif // FILEOPERATIONJOB_H
@@ -75,32 +75,15 @@ void FileOperationsDialog::loadNecessaryData()
 }
 
 /**
- * \brief Deletes the file or directory at the provided rootPath.
+ * \brief Requests moving the file or directory at the provided rootPath to the trash, from where it can be restored with undo.
  */
 void FileOperationsDialog::deleteFile()
 {
     QFile file(rootPath);
     if (file.exists())
     {
-        if (file.remove())
-        {
-            emit refresh();
-            close();
-        }
-        else
-        {
-            QDir dir(rootPath);
-
-            if (dir.removeRecursively()) {
-                emit refresh();
-                close();
-                return;
-            }
-            else
-            {
-                QMessageBox::critical(this, "Error", "Failed to delete file!");
-            }
-        }
+        emit deleteRequested(rootPath);
+        close();
     }
     else
     {
@@ -123,6 +106,7 @@ void FileOperationsDialog::renameFile()
 
         if (file.rename(newFilePath))
         {
+            emit renamed(rootPath, newFilePath);
             emit refresh();
             close();
             QMessageBox::information(this, "Success", "File renamed successfully!");
@@ -158,6 +142,7 @@ void FileOperationsDialog::addFolder()
             {
                 if (newDir.mkdir(filePath))
                 {
+                    emit folderCreated(filePath);
                     emit refresh();
                     close();
                     QMessageBox::information(this, "Success", "Folder created successfully!");
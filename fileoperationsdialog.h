@@ -24,6 +24,9 @@ public:
 signals:
     void selectionClear();
     void refresh();
+    void deleteRequested(const QString &path);
+    void renamed(const QString &oldPath, const QString &newPath);
+    void folderCreated(const QString &path);
 
 private slots:
     void on_QPushButton_Cancel_clicked();
@@ -0,0 +1,150 @@
+#include "filestatusreader.h"
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QTimeZone>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <pwd.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * @file filestatusreader.h
+ * @brief The FileStatusReader class reads the size, modification time, permissions, owner and inode of a batch of
+ * directory entries.
+ * The directory is opened once per batch and every entry is resolved relative to it, with statx on Linux and fstatat
+ * on other Unix systems, so the path is not walked again for each file. Meant to run on a worker thread.
+ */
+
+namespace
+{
+#if defined(Q_OS_LINUX) && defined(STATX_BASIC_STATS)
+const unsigned int statusMask = STATX_TYPE | STATX_MODE | STATX_UID | STATX_INO | STATX_SIZE | STATX_MTIME;
+#endif
+
+QMutex ownerNamesMutex;
+QHash<quint32, QString> ownerNames;
+}
+
+/**
+ * @brief Reads the status of the entries of a directory and marks them as read. Entries that vanished keep no
+ * status but are marked as read too, so they are not asked for again.
+ *
+ * @param directory The directory holding the entries, or an empty string if the names are absolute paths.
+ * @param entries The entries, only name and type need to be set.
+ */
+void FileStatusReader::read(const QString &directory, DirectoryListing &entries)
+{
+#ifdef Q_OS_UNIX
+    const int directoryFd = directory.isEmpty() ? AT_FDCWD
+                                                : ::open(QFile::encodeName(directory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (directoryFd == AT_FDCWD || directoryFd >= 0)
+    {
+        for (DirectoryEntry &entry : entries)
+        {
+            const QByteArray name = QFile::encodeName(entry.name);
+            entry.hasStatus = true;
+#if defined(Q_OS_LINUX) && defined(STATX_BASIC_STATS)
+            struct statx status;
+            if (::statx(directoryFd, name.constData(), AT_STATX_DONT_SYNC, statusMask, &status) == 0)
+            {
+                entry.size = entry.isDir ? 0 : qint64(status.stx_size);
+                entry.modifiedMs = qint64(status.stx_mtime.tv_sec) * 1000 + status.stx_mtime.tv_nsec / 1000000;
+                entry.mode = status.stx_mode;
+                entry.ownerId = status.stx_uid;
+                entry.inode = status.stx_ino;
+            }
+#else
+            struct stat status;
+            if (::fstatat(directoryFd, name.constData(), &status, 0) == 0)
+            {
+                entry.size = entry.isDir ? 0 : qint64(status.st_size);
+                entry.modifiedMs = qint64(status.st_mtime) * 1000;
+                entry.mode = status.st_mode;
+                entry.ownerId = status.st_uid;
+                entry.inode = status.st_ino;
+            }
+#endif
+            ownerName(entry.ownerId);
+        }
+        if (directoryFd != AT_FDCWD)
+        {
+            ::close(directoryFd);
+        }
+        return;
+    }
+#endif
+
+    for (DirectoryEntry &entry : entries)
+    {
+        const QFileInfo fileInfo(directory.isEmpty() ? entry.name : directory + '/' + entry.name);
+        entry.hasStatus = true;
+        if (fileInfo.exists())
+        {
+            const QFile::Permissions permissions = fileInfo.permissions();
+            entry.size = entry.isDir ? 0 : fileInfo.size();
+            entry.modifiedMs = fileInfo.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+            entry.mode = (permissions & QFile::ReadOwner ? 0400 : 0) | (permissions & QFile::WriteOwner ? 0200 : 0)
+                         | (permissions & QFile::ExeOwner ? 0100 : 0) | (permissions & QFile::ReadGroup ? 040 : 0)
+                         | (permissions & QFile::WriteGroup ? 020 : 0) | (permissions & QFile::ExeGroup ? 010 : 0)
+                         | (permissions & QFile::ReadOther ? 04 : 0) | (permissions & QFile::WriteOther ? 02 : 0)
+                         | (permissions & QFile::ExeOther ? 01 : 0);
+            entry.ownerId = fileInfo.ownerId();
+        }
+    }
+}
+
+/**
+ * @brief Returns the name of a user, or the id if it has none. Names are looked up once and cached, so the
+ * reader resolves them on its thread and the GUI thread only hits the cache.
+ */
+QString FileStatusReader::ownerName(quint32 ownerId)
+{
+    {
+        QMutexLocker locker(&ownerNamesMutex);
+        const auto found = ownerNames.constFind(ownerId);
+        if (found != ownerNames.constEnd())
+        {
+            return *found;
+        }
+    }
+
+    QString name = QString::number(ownerId);
+#ifdef Q_OS_UNIX
+    struct passwd user;
+    struct passwd *result = nullptr;
+    char buffer[4096];
+    if (::getpwuid_r(uid_t(ownerId), &user, buffer, sizeof(buffer), &result) == 0 && result != nullptr)
+    {
+        name = QFile::decodeName(result->pw_name);
+    }
+#endif
+
+    QMutexLocker locker(&ownerNamesMutex);
+    ownerNames.insert(ownerId, name);
+    return name;
+}
+
+/**
+ * @brief Formats the permission bits of a mode like ls -l, e.g. drwxr-xr-x.
+ */
+QString FileStatusReader::permissionsText(quint32 mode, bool isDir)
+{
+    static const char flags[] = "rwxrwxrwx";
+    QString text(10, '-');
+    text[0] = isDir ? 'd' : '-';
+    for (int i = 0; i < 9; ++i)
+    {
+        if (mode & (0400 >> i))
+        {
+            text[i + 1] = QLatin1Char(flags[i]);
+        }
+    }
+    return text;
+}
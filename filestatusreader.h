@@ -0,0 +1,15 @@
+#ifndef FILESTATUSREADER_H
+#define FILESTATUSREADER_H
+
+#include "directorylistingcache.h"
+#include <QString>
+
+class FileStatusReader
+{
+public:
+    static void read(const QString &directory, DirectoryListing &entries);
+    static QString ownerName(quint32 ownerId);
+    static QString permissionsText(quint32 mode, bool isDir);
+};
+
+#endif // FILESTATUSREADER_H
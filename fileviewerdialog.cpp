@@ -1,17 +1,33 @@
 #include "fileviewerdialog.h"
 #include "ui_fileviewerdialog.h"
-#include <QTextStream>
+#include "archiveindex.h"
+#include "hexview.h"
+#include "sourceview.h"
 #include <QFileDialog>
 #include <QFile>
-#include <QTextEdit>
+#include <QFileInfo>
 #include <QLabel>
 #include <QPixmap>
+#include <QLineEdit>
+#include <QCheckBox>
+#include <QHBoxLayout>
+#include <QLocale>
+#include <algorithm>
+#include <memory>
 
 /**
  * @file fileviewerdialog.h
  * @brief The FileViewerDialog class manages the display of text and image files in a QDialog window.
+ * Text is shown in a SourceView, which highlights source code of common languages; binary files are shown in a
+ * HexView with jump-to-offset and byte search.
  */
 
+namespace
+{
+const qint64 binarySniffSize = 8192;
+const qint64 maxBufferedMemberSize = 64 * 1024 * 1024;
+}
+
 FileViewerDialog::FileViewerDialog(QWidget *parent) :
     QDialog(parent),
     ui(new Ui::FileViewerDialog)
@@ -21,6 +37,7 @@ FileViewerDialog::FileViewerDialog(QWidget *parent) :
 
 FileViewerDialog::~FileViewerDialog()
 {
+    memberPool.waitForDone();
     delete ui;
 }
 
@@ -29,37 +46,48 @@ FileViewerDialog::~FileViewerDialog()
  */
 
 /**
- * \brief Loads and displays the content of a text file in a QTextEdit within the dialog window.
+ * \brief Loads and displays a text file in a SourceView within the dialog window, highlighted if it is source code
+ * of a known language. Files too large to be shown as text open in the hex view. Files on disk can be followed as
+ * they grow; .log files are followed from the start.
  *
  * \param filePath The path of the text file to be displayed.
  */
 void FileViewerDialog::loadTextFile(const QString& filePath)
 {
-    QTextEdit* textEdit = new QTextEdit(this);
-
-    QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    if (ArchiveIndex::isInsideArchive(filePath))
     {
-        delete textEdit;
-        close();
+        openArchiveMember(filePath, false);
         return;
     }
 
-    QTextStream textStream(&file);
-
-    QString fileContent;
-    int lineCount = 0;
-    while (!textStream.atEnd() && lineCount < 100)
+    SourceView *sourceView = new SourceView(this);
+    if (!sourceView->openFile(filePath))
     {
-        fileContent += textStream.readLine() + "\n";
-        ++lineCount;
+        delete sourceView;
+        if (QFileInfo(filePath).isReadable())
+        {
+            openHexView(filePath);
+        }
+        else
+        {
+            close();
+        }
+        return;
     }
 
-    file.close();
+    QBoxLayout *frameLayout = qobject_cast<QBoxLayout*>(ui->QFrame_FileViewer->layout());
+    QCheckBox *followCheckBox = new QCheckBox(tr("Follow (tail -f)"), this);
+    QHBoxLayout *toolLayout = new QHBoxLayout();
+    toolLayout->setContentsMargins(4, 4, 4, 4);
+    toolLayout->addWidget(followCheckBox);
+    toolLayout->addStretch();
+    frameLayout->addLayout(toolLayout);
 
-    textEdit->setPlainText(fileContent);
-    textEdit->setReadOnly(true);
-    ui->QFrame_FileViewer->layout()->addWidget(textEdit);
+    connect(followCheckBox, &QCheckBox::toggled, sourceView, &SourceView::setFollowing);
+    followCheckBox->setChecked(QFileInfo(filePath).suffix().compare("log", Qt::CaseInsensitive) == 0);
+
+    frameLayout->addWidget(sourceView);
+    resize(std::max(width(), 820), std::max(height(), 560));
 }
 
 /**
@@ -68,9 +96,24 @@ void FileViewerDialog::loadTextFile(const QString& filePath)
  * \param filePath The path of the image file to be displayed.
  */
 void FileViewerDialog::openImage(const QString& filePath)
+{
+    if (ArchiveIndex::isInsideArchive(filePath))
+    {
+        openArchiveMember(filePath, true);
+        return;
+    }
+
+    showImage(QPixmap(filePath));
+}
+
+/**
+ * \brief Shows an image scaled to the dialog in a QLabel, nothing if it could not be decoded.
+ *
+ * \param image The decoded image.
+ */
+void FileViewerDialog::showImage(const QPixmap &image)
 {
     QLabel* imageLabel = new QLabel(this);
-    QPixmap image(filePath);
     if (!image.isNull())
     {
         QSize dialogSize = this->size();
@@ -81,3 +124,176 @@ void FileViewerDialog::openImage(const QString& filePath)
         ui->QFrame_FileViewer->layout()->addWidget(imageLabel);
     }
 }
+
+/**
+ * \brief Shows a file as text, or in the hex view if it looks binary (a NUL byte in its first kilobytes).
+ *
+ * \param filePath The path of the file to be displayed.
+ */
+void FileViewerDialog::openFile(const QString& filePath)
+{
+    if (ArchiveIndex::isInsideArchive(filePath))
+    {
+        openArchiveMember(filePath, false);
+        return;
+    }
+
+    QFile file(filePath);
+    const bool isBinary = file.open(QIODevice::ReadOnly) && file.peek(binarySniffSize).contains('\0');
+    file.close();
+
+    if (isBinary)
+    {
+        openHexView(filePath);
+    }
+    else
+    {
+        loadTextFile(filePath);
+    }
+}
+
+/**
+ * \brief Shows the bytes of a file in a HexView with fields to jump to an offset and to search for bytes or text.
+ * Files on disk are paged in from a memory map; members of archives are read into memory, up to a limit.
+ *
+ * \param filePath The path of the file to be displayed.
+ */
+void FileViewerDialog::openHexView(const QString& filePath)
+{
+    if (ArchiveIndex::isInsideArchive(filePath))
+    {
+        openArchiveMember(filePath, false);
+        return;
+    }
+
+    HexView *hexView = new HexView(this);
+    if (!hexView->openFile(filePath))
+    {
+        delete hexView;
+        close();
+        return;
+    }
+
+    QLabel *statusLabel = new QLabel(QLocale().formattedDataSize(hexView->dataSize()), this);
+    addHexView(hexView, statusLabel);
+}
+
+/**
+ * \brief Adds a HexView with its fields to jump to an offset and to search for bytes or text.
+ *
+ * \param hexView The view holding the data.
+ * \param statusLabel The label showing the size, search results and errors.
+ */
+void FileViewerDialog::addHexView(HexView *hexView, QLabel *statusLabel)
+{
+    QLineEdit *offsetEdit = new QLineEdit(this);
+    offsetEdit->setPlaceholderText(tr("Go to offset (0x...)"));
+    QLineEdit *findEdit = new QLineEdit(this);
+    findEdit->setPlaceholderText(tr("Find bytes (4D 5A) or text"));
+
+    QHBoxLayout *toolLayout = new QHBoxLayout();
+    toolLayout->setContentsMargins(4, 4, 4, 4);
+    toolLayout->addWidget(offsetEdit);
+    toolLayout->addWidget(findEdit);
+    toolLayout->addWidget(statusLabel);
+
+    connect(offsetEdit, &QLineEdit::returnPressed, this, [hexView, offsetEdit, statusLabel]()
+            {
+                qint64 offset = 0;
+                if (HexView::parseOffset(offsetEdit->text(), offset) && offset < hexView->dataSize())
+                {
+                    hexView->goToOffset(offset);
+                    hexView->setFocus();
+                }
+                else
+                {
+                    statusLabel->setText(tr("Invalid offset"));
+                }
+            });
+    connect(findEdit, &QLineEdit::returnPressed, this, [hexView, findEdit, statusLabel]()
+            {
+                statusLabel->setText(tr("Searching..."));
+                hexView->find(HexView::parsePattern(findEdit->text()));
+            });
+    connect(hexView, &HexView::searchFinished, this, [statusLabel](qint64 offset)
+            {
+                statusLabel->setText(offset >= 0 ? tr("Found at 0x%1").arg(offset, 0, 16) : tr("Not found"));
+            });
+
+    QBoxLayout *frameLayout = qobject_cast<QBoxLayout*>(ui->QFrame_FileViewer->layout());
+    frameLayout->addLayout(toolLayout);
+    frameLayout->addWidget(hexView);
+    resize(std::max(width(), 820), std::max(height(), 560));
+}
+
+/**
+ * \brief Reads a member of an archive on a worker thread, so unpacking it does not block the GUI, and shows a
+ * placeholder until it is read.
+ *
+ * \param filePath The path of the member inside the archive.
+ * \param isImage Shows the member as an image, otherwise as text or, if it looks binary, in the hex view.
+ */
+void FileViewerDialog::openArchiveMember(const QString &filePath, bool isImage)
+{
+    QLabel *placeholderLabel = new QLabel(tr("Reading archive..."), this);
+    placeholderLabel->setAlignment(Qt::AlignCenter);
+    ui->QFrame_FileViewer->layout()->addWidget(placeholderLabel);
+
+    memberPool.start([this, filePath, isImage, placeholderLabel]()
+                     {
+                         std::unique_ptr<QIODevice> member(ArchiveIndex::instance().openMember(filePath));
+                         const bool isOpened = member != nullptr;
+                         // Images are decoded as a whole, text and bytes are shown up to a limit.
+                         const QByteArray data = !isOpened ? QByteArray()
+                                                 : isImage ? member->readAll()
+                                                           : member->read(maxBufferedMemberSize);
+                         const bool isComplete = isOpened && member->atEnd();
+
+                         QMetaObject::invokeMethod(this, [this, filePath, isImage, placeholderLabel, isOpened, data, isComplete]()
+                                                   {
+                                                       delete placeholderLabel;
+                                                       if (!isOpened)
+                                                       {
+                                                           close();
+                                                       }
+                                                       else
+                                                       {
+                                                           showMember(filePath, isImage, data, isComplete);
+                                                       }
+                                                   }, Qt::QueuedConnection);
+                     });
+}
+
+/**
+ * \brief Shows a member read by openArchiveMember().
+ *
+ * \param filePath The path of the member inside the archive.
+ * \param isImage Shows the member as an image.
+ * \param data The content of the member, possibly truncated.
+ * \param isComplete False if the content was truncated.
+ */
+void FileViewerDialog::showMember(const QString &filePath, bool isImage, const QByteArray &data, bool isComplete)
+{
+    if (isImage)
+    {
+        QPixmap image;
+        image.loadFromData(data);
+        showImage(image);
+        return;
+    }
+
+    if (data.left(binarySniffSize).contains('\0'))
+    {
+        HexView *hexView = new HexView(this);
+        hexView->setData(data);
+        QLabel *statusLabel = new QLabel(isComplete ? QLocale().formattedDataSize(hexView->dataSize())
+                                                    : tr("First %1 MiB").arg(maxBufferedMemberSize / (1024 * 1024)), this);
+        addHexView(hexView, statusLabel);
+        return;
+    }
+
+    SourceView *sourceView = new SourceView(this);
+    sourceView->setData(data, QFileInfo(filePath).fileName());
+    ui->QFrame_FileViewer->layout()->addWidget(sourceView);
+    resize(std::max(width(), 820), std::max(height(), 560));
+}
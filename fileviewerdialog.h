@@ -3,6 +3,10 @@
 
 #include <QDialog>
 #include <QFile>
+#include <QThreadPool>
+
+class HexView;
+class QLabel;
 
 namespace Ui {
 class FileViewerDialog;
@@ -17,10 +21,18 @@ public:
     ~FileViewerDialog();
     void loadTextFile(const QString& filePath);
     void openImage(const QString& filePath);
+    void openFile(const QString& filePath);
+    void openHexView(const QString& filePath);
 
 
 private:
     Ui::FileViewerDialog *ui;
+    QThreadPool memberPool;
+
+    void showImage(const QPixmap &image);
+    void addHexView(HexView *hexView, QLabel *statusLabel);
+    void openArchiveMember(const QString &filePath, bool isImage);
+    void showMember(const QString &filePath, bool isImage, const QByteArray &data, bool isComplete);
 };
 
 #endif // FILEVIEWERDIALOG_H
@@ -0,0 +1,490 @@
+#include "hexview.h"
+#include <QFontDatabase>
+#include <QPainter>
+#include <QRegularExpression>
+#include <QScrollBar>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @file hexview.h
+ * @brief The HexView class shows the bytes of a file as offset, hex and text columns.
+ * Only the visible rows are painted, from a window of the file that is memory-mapped on demand and moved when the
+ * view scrolls past it, so files of any size open instantly and use constant memory. The scroll bar is scaled for
+ * files with more rows than it can count. A byte pattern is searched on a background thread over successive
+ * mapped windows, locating the pattern with memchr on one of its distinctive bytes before comparing it.
+ */
+
+namespace
+{
+const int bytesPerRow = 16;
+const qint64 mapWindowSize = 4 * 1024 * 1024;
+const qint64 searchWindowSize = 64 * 1024 * 1024;
+const qint64 maxScrollValue = 1 << 30;
+
+/**
+ * @brief Returns the index of the byte searched with memchr. Zero and 0xFF bytes fill much of a binary file, so
+ * the first other byte is preferred.
+ */
+qsizetype anchorIndex(const QByteArray &pattern)
+{
+    for (qsizetype i = 0; i < pattern.size(); ++i)
+    {
+        if (uchar(pattern.at(i)) != 0x00 && uchar(pattern.at(i)) != 0xFF)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Returns the offset of the first occurrence of the pattern in [data, data + length), or -1.
+ */
+qint64 findBytes(const char *data, qint64 length, const QByteArray &pattern, qsizetype anchor)
+{
+    const qsizetype patternLength = pattern.size();
+    if (length < patternLength)
+    {
+        return -1;
+    }
+
+    const char anchorByte = pattern.at(anchor);
+    const char *position = data + anchor;
+    const char *limit = data + length - (patternLength - 1 - anchor);
+    while (position < limit)
+    {
+        const char *hit = static_cast<const char*>(std::memchr(position, anchorByte, limit - position));
+        if (hit == nullptr)
+        {
+            return -1;
+        }
+
+        const char *start = hit - anchor;
+        if (std::memcmp(start, pattern.constData(), patternLength) == 0)
+        {
+            return start - data;
+        }
+        position = hit + 1;
+    }
+    return -1;
+}
+
+/**
+ * @brief Searches a file window by window for a match starting in [from, to).
+ *
+ * @return The offset of the match, -1 if there is none or -2 if the search was superseded.
+ */
+qint64 findInFile(QFile &file, qint64 size, qint64 from, qint64 to, const QByteArray &pattern,
+                  const std::atomic<quint64> &generation, quint64 searchId)
+{
+    const qsizetype anchor = anchorIndex(pattern);
+    for (qint64 windowStart = from; windowStart < to; windowStart += searchWindowSize)
+    {
+        if (generation != searchId)
+        {
+            return -2;
+        }
+
+        const qint64 length = std::min(searchWindowSize + pattern.size() - 1, size - windowStart);
+        QByteArray fallback;
+        uchar *mapped = file.map(windowStart, length);
+        const char *data = reinterpret_cast<const char*>(mapped);
+        if (mapped == nullptr)
+        {
+            if (!file.seek(windowStart))
+            {
+                return -1;
+            }
+            fallback = file.read(length);
+            data = fallback.constData();
+        }
+
+        const qint64 found = findBytes(data, mapped ? length : fallback.size(), pattern, anchor);
+        if (mapped != nullptr)
+        {
+            file.unmap(mapped);
+        }
+        if (found >= 0)
+        {
+            return windowStart + found < to ? windowStart + found : -1;
+        }
+    }
+    return -1;
+}
+}
+
+HexView::HexView(QWidget *parent)
+    : QAbstractScrollArea(parent), searchGeneration(0)
+{
+    const QFont fixedFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    setFont(fixedFont);
+    // The viewer dialog styles every child with a proportional font.
+    setStyleSheet(QString("font-family: \"%1\";").arg(fixedFont.family()));
+    searchPool.setMaxThreadCount(1);
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+HexView::~HexView()
+{
+    cancelSearch();
+    searchPool.waitForDone();
+    releaseWindow();
+}
+
+/**
+ * @brief Shows a file on disk. Nothing is read until rows are painted.
+ *
+ * @return False if the file cannot be opened.
+ */
+bool HexView::openFile(const QString &filePath)
+{
+    cancelSearch();
+    releaseWindow();
+    buffer.clear();
+    file.close();
+    file.setFileName(filePath);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        size = 0;
+        updateScrollBars();
+        return false;
+    }
+
+    size = file.size();
+    selectionStart = -1;
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+/**
+ * @brief Shows bytes held in memory, used for members of archives.
+ */
+void HexView::setData(const QByteArray &data)
+{
+    cancelSearch();
+    releaseWindow();
+    file.close();
+
+    buffer = data;
+    size = buffer.size();
+    selectionStart = -1;
+    updateScrollBars();
+    viewport()->update();
+}
+
+qint64 HexView::dataSize() const
+{
+    return size;
+}
+
+/**
+ * @brief Scrolls the byte at the offset into view and selects it.
+ */
+void HexView::goToOffset(qint64 offset)
+{
+    if (size == 0)
+    {
+        return;
+    }
+
+    offset = std::clamp<qint64>(offset, 0, size - 1);
+    if (selectionStart != offset || selectionLength == 0)
+    {
+        selectionStart = offset;
+        selectionLength = 1;
+    }
+
+    const qint64 row = offset / bytesPerRow;
+    if (row < topRow() || row >= topRow() + visibleRowCount() - 1)
+    {
+        const qint64 top = std::max<qint64>(0, row - visibleRowCount() / 3);
+        verticalScrollBar()->setValue(int(top / rowsPerStep));
+    }
+    viewport()->update();
+}
+
+/**
+ * @brief Searches for the pattern after the current selection, wrapping around at the end, and selects the match.
+ * The search runs in the background; searchFinished() reports the offset of the match or -1.
+ */
+void HexView::find(const QByteArray &pattern)
+{
+    const quint64 searchId = ++searchGeneration;
+    if (pattern.isEmpty() || pattern.size() > size)
+    {
+        emit searchFinished(-1);
+        return;
+    }
+
+    const qint64 start = selectionStart >= 0 ? std::min(selectionStart + 1, size) : 0;
+    const QString path = file.isOpen() ? file.fileName() : QString();
+    const QByteArray data = buffer;
+    const qint64 length = size;
+
+    searchPool.start([this, searchId, pattern, start, path, data, length]()
+                     {
+                         qint64 found = -1;
+                         if (path.isEmpty())
+                         {
+                             const qsizetype anchor = anchorIndex(pattern);
+                             found = findBytes(data.constData() + start, length - start, pattern, anchor);
+                             found = found >= 0 ? start + found : findBytes(data.constData(), std::min(length, start + pattern.size() - 1), pattern, anchor);
+                         }
+                         else
+                         {
+                             QFile searchedFile(path);
+                             if (searchedFile.open(QIODevice::ReadOnly))
+                             {
+                                 found = findInFile(searchedFile, length, start, length, pattern, searchGeneration, searchId);
+                                 if (found == -1)
+                                 {
+                                     found = findInFile(searchedFile, length, 0, start, pattern, searchGeneration, searchId);
+                                 }
+                             }
+                         }
+
+                         QMetaObject::invokeMethod(this, [this, searchId, found, length = pattern.size()]()
+                                                   {
+                                                       if (searchId != searchGeneration || found == -2)
+                                                       {
+                                                           return;
+                                                       }
+                                                       if (found >= 0)
+                                                       {
+                                                           selectionStart = found;
+                                                           selectionLength = length;
+                                                           goToOffset(found);
+                                                       }
+                                                       emit searchFinished(found);
+                                                   }, Qt::QueuedConnection);
+                     });
+}
+
+/**
+ * @brief Drops the running search; its result is never reported.
+ */
+void HexView::cancelSearch()
+{
+    ++searchGeneration;
+}
+
+/**
+ * @brief Parses an offset typed as decimal, as hex with a 0x prefix or with an h suffix.
+ */
+bool HexView::parseOffset(const QString &text, qint64 &offset)
+{
+    QString trimmed = text.trimmed();
+    bool isValid = false;
+    if (trimmed.startsWith("0x", Qt::CaseInsensitive))
+    {
+        offset = trimmed.mid(2).toLongLong(&isValid, 16);
+    }
+    else if (trimmed.endsWith('h', Qt::CaseInsensitive))
+    {
+        trimmed.chop(1);
+        offset = trimmed.toLongLong(&isValid, 16);
+    }
+    else
+    {
+        offset = trimmed.toLongLong(&isValid, 10);
+    }
+    return isValid && offset >= 0;
+}
+
+/**
+ * @brief Turns a search text into bytes. Pairs of hex digits, optionally separated by spaces, are taken as bytes,
+ * any other text as UTF-8. Quotes force text, e.g. "CAFE".
+ */
+QByteArray HexView::parsePattern(const QString &text)
+{
+    static const QRegularExpression hexBytes("^([0-9A-Fa-f]{2}\\s*)+$");
+    const QString trimmed = text.trimmed();
+
+    if (trimmed.size() >= 2 && trimmed.startsWith('"') && trimmed.endsWith('"'))
+    {
+        return trimmed.mid(1, trimmed.size() - 2).toUtf8();
+    }
+    if (hexBytes.match(trimmed).hasMatch())
+    {
+        return QByteArray::fromHex(trimmed.toLatin1());
+    }
+    return trimmed.toUtf8();
+}
+
+void HexView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(viewport());
+    painter.setFont(font());
+    painter.translate(-horizontalScrollBar()->value(), 0);
+
+    const QFontMetrics metrics(font());
+    const int charWidth = metrics.horizontalAdvance('0');
+    const int rowHeight = metrics.height();
+    const int digits = offsetDigits();
+    const int hexX = charWidth * (digits + 2);
+    const int textX = hexX + charWidth * (bytesPerRow * 3 + 2);
+    const QColor textColor = palette().color(QPalette::WindowText);
+    const QColor offsetColor = palette().color(QPalette::PlaceholderText);
+    const QColor selectionColor = palette().color(QPalette::Highlight);
+
+    const qint64 firstRow = topRow();
+    const qint64 firstOffset = firstRow * bytesPerRow;
+    const qint64 length = std::min<qint64>(qint64(visibleRowCount()) * bytesPerRow, size - firstOffset);
+    const uchar *data = length > 0 ? bytesAt(firstOffset, length) : nullptr;
+    if (data == nullptr)
+    {
+        return;
+    }
+
+    auto hexColumnX = [hexX, charWidth](int column)
+    {
+        return hexX + charWidth * (column * 3 + (column >= bytesPerRow / 2 ? 1 : 0));
+    };
+
+    for (qint64 rowOffset = 0; rowOffset < length; rowOffset += bytesPerRow)
+    {
+        const int y = int(rowOffset / bytesPerRow) * rowHeight;
+        const int count = int(std::min<qint64>(bytesPerRow, length - rowOffset));
+        const qint64 offset = firstOffset + rowOffset;
+
+        for (int column = 0; column < count; ++column)
+        {
+            const qint64 byteOffset = offset + column;
+            if (byteOffset >= selectionStart && byteOffset < selectionStart + selectionLength)
+            {
+                painter.fillRect(hexColumnX(column), y, charWidth * 2, rowHeight, selectionColor);
+                painter.fillRect(textX + charWidth * column, y, charWidth, rowHeight, selectionColor);
+            }
+        }
+
+        QString hexText;
+        QString plainText;
+        hexText.reserve(bytesPerRow * 3 + 1);
+        plainText.reserve(bytesPerRow);
+        for (int column = 0; column < count; ++column)
+        {
+            const uchar byte = data[rowOffset + column];
+            hexText += QString("%1 ").arg(byte, 2, 16, QChar('0')).toUpper();
+            if (column == bytesPerRow / 2 - 1)
+            {
+                hexText += ' ';
+            }
+            plainText += (byte >= 0x20 && byte < 0x7F) ? QChar(byte) : QChar('.');
+        }
+
+        const int baseline = y + metrics.ascent();
+        painter.setPen(offsetColor);
+        painter.drawText(charWidth, baseline, QString("%1").arg(offset, digits, 16, QChar('0')).toUpper());
+        painter.setPen(textColor);
+        painter.drawText(hexX, baseline, hexText);
+        painter.drawText(textX, baseline, plainText);
+    }
+}
+
+void HexView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void HexView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    viewport()->update();
+}
+
+/**
+ * @brief Returns the bytes of a range, mapping a new window of the file if the range lies outside the current one.
+ * A file that cannot be mapped is read instead.
+ */
+const uchar* HexView::bytesAt(qint64 offset, qint64 length)
+{
+    if (!file.isOpen())
+    {
+        return reinterpret_cast<const uchar*>(buffer.constData()) + offset;
+    }
+
+    if (offset < windowOffset || offset + length > windowOffset + windowSize || (mappedWindow == nullptr && readWindow.isEmpty()))
+    {
+        releaseWindow();
+        windowOffset = std::max<qint64>(0, offset - mapWindowSize / 4) / mapWindowSize * mapWindowSize;
+        windowSize = std::min(std::max(mapWindowSize, offset + length - windowOffset), size - windowOffset);
+
+        mappedWindow = file.map(windowOffset, windowSize);
+        if (mappedWindow == nullptr && file.seek(windowOffset))
+        {
+            readWindow = file.read(windowSize);
+            windowSize = readWindow.size();
+        }
+        if (offset + length > windowOffset + windowSize)
+        {
+            return nullptr;
+        }
+    }
+
+    const uchar *window = mappedWindow ? mappedWindow : reinterpret_cast<const uchar*>(readWindow.constData());
+    return window + (offset - windowOffset);
+}
+
+void HexView::releaseWindow()
+{
+    if (mappedWindow != nullptr)
+    {
+        file.unmap(mappedWindow);
+        mappedWindow = nullptr;
+    }
+    readWindow.clear();
+    windowOffset = 0;
+    windowSize = 0;
+}
+
+/**
+ * @brief Sets the scroll ranges. With more rows than the scroll bar can count, one step moves several rows.
+ */
+void HexView::updateScrollBars()
+{
+    const qint64 maxTopRow = std::max<qint64>(0, rowCount() - visibleRowCount() + 1);
+    rowsPerStep = maxTopRow / maxScrollValue + 1;
+
+    verticalScrollBar()->setRange(0, int((maxTopRow + rowsPerStep - 1) / rowsPerStep));
+    verticalScrollBar()->setPageStep(int(std::max<qint64>(1, (visibleRowCount() - 1) / rowsPerStep)));
+    verticalScrollBar()->setSingleStep(1);
+
+    horizontalScrollBar()->setRange(0, std::max(0, contentWidth() - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+}
+
+qint64 HexView::rowCount() const
+{
+    return (size + bytesPerRow - 1) / bytesPerRow;
+}
+
+qint64 HexView::topRow() const
+{
+    return std::min(qint64(verticalScrollBar()->value()) * rowsPerStep, std::max<qint64>(0, rowCount() - 1));
+}
+
+/**
+ * @brief Returns how many rows fit the viewport, counting a partly visible last row.
+ */
+int HexView::visibleRowCount() const
+{
+    const int rowHeight = QFontMetrics(font()).height();
+    return std::max(1, (viewport()->height() + rowHeight - 1) / rowHeight);
+}
+
+int HexView::offsetDigits() const
+{
+    return size > 0xFFFFFFFFLL ? 16 : 8;
+}
+
+int HexView::contentWidth() const
+{
+    const int charWidth = QFontMetrics(font()).horizontalAdvance('0');
+    return charWidth * (offsetDigits() + 2 + bytesPerRow * 3 + 2 + bytesPerRow + 1);
+}
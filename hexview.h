@@ -0,0 +1,60 @@
+#ifndef HEXVIEW_H
+#define HEXVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QThreadPool>
+#include <atomic>
+
+class HexView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit HexView(QWidget *parent = nullptr);
+    ~HexView();
+
+    bool openFile(const QString &filePath);
+    void setData(const QByteArray &data);
+    qint64 dataSize() const;
+
+    void goToOffset(qint64 offset);
+    void find(const QByteArray &pattern);
+    void cancelSearch();
+
+    static bool parseOffset(const QString &text, qint64 &offset);
+    static QByteArray parsePattern(const QString &text);
+
+signals:
+    void searchFinished(qint64 offset);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    QFile file;
+    QByteArray buffer;
+    QByteArray readWindow;
+    uchar *mappedWindow = nullptr;
+    qint64 windowOffset = 0;
+    qint64 windowSize = 0;
+    qint64 size = 0;
+    qint64 rowsPerStep = 1;
+    qint64 selectionStart = -1;
+    qint64 selectionLength = 0;
+
+    QThreadPool searchPool;
+    std::atomic<quint64> searchGeneration;
+
+    const uchar* bytesAt(qint64 offset, qint64 length);
+    void releaseWindow();
+    void updateScrollBars();
+    qint64 rowCount() const;
+    qint64 topRow() const;
+    int visibleRowCount() const;
+    int offsetDigits() const;
+    int contentWidth() const;
+};
+
+#endif // HEXVIEW_H
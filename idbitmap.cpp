@@ -0,0 +1,391 @@
+#include "idbitmap.h"
+#include <algorithm>
+#include <iterator>
+
+/**
+ * @file idbitmap.h
+ * @brief The IdBitmap class is a compressed set of 32-bit ids in the style of a roaring bitmap.
+ * Ids are grouped by their upper 16 bits into containers. A container holds its lower 16 bits as a sorted array
+ * while it has at most 4096 of them and as a 65536 bit set above that, so sparse sets stay small and dense ones are
+ * combined a machine word at a time. Intersection, union and difference walk the containers of both operands in
+ * key order; two dense containers are combined with 1024 word operations.
+ */
+
+namespace
+{
+const quint32 arrayLimit = 4096;
+const size_t wordsPerContainer = 65536 / 64;
+}
+
+void IdBitmap::add(quint32 id)
+{
+    const quint16 key = quint16(id >> 16);
+    const quint16 low = quint16(id & 0xFFFF);
+
+    auto it = find(key);
+    if (it == containers.end() || it->key != key)
+    {
+        Container container;
+        container.key = key;
+        it = containers.insert(it, container);
+    }
+
+    Container &container = *it;
+    if (container.isBitset())
+    {
+        quint64 &word = container.words[low >> 6];
+        const quint64 mask = quint64(1) << (low & 63);
+        if ((word & mask) == 0)
+        {
+            word |= mask;
+            ++container.cardinality;
+        }
+        return;
+    }
+
+    const auto position = std::lower_bound(container.values.begin(), container.values.end(), low);
+    if (position == container.values.end() || *position != low)
+    {
+        container.values.insert(position, low);
+        ++container.cardinality;
+        optimize(container);
+    }
+}
+
+void IdBitmap::remove(quint32 id)
+{
+    const quint16 key = quint16(id >> 16);
+    const quint16 low = quint16(id & 0xFFFF);
+
+    auto it = find(key);
+    if (it == containers.end() || it->key != key)
+    {
+        return;
+    }
+
+    Container &container = *it;
+    if (container.isBitset())
+    {
+        quint64 &word = container.words[low >> 6];
+        const quint64 mask = quint64(1) << (low & 63);
+        if (word & mask)
+        {
+            word &= ~mask;
+            --container.cardinality;
+        }
+    }
+    else
+    {
+        const auto position = std::lower_bound(container.values.begin(), container.values.end(), low);
+        if (position != container.values.end() && *position == low)
+        {
+            container.values.erase(position);
+            --container.cardinality;
+        }
+    }
+
+    if (container.cardinality == 0)
+    {
+        containers.erase(it);
+    }
+    else
+    {
+        optimize(container);
+    }
+}
+
+bool IdBitmap::contains(quint32 id) const
+{
+    const quint16 key = quint16(id >> 16);
+    const quint16 low = quint16(id & 0xFFFF);
+
+    const auto it = find(key);
+    if (it == containers.end() || it->key != key)
+    {
+        return false;
+    }
+
+    if (it->isBitset())
+    {
+        return (it->words[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(it->values.begin(), it->values.end(), low);
+}
+
+quint64 IdBitmap::count() const
+{
+    quint64 total = 0;
+    for (const Container &container : containers)
+    {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+bool IdBitmap::isEmpty() const
+{
+    return containers.empty();
+}
+
+void IdBitmap::clear()
+{
+    containers.clear();
+}
+
+/**
+ * @brief Returns the ids contained in both bitmaps.
+ */
+IdBitmap IdBitmap::operator&(const IdBitmap &other) const
+{
+    IdBitmap result;
+    auto a = containers.cbegin();
+    auto b = other.containers.cbegin();
+    while (a != containers.cend() && b != other.containers.cend())
+    {
+        if (a->key < b->key)
+        {
+            ++a;
+        }
+        else if (b->key < a->key)
+        {
+            ++b;
+        }
+        else
+        {
+            Container container = intersect(*a, *b);
+            if (container.cardinality != 0)
+            {
+                result.containers.push_back(std::move(container));
+            }
+            ++a;
+            ++b;
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the ids contained in either bitmap.
+ */
+IdBitmap IdBitmap::operator|(const IdBitmap &other) const
+{
+    IdBitmap result;
+    auto a = containers.cbegin();
+    auto b = other.containers.cbegin();
+    while (a != containers.cend() || b != other.containers.cend())
+    {
+        if (b == other.containers.cend() || (a != containers.cend() && a->key < b->key))
+        {
+            result.containers.push_back(*a++);
+        }
+        else if (a == containers.cend() || b->key < a->key)
+        {
+            result.containers.push_back(*b++);
+        }
+        else
+        {
+            result.containers.push_back(unite(*a++, *b++));
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Returns the ids of this bitmap that are not contained in the other one.
+ */
+IdBitmap IdBitmap::operator-(const IdBitmap &other) const
+{
+    IdBitmap result;
+    auto b = other.containers.cbegin();
+    for (const Container &container : containers)
+    {
+        while (b != other.containers.cend() && b->key < container.key)
+        {
+            ++b;
+        }
+
+        if (b == other.containers.cend() || b->key != container.key)
+        {
+            result.containers.push_back(container);
+            continue;
+        }
+
+        Container difference = subtract(container, *b);
+        if (difference.cardinality != 0)
+        {
+            result.containers.push_back(std::move(difference));
+        }
+    }
+    return result;
+}
+
+std::vector<IdBitmap::Container>::iterator IdBitmap::find(quint16 key)
+{
+    return std::lower_bound(containers.begin(), containers.end(), key,
+                            [](const Container &container, quint16 value) { return container.key < value; });
+}
+
+std::vector<IdBitmap::Container>::const_iterator IdBitmap::find(quint16 key) const
+{
+    return std::lower_bound(containers.cbegin(), containers.cend(), key,
+                            [](const Container &container, quint16 value) { return container.key < value; });
+}
+
+/**
+ * @brief Switches a container to the array or bit set form its cardinality calls for.
+ */
+void IdBitmap::optimize(Container &container)
+{
+    if (container.isBitset() && container.cardinality <= arrayLimit)
+    {
+        container.values.clear();
+        container.values.reserve(container.cardinality);
+        for (size_t i = 0; i < container.words.size(); ++i)
+        {
+            quint64 word = container.words[i];
+            while (word != 0)
+            {
+                container.values.push_back(quint16(i * 64 + qCountTrailingZeroBits(word)));
+                word &= word - 1;
+            }
+        }
+        std::vector<quint64>().swap(container.words);
+    }
+    else if (!container.isBitset() && container.cardinality > arrayLimit)
+    {
+        container.words.assign(wordsPerContainer, 0);
+        for (quint16 value : container.values)
+        {
+            container.words[value >> 6] |= quint64(1) << (value & 63);
+        }
+        std::vector<quint16>().swap(container.values);
+    }
+}
+
+IdBitmap::Container IdBitmap::intersect(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+
+    if (a.isBitset() && b.isBitset())
+    {
+        result.words.resize(wordsPerContainer);
+        for (size_t i = 0; i < wordsPerContainer; ++i)
+        {
+            result.words[i] = a.words[i] & b.words[i];
+            result.cardinality += qPopulationCount(result.words[i]);
+        }
+    }
+    else if (a.isBitset() || b.isBitset())
+    {
+        const Container &array = a.isBitset() ? b : a;
+        const Container &bitset = a.isBitset() ? a : b;
+        for (quint16 value : array.values)
+        {
+            if ((bitset.words[value >> 6] >> (value & 63)) & 1)
+            {
+                result.values.push_back(value);
+            }
+        }
+        result.cardinality = quint32(result.values.size());
+    }
+    else
+    {
+        std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                              std::back_inserter(result.values));
+        result.cardinality = quint32(result.values.size());
+    }
+
+    optimize(result);
+    return result;
+}
+
+IdBitmap::Container IdBitmap::unite(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+
+    if (!a.isBitset() && !b.isBitset())
+    {
+        result.values.reserve(a.values.size() + b.values.size());
+        std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                       std::back_inserter(result.values));
+        result.cardinality = quint32(result.values.size());
+        optimize(result);
+        return result;
+    }
+
+    const Container &bitset = a.isBitset() ? a : b;
+    const Container &other = a.isBitset() ? b : a;
+    result.words = bitset.words;
+    if (other.isBitset())
+    {
+        for (size_t i = 0; i < wordsPerContainer; ++i)
+        {
+            result.words[i] |= other.words[i];
+        }
+    }
+    else
+    {
+        for (quint16 value : other.values)
+        {
+            result.words[value >> 6] |= quint64(1) << (value & 63);
+        }
+    }
+
+    for (quint64 word : result.words)
+    {
+        result.cardinality += qPopulationCount(word);
+    }
+    return result;
+}
+
+IdBitmap::Container IdBitmap::subtract(const Container &a, const Container &b)
+{
+    Container result;
+    result.key = a.key;
+
+    if (!a.isBitset())
+    {
+        if (b.isBitset())
+        {
+            for (quint16 value : a.values)
+            {
+                if (((b.words[value >> 6] >> (value & 63)) & 1) == 0)
+                {
+                    result.values.push_back(value);
+                }
+            }
+        }
+        else
+        {
+            std::set_difference(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                                std::back_inserter(result.values));
+        }
+        result.cardinality = quint32(result.values.size());
+        return result;
+    }
+
+    result.words = a.words;
+    if (b.isBitset())
+    {
+        for (size_t i = 0; i < wordsPerContainer; ++i)
+        {
+            result.words[i] &= ~b.words[i];
+        }
+    }
+    else
+    {
+        for (quint16 value : b.values)
+        {
+            result.words[value >> 6] &= ~(quint64(1) << (value & 63));
+        }
+    }
+
+    for (quint64 word : result.words)
+    {
+        result.cardinality += qPopulationCount(word);
+    }
+    optimize(result);
+    return result;
+}
@@ -0,0 +1,77 @@
+#ifndef IDBITMAP_H
+#define IDBITMAP_H
+
+#include <QtGlobal>
+#include <QtAlgorithms>
+#include <vector>
+
+class IdBitmap
+{
+public:
+    void add(quint32 id);
+    void remove(quint32 id);
+    bool contains(quint32 id) const;
+    quint64 count() const;
+    bool isEmpty() const;
+    void clear();
+
+    IdBitmap operator&(const IdBitmap &other) const;
+    IdBitmap operator|(const IdBitmap &other) const;
+    IdBitmap operator-(const IdBitmap &other) const;
+
+    template <typename Function>
+    void forEach(Function function) const;
+
+private:
+    struct Container
+    {
+        quint16 key = 0;
+        quint32 cardinality = 0;
+        std::vector<quint16> values;
+        std::vector<quint64> words;
+
+        bool isBitset() const { return !words.empty(); }
+    };
+
+    std::vector<Container> containers;
+
+    std::vector<Container>::iterator find(quint16 key);
+    std::vector<Container>::const_iterator find(quint16 key) const;
+
+    static void optimize(Container &container);
+    static Container intersect(const Container &a, const Container &b);
+    static Container unite(const Container &a, const Container &b);
+    static Container subtract(const Container &a, const Container &b);
+};
+
+/**
+ * @brief Calls the function with every id of the bitmap in ascending order.
+ */
+template <typename Function>
+void IdBitmap::forEach(Function function) const
+{
+    for (const Container &container : containers)
+    {
+        const quint32 high = quint32(container.key) << 16;
+        if (!container.isBitset())
+        {
+            for (quint16 value : container.values)
+            {
+                function(high | value);
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < container.words.size(); ++i)
+        {
+            quint64 word = container.words[i];
+            while (word != 0)
+            {
+                function(high | quint32(i * 64 + qCountTrailingZeroBits(word)));
+                word &= word - 1;
+            }
+        }
+    }
+}
+
+#endif // IDBITMAP_H
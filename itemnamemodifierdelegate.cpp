@@ -1,12 +1,77 @@
 #include "itemnamemodifierdelegate.h"
+#include "modifiedfilesystemmodel.h"
+#include <QDateTime>
+#include <QLocale>
 #include <QPainter>
 #include <QApplication>
 #include <QListView>
+#include <QTextLayout>
+#include <QIcon>
+#include <iterator>
 /**
  * @file itemnamemodifierdelegate.h
  * \brief The ItemNameModifierDelegate class customizes the appearance of items in QListView, particularly the text display.
+ * Elided text layouts, the formatted and elided metadata columns and icon pixmaps are cached per row, so repainting
+ * while scrolling does not query the model or the style, nor re-elide. A layout is kept while the row's text, font,
+ * view mode and width stay the same; the metadata of a row is formatted again once the model reports it changed.
+ * In list mode the size, modification time, permissions, owner and inode are drawn as columns right of the name.
+ * Asking the model for them is what makes it read them, so only painted rows are stat'ed right away.
  */
 
+namespace
+{
+const int itemPadding = 4;
+const int maxCachedItems = 4096;
+const int minNameWidth = 160;
+
+struct MetadataColumn
+{
+    int role;
+    int width;
+    Qt::Alignment alignment;
+};
+
+const MetadataColumn metadataColumns[] = {
+    { ModifiedFileSystemModel::SizeRole, 80, Qt::AlignRight },
+    { ModifiedFileSystemModel::ModifiedRole, 140, Qt::AlignLeft },
+    { ModifiedFileSystemModel::PermissionsRole, 90, Qt::AlignLeft },
+    { ModifiedFileSystemModel::OwnerRole, 80, Qt::AlignLeft },
+    { ModifiedFileSystemModel::InodeRole, 90, Qt::AlignRight }
+};
+
+int metadataColumnsWidth()
+{
+    int width = 0;
+    for (const MetadataColumn &column : metadataColumns)
+    {
+        width += column.width;
+    }
+    return width;
+}
+
+/**
+ * \brief Returns the text of a metadata column, empty until the model has read it.
+ */
+QString metadataText(const QModelIndex &index, int role)
+{
+    const QVariant value = index.data(role);
+    if (!value.isValid())
+    {
+        return QString();
+    }
+
+    switch (role)
+    {
+    case ModifiedFileSystemModel::SizeRole:
+        return QLocale().formattedDataSize(value.toLongLong());
+    case ModifiedFileSystemModel::ModifiedRole:
+        return QLocale().toString(value.toDateTime(), QLocale::ShortFormat);
+    default:
+        return value.toString();
+    }
+}
+}
+
 ItemNameModifierDelegate::ItemNameModifierDelegate(QObject* parent) : QStyledItemDelegate(parent)
 {
     customSize = QSize(80, 100);
@@ -14,6 +79,7 @@ ItemNameModifierDelegate::ItemNameModifierDelegate(QObject* parent) : QStyledIte
 
 /**
  * \brief Paints the item in the view using customized options.
+ * Background is drawn by the style, while the icon and the elided text are drawn directly from the cache.
  *
  * \param painter The QPainter object used for painting.
  * \param option The style options for the item view.
@@ -21,12 +87,236 @@ ItemNameModifierDelegate::ItemNameModifierDelegate(QObject* parent) : QStyledIte
  */
 void ItemNameModifierDelegate::paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const
 {
-    QStyleOptionViewItem opt = option;
-    initStyleOption(&opt, index);
+    if (index.model() != cachedModel)
+    {
+        itemCache.clear();
+        cachedModel = index.model();
+        watchModel(cachedModel);
+    }
+    else if (itemCache.size() > maxCachedItems)
+    {
+        itemCache.clear();
+    }
+
+    const bool isIconMode = option.decorationPosition == QStyleOptionViewItem::Top;
+    const QString text = index.data(Qt::DisplayRole).toString();
+    CachedItem &item = itemCache[index.row()];
+    if (item.text != text || item.isIconMode != isIconMode || item.font != option.font)
+    {
+        item = CachedItem();
+        item.text = text;
+        item.isIconMode = isIconMode;
+        item.font = option.font;
+    }
+
+    const QSize iconSize = option.decorationSize;
+    const QRect itemRect = option.rect;
+    QRect iconRect;
+    QRect textRect;
+    QRect columnsRect;
+
+    if (isIconMode)
+    {
+        iconRect = QRect(itemRect.x() + (itemRect.width() - iconSize.width()) / 2, itemRect.y() + itemPadding, iconSize.width(), iconSize.height());
+        textRect = QRect(itemRect.x() + itemPadding, iconRect.bottom() + itemPadding, itemRect.width() - 2 * itemPadding, itemRect.bottom() - iconRect.bottom() - itemPadding);
+    }
+    else
+    {
+        iconRect = QRect(itemRect.x() + itemPadding, itemRect.y() + (itemRect.height() - iconSize.height()) / 2, iconSize.width(), iconSize.height());
+        textRect = QRect(iconRect.right() + 2 * itemPadding, itemRect.y(), itemRect.right() - iconRect.right() - 2 * itemPadding, itemRect.height());
+        if (textRect.width() - metadataColumnsWidth() >= minNameWidth)
+        {
+            columnsRect = QRect(itemRect.right() - metadataColumnsWidth(), itemRect.y(), metadataColumnsWidth(), itemRect.height());
+            textRect.setRight(columnsRect.left() - itemPadding);
+        }
+    }
+
+    if (item.textWidth != textRect.width())
+    {
+        item.textWidth = textRect.width();
+        item.lines.clear();
+
+        const QStringList lines = elidedLines(text, option.font, textRect.width(), isIconMode ? 2 : 1);
+        for (const QString &line : lines)
+        {
+            QStaticText staticText(line);
+            staticText.setTextFormat(Qt::PlainText);
+            staticText.prepare(QTransform(), option.font);
+            item.lines.append(staticText);
+        }
+    }
+
+    if (item.iconSize != iconSize || item.pixmap.isNull())
+    {
+        item.iconSize = iconSize;
+        item.pixmap = index.data(Qt::DecorationRole).value<QIcon>().pixmap(iconSize);
+    }
+
+    if (option.state & (QStyle::State_Selected | QStyle::State_MouseOver))
+    {
+        QStyle *style = option.widget ? option.widget->style() : QApplication::style();
+        style->drawPrimitive(QStyle::PE_PanelItemViewItem, &option, painter, option.widget);
+    }
+
+    if (!item.pixmap.isNull())
+    {
+        const QSize pixmapSize = item.pixmap.deviceIndependentSize().toSize();
+        painter->drawPixmap(iconRect.x() + (iconRect.width() - pixmapSize.width()) / 2,
+                            iconRect.y() + (iconRect.height() - pixmapSize.height()) / 2,
+                            item.pixmap);
+    }
+
+    const QPalette::ColorGroup colorGroup = (option.state & QStyle::State_Enabled) ? QPalette::Normal : QPalette::Disabled;
+    const QPalette::ColorRole colorRole = (option.state & QStyle::State_Selected) ? QPalette::HighlightedText : QPalette::Text;
 
-    opt.textElideMode = Qt::ElideMiddle;
+    painter->save();
+    painter->setFont(option.font);
+    painter->setPen(option.palette.color(colorGroup, colorRole));
 
-    QApplication::style()->drawControl(QStyle::CE_ItemViewItem, &opt, painter);
+    const int lineHeight = option.fontMetrics.height();
+    int y = isIconMode ? textRect.y() : textRect.y() + (textRect.height() - lineHeight * item.lines.size()) / 2;
+
+    for (const QStaticText &line : std::as_const(item.lines))
+    {
+        int x = textRect.x();
+        if (isIconMode)
+        {
+            x += (textRect.width() - qRound(line.size().width())) / 2;
+        }
+        painter->drawStaticText(x, y, line);
+        y += lineHeight;
+    }
+
+    if (!columnsRect.isNull())
+    {
+        if (!item.hasMetadata)
+        {
+            item.columns.resize(std::size(metadataColumns));
+            for (size_t i = 0; i < std::size(metadataColumns); ++i)
+            {
+                const QString columnText = metadataText(index, metadataColumns[i].role);
+                if (item.columns[i].text != columnText)
+                {
+                    item.columns[i].text = columnText;
+                    item.columns[i].width = -1;
+                }
+            }
+            item.hasMetadata = true;
+        }
+
+        int x = columnsRect.x();
+        for (size_t i = 0; i < std::size(metadataColumns); ++i)
+        {
+            const MetadataColumn &column = metadataColumns[i];
+            const QRect cellRect(x, columnsRect.y(), column.width - itemPadding, columnsRect.height());
+
+            CachedColumn &cachedColumn = item.columns[i];
+            if (cachedColumn.width != cellRect.width())
+            {
+                cachedColumn.width = cellRect.width();
+                cachedColumn.elided = QStaticText(option.fontMetrics.elidedText(cachedColumn.text, Qt::ElideRight, cellRect.width()));
+                cachedColumn.elided.setTextFormat(Qt::PlainText);
+                cachedColumn.elided.prepare(QTransform(), option.font);
+            }
+
+            const int columnX = (column.alignment & Qt::AlignRight)
+                                    ? cellRect.right() + 1 - qRound(cachedColumn.elided.size().width())
+                                    : cellRect.x();
+            painter->drawStaticText(columnX, cellRect.y() + (cellRect.height() - lineHeight) / 2, cachedColumn.elided);
+            x += column.width;
+        }
+    }
+
+    painter->restore();
+}
+
+/**
+ * \brief Follows the model whose rows are cached. Changed rows format their metadata again; inserted, removed or
+ * reordered rows shift the row numbers, so the whole cache is dropped.
+ *
+ * \param model The model of the painted indexes.
+ */
+void ItemNameModifierDelegate::watchModel(const QAbstractItemModel* model) const
+{
+    for (const QMetaObject::Connection &connection : std::as_const(modelConnections))
+    {
+        disconnect(connection);
+    }
+    modelConnections.clear();
+
+    if (model == nullptr)
+    {
+        return;
+    }
+
+    const auto dropCache = [this]() { itemCache.clear(); };
+    modelConnections << connect(model, &QAbstractItemModel::dataChanged, this,
+                                [this](const QModelIndex &topLeft, const QModelIndex &bottomRight)
+                                {
+                                    for (auto it = itemCache.begin(); it != itemCache.end(); ++it)
+                                    {
+                                        if (it.key() >= topLeft.row() && it.key() <= bottomRight.row())
+                                        {
+                                            it->hasMetadata = false;
+                                        }
+                                    }
+                                })
+                     << connect(model, &QAbstractItemModel::rowsInserted, this, dropCache)
+                     << connect(model, &QAbstractItemModel::rowsRemoved, this, dropCache)
+                     << connect(model, &QAbstractItemModel::rowsMoved, this, dropCache)
+                     << connect(model, &QAbstractItemModel::layoutChanged, this, dropCache)
+                     << connect(model, &QAbstractItemModel::modelReset, this, dropCache);
+}
+
+/**
+ * \brief Splits the text into at most maxLines lines that fit in the given width, eliding the last line in the middle.
+ *
+ * \param text The text to lay out.
+ * \param font The font used for measuring.
+ * \param width The available width in pixels.
+ * \param maxLines The maximum number of lines.
+ * \return The laid out lines.
+ */
+QStringList ItemNameModifierDelegate::elidedLines(const QString& text, const QFont& font, int width, int maxLines)
+{
+    const QFontMetrics metrics(font);
+    QStringList lines;
+
+    if (maxLines <= 1 || metrics.horizontalAdvance(text) <= width)
+    {
+        lines << metrics.elidedText(text, Qt::ElideMiddle, width);
+        return lines;
+    }
+
+    QTextOption textOption;
+    textOption.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+
+    QTextLayout textLayout(text, font);
+    textLayout.setTextOption(textOption);
+    textLayout.beginLayout();
+
+    int consumed = 0;
+    while (lines.size() < maxLines - 1)
+    {
+        QTextLine line = textLayout.createLine();
+        if (!line.isValid())
+        {
+            break;
+        }
+
+        line.setLineWidth(width);
+        lines << text.mid(line.textStart(), line.textLength());
+        consumed = line.textStart() + line.textLength();
+    }
+
+    textLayout.endLayout();
+
+    if (consumed < text.size())
+    {
+        lines << metrics.elidedText(text.mid(consumed), Qt::ElideMiddle, width);
+    }
+
+    return lines;
 }
 
 /**
@@ -57,4 +347,15 @@ QSize ItemNameModifierDelegate::sizeHint(const QStyleOptionViewItem& option, con
 void ItemNameModifierDelegate::setCustomSize(const QSize& size)
 {
     customSize = size;
+    clearCache();
+}
+
+/**
+ * \brief Drops all cached text layouts and icon pixmaps, e.g. after the listed directory changed.
+ */
+void ItemNameModifierDelegate::clearCache()
+{
+    itemCache.clear();
+    cachedModel = nullptr;
+    watchModel(nullptr);
 }
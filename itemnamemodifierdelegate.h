@@ -2,6 +2,10 @@
 #define ITEMNAMEMODIFIERDELEGATE_H
 
 #include <QStyledItemDelegate>
+#include <QStaticText>
+#include <QFont>
+#include <QPixmap>
+#include <QHash>
 
 class ItemNameModifierDelegate : public QStyledItemDelegate
 {
@@ -9,13 +13,40 @@ class ItemNameModifierDelegate : public QStyledItemDelegate
 public:
     explicit ItemNameModifierDelegate(QObject* parent = nullptr);
     void setCustomSize(const QSize& size);
+    void clearCache();
 
     void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override;
     QSize sizeHint(const QStyleOptionViewItem& option, const QModelIndex& index) const override;
 
 
 private:
+    struct CachedColumn
+    {
+        QString text;
+        int width = -1;
+        QStaticText elided;
+    };
+
+    struct CachedItem
+    {
+        QString text;
+        QFont font;
+        bool isIconMode = false;
+        int textWidth = -1;
+        QList<QStaticText> lines;
+        bool hasMetadata = false;
+        QList<CachedColumn> columns;
+        QSize iconSize;
+        QPixmap pixmap;
+    };
+
     QSize customSize;
+    mutable QHash<int, CachedItem> itemCache;
+    mutable const QAbstractItemModel* cachedModel = nullptr;
+    mutable QList<QMetaObject::Connection> modelConnections;
+
+    void watchModel(const QAbstractItemModel* model) const;
+    static QStringList elidedLines(const QString& text, const QFont& font, int width, int maxLines);
 };
 
 #endif // ITEMNAMEMODIFIERDELEGATE_H
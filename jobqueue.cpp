@@ -0,0 +1,78 @@
+#include "jobqueue.h"
+
+/**
+ * @file jobqueue.h
+ * @brief The JobQueue class runs BackgroundJob instances on its own thread pool and relays their progress to the GUI thread.
+ * Finished jobs are announced through jobFinished() and deleted afterwards.
+ */
+
+namespace
+{
+const int maxConcurrentJobs = 2;
+}
+
+JobQueue::JobQueue(QObject *parent) : QObject(parent)
+{
+    pool.setMaxThreadCount(maxConcurrentJobs);
+}
+
+JobQueue::~JobQueue()
+{
+    cancelAll();
+    pool.waitForDone();
+    qDeleteAll(jobs);
+}
+
+/**
+ * @brief Queues a job. The queue takes ownership of it.
+ *
+ * @param job The job to run.
+ */
+void JobQueue::enqueue(BackgroundJob *job)
+{
+    jobs.append(job);
+
+    // Jobs beyond maxConcurrentJobs wait in the pool, so they are announced once a thread picks them up.
+    connect(job, &BackgroundJob::started, this, [this, job]()
+            {
+                emit jobStarted(job);
+            }, Qt::QueuedConnection);
+
+    connect(job, &BackgroundJob::progressChanged, this, [this, job](qint64 done, qint64 total)
+            {
+                emit jobProgress(job, done, total);
+            }, Qt::QueuedConnection);
+
+    connect(job, &BackgroundJob::finished, this, [this, job]()
+            {
+                jobs.removeOne(job);
+                emit jobFinished(job);
+                job->deleteLater();
+
+                if (jobs.isEmpty())
+                {
+                    emit idle();
+                }
+            }, Qt::QueuedConnection);
+
+    pool.start(job);
+}
+
+/**
+ * @brief Returns the number of queued or running jobs.
+ */
+int JobQueue::activeJobCount() const
+{
+    return jobs.size();
+}
+
+/**
+ * @brief Asks every queued or running job to stop.
+ */
+void JobQueue::cancelAll()
+{
+    for (BackgroundJob *job : std::as_const(jobs))
+    {
+        job->cancel();
+    }
+}
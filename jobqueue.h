@@ -0,0 +1,33 @@
+#ifndef JOBQUEUE_H
+#define JOBQUEUE_H
+
+#include "backgroundjob.h"
+#include <QObject>
+#include <QThreadPool>
+#include <QList>
+
+class JobQueue : public QObject
+{
+    Q_OBJECT
+public:
+    explicit JobQueue(QObject *parent = nullptr);
+    ~JobQueue();
+
+    void enqueue(BackgroundJob *job);
+    int activeJobCount() const;
+
+public slots:
+    void cancelAll();
+
+private:
+    QThreadPool pool;
+    QList<BackgroundJob*> jobs;
+
+signals:
+    void jobStarted(BackgroundJob *job);
+    void jobProgress(BackgroundJob *job, qint64 done, qint64 total);
+    void jobFinished(BackgroundJob *job);
+    void idle();
+};
+
+#endif // JOBQUEUE_H
@@ -1,16 +1,31 @@
 #include "listviewmanager.h"
+#include "archiveindex.h"
+#include "tagstore.h"
+#include "smartfolderindex.h"
 #include "qlineedit.h"
 #include <QListView>
+#include <QLabel>
 #include <QFileSystemModel>
+#include <QScrollBar>
+#include <QItemSelection>
+#include <QSet>
 
 /**
 * @file listviewmanager.h
 * @brief Manages the interaction and behavior of the QListView component within the application.
 */
 
-ListViewManager::ListViewManager()
+ListViewManager::ListViewManager(QListView* listView, QObject *parent) : QObject(parent), listView(listView)
 {
     modifiedFileSystemModel = new ModifiedFileSystemModel(this);
+    directoryPrefetcher = new DirectoryPrefetcher(this);
+
+    archivePlaceholder = new QLabel(tr("Reading archive..."), listView->viewport());
+    archivePlaceholder->setAlignment(Qt::AlignCenter);
+    archivePlaceholder->setAttribute(Qt::WA_TransparentForMouseEvents);
+    archivePlaceholder->hide();
+
+    connect(directoryPrefetcher, &DirectoryPrefetcher::revalidated, this, &ListViewManager::onDirectoryRevalidated);
     connect(this, &ListViewManager::shouldAcceptDirectories, modifiedFileSystemModel, &ModifiedFileSystemModel::shouldAcceptDirectories);
 }
 
@@ -19,15 +34,12 @@ ListViewManager::~ListViewManager()
 
 }
 
-void ListViewManager::initialize(QListView* listView)
-{
-    this->listView = listView;
-}
-
-ListViewManager& ListViewManager::instance()
+/**
+ * @brief Returns the model owned by this manager.
+ */
+ModifiedFileSystemModel* ListViewManager::model() const
 {
-    static ListViewManager instance;
-    return instance;
+    return modifiedFileSystemModel;
 }
 
 /**
@@ -38,9 +50,149 @@ ListViewManager& ListViewManager::instance()
  */
 void ListViewManager::setModelForListView(const QString &path)
 {
-    modifiedFileSystemModel->setFileData(path);
+    const bool provisional = modifiedFileSystemModel->setFileData(path);
     listView->setModel(modifiedFileSystemModel);
     listView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+
+    // An archive that was not read yet is read on the prefetcher's thread, the listing follows once it is done.
+    const bool isInArchive = ArchiveIndex::isInsideArchive(path);
+    setArchivePlaceholderVisible(isInArchive && provisional);
+    if (isInArchive || TagStore::isQueryPath(path))
+    {
+        directoryPrefetcher->cancel();
+        if (isInArchive && provisional)
+        {
+            directoryPrefetcher->revalidate(path);
+        }
+        return;
+    }
+
+    // Smart folders are shown from their index right away and checked against the disk in the background.
+    if (SmartFolderIndex::isSmartFolderPath(path))
+    {
+        directoryPrefetcher->cancel();
+        SmartFolderIndex::instance().revalidate(path);
+        return;
+    }
+
+    directoryPrefetcher->scheduleNeighbourPrefetch(path);
+    if (provisional)
+    {
+        directoryPrefetcher->revalidate(path);
+    }
+}
+
+/**
+ * @brief Applies the fresh listing of a directory that was shown from the metadata index, if it is still shown.
+ *
+ * @param path The revalidated directory.
+ */
+void ListViewManager::onDirectoryRevalidated(const QString &path)
+{
+    if (QDir::cleanPath(path) == QDir::cleanPath(modifiedFileSystemModel->currentDirectory()))
+    {
+        setArchivePlaceholderVisible(false);
+        modifiedFileSystemModel->revalidate();
+    }
+}
+
+/**
+ * @brief Shows or hides the note over the empty list view while an archive is being read.
+ */
+void ListViewManager::setArchivePlaceholderVisible(bool isVisible)
+{
+    if (isVisible)
+    {
+        archivePlaceholder->setGeometry(listView->viewport()->rect());
+        archivePlaceholder->raise();
+    }
+    archivePlaceholder->setVisible(isVisible);
+}
+
+/**
+ * @brief Captures the model data, scroll offset and selection of the list view.
+ *
+ * @param path The directory currently shown in the list view.
+ * @return The navigation entry describing the current view.
+ */
+NavigationEntry ListViewManager::captureViewState(const QString &path) const
+{
+    NavigationEntry entry;
+    entry.path = path;
+    entry.snapshot = modifiedFileSystemModel->snapshot();
+
+    if (listView->verticalScrollBar())
+    {
+        entry.scrollPosition = listView->verticalScrollBar()->value();
+    }
+
+    if (listView->selectionModel())
+    {
+        const QModelIndexList selectedIndexes = listView->selectionModel()->selectedIndexes();
+        for (const QModelIndex &index : selectedIndexes)
+        {
+            entry.selectedNames << index.data(Qt::DisplayRole).toString();
+        }
+
+        entry.currentName = listView->currentIndex().data(Qt::DisplayRole).toString();
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Restores a view captured by captureViewState().
+ * The model snapshot is reused if the directory did not change, otherwise the directory is listed again.
+ *
+ * @param entry The navigation entry to restore.
+ */
+void ListViewManager::restoreViewState(const NavigationEntry &entry)
+{
+    const bool provisional = !modifiedFileSystemModel->restoreSnapshot(entry.snapshot)
+                             && modifiedFileSystemModel->setFileData(entry.path);
+    setArchivePlaceholderVisible(provisional && ArchiveIndex::isInsideArchive(entry.path));
+    if (provisional)
+    {
+        directoryPrefetcher->revalidate(entry.path);
+    }
+
+    if (listView->model() != modifiedFileSystemModel)
+    {
+        listView->setModel(modifiedFileSystemModel);
+    }
+
+    if (!entry.selectedNames.isEmpty() || !entry.currentName.isEmpty())
+    {
+        const QSet<QString> selectedNames(entry.selectedNames.cbegin(), entry.selectedNames.cend());
+        QItemSelection selection;
+        QModelIndex currentIndex;
+
+        for (int row = 0; row < modifiedFileSystemModel->rowCount(); ++row)
+        {
+            const QModelIndex index = modifiedFileSystemModel->index(row);
+            const QString name = index.data(Qt::DisplayRole).toString();
+
+            if (selectedNames.contains(name))
+            {
+                selection.select(index, index);
+            }
+            if (name == entry.currentName)
+            {
+                currentIndex = index;
+            }
+        }
+
+        if (currentIndex.isValid())
+        {
+            listView->selectionModel()->setCurrentIndex(currentIndex, QItemSelectionModel::NoUpdate);
+        }
+        listView->selectionModel()->select(selection, QItemSelectionModel::ClearAndSelect);
+    }
+
+    listView->doItemsLayout();
+    listView->verticalScrollBar()->setValue(entry.scrollPosition);
+
+    directoryPrefetcher->scheduleNeighbourPrefetch(entry.path);
 }
 
 /**
@@ -103,7 +255,9 @@ void ListViewManager::handleRenaming(const QFileInfo &fileInfo, QLineEdit *lineE
 
         if (QFile::rename(fileInfo.filePath(), newPath))
         {
-            this->setModelForListView(fileInfo.absolutePath());
+            DirectoryListingCache::instance().invalidate(fileInfo.absolutePath());
+            modifiedFileSystemModel->applyChanges({ fileInfo.filePath() }, { { QDir::cleanPath(newPath), fileInfo.isDir() } });
+            emit itemRenamed(fileInfo.filePath(), QDir::cleanPath(newPath));
         }
         else
         {
@@ -132,6 +286,8 @@ void ListViewManager::handleCancelEditing(QLineEdit *lineEdit, const QString &or
 
 /**
  * @brief Handles double clicks on items in the ListView.
+ * Archives and directories inside them are opened like directories, files inside them are streamed to the viewer.
+ * Images open in the image viewer, any other file as text or, if it is binary, in the hex view.
  *
  * @param index The QModelIndex of the double-clicked item in the QListView.
  */
@@ -140,15 +296,19 @@ void ListViewManager::onListViewItemDoubleClicked(const QModelIndex &index)
     if (index.isValid())
     {
         QString filePath = modifiedFileSystemModel->getFilePathForIndex(index);
-        QFileInfo fileInfo(filePath);
-        if (fileInfo.isDir())
+        QString archivePath;
+        QString memberPath;
+        const bool isInArchive = ArchiveIndex::splitPath(filePath, archivePath, memberPath);
+        // The entries know whether they are directories, so the archive is not read on the GUI thread here.
+        if (modifiedFileSystemModel->isDirectory(index) || (isInArchive && memberPath.isEmpty())
+            || (!isInArchive && QFileInfo(filePath).isDir()))
         {
             emit updateViewData(filePath);
         }
         else
         {
             QFile file(filePath);
-            if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            if (!isInArchive && !file.open(QIODevice::ReadOnly | QIODevice::Text)) {
                 return;
             }
 
@@ -163,8 +323,7 @@ void ListViewManager::onListViewItemDoubleClicked(const QModelIndex &index)
             {
                 emit callFileViewerDialog(filePath, true);
             }
-            else if (fileInfo.suffix().compare("txt", Qt::CaseInsensitive) == 0 ||
-                     fileInfo.suffix().compare("text", Qt::CaseInsensitive) == 0)
+            else
             {
                 emit callFileViewerDialog(filePath, false);
             }
@@ -186,3 +345,31 @@ QString ListViewManager::listViewSelectedItemPath(const QModelIndex &index)
     }
     return "";
 }
+
+/**
+ * @brief Retrieves the file paths of all selected items in the ListView, in view order.
+ *
+ * @return The selected file paths, or the current item if nothing is selected.
+ */
+QStringList ListViewManager::selectedItemPaths() const
+{
+    QStringList paths;
+
+    if (listView->selectionModel())
+    {
+        QModelIndexList selectedIndexes = listView->selectionModel()->selectedIndexes();
+        std::sort(selectedIndexes.begin(), selectedIndexes.end());
+
+        for (const QModelIndex &index : std::as_const(selectedIndexes))
+        {
+            paths << modifiedFileSystemModel->getFilePathForIndex(index);
+        }
+    }
+
+    if (paths.isEmpty() && listView->currentIndex().isValid())
+    {
+        paths << modifiedFileSystemModel->getFilePathForIndex(listView->currentIndex());
+    }
+
+    return paths;
+}
@@ -2,23 +2,31 @@
 #define LISTVIEWMANAGER_H
 
 #include "modifiedfilesystemmodel.h"
+#include "navigationhistory.h"
+#include "directoryprefetcher.h"
 #include <QObject>
 #include <QListView>
+#include <QLabel>
 
 class ListViewManager : public QObject
 {
     Q_OBJECT
 public:
-    static ListViewManager& instance();
+    explicit ListViewManager(QListView* listView, QObject *parent = nullptr);
+    ~ListViewManager();
     QString listViewSelectedItemPath(const QModelIndex &index);
-    void initialize(QListView* listView);
+    QStringList selectedItemPaths() const;
+    ModifiedFileSystemModel* model() const;
+    NavigationEntry captureViewState(const QString &path) const;
+    void restoreViewState(const NavigationEntry &entry);
 
 private:
-    ListViewManager();  // Private constructor to prevent instantiation
-    ~ListViewManager();
     QListView* listView;
 
     ModifiedFileSystemModel* modifiedFileSystemModel;
+    DirectoryPrefetcher* directoryPrefetcher;
+    QLabel* archivePlaceholder;
+    void setArchivePlaceholderVisible(bool isVisible);
     void handleRenaming(const QFileInfo &fileInfo, QLineEdit *lineEdit, const QString &originalFilename);
     void handleCancelEditing(QLineEdit *lineEdit, const QString &originalFilename);
 
@@ -26,11 +34,13 @@ signals:
     void updateViewData(const QString& path);
     void callFileViewerDialog(const QString& path, bool isImage);
     void shouldAcceptDirectories(bool acceptsDirectories);
+    void itemRenamed(const QString &oldPath, const QString &newPath);
 
 public slots:
     void onListViewItemLongClicked(const QModelIndex &index);
     void onListViewItemDoubleClicked(const QModelIndex &index);
     void setModelForListView(const QString &path);
+    void onDirectoryRevalidated(const QString &path);
 
 };
 
@@ -1,11 +1,27 @@
 #include "mainwindow.h"
+#include "startupprofiler.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
 
 int main(int argc, char *argv[])
 {
+    StartupProfiler &profiler = StartupProfiler::instance();
+
     QApplication a(argc, argv);
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption profileStartupOption("profile-startup", "Print the duration of every startup phase.");
+    parser.addOption(profileStartupOption);
+    parser.process(a);
+
+    profiler.setEnabled(parser.isSet(profileStartupOption));
+    profiler.mark("application");
+
     MainWindow w;
+    profiler.mark("main window");
     w.show();
+    profiler.mark("show");
     return a.exec();
 }
@@ -2,17 +2,41 @@
 #include "./ui_mainwindow.h"
 #include "fileviewerdialog.h"
 #include "fileoperationsdialog.h"
+#include "bulkrenamedialog.h"
+#include "quickopendialog.h"
+#include "contentsearchdialog.h"
+#include "directorycomparedialog.h"
+#include "contentindex.h"
+#include "contentindexjob.h"
+#include "archiveindex.h"
+#include "archivejob.h"
+#include "checksumjob.h"
+#include "pathcompleter.h"
 #include "itemnamemodifierdelegate.h"
-#include "longclickhandler.h"
 #include "visualmodeupdater.h"
-#include <QStandardItemModel>
+#include "directorylistingcache.h"
+#include "operationjournal.h"
+#include "metadataindex.h"
+#include "tagstore.h"
+#include "smartfolderindex.h"
+#include "startupprofiler.h"
 #include <QSettings>
 #include <QSplitter>
 #include <QFileSystemModel>
 #include <QClipboard>
 #include <QFileDialog>
 #include <QResizeEvent>
+#include <QPaintEvent>
 #include <QEvent>
+#include <QShortcut>
+#include <QKeySequence>
+#include <QTimer>
+#include <QMenu>
+#include <QMessageBox>
+#include <QInputDialog>
+#include <QStatusBar>
+#include <algorithm>
+#include <utility>
 
 /**
  * @file mainwindow.h
@@ -20,63 +44,1169 @@
  * for the FileManager application. It acts as the main brain, coordinating various functionalities and interactions.
  */
 
+namespace
+{
+/**
+ * @brief Returns true if all paths lie in the same directory. Tag queries and smart folders list items of many.
+ */
+bool isInOneDirectory(const QStringList &paths)
+{
+    const QString directory = paths.isEmpty() ? QString() : QFileInfo(paths.first()).absolutePath();
+    return std::all_of(paths.cbegin(), paths.cend(), [&directory](const QString &path)
+                       {
+                           return QFileInfo(path).absolutePath() == directory;
+                       });
+}
+}
+
+MainWindow::MainWindow(QWidget *parent)
+    : QMainWindow(parent)
+    , ui(new Ui::MainWindow)
+{
+    StartupProfiler &profiler = StartupProfiler::instance();
+
+    ui->setupUi(this);
+    profiler.mark("setup ui");
+
+    treeViewManager = new TreeViewManager(ui->QTreeView_MainTree, this);
+    visuals = new VisualModeUpdater(this);
+
+    connect(this, &MainWindow::populateTreeView, treeViewManager, &TreeViewManager::updateModelForTreeView);
+    connect(ui->QTreeView_MainTree, &QTreeView::clicked, treeViewManager, &TreeViewManager::treeViewSelectedItemPath);
+    connect(treeViewManager, &TreeViewManager::updateViewData, this, &MainWindow::updateTreeView);
+    connect(ui->QTreeView_MainTree, &QTreeView::expanded, treeViewManager, &TreeViewManager::onTreeViewIndexExpanded);
+
+    virtualFolderTree = new VirtualFolderTree(this);
+    virtualFolderTree->setMaximumHeight(160);
+    ui->LeftPanel->addWidget(virtualFolderTree);
+    connect(virtualFolderTree, &VirtualFolderTree::folderActivated, this, &MainWindow::updateTreeView);
+
+    connect(this, &MainWindow::updateLightModeBooleanData, visuals, &VisualModeUpdater::updateLightModeBooleanData);
+
+    splitter = splitterLeftAndRightPanels();
+    connect(splitter, &QSplitter::splitterMoved, this, &MainWindow::handleSplitterMoved);
+
+    initializePreviewPane();
+    initializePanes();
+    initializeNavigationButtons();
+    initializeJobQueue();
+    profiler.mark("panes");
+
+    initializeMainWindow();
+    profiler.mark("layout");
+}
+
+MainWindow::~MainWindow()
+{
+    delete ui;
+}
+
+/**
+ * @brief Restores the layout and the last directory from cached state, so the first frame shows them.
+ * The active pane lists the directory from the metadata index and revalidates it in the background.
+ */
+void MainWindow::initializeMainWindow()
+{
+    if (!loadLayout())
+    {
+        updateTreeView(nullptr);
+    }
+}
+
+/**
+ * @brief Loads what the first frame does not need: the tree model and the icons.
+ * Runs once, right after the first paint.
+ */
+void MainWindow::finishStartup()
+{
+    StartupProfiler &profiler = StartupProfiler::instance();
+    profiler.mark("first paint");
+
+    treeViewManager->setModelForTreeView(ui->QTreeView_MainTree);
+    ui->QTreeView_MainTree->header()->resizeSection(0,250);
+    ui->QTreeView_MainTree->header()->hideSection(1);
+    profiler.mark("tree model");
+
+    updateIcons();
+    profiler.mark("icons");
+
+    profiler.report();
+
+    ContentIndex::instance().restore();
+    TagStore::instance().restore();
+    SmartFolderIndex::instance().restore();
+
+    connect(&OperationJournal::instance(), &OperationJournal::writeFailed, this, [this](const QString &message)
+            {
+                statusBar()->showMessage(message, 10000);
+            });
+    if (!OperationJournal::instance().errorString().isEmpty())
+    {
+        QMessageBox::warning(this, tr("Undo history"), OperationJournal::instance().errorString());
+    }
+}
+
+/**
+ * @brief Creates the tab widgets hosting the file browser panes. The second tab widget forms the dual-pane view.
+ */
+void MainWindow::initializePanes()
+{
+    paneSplitter = new QSplitter(Qt::Horizontal, ui->Widget_ListViewPanel);
+    ui->Widget_ListViewPanel->layout()->addWidget(paneSplitter);
+
+    for (QTabWidget *&tabWidget : paneTabs)
+    {
+        tabWidget = new QTabWidget(paneSplitter);
+        tabWidget->setDocumentMode(true);
+        tabWidget->setTabsClosable(true);
+        tabWidget->setMovable(true);
+        paneSplitter->addWidget(tabWidget);
+
+        QPushButton *addTabButton = new QPushButton("+", tabWidget);
+        addTabButton->setToolTip(tr("New tab"));
+        addTabButton->setStyleSheet("padding:0 6px;");
+        tabWidget->setCornerWidget(addTabButton, Qt::TopRightCorner);
+
+        connect(addTabButton, &QPushButton::clicked, this, [this, tabWidget]()
+                {
+                    FileBrowserPane *pane = addPane(tabWidget, activePane() ? activePane()->currentPath() : QString());
+                    onPaneActivated(pane);
+                });
+
+        connect(tabWidget, &QTabWidget::tabCloseRequested, this, [this, tabWidget](int index)
+                {
+                    if (tabWidget->count() > 1)
+                    {
+                        QWidget *pane = tabWidget->widget(index);
+                        tabWidget->removeTab(index);
+                        if (pane == currentPane)
+                        {
+                            currentPane = nullptr;
+                            onPaneActivated(qobject_cast<FileBrowserPane*>(tabWidget->currentWidget()));
+                        }
+                        pane->deleteLater();
+                    }
+                });
+
+        connect(tabWidget, &QTabWidget::currentChanged, this, [this, tabWidget](int index)
+                {
+                    if (index >= 0 && tabWidget->isVisible())
+                    {
+                        onPaneActivated(qobject_cast<FileBrowserPane*>(tabWidget->widget(index)));
+                    }
+                });
+
+        addPane(tabWidget, QString());
+    }
+
+    paneTabs[1]->hide();
+    currentPane = qobject_cast<FileBrowserPane*>(paneTabs[0]->currentWidget());
+
+    connect(new QShortcut(QKeySequence::AddTab, this), &QShortcut::activated, this, &MainWindow::addTab);
+    connect(new QShortcut(QKeySequence::Close, this), &QShortcut::activated, this, &MainWindow::closeCurrentTab);
+    connect(new QShortcut(QKeySequence(Qt::Key_F6), this), &QShortcut::activated, this, &MainWindow::toggleDualPane);
+    connect(new QShortcut(QKeySequence::Undo, this), &QShortcut::activated, this, &MainWindow::undoLastOperation);
+    connect(new QShortcut(QKeySequence::Redo, this), &QShortcut::activated, this, &MainWindow::redoLastOperation);
+    connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::Key_P), this), &QShortcut::activated, this, &MainWindow::openQuickOpen);
+    connect(new QShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_F), this), &QShortcut::activated, this, &MainWindow::openContentSearch);
+}
+
+/**
+ * @brief Creates a pane in the given tab widget and wires it to the main window.
+ *
+ * @param tabWidget The tab widget receiving the pane.
+ * @param path The directory to open in the new pane, may be empty.
+ * @return The new pane.
+ */
+FileBrowserPane* MainWindow::addPane(QTabWidget *tabWidget, const QString &path)
+{
+    FileBrowserPane *pane = new FileBrowserPane(tabWidget);
+    pane->listViewManager()->model()->shouldAcceptDirectories(isShowFiles);
+
+    connect(this, &MainWindow::updateHideFilesFilter, pane->listViewManager(), &ListViewManager::shouldAcceptDirectories);
+    connect(pane->listViewManager(), &ListViewManager::updateViewData, this, &MainWindow::updateTreeView);
+    connect(pane->listViewManager(), &ListViewManager::callFileViewerDialog, this, &MainWindow::openFileViewerDialog);
+    connect(pane->listViewManager(), &ListViewManager::itemRenamed, this, [this](const QString &oldPath, const QString &newPath)
+            {
+                recordInJournal(tr("Rename"), JournalEntry::Move, { { oldPath, newPath } });
+            });
+    connect(pane, &FileBrowserPane::activated, this, &MainWindow::onPaneActivated);
+    connect(pane, &FileBrowserPane::pathChanged, this, &MainWindow::onPanePathChanged);
+    connect(pane, &FileBrowserPane::currentItemChanged, this, [this](FileBrowserPane *changedPane, const QString &path)
+            {
+                if (changedPane == currentPane)
+                {
+                    previewPane->showPath(path);
+                }
+            });
+    connect(pane->navigationHistory(), &NavigationHistory::historyChanged, this, &MainWindow::updateNavigationButtons);
+    connect(pane->listView(), &QListView::customContextMenuRequested, this, [this, pane](const QPoint &pos)
+            {
+                onPaneActivated(pane);
+                showListViewContextMenu(pane->listView()->viewport()->mapToGlobal(pos));
+            });
+
+    applyLayoutToPane(pane);
+    if (currentPane)
+    {
+        pane->listView()->setStyleSheet(currentPane->listView()->styleSheet());
+    }
+
+    const int index = tabWidget->addTab(pane, path.isEmpty() ? tr("New tab") : QFileInfo(path).fileName());
+    tabWidget->setCurrentIndex(index);
+
+    pane->navigateTo(path);
+    return pane;
+}
+
+/**
+ * @brief Returns the pane that receives navigation and file operations.
+ */
+FileBrowserPane* MainWindow::activePane() const
+{
+    return currentPane;
+}
+
+/**
+ * @brief Returns every pane of both tab widgets.
+ */
+QList<FileBrowserPane*> MainWindow::allPanes() const
+{
+    QList<FileBrowserPane*> panes;
+    for (QTabWidget *tabWidget : paneTabs)
+    {
+        for (int i = 0; i < tabWidget->count(); ++i)
+        {
+            if (FileBrowserPane *pane = qobject_cast<FileBrowserPane*>(tabWidget->widget(i)))
+            {
+                panes << pane;
+            }
+        }
+    }
+    return panes;
+}
+
+/**
+ * @brief Returns the item views that follow the light/dark background.
+ */
+QList<QAbstractItemView*> MainWindow::themedViews() const
+{
+    QList<QAbstractItemView*> views = { ui->QTreeView_MainTree };
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
+    {
+        views << pane->listView();
+    }
+    return views;
+}
+
+/**
+ * @brief Makes the pane the target of navigation and file operations and syncs the tree and path display to it.
+ *
+ * @param pane The pane that got focus.
+ */
+void MainWindow::onPaneActivated(FileBrowserPane *pane)
+{
+    if (pane == nullptr || pane == currentPane)
+    {
+        return;
+    }
+
+    currentPane = pane;
+    updateNavigationButtons();
+    updatePreview();
+
+    if (!pane->currentPath().isEmpty())
+    {
+        emit populateTreeView(pane->currentPath());
+        ui->QLineEdit_DirectoryTextDisplay->setText(pane->currentPath());
+    }
+}
+
+/**
+ * @brief Updates the tab title and, for the active pane, the displayed path.
+ *
+ * @param pane The pane that navigated.
+ * @param path The new directory of the pane.
+ */
+void MainWindow::onPanePathChanged(FileBrowserPane *pane, const QString &path)
+{
+    for (QTabWidget *tabWidget : paneTabs)
+    {
+        const int index = tabWidget->indexOf(pane);
+        if (index >= 0)
+        {
+            const QString name = QFileInfo(path).fileName();
+            tabWidget->setTabText(index, name.isEmpty() ? path : name);
+            tabWidget->setTabToolTip(index, path);
+        }
+    }
+
+    if (pane == currentPane)
+    {
+        ui->QLineEdit_DirectoryTextDisplay->setText(path);
+        updateNavigationButtons();
+        updatePreview();
+    }
+}
+
+/**
+ * @brief Previews the current item of the active pane.
+ */
+void MainWindow::updatePreview()
+{
+    if (currentPane)
+    {
+        previewPane->showPath(currentPane->listViewManager()->listViewSelectedItemPath(currentPane->listView()->currentIndex()));
+    }
+}
+
+/**
+ * @brief Opens a new tab showing the directory of the active pane.
+ */
+void MainWindow::addTab()
+{
+    QTabWidget *tabWidget = paneTabs[0];
+    if (currentPane && paneTabs[1]->indexOf(currentPane) >= 0)
+    {
+        tabWidget = paneTabs[1];
+    }
+
+    onPaneActivated(addPane(tabWidget, currentPane ? currentPane->currentPath() : QString()));
+}
+
+/**
+ * @brief Closes the tab of the active pane unless it is the last one of its tab widget.
+ */
+void MainWindow::closeCurrentTab()
+{
+    for (QTabWidget *tabWidget : paneTabs)
+    {
+        const int index = tabWidget->indexOf(currentPane);
+        if (index >= 0)
+        {
+            emit tabWidget->tabCloseRequested(index);
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Shows or hides the second pane next to the first one.
+ */
+void MainWindow::toggleDualPane()
+{
+    QTabWidget *secondTabs = paneTabs[1];
+    secondTabs->setVisible(!secondTabs->isVisible());
+
+    FileBrowserPane *secondPane = qobject_cast<FileBrowserPane*>(secondTabs->currentWidget());
+    if (secondTabs->isVisible())
+    {
+        if (secondPane && secondPane->currentPath().isEmpty() && currentPane)
+        {
+            secondPane->navigateTo(currentPane->currentPath());
+        }
+        onPaneActivated(secondPane);
+    }
+    else if (currentPane && secondTabs->indexOf(currentPane) >= 0)
+    {
+        onPaneActivated(qobject_cast<FileBrowserPane*>(paneTabs[0]->currentWidget()));
+    }
+
+    dualPaneButton->setChecked(secondTabs->isVisible());
+}
+
+/**
+ * @brief Enables the back and forward buttons according to the history of the active pane.
+ */
+void MainWindow::updateNavigationButtons()
+{
+    if (currentPane == nullptr || backButton == nullptr)
+    {
+        return;
+    }
+
+    backButton->setEnabled(currentPane->navigationHistory()->canGoBack());
+    forwardButton->setEnabled(currentPane->navigationHistory()->canGoForward());
+}
+
+/**
+ * @brief Adds back, forward, up and dual-pane buttons in front of the directory button and binds the matching shortcuts.
+ * The path display becomes editable, with completion of the typed directory.
+ */
+void MainWindow::initializeNavigationButtons()
+{
+    QHBoxLayout *pathLayout = qobject_cast<QHBoxLayout*>(ui->Widget_SelectPath->layout());
+
+    backButton = new QPushButton(QString(QChar(0x2190)), ui->Widget_SelectPath);
+    forwardButton = new QPushButton(QString(QChar(0x2192)), ui->Widget_SelectPath);
+    upButton = new QPushButton(QString(QChar(0x2191)), ui->Widget_SelectPath);
+    dualPaneButton = new QPushButton(QString(QChar(0x25EB)), ui->Widget_SelectPath);
+
+    backButton->setToolTip(tr("Back"));
+    forwardButton->setToolTip(tr("Forward"));
+    upButton->setToolTip(tr("Up"));
+    dualPaneButton->setToolTip(tr("Dual pane (F6)"));
+
+    const QList<QPushButton*> buttons = { backButton, forwardButton, upButton, dualPaneButton };
+    for (int i = 0; i < buttons.size(); ++i)
+    {
+        buttons.at(i)->setFixedSize(24, 24);
+        buttons.at(i)->setStyleSheet("padding:0; text-align:center;");
+        if (pathLayout)
+        {
+            pathLayout->insertWidget(i, buttons.at(i));
+        }
+    }
+
+    backButton->setEnabled(false);
+    forwardButton->setEnabled(false);
+    dualPaneButton->setCheckable(true);
+
+    connect(backButton, &QPushButton::clicked, this, &MainWindow::navigateBack);
+    connect(forwardButton, &QPushButton::clicked, this, &MainWindow::navigateForward);
+    connect(upButton, &QPushButton::clicked, this, &MainWindow::navigateUp);
+    connect(dualPaneButton, &QPushButton::clicked, this, &MainWindow::toggleDualPane);
+
+    new PathCompleter(ui->QLineEdit_DirectoryTextDisplay, this);
+    connect(ui->QLineEdit_DirectoryTextDisplay, &QLineEdit::returnPressed, this, &MainWindow::navigateToTypedPath);
+
+    connect(new QShortcut(QKeySequence::Back, this), &QShortcut::activated, this, &MainWindow::navigateBack);
+    connect(new QShortcut(QKeySequence::Forward, this), &QShortcut::activated, this, &MainWindow::navigateForward);
+    connect(new QShortcut(QKeySequence(Qt::ALT | Qt::Key_Up), this), &QShortcut::activated, this, &MainWindow::navigateUp);
+}
+
+/**
+ * @brief Creates the dock previewing the current item of the active pane. It starts hidden and is toggled with F3.
+ */
+void MainWindow::initializePreviewPane()
+{
+    previewPane = new PreviewPane(this);
+    previewDock = new QDockWidget(tr("Preview"), this);
+    previewDock->setObjectName("PreviewDock");
+    previewDock->setWidget(previewPane);
+    addDockWidget(Qt::RightDockWidgetArea, previewDock);
+    previewDock->hide();
+
+    previewDock->toggleViewAction()->setShortcut(QKeySequence(Qt::Key_F3));
+    addAction(previewDock->toggleViewAction());
+}
+
+/**
+ * @brief Creates the queue running file operations in the background and the status bar widgets showing its progress.
+ */
+void MainWindow::initializeJobQueue()
+{
+    jobQueue = new JobQueue(this);
+
+    jobLabel = new QLabel(this);
+    jobProgressBar = new QProgressBar(this);
+    jobProgressBar->setMaximumWidth(200);
+    jobCancelButton = new QPushButton(tr("Cancel"), this);
+
+    statusBar()->addPermanentWidget(jobLabel);
+    statusBar()->addPermanentWidget(jobProgressBar);
+    statusBar()->addPermanentWidget(jobCancelButton);
+
+    jobLabel->hide();
+    jobProgressBar->hide();
+    jobCancelButton->hide();
+
+    connect(jobCancelButton, &QPushButton::clicked, jobQueue, &JobQueue::cancelAll);
+    connect(jobQueue, &JobQueue::jobProgress, this, &MainWindow::onJobProgress);
+    connect(jobQueue, &JobQueue::jobFinished, this, &MainWindow::onJobFinished);
+    connect(jobQueue, &JobQueue::jobStarted, this, [this](BackgroundJob *job)
+            {
+                jobLabel->setText(job->title());
+                jobProgressBar->setRange(0, 0);
+                jobLabel->show();
+                jobProgressBar->show();
+                jobCancelButton->show();
+            });
+    connect(jobQueue, &JobQueue::idle, this, [this]()
+            {
+                jobLabel->hide();
+                jobProgressBar->hide();
+                jobCancelButton->hide();
+            });
+}
+
+/**
+ * @brief Shows the file operations for the selected items of the active pane and undo/redo of the journal.
+ *
+ * @param globalPos The position of the menu in global coordinates.
+ */
+void MainWindow::showListViewContextMenu(const QPoint &globalPos)
+{
+    if (activePane() == nullptr)
+    {
+        return;
+    }
+
+    // Members of a browsed archive are read-only.
+    const bool hasSelection = !activePane()->listViewManager()->selectedItemPaths().isEmpty()
+                              && !ArchiveIndex::isInsideArchive(activePane()->currentPath());
+
+    QMenu menu(this);
+    const QList<QAction*> selectionActions = {
+        menu.addAction(tr("Copy to..."), this, &MainWindow::copySelectedItems),
+        menu.addAction(tr("Move to..."), this, &MainWindow::moveSelectedItems),
+        menu.addSeparator(),
+        menu.addAction(tr("Rename"), this, &MainWindow::renameSelectedItems),
+        menu.addAction(tr("Delete"), this, &MainWindow::deleteSelectedItems),
+        menu.addAction(tr("Delete permanently"), this, &MainWindow::deleteSelectedItemsPermanently),
+        menu.addSeparator(),
+        menu.addAction(tr("Compress to archive"), this, &MainWindow::compressSelectedItems)
+    };
+    for (QAction *action : selectionActions)
+    {
+        action->setEnabled(hasSelection);
+    }
+
+    // The bulk rename plans the names of one directory.
+    const QStringList selectedPaths = activePane()->listViewManager()->selectedItemPaths();
+    QAction *renameAction = selectionActions.at(3);
+    renameAction->setEnabled(hasSelection && isInOneDirectory(selectedPaths));
+    QAction *extractAction = menu.addAction(tr("Extract here"), this, &MainWindow::extractSelectedArchive);
+    extractAction->setEnabled(hasSelection && selectedPaths.size() == 1
+                              && ArchiveIndex::formatForName(selectedPaths.first()) != ArchiveIndex::NotAnArchive);
+    QMenu *checksumMenu = menu.addMenu(tr("Create checksums"));
+    for (ChecksumJob::Algorithm algorithm : { ChecksumJob::Sha256, ChecksumJob::Blake3, ChecksumJob::XxHash64 })
+    {
+        checksumMenu->addAction(ChecksumJob::algorithmName(algorithm), this, [this, algorithm]()
+                                {
+                                    createChecksumsOfSelectedItems(algorithm);
+                                });
+    }
+    checksumMenu->setEnabled(hasSelection);
+    QAction *verifyAction = menu.addAction(tr("Verify checksums"), this, &MainWindow::verifySelectedChecksums);
+    verifyAction->setEnabled(hasSelection);
+    menu.addSeparator();
+
+    QAction *tagsAction = menu.addAction(tr("Tags..."), this, &MainWindow::editTagsOfSelectedItems);
+    tagsAction->setEnabled(hasSelection);
+    menu.addSeparator();
+
+    menu.addAction(previewDock->toggleViewAction());
+    menu.addAction(tr("Search contents..."), this, &MainWindow::openContentSearch);
+    QAction *compareAction = menu.addAction(tr("Compare folders..."), this, &MainWindow::openDirectoryCompare);
+    compareAction->setEnabled(QFileInfo(activePane()->currentPath()).isDir());
+    QAction *smartFolderAction = menu.addAction(tr("Save as smart folder..."), this, &MainWindow::saveSmartFolder);
+    smartFolderAction->setEnabled(QFileInfo(activePane()->currentPath()).isDir());
+    menu.addAction(tr("Index contents here"), this, &MainWindow::buildContentIndex);
+    if (!ContentIndex::instance().rootDirectory().isEmpty())
+    {
+        menu.addAction(tr("Remove content index of %1").arg(QDir::toNativeSeparators(ContentIndex::instance().rootDirectory())),
+                       this, []() { ContentIndex::instance().remove(); });
+    }
+    menu.addSeparator();
+
+    QAction *undoAction = menu.addAction(tr("Undo %1").arg(OperationJournal::instance().undoTitle()), this, &MainWindow::undoLastOperation);
+    undoAction->setEnabled(OperationJournal::instance().canUndo() && journalReplay.batchId == 0);
+    QAction *redoAction = menu.addAction(tr("Redo %1").arg(OperationJournal::instance().redoTitle()), this, &MainWindow::redoLastOperation);
+    redoAction->setEnabled(OperationJournal::instance().canRedo() && journalReplay.batchId == 0);
+
+    menu.exec(globalPos);
+}
+
+/**
+ * @brief Returns the directory of the second visible pane, used as the default destination of copy and move.
+ */
+QString MainWindow::otherPanePath() const
+{
+    if (!paneTabs[1]->isVisible())
+    {
+        return QString();
+    }
+
+    for (QTabWidget *tabWidget : paneTabs)
+    {
+        FileBrowserPane *pane = qobject_cast<FileBrowserPane*>(tabWidget->currentWidget());
+        if (pane && pane != currentPane)
+        {
+            return pane->currentPath();
+        }
+    }
+
+    return QString();
+}
+
+/**
+ * @brief Moves all selected items to the trash as one background job after a single confirmation.
+ */
+void MainWindow::deleteSelectedItems()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (paths.isEmpty())
+    {
+        return;
+    }
+
+    const QString question = paths.size() == 1 ? tr("Move \"%1\" to the trash?").arg(QFileInfo(paths.first()).fileName())
+                                               : tr("Move %n selected item(s) to the trash?", nullptr, int(paths.size()));
+
+    if (QMessageBox::question(this, tr("Delete"), question) == QMessageBox::Yes)
+    {
+        startFileOperation(FileOperationJob::trashItems(paths));
+    }
+}
+
+/**
+ * @brief Deletes all selected items without the possibility to undo it.
+ */
+void MainWindow::deleteSelectedItemsPermanently()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (paths.isEmpty())
+    {
+        return;
+    }
+
+    const QString question = tr("Permanently delete %n selected item(s)? This cannot be undone.", nullptr, int(paths.size()));
+
+    if (QMessageBox::warning(this, tr("Delete permanently"), question, QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes)
+    {
+        startFileOperation(FileOperationJob::deleteItems(paths));
+    }
+}
+
+/**
+ * @brief Reverts the most recent journaled operation. Renames, moves and trashing are reverted by renaming back,
+ * copies by deleting the copies and created folders by removing them if they are still empty. The batch is only
+ * marked as undone once this succeeded, see finishJournalReplay().
+ */
+void MainWindow::undoLastOperation()
+{
+    const JournalBatch batch = OperationJournal::instance().undoBatch();
+    if (batch.entries.isEmpty() || journalReplay.batchId != 0)
+    {
+        return;
+    }
+
+    journalReplay = { batch.id, true, {}, true };
+
+    QList<QPair<QString, QString>> moves;
+    QList<QPair<QString, QString>> copies;
+    QStringList failedFolders;
+
+    for (auto it = batch.entries.crbegin(); it != batch.entries.crend(); ++it)
+    {
+        if (it->kind == JournalEntry::Move || it->kind == JournalEntry::Trash)
+        {
+            moves.append({ it->target, it->source });
+        }
+        else if (it->kind == JournalEntry::Copy)
+        {
+            copies.append({ it->target, QString() });
+        }
+        else if (it->kind == JournalEntry::CreateFolder)
+        {
+            if (QDir().rmdir(it->target))
+            {
+                applyFileChanges({ it->target }, {});
+            }
+            else
+            {
+                failedFolders << it->target;
+            }
+        }
+    }
+
+    runJournalJob(FileOperationJob::Move, moves);
+    runJournalJob(FileOperationJob::Delete, copies);
+    finishFolderReplay(tr("Undo %1").arg(batch.title), failedFolders);
+}
+
+/**
+ * @brief Applies again the operation reverted by the last undo.
+ */
+void MainWindow::redoLastOperation()
+{
+    const JournalBatch batch = OperationJournal::instance().redoBatch();
+    if (batch.entries.isEmpty() || journalReplay.batchId != 0)
+    {
+        return;
+    }
+
+    journalReplay = { batch.id, false, {}, true };
+
+    QList<QPair<QString, QString>> moves;
+    QList<QPair<QString, QString>> copies;
+    QStringList failedFolders;
+
+    for (const JournalEntry &entry : batch.entries)
+    {
+        if (entry.kind == JournalEntry::Move || entry.kind == JournalEntry::Trash)
+        {
+            moves.append({ entry.source, entry.target });
+        }
+        else if (entry.kind == JournalEntry::Copy)
+        {
+            copies.append({ entry.source, entry.target });
+        }
+        else if (entry.kind == JournalEntry::CreateFolder)
+        {
+            if (QDir().mkdir(entry.target))
+            {
+                applyFileChanges({}, { { entry.target, true } });
+            }
+            else
+            {
+                failedFolders << entry.target;
+            }
+        }
+    }
+
+    runJournalJob(FileOperationJob::Move, moves);
+    runJournalJob(FileOperationJob::Copy, copies);
+    finishFolderReplay(tr("Redo %1").arg(batch.title), failedFolders);
+}
+
+/**
+ * @brief Queues a job replaying the journal, unless it has nothing to do. Such jobs are not recorded again.
+ *
+ * @param operation The operation to run.
+ * @param items Source and target of every step.
+ */
+void MainWindow::runJournalJob(FileOperationJob::Operation operation, const QList<QPair<QString, QString>> &items)
+{
+    if (items.isEmpty())
+    {
+        return;
+    }
+
+    FileOperationJob *job = new FileOperationJob(operation, items);
+    job->setRecordedInJournal(false);
+    journalReplay.runningJobs.insert(job);
+    startFileOperation(job);
+}
+
+/**
+ * @brief Reports the folders an undo or redo could not remove or create, which keeps the batch from being marked,
+ * and finishes the replay if it started no jobs.
+ *
+ * @param title The text shown for the failure.
+ * @param failedFolders The folders that could not be removed or created.
+ */
+void MainWindow::finishFolderReplay(const QString &title, const QStringList &failedFolders)
+{
+    if (!failedFolders.isEmpty())
+    {
+        journalReplay.succeeded = false;
+        reportFailedPaths(title, failedFolders);
+    }
+    finishJournalReplay();
+}
+
+/**
+ * @brief Records the undo or redo in the journal once all of its jobs are done, but only if they all succeeded.
+ * A cancelled or partly failed replay leaves the batch where it was, so it can be tried again. Operations that
+ * finished during the replay are committed afterwards, so they do not clear the batch being replayed.
+ */
+void MainWindow::finishJournalReplay()
+{
+    if (journalReplay.batchId == 0 || !journalReplay.runningJobs.isEmpty())
+    {
+        return;
+    }
+
+    if (journalReplay.succeeded)
+    {
+        if (journalReplay.isUndo)
+        {
+            OperationJournal::instance().markUndone(journalReplay.batchId);
+        }
+        else
+        {
+            OperationJournal::instance().markRedone(journalReplay.batchId);
+        }
+    }
+
+    journalReplay = JournalReplay();
+
+    const QList<QPair<QString, QList<JournalEntry>>> commits = std::exchange(deferredCommits, {});
+    for (const QPair<QString, QList<JournalEntry>> &commit : commits)
+    {
+        OperationJournal::instance().commit(commit.first, commit.second);
+    }
+}
+
+/**
+ * @brief Records a finished operation in the journal so it can be undone.
+ *
+ * @param title The text shown for undo and redo.
+ * @param kind The kind of every step.
+ * @param items Source and target of every step.
+ */
+void MainWindow::recordInJournal(const QString &title, JournalEntry::Kind kind, const QList<QPair<QString, QString>> &items)
+{
+    QList<JournalEntry> entries;
+    entries.reserve(items.size());
+    for (const QPair<QString, QString> &item : items)
+    {
+        entries.append({ kind, item.first, item.second });
+    }
+
+    if (journalReplay.batchId != 0)
+    {
+        deferredCommits.append({ title, entries });
+        return;
+    }
+    OperationJournal::instance().commit(title, entries);
+}
+
+/**
+ * @brief Applies changed paths to every pane with one incremental model update each.
+ *
+ * @param removedPaths Full paths that no longer exist.
+ * @param addedPaths Full paths that were created, mapped to whether they are directories.
+ */
+void MainWindow::applyFileChanges(const QSet<QString> &removedPaths, const QHash<QString, bool> &addedPaths)
+{
+    QSet<QString> directories;
+    for (const QString &path : removedPaths)
+    {
+        directories.insert(QFileInfo(path).absolutePath());
+    }
+    for (auto it = addedPaths.cbegin(); it != addedPaths.cend(); ++it)
+    {
+        directories.insert(QFileInfo(it.key()).absolutePath());
+    }
+    for (const QString &directory : std::as_const(directories))
+    {
+        DirectoryListingCache::instance().invalidate(directory);
+    }
+
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
+    {
+        pane->listViewManager()->model()->applyChanges(removedPaths, addedPaths);
+    }
+}
+
+/**
+ * @brief Opens the bulk rename dialog for the selected items and runs the planned renames as one background job.
+ */
+void MainWindow::renameSelectedItems()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (paths.isEmpty())
+    {
+        return;
+    }
+
+    // Names are planned and renamed relative to one directory, a virtual folder may mix several.
+    if (!isInOneDirectory(paths))
+    {
+        statusBar()->showMessage(tr("Items from different folders cannot be renamed together"), 5000);
+        return;
+    }
+
+    QStringList names;
+    names.reserve(paths.size());
+    for (const QString &path : paths)
+    {
+        names << QFileInfo(path).fileName();
+    }
+
+    BulkRenameDialog *renameDialog = new BulkRenameDialog(QFileInfo(paths.first()).absolutePath(), names, this);
+    connect(renameDialog, &BulkRenameDialog::renameRequested, this, [this](const QList<QPair<QString, QString>> &renames)
+            {
+                startFileOperation(FileOperationJob::renameItems(renames));
+            });
+
+    renameDialog->show();
+}
+
+/**
+ * @brief Copies the selected items into a chosen directory, by default the directory of the other pane.
+ */
+void MainWindow::copySelectedItems()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    const QString startDirectory = otherPanePath().isEmpty() ? activePane()->currentPath() : otherPanePath();
+    const QString destination = QFileDialog::getExistingDirectory(this, tr("Copy to"), startDirectory);
+
+    if (!paths.isEmpty() && !destination.isEmpty())
+    {
+        startFileOperation(FileOperationJob::copyItems(paths, destination));
+    }
+}
+
+/**
+ * @brief Packs the selected items into a new compressed archive next to them.
+ */
+void MainWindow::compressSelectedItems()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (!paths.isEmpty())
+    {
+        jobQueue->enqueue(ArchiveJob::compressItems(paths, ArchiveJob::defaultArchivePath(paths)));
+    }
+}
+
+/**
+ * @brief Unpacks the selected archive into a new folder next to it.
+ */
+void MainWindow::extractSelectedArchive()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (paths.size() == 1 && ArchiveIndex::formatForName(paths.first()) != ArchiveIndex::NotAnArchive)
+    {
+        jobQueue->enqueue(ArchiveJob::extractArchive(paths.first(), QFileInfo(paths.first()).absolutePath()));
+    }
+}
+
+/**
+ * @brief Hashes the selected files and directory trees into a checksum manifest next to them.
+ */
+void MainWindow::createChecksumsOfSelectedItems(ChecksumJob::Algorithm algorithm)
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (!paths.isEmpty())
+    {
+        jobQueue->enqueue(ChecksumJob::createManifest(paths, algorithm));
+    }
+}
+
+/**
+ * @brief Checks the selected checksum manifests, or the manifests found in the selected directories.
+ */
+void MainWindow::verifySelectedChecksums()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (!paths.isEmpty())
+    {
+        jobQueue->enqueue(ChecksumJob::verifyManifests(paths));
+    }
+}
+
+/**
+ * @brief Moves the selected items into a chosen directory, by default the directory of the other pane.
+ */
+void MainWindow::moveSelectedItems()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    const QString startDirectory = otherPanePath().isEmpty() ? activePane()->currentPath() : otherPanePath();
+    const QString destination = QFileDialog::getExistingDirectory(this, tr("Move to"), startDirectory);
+
+    if (!paths.isEmpty() && !destination.isEmpty() && QDir::cleanPath(destination) != QDir::cleanPath(activePane()->currentPath()))
+    {
+        startFileOperation(FileOperationJob::moveItems(paths, destination));
+    }
+}
+
+/**
+ * @brief Queues a file operation job.
+ *
+ * @param job The job to run; the queue takes ownership.
+ */
+void MainWindow::startFileOperation(FileOperationJob *job)
+{
+    jobQueue->enqueue(job);
+}
+
+/**
+ * @brief Runs a folder synchronization. Replaced and removed items go to the trash first, so the copies start
+ * once that job finished and cannot clash with the items they replace.
+ */
+void MainWindow::runSyncPlan(const SyncPlan &plan)
+{
+    if (plan.trashPaths.isEmpty())
+    {
+        startSyncCopies(plan.copies);
+        return;
+    }
 
-MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent)
-    , ui(new Ui::MainWindow)
-    , listViewManager(ListViewManager::instance())
-    , treeViewManager(TreeViewManager::instance())
-    , visuals((VisualModeUpdater::instance()))
+    FileOperationJob *trashJob = FileOperationJob::trashItems(plan.trashPaths);
+    pendingSyncCopies.insert(trashJob, plan.copies);
+    startFileOperation(trashJob);
+}
+
+/**
+ * @brief Queues the copies of a synchronization. Copies keep the modification times of their sources, so the
+ * folders compare as equal afterwards.
+ */
+void MainWindow::startSyncCopies(const QList<QPair<QString, QString>> &copies)
 {
-    ui->setupUi(this);
+    if (!copies.isEmpty())
+    {
+        FileOperationJob *copyJob = FileOperationJob::copyItems(copies);
+        copyJob->setPreservesModificationTimes(true);
+        startFileOperation(copyJob);
+    }
+}
+
+/**
+ * @brief Updates the status bar progress of the running job.
+ */
+void MainWindow::onJobProgress(BackgroundJob *job, qint64 done, qint64 total)
+{
+    jobLabel->setText(job->title());
+    jobProgressBar->setRange(0, 1000);
+    jobProgressBar->setValue(total > 0 ? int(done * 1000 / total) : 0);
+}
+
+/**
+ * @brief Applies the result of a finished file operation, archive or checksum job to every pane and records file
+ * operations in the journal.
+ *
+ * @param job The finished job.
+ */
+void MainWindow::onJobFinished(BackgroundJob *job)
+{
+    if (ArchiveJob *archiveJob = qobject_cast<ArchiveJob*>(job))
+    {
+        const QString createdPath = archiveJob->createdPath();
+        if (!createdPath.isEmpty())
+        {
+            const QString directory = QFileInfo(createdPath).absolutePath();
+            DirectoryListingCache::instance().invalidate(directory);
+            ContentIndex::instance().scheduleUpdate(directory);
+            SmartFolderIndex::instance().scheduleUpdate(directory);
+            applyFileChanges({}, { { createdPath, archiveJob->operation() == ArchiveJob::Extract } });
+        }
+        reportFailedPaths(job->title(), archiveJob->failedPaths());
+        return;
+    }
+
+    if (ChecksumJob *checksumJob = qobject_cast<ChecksumJob*>(job))
+    {
+        const QString createdPath = checksumJob->createdPath();
+        if (!createdPath.isEmpty())
+        {
+            const QString directory = QFileInfo(createdPath).absolutePath();
+            DirectoryListingCache::instance().invalidate(directory);
+            ContentIndex::instance().scheduleUpdate(directory);
+            SmartFolderIndex::instance().scheduleUpdate(directory);
+            // The manifest may replace an older one that is already listed.
+            applyFileChanges({ createdPath }, { { createdPath, false } });
+            statusBar()->showMessage(tr("Checksums written to %1").arg(QFileInfo(createdPath).fileName()), 5000);
+        }
+        else if (checksumJob->operation() == ChecksumJob::Verify && !job->isCancelled())
+        {
+            reportChecksumMismatches(job->title(), checksumJob);
+        }
+        reportFailedPaths(job->title(), checksumJob->failedPaths());
+        return;
+    }
 
-    listViewManager.instance().initialize(ui->QListView_FileViewer);
-    treeViewManager.instance().initialize(ui->QTreeView_MainTree);
+    FileOperationJob *fileJob = qobject_cast<FileOperationJob*>(job);
+    if (fileJob == nullptr)
+    {
+        return;
+    }
 
-    connect(this, &MainWindow::populateTreeView, &treeViewManager.instance(), &TreeViewManager::updateModelForTreeView);
-    connect(ui->QTreeView_MainTree, &QTreeView::clicked, &treeViewManager.instance(), &TreeViewManager::treeViewSelectedItemPath);
-    connect(&treeViewManager.instance(), &TreeViewManager::updateViewData, this, &MainWindow::updateTreeView);
-    connect(ui->QTreeView_MainTree, &QTreeView::expanded, &treeViewManager.instance(), &TreeViewManager::onTreeViewIndexExpanded);
+    const QSet<QString> directories = fileJob->affectedDirectories();
+    for (const QString &directory : directories)
+    {
+        DirectoryListingCache::instance().invalidate(directory);
+        ContentIndex::instance().scheduleUpdate(directory);
+        SmartFolderIndex::instance().scheduleUpdate(directory);
+    }
 
-    LongClickHandler *longClickHandler = new LongClickHandler(ui->QListView_FileViewer, this);
-    connect(longClickHandler, &LongClickHandler::longClicked, &listViewManager.instance(), &ListViewManager::onListViewItemLongClicked);
-    connect(this, &MainWindow::populateListView, &listViewManager.instance(), &ListViewManager::setModelForListView);
-    connect(ui->QListView_FileViewer, &QListView::doubleClicked, &listViewManager.instance(), &ListViewManager::onListViewItemDoubleClicked);
-    connect(&listViewManager.instance(), &ListViewManager::updateViewData, this, &MainWindow::updateTreeView);
-    connect(&listViewManager.instance(), &ListViewManager::callFileViewerDialog, this, &MainWindow::openFileViewerDialog);
-    connect(this, &MainWindow::updateHideFilesFilter, &listViewManager.instance(),&ListViewManager::shouldAcceptDirectories);
+    applyFileChanges(fileJob->removedPaths(), fileJob->addedPaths());
 
-    connect(this, &MainWindow::updateLightModeBooleanData, &visuals.instance(), &VisualModeUpdater::updateLightModeBooleanData);
+    if (fileJob->operation() == FileOperationJob::Delete)
+    {
+        QStringList deletedPaths;
+        for (const QPair<QString, QString> &item : fileJob->completedItems())
+        {
+            deletedPaths << item.first;
+        }
+        TagStore::instance().removePaths(deletedPaths);
+    }
+    else if (fileJob->operation() != FileOperationJob::Copy)
+    {
+        TagStore::instance().movePaths(fileJob->completedItems());
+    }
 
-    splitter = splitterLeftAndRightPanels();
-    connect(splitter, &QSplitter::splitterMoved, this, &MainWindow::handleSplitterMoved);
+    if (fileJob->isRecordedInJournal() && !fileJob->completedItems().isEmpty())
+    {
+        const JournalEntry::Kind kind = fileJob->operation() == FileOperationJob::Copy  ? JournalEntry::Copy
+                                        : fileJob->operation() == FileOperationJob::Trash ? JournalEntry::Trash
+                                                                                          : JournalEntry::Move;
+        recordInJournal(job->title(), kind, fileJob->completedItems());
+    }
+    else if (journalReplay.runningJobs.remove(job))
+    {
+        journalReplay.succeeded = journalReplay.succeeded && !job->isCancelled() && fileJob->failedPaths().isEmpty();
+        finishJournalReplay();
+    }
 
-    treeViewManager.instance().setModelForTreeView(ui->QTreeView_MainTree);
+    if (pendingSyncCopies.contains(job))
+    {
+        // A target that could not be moved away would be copied under a new name instead of being replaced.
+        QList<QPair<QString, QString>> copies = pendingSyncCopies.take(job);
+        const QStringList failedPaths = fileJob->failedPaths();
+        const QSet<QString> keptTargets(failedPaths.cbegin(), failedPaths.cend());
+        copies.removeIf([&keptTargets](const QPair<QString, QString> &copy)
+                        {
+                            return keptTargets.contains(copy.second);
+                        });
+        if (!job->isCancelled())
+        {
+            startSyncCopies(copies);
+        }
+    }
 
-    QTimer::singleShot(100, this, &MainWindow::initializeMainWindow);
-    QTimer::singleShot(100, this, &MainWindow::updateIcons);
-    QTimer::singleShot(100, this, &MainWindow::refresh);
+    reportFailedPaths(job->title(), fileJob->failedPaths());
 }
 
-MainWindow::~MainWindow()
+/**
+ * @brief Lists the items a job could not process, at most ten of them.
+ *
+ * @param title The title of the job.
+ * @param failedPaths The paths that failed.
+ */
+void MainWindow::reportFailedPaths(const QString &title, const QStringList &failedPaths)
 {
-    delete ui;
+    if (failedPaths.isEmpty())
+    {
+        return;
+    }
+
+    QStringList names;
+    for (int i = 0; i < failedPaths.size() && i < 10; ++i)
+    {
+        names << QFileInfo(failedPaths.at(i)).fileName();
+    }
+    if (failedPaths.size() > names.size())
+    {
+        names << tr("...");
+    }
+
+    QMessageBox::warning(this, title, tr("%n item(s) could not be processed:", nullptr, int(failedPaths.size())) + "\n" + names.join('\n'));
 }
 
 /**
- * @brief Initializes the main window components and UI elements outside constructor.
+ * @brief Lists the files whose checksums did not match, at most ten of them, or shows the number of verified
+ * files in the status bar.
+ *
+ * @param title The title of the job.
+ * @param job The finished verification job.
  */
-void MainWindow::initializeMainWindow()
+void MainWindow::reportChecksumMismatches(const QString &title, const ChecksumJob *job)
 {
-    if (!loadLayout())
+    const QStringList mismatchedPaths = job->mismatchedPaths();
+    if (mismatchedPaths.isEmpty())
     {
-        updateTreeView(nullptr);
-        QStandardItemModel *standardModel = new QStandardItemModel(this);
-        ui->QListView_FileViewer->setModel(standardModel);
+        statusBar()->showMessage(tr("%n file(s) verified", nullptr, int(job->verifiedCount())), 5000);
+        return;
     }
 
-    ui->QTreeView_MainTree->header()->resizeSection(0,250);
-    ui->QTreeView_MainTree->header()->hideSection(1);
+    QStringList names;
+    for (int i = 0; i < mismatchedPaths.size() && i < 10; ++i)
+    {
+        names << QDir::toNativeSeparators(mismatchedPaths.at(i));
+    }
+    if (mismatchedPaths.size() > names.size())
+    {
+        names << tr("...");
+    }
+
+    QMessageBox::warning(this, title, tr("%n file(s) do not match their checksum:", nullptr, int(mismatchedPaths.size())) + "\n"
+                         + names.join('\n'));
 }
 
 /**
@@ -88,19 +1218,28 @@ void MainWindow::resizeEvent(QResizeEvent *event)
 {
     if (event->spontaneous() && event->type() == QEvent::Resize)
     {
-        ui->QListView_FileViewer->resize(ui->Widget_ListViewPanel->size());
-
-        ModifiedFileSystemModel *model = dynamic_cast<ModifiedFileSystemModel*>(ui->QListView_FileViewer->model());
-        if (model)
-        {
-            ui->QListView_FileViewer->setModel(nullptr);
-            ui->QListView_FileViewer->setModel(model);
-        }
+        relayoutPanes();
     }
 
     QMainWindow::resizeEvent(event);
 }
 
+/**
+ * @brief Overrides the paintEvent function to finish startup once the first frame was drawn.
+ *
+ * @param event A QPaintEvent representing the paint event.
+ */
+void MainWindow::paintEvent(QPaintEvent *event)
+{
+    QMainWindow::paintEvent(event);
+
+    if (!isFirstFramePainted)
+    {
+        isFirstFramePainted = true;
+        QTimer::singleShot(0, this, &MainWindow::finishStartup);
+    }
+}
+
 /**
  * @brief Handles the moved signal of the splitter, updating the file viewer list view accordingly.
  *
@@ -112,11 +1251,22 @@ void MainWindow::handleSplitterMoved(int pos, int index)
     Q_UNUSED(pos);
     Q_UNUSED(index);
 
-    ModifiedFileSystemModel *model = qobject_cast<ModifiedFileSystemModel*>(ui->QListView_FileViewer->model());
-    if (model)
+    relayoutPanes();
+}
+
+/**
+ * @brief Lays out the items of all list views again for the new size. The models stay attached, so the selection
+ * models the panes and the preview follow are kept.
+ */
+void MainWindow::relayoutPanes()
+{
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
     {
-        ui->QListView_FileViewer->setModel(nullptr);
-        ui->QListView_FileViewer->setModel(model);
+        if (pane->listView()->model())
+        {
+            pane->listView()->doItemsLayout();
+        }
     }
 }
 
@@ -130,6 +1280,9 @@ void MainWindow::closeEvent(QCloseEvent *event)
     QSettings settings("FileManager", "Splitter");
     settings.setValue("SplitterSizes", splitter->saveState());
     saveLayout();
+    MetadataIndex::instance().save();
+    TagStore::instance().save();
+    SmartFolderIndex::instance().save();
     QMainWindow::closeEvent(event);
 }
 
@@ -178,14 +1331,27 @@ bool MainWindow::loadLayout()
 {
     QSettings settings("FileManager", "AppSettings");
 
-    if (settings.allKeys().isEmpty())
+    const bool hasSettings = !settings.allKeys().isEmpty();
+
+    // The settings hold the states before the toggle, see saveLayout(). Without settings all three flags start
+    // false: list layout, folders left out of the file list, and the light theme (the flag selects the dark one).
+    isGridLayout = !settings.value("isGridLayout", true).toBool();
+    isShowFiles = !settings.value("isShowFiles", true).toBool();
+    isLightMode = !settings.value("isLightMode", true).toBool();
+    visuals->updateLightModeBooleanData(isLightMode, isGridLayout, isShowFiles);
+    visuals->applyTheme(*this, themedViews());
+
+    // Icons are loaded after the first paint, only the state they depend on is restored here.
+    emit updateHideFilesFilter(isShowFiles);
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
     {
-        ui->QPushButton_ShowPanel->hide();
-        visuals.updateLightModeBooleanData(isLightMode, isGridLayout, isShowFiles);
-        on_QPushButton_LightDarkModePushButton_clicked();
-        on_QPushButton_HideFilesPushButton_clicked();
-        on_QPushButton_LayoutPushButton_clicked();
+        applyLayoutToPane(pane);
+    }
 
+    if (!hasSettings)
+    {
+        ui->QPushButton_ShowPanel->hide();
         return false;
     }
 
@@ -198,16 +1364,8 @@ bool MainWindow::loadLayout()
         ui->QLineEdit_DirectoryTextDisplay->setText(rootPath);
     }
 
-    isGridLayout = settings.value("isGridLayout").toBool();
-    isShowFiles = settings.value("isShowFiles").toBool();
-    isLightMode = settings.value("isLightMode").toBool();
-    visuals.updateLightModeBooleanData(isLightMode, isGridLayout, isShowFiles);
-
-    on_QPushButton_LightDarkModePushButton_clicked();
-    on_QPushButton_HideFilesPushButton_clicked();
-    on_QPushButton_LayoutPushButton_clicked();
-
     ui->Widget_HidePanel->setVisible(settings.value("HideButtons").toBool());
+    previewDock->setVisible(settings.value("ShowPreview", false).toBool());
 
     QSettings splitterSize("FileManager", "Splitter");
     QByteArray splitterState = splitterSize.value("SplitterSizes").toByteArray();
@@ -234,8 +1392,9 @@ void MainWindow::saveLayout()
     settings.setValue("isShowFiles", !isShowFiles);
 
     settings.setValue("HideButtons", !ui->Widget_HidePanel->isHidden());
+    settings.setValue("ShowPreview", !previewDock->isHidden());
 
-    settings.setValue("RootPath", ui->QLineEdit_DirectoryTextDisplay->text());
+    settings.setValue("RootPath", activePane()->currentPath());
     settings.sync();
 }
 
@@ -244,7 +1403,11 @@ void MainWindow::saveLayout()
  */
 void MainWindow::refresh()
 {
-    emit populateListView(treeViewManager.treeViewSelectedItemPath(ui->QTreeView_MainTree->currentIndex()));
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
+    {
+        pane->refresh();
+    }
 
     QModelIndex selectedIndex = ui->QTreeView_MainTree->currentIndex();
     QTimer::singleShot(100, this, [this, selectedIndex]() {
@@ -262,11 +1425,243 @@ void MainWindow::updateTreeView(const QString &path)
     if(!path.isEmpty())
     {
         emit populateTreeView(path);
-        emit populateListView(path);
+        activePane()->navigateTo(path);
         ui->QLineEdit_DirectoryTextDisplay->setText(path);
     }
 }
 
+/**
+ * \brief Goes back to the previously visited directory of the active pane.
+ */
+void MainWindow::navigateBack()
+{
+    activePane()->navigateBack();
+    emit populateTreeView(activePane()->currentPath());
+}
+
+/**
+ * \brief Goes forward to the directory left by navigateBack().
+ */
+void MainWindow::navigateForward()
+{
+    activePane()->navigateForward();
+    emit populateTreeView(activePane()->currentPath());
+}
+
+/**
+ * \brief Navigates to the directory typed into the path display. Restores the current path if it is not a directory.
+ */
+void MainWindow::navigateToTypedPath()
+{
+    const QString path = QDir::cleanPath(QDir::fromNativeSeparators(ui->QLineEdit_DirectoryTextDisplay->text()));
+    const QString typedText = ui->QLineEdit_DirectoryTextDisplay->text().trimmed();
+    if (TagStore::isQueryPath(typedText))
+    {
+        QString error;
+        DirectoryListing listing;
+        if (TagStore::instance().query(typedText, listing, &error))
+        {
+            updateTreeView(typedText);
+        }
+        else
+        {
+            statusBar()->showMessage(error, 5000);
+            ui->QLineEdit_DirectoryTextDisplay->setText(activePane()->currentPath());
+        }
+    }
+    else if (SmartFolderIndex::isSmartFolderPath(typedText))
+    {
+        if (SmartFolderIndex::instance().folderNames().contains(typedText.mid(typedText.indexOf(':') + 1)))
+        {
+            updateTreeView(typedText);
+        }
+        else
+        {
+            ui->QLineEdit_DirectoryTextDisplay->setText(activePane()->currentPath());
+        }
+    }
+    else if (QFileInfo(path).isDir()
+             || (ArchiveIndex::isInsideArchive(path)
+                 && (!ArchiveIndex::instance().isCached(path) || ArchiveIndex::instance().isDirectory(path))))
+    {
+        // An archive that was not read yet is read by the pane in the background; a directory missing from it is
+        // shown empty then.
+        updateTreeView(path);
+    }
+    else
+    {
+        ui->QLineEdit_DirectoryTextDisplay->setText(activePane()->currentPath());
+    }
+}
+
+/**
+ * \brief Navigates to the parent of the current directory.
+ */
+void MainWindow::navigateUp()
+{
+    const QString currentPath = activePane()->currentPath();
+    if (TagStore::isQueryPath(currentPath) || SmartFolderIndex::isSmartFolderPath(currentPath))
+    {
+        return;
+    }
+
+    if (ArchiveIndex::isInsideArchive(currentPath))
+    {
+        updateTreeView(QFileInfo(currentPath).path());
+        return;
+    }
+
+    QDir directory(currentPath);
+    if (!currentPath.isEmpty() && directory.cdUp())
+    {
+        updateTreeView(directory.absolutePath());
+    }
+}
+
+/**
+ * \brief Opens the quick-open dialog over the home directory and the directories of all panes.
+ * A chosen directory is shown in the active pane, a chosen file in its parent directory.
+ */
+void MainWindow::openQuickOpen()
+{
+    QStringList roots = { QDir::homePath() };
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
+    {
+        roots << pane->currentPath();
+    }
+
+    QuickOpenDialog *quickOpen = new QuickOpenDialog(roots, this);
+    connect(quickOpen, &QuickOpenDialog::pathChosen, this, [this](const QString &path, bool isDir)
+            {
+                updateTreeView(isDir ? path : QFileInfo(path).absolutePath());
+            });
+    quickOpen->show();
+}
+
+/**
+ * \brief Opens the content search dialog over the directory of the active pane.
+ * An activated match shows its directory in the active pane and opens the file in the viewer.
+ */
+void MainWindow::openContentSearch()
+{
+    const QString root = activePane()->currentPath();
+    if (root.isEmpty())
+    {
+        return;
+    }
+
+    ContentSearchDialog *contentSearch = new ContentSearchDialog(root, jobQueue, this);
+    connect(contentSearch, &ContentSearchDialog::matchActivated, this, [this](const QString &path, int lineNumber)
+            {
+                Q_UNUSED(lineNumber);
+                updateTreeView(QFileInfo(path).absolutePath());
+                openFileViewerDialog(path, false);
+            });
+    contentSearch->show();
+}
+
+/**
+ * \brief Opens the folder comparison of the active pane with the other pane, or with a chosen directory if only
+ * one pane is shown. A requested synchronization runs as file operation jobs.
+ */
+void MainWindow::openDirectoryCompare()
+{
+    const QString left = activePane()->currentPath();
+    QString right = otherPanePath();
+    if (right.isEmpty() || QDir::cleanPath(right) == QDir::cleanPath(left))
+    {
+        right = QFileDialog::getExistingDirectory(this, tr("Compare with"), left);
+    }
+    if (!QFileInfo(left).isDir() || right.isEmpty() || QDir::cleanPath(right) == QDir::cleanPath(left))
+    {
+        return;
+    }
+
+    DirectoryCompareDialog *directoryCompare = new DirectoryCompareDialog(left, right, jobQueue, this);
+    connect(directoryCompare, &DirectoryCompareDialog::syncRequested, this, &MainWindow::runSyncPlan);
+    directoryCompare->show();
+}
+
+/**
+ * \brief Makes the directory of the active pane the root of the content index and brings the index up to date.
+ * Files that did not change since the last indexing are not read again.
+ */
+void MainWindow::buildContentIndex()
+{
+    const QString root = activePane()->currentPath();
+    if (root.isEmpty())
+    {
+        return;
+    }
+
+    ContentIndex::instance().setRootDirectory(root);
+    jobQueue->enqueue(new ContentIndexJob({ root }, true));
+}
+
+/**
+ * \brief Asks for the criteria and the name of a smart folder over the directory of the active pane and opens it.
+ */
+void MainWindow::saveSmartFolder()
+{
+    const QString root = activePane()->currentPath();
+    bool accepted = false;
+    const QString criteria = QInputDialog::getText(this, tr("Save as smart folder"),
+                                                   tr("Files below %1 matching, e.g. *.parquet size>100MB modified<24h:")
+                                                       .arg(QDir::toNativeSeparators(root)),
+                                                   QLineEdit::Normal, QString(), &accepted);
+    if (!accepted)
+    {
+        return;
+    }
+
+    SmartFolderQuery query;
+    QString error;
+    if (!SmartFolderQuery::parse(root, criteria, query, &error))
+    {
+        QMessageBox::warning(this, tr("Save as smart folder"), error);
+        return;
+    }
+
+    const QString name = QInputDialog::getText(this, tr("Save as smart folder"), tr("Name:"), QLineEdit::Normal,
+                                               criteria.isEmpty() ? QFileInfo(root).fileName() : criteria.simplified(), &accepted);
+    if (accepted && SmartFolderIndex::instance().addFolder(name, query))
+    {
+        updateTreeView(SmartFolderIndex::pathForFolder(name.trimmed()));
+    }
+}
+
+/**
+ * \brief Asks for the tags of the selected items, prefilled with the tags of the first one, and applies them to all.
+ */
+void MainWindow::editTagsOfSelectedItems()
+{
+    const QStringList paths = activePane()->listViewManager()->selectedItemPaths();
+    if (paths.isEmpty())
+    {
+        return;
+    }
+
+    bool accepted = false;
+    const QString text = QInputDialog::getText(this, tr("Tags"), tr("Tags, separated by commas:"), QLineEdit::Normal,
+                                               TagStore::instance().tags(paths.first()).join(", "), &accepted);
+    if (!accepted)
+    {
+        return;
+    }
+
+    const QStringList tags = TagStore::parseTags(text);
+    QStringList failedPaths;
+    for (const QString &path : paths)
+    {
+        if (!TagStore::instance().setTags(path, tags))
+        {
+            failedPaths << path;
+        }
+    }
+    reportFailedPaths(tr("Tags"), failedPaths);
+}
+
 /**
  * \brief Opens file view dialog.
  *
@@ -283,7 +1678,7 @@ void MainWindow::openFileViewerDialog(const QString &path, bool isImage)
     }
     else
     {
-        fileViewer->loadTextFile(path);
+        fileViewer->openFile(path);
     }
 
     fileViewer->show();
@@ -302,11 +1697,11 @@ void MainWindow::on_QPushButton_ShowPanel_clicked()
  */
 void MainWindow::on_QPushButton_AddFolder_clicked()
 {
-    QString selectedItemPath = listViewManager.instance().listViewSelectedItemPath(ui->QListView_FileViewer->currentIndex());
+    QString selectedItemPath = activePane()->listViewManager()->listViewSelectedItemPath(activePane()->listView()->currentIndex());
 
     if(selectedItemPath.isEmpty())
     {
-        selectedItemPath = treeViewManager.treeViewSelectedItemPath(ui->QTreeView_MainTree->currentIndex());
+        selectedItemPath = treeViewManager->treeViewSelectedItemPath(ui->QTreeView_MainTree->currentIndex());
 
         if(selectedItemPath.isEmpty())
         {
@@ -316,33 +1711,52 @@ void MainWindow::on_QPushButton_AddFolder_clicked()
 
     FileOperationsDialog *secondaryWindow = new FileOperationsDialog(selectedItemPath, 'c', this);
     connect(secondaryWindow, &FileOperationsDialog::refresh, this, &MainWindow::refresh);
+    connect(secondaryWindow, &FileOperationsDialog::folderCreated, this, [this](const QString &path)
+            {
+                recordInJournal(tr("Create folder"), JournalEntry::CreateFolder, { { QString(), path } });
+            });
 
     secondaryWindow->show();
 }
 
 /**
- * \brief Opens a secondary window for deleting the selected file.
+ * \brief Opens a secondary window for moving the selected file to the trash, or trashes a multi-selection as one background job.
  */
 void MainWindow::on_QPushButton_DeleteFile_clicked()
 {
-    QString selectedItemPath = listViewManager.listViewSelectedItemPath(ui->QListView_FileViewer->currentIndex());
+    if (activePane()->listViewManager()->selectedItemPaths().size() > 1)
+    {
+        deleteSelectedItems();
+        return;
+    }
+
+    QString selectedItemPath = activePane()->listViewManager()->listViewSelectedItemPath(activePane()->listView()->currentIndex());
     if(selectedItemPath.isEmpty())
     {
         return;
     }
 
     FileOperationsDialog *secondaryWindow = new FileOperationsDialog(selectedItemPath, 'd', this);
-    connect(secondaryWindow, &FileOperationsDialog::refresh, this, &MainWindow::refresh);
+    connect(secondaryWindow, &FileOperationsDialog::deleteRequested, this, [this](const QString &path)
+            {
+                startFileOperation(FileOperationJob::trashItems({ path }));
+            });
 
     secondaryWindow->show();
 }
 
 /**
- * \brief Opens a secondary window for renaming the selected file.
+ * \brief Opens a secondary window for renaming the selected file, or renames a multi-selection as one background job.
  */
 void MainWindow::on_QPushButton_RenameFile_clicked()
 {
-    QString selectedItemPath = listViewManager.listViewSelectedItemPath(ui->QListView_FileViewer->currentIndex());
+    if (activePane()->listViewManager()->selectedItemPaths().size() > 1)
+    {
+        renameSelectedItems();
+        return;
+    }
+
+    QString selectedItemPath = activePane()->listViewManager()->listViewSelectedItemPath(activePane()->listView()->currentIndex());
     if(selectedItemPath.isEmpty())
     {
         return;
@@ -350,6 +1764,10 @@ void MainWindow::on_QPushButton_RenameFile_clicked()
 
     FileOperationsDialog *secondaryWindow = new FileOperationsDialog(selectedItemPath, 'r', this);
     connect(secondaryWindow, &FileOperationsDialog::refresh, this, &MainWindow::refresh);
+    connect(secondaryWindow, &FileOperationsDialog::renamed, this, [this](const QString &oldPath, const QString &newPath)
+            {
+                recordInJournal(tr("Rename"), JournalEntry::Move, { { oldPath, newPath } });
+            });
 
     secondaryWindow->show();
 }
@@ -386,9 +1804,9 @@ void MainWindow::on_QPushButton_LightDarkModePushButton_clicked()
 {
     isLightMode = !isLightMode;
 
-    visuals.instance().loadStyleSheet(*ui->centralwidget, *ui->QListView_FileViewer,*ui->QTreeView_MainTree);
-
     updateIcons();
+
+    visuals->applyTheme(*this, themedViews());
 }
 
 /**
@@ -398,24 +1816,42 @@ void MainWindow::on_QPushButton_LayoutPushButton_clicked()
 {
     isGridLayout = !isGridLayout;
 
-    ui->QListView_FileViewer->setItemDelegate(nullptr);
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
+    {
+        applyLayoutToPane(pane);
+    }
+
+    updateIcons();
+}
+
+/**
+ * \brief Applies the current grid or list layout to the list view of a pane.
+ *
+ * \param pane The pane to update.
+ */
+void MainWindow::applyLayoutToPane(FileBrowserPane *pane)
+{
+    QListView *listView = pane->listView();
+    QAbstractItemDelegate *previousDelegate = listView->itemDelegate();
+    ItemNameModifierDelegate* delegate = new ItemNameModifierDelegate(listView);
 
     if (isGridLayout)
     {
-        ui->QListView_FileViewer->setViewMode(QListView::IconMode);
-        ItemNameModifierDelegate* delegate = new ItemNameModifierDelegate(this);
+        listView->setViewMode(QListView::IconMode);
         delegate->setCustomSize(QSize(120, 120));
-        ui->QListView_FileViewer->setItemDelegate(delegate);
     }
     else
     {
-        ui->QListView_FileViewer->setViewMode(QListView::ListMode);
-        ItemNameModifierDelegate* delegate = new ItemNameModifierDelegate(this);
+        listView->setViewMode(QListView::ListMode);
         delegate->setCustomSize(QSize(800, 40));
-        ui->QListView_FileViewer->setItemDelegate(delegate);
     }
 
-    updateIcons();
+    listView->setItemDelegate(delegate);
+    if (previousDelegate && previousDelegate->parent() == listView)
+    {
+        previousDelegate->deleteLater();
+    }
 }
 
 /**
@@ -426,7 +1862,12 @@ void MainWindow::on_QPushButton_HideFilesPushButton_clicked()
     isShowFiles = !isShowFiles;
 
     emit updateHideFilesFilter(isShowFiles);
-    updateTreeView(treeViewManager.treeViewSelectedItemPath(ui->QTreeView_MainTree->currentIndex()));
+
+    const QList<FileBrowserPane*> panes = allPanes();
+    for (FileBrowserPane *pane : panes)
+    {
+        pane->refresh();
+    }
 
     updateIcons();
 }
@@ -437,12 +1878,12 @@ void MainWindow::on_QPushButton_HideFilesPushButton_clicked()
 void MainWindow::updateIcons()
 {
     emit updateLightModeBooleanData(isLightMode,isGridLayout, isShowFiles);
-    visuals.instance().updateIconsToMode(*ui->QPushButton_CopyButton
-                                         ,*ui->QPushButton_DirectoryButton
-                                         ,*ui->QPushButton_RenameFile
-                                         ,*ui->QPushButton_DeleteFile
-                                         ,*ui->QPushButton_AddFolder
-                                         ,*ui->QPushButton_LightDarkModePushButton
-                                         ,*ui->QPushButton_LayoutPushButton
-                                         ,*ui->QPushButton_HideFilesPushButton);
+    visuals->updateIconsToMode(*ui->QPushButton_CopyButton
+                               ,*ui->QPushButton_DirectoryButton
+                               ,*ui->QPushButton_RenameFile
+                               ,*ui->QPushButton_DeleteFile
+                               ,*ui->QPushButton_AddFolder
+                               ,*ui->QPushButton_LightDarkModePushButton
+                               ,*ui->QPushButton_LayoutPushButton
+                               ,*ui->QPushButton_HideFilesPushButton);
 }
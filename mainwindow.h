@@ -1,13 +1,24 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
-#include "listviewmanager.h"
+#include "filebrowserpane.h"
 #include "treeviewmanager.h"
 #include "visualmodeupdater.h"
+#include "jobqueue.h"
+#include "fileoperationjob.h"
+#include "checksumjob.h"
+#include "directorycomparejob.h"
+#include "operationjournal.h"
+#include "previewpane.h"
+#include "virtualfoldertree.h"
 #include <QMainWindow>
 #include <QSplitter>
 #include <QFileSystemModel>
 #include <QListView>
+#include <QTabWidget>
+#include <QProgressBar>
+#include <QLabel>
+#include <QDockWidget>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -23,13 +34,43 @@ public:
 
 private:
     Ui::MainWindow *ui;
-    ListViewManager& listViewManager;
-    TreeViewManager& treeViewManager;
-    VisualModeUpdater& visuals;
+    TreeViewManager *treeViewManager;
+    VisualModeUpdater *visuals;
     QSplitter *splitter;
+    QSplitter *paneSplitter;
+    QTabWidget *paneTabs[2];
+    FileBrowserPane *currentPane = nullptr;
+    QPushButton *backButton = nullptr;
+    QPushButton *forwardButton = nullptr;
+    QPushButton *upButton = nullptr;
+    QPushButton *dualPaneButton = nullptr;
+    JobQueue *jobQueue;
+    QLabel *jobLabel;
+    QProgressBar *jobProgressBar;
+    QPushButton *jobCancelButton;
+    PreviewPane *previewPane;
+    QDockWidget *previewDock;
+    VirtualFolderTree *virtualFolderTree;
+    QHash<BackgroundJob*, QList<QPair<QString, QString>>> pendingSyncCopies;
+
+    struct JournalReplay
+    {
+        quint32 batchId = 0;
+        bool isUndo = true;
+        QSet<BackgroundJob*> runningJobs;
+        bool succeeded = true;
+    };
+    JournalReplay journalReplay;
+    QList<QPair<QString, QList<JournalEntry>>> deferredCommits;
 
     void initializeMainWindow();
+    void initializePanes();
+    void initializeNavigationButtons();
+    void initializeJobQueue();
+    void initializePreviewPane();
+    void finishStartup();
     void resizeEvent(QResizeEvent *event);
+    void paintEvent(QPaintEvent *event);
     void closeEvent(QCloseEvent *event);
     QSplitter* splitterLeftAndRightPanels();
     bool loadLayout();
@@ -37,12 +78,57 @@ private:
     bool isLightMode = true;
     bool isShowFiles = true;
     bool isGridLayout = true;
+    bool isFirstFramePainted = false;
     void updateIcons();
+    void createChecksumsOfSelectedItems(ChecksumJob::Algorithm algorithm);
+
+    FileBrowserPane* activePane() const;
+    QList<FileBrowserPane*> allPanes() const;
+    QList<QAbstractItemView*> themedViews() const;
+    FileBrowserPane* addPane(QTabWidget *tabWidget, const QString &path);
+    void applyLayoutToPane(FileBrowserPane *pane);
+    void relayoutPanes();
+    void updateNavigationButtons();
+    QString otherPanePath() const;
+    void startFileOperation(FileOperationJob *job);
+    void runSyncPlan(const SyncPlan &plan);
+    void startSyncCopies(const QList<QPair<QString, QString>> &copies);
+    void runJournalJob(FileOperationJob::Operation operation, const QList<QPair<QString, QString>> &items);
+    void finishFolderReplay(const QString &title, const QStringList &failedFolders);
+    void finishJournalReplay();
+    void recordInJournal(const QString &title, JournalEntry::Kind kind, const QList<QPair<QString, QString>> &items);
+    void applyFileChanges(const QSet<QString> &removedPaths, const QHash<QString, bool> &addedPaths);
+    void reportFailedPaths(const QString &title, const QStringList &failedPaths);
+    void reportChecksumMismatches(const QString &title, const ChecksumJob *job);
+    void updatePreview();
 
 public slots:
     void updateTreeView(const QString& path);
     void openFileViewerDialog(const QString &path, bool isImage);
     void refresh();
+    void navigateBack();
+    void navigateForward();
+    void navigateUp();
+    void navigateToTypedPath();
+    void addTab();
+    void closeCurrentTab();
+    void toggleDualPane();
+    void deleteSelectedItems();
+    void deleteSelectedItemsPermanently();
+    void undoLastOperation();
+    void redoLastOperation();
+    void renameSelectedItems();
+    void copySelectedItems();
+    void moveSelectedItems();
+    void compressSelectedItems();
+    void extractSelectedArchive();
+    void verifySelectedChecksums();
+    void openQuickOpen();
+    void openContentSearch();
+    void openDirectoryCompare();
+    void buildContentIndex();
+    void editTagsOfSelectedItems();
+    void saveSmartFolder();
 
 private slots:
     void on_QPushButton_AddFolder_clicked();
@@ -56,10 +142,14 @@ private slots:
     void on_QPushButton_HideFilesPushButton_clicked();
 
     void handleSplitterMoved(int pos, int index);
+    void onPaneActivated(FileBrowserPane *pane);
+    void onPanePathChanged(FileBrowserPane *pane, const QString &path);
+    void showListViewContextMenu(const QPoint &globalPos);
+    void onJobProgress(BackgroundJob *job, qint64 done, qint64 total);
+    void onJobFinished(BackgroundJob *job);
 
 signals:
     void populateTreeView(const QString &path);
-    void populateListView(const QString &path);
     void updateHideFilesFilter(bool isVisible);
     void updateLightModeBooleanData(bool isLight,bool isShowGrid,bool isShowFiles);
 
@@ -0,0 +1,352 @@
+#include "metadataindex.h"
+#include <QDir>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <cstring>
+
+/**
+ * @file metadataindex.h
+ * @brief The MetadataIndex class persists the listings of recently browsed directories (names and types) between
+ * runs, so the last directory can be shown before it is listed again. Sizes and times are not kept; the model reads
+ * them in the background like for any fresh listing.
+ * The index is a compact little-endian binary file that is memory-mapped on startup; only the directory headers
+ * are scanned when it is opened, and a listing is decoded from the mapping when it is looked up.
+ * New listings are kept in memory and written together with the retained ones by save().
+ */
+
+namespace
+{
+const char indexMagic[4] = { 'F', 'X', 'M', 'I' };
+const quint32 indexVersion = 2;
+const qint64 headerSize = 16;
+const qint64 recordHeaderSize = 4 + 4 + 8 + 8 + 2;
+const qint64 entryHeaderSize = 1 + 2;
+const int maxIndexedDirectories = 256;
+const qsizetype maxIndexedEntries = 1000000;
+const quint8 directoryFlag = 0x01;
+
+class RecordReader
+{
+public:
+    RecordReader(const uchar *data, qint64 size, qint64 position) : data(data), size(size), position(position) {}
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (position + qint64(sizeof(T)) > size)
+        {
+            return false;
+        }
+
+        value = qFromLittleEndian<T>(data + position);
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readString(quint16 length, QString &value)
+    {
+        if (position + length > size)
+        {
+            return false;
+        }
+
+        value = QString::fromUtf8(reinterpret_cast<const char*>(data + position), length);
+        position += length;
+        return true;
+    }
+
+private:
+    const uchar *data;
+    qint64 size;
+    qint64 position;
+};
+
+template <typename T>
+void appendValue(QByteArray &buffer, T value)
+{
+    const T littleEndian = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char*>(&littleEndian), sizeof(T));
+}
+}
+
+MetadataIndex::MetadataIndex()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    indexFile.setFileName(directory + "/metadata.idx");
+
+    open();
+}
+
+MetadataIndex::~MetadataIndex()
+{
+    close();
+}
+
+MetadataIndex& MetadataIndex::instance()
+{
+    static MetadataIndex instance;
+    return instance;
+}
+
+/**
+ * @brief Returns the indexed listing of a directory, as it was when it was last recorded.
+ *
+ * @param path The directory path.
+ * @param listing Receives the sorted listing.
+ * @param stamp Receives the stamp of the directory at the time it was recorded.
+ * @return True if the directory is in the index.
+ */
+bool MetadataIndex::lookup(const QString &path, DirectoryListing &listing, DirectoryStamp &stamp)
+{
+    const QString key = QDir::cleanPath(path);
+
+    IndexedDirectory directory;
+    const auto pending = pendingDirectories.constFind(key);
+    if (pending != pendingDirectories.constEnd())
+    {
+        directory = *pending;
+    }
+    else
+    {
+        const auto offset = recordOffsets.constFind(key);
+        if (offset == recordOffsets.constEnd() || !readRecord(*offset, directory))
+        {
+            return false;
+        }
+    }
+
+    touch(key);
+    listing = directory.listing;
+    stamp = directory.stamp;
+    return true;
+}
+
+/**
+ * @brief Records a freshly read listing. It is written to disk by the next save().
+ *
+ * @param path The directory path.
+ * @param stamp The stamp the listing was read with.
+ * @param listing The sorted listing.
+ */
+void MetadataIndex::record(const QString &path, const DirectoryStamp &stamp, const DirectoryListing &listing)
+{
+    if (!stamp.isValid())
+    {
+        return;
+    }
+
+    const QString key = QDir::cleanPath(path);
+    pendingDirectories.insert(key, { stamp, listing });
+    touch(key);
+}
+
+/**
+ * @brief Writes the most recently used directories to disk and maps the new file.
+ */
+void MetadataIndex::save()
+{
+    if (pendingDirectories.isEmpty())
+    {
+        return;
+    }
+
+    QByteArray buffer;
+    buffer.append(indexMagic, sizeof(indexMagic));
+    appendValue<quint32>(buffer, indexVersion);
+    appendValue<quint32>(buffer, 0);
+    appendValue<quint32>(buffer, 0);
+
+    quint32 directoryCount = 0;
+    qsizetype entryCount = 0;
+
+    for (const QString &path : std::as_const(recentPaths))
+    {
+        if (directoryCount == maxIndexedDirectories)
+        {
+            break;
+        }
+
+        IndexedDirectory directory;
+        const auto pending = pendingDirectories.constFind(path);
+        if (pending != pendingDirectories.constEnd())
+        {
+            directory = *pending;
+        }
+        else if (!recordOffsets.contains(path) || !readRecord(recordOffsets.value(path), directory))
+        {
+            continue;
+        }
+
+        if (entryCount + directory.listing.size() > maxIndexedEntries)
+        {
+            continue;
+        }
+
+        const qsizetype recordStart = buffer.size();
+        const QByteArray pathBytes = path.toUtf8().left(0xFFFF);
+
+        appendValue<quint32>(buffer, 0);
+        appendValue<quint32>(buffer, quint32(directory.listing.size()));
+        appendValue<qint64>(buffer, directory.stamp.modifiedNs);
+        appendValue<quint64>(buffer, directory.stamp.inode);
+        appendValue<quint16>(buffer, quint16(pathBytes.size()));
+        buffer.append(pathBytes);
+
+        for (const DirectoryEntry &entry : std::as_const(directory.listing))
+        {
+            const QByteArray nameBytes = entry.name.toUtf8().left(0xFFFF);
+            appendValue<quint8>(buffer, entry.isDir ? directoryFlag : 0);
+            appendValue<quint16>(buffer, quint16(nameBytes.size()));
+            buffer.append(nameBytes);
+        }
+
+        qToLittleEndian<quint32>(quint32(buffer.size() - recordStart), buffer.data() + recordStart);
+        entryCount += directory.listing.size();
+        ++directoryCount;
+    }
+
+    qToLittleEndian<quint32>(directoryCount, buffer.data() + 8);
+
+    close();
+
+    QSaveFile file(indexFile.fileName());
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(buffer);
+        file.commit();
+    }
+
+    pendingDirectories.clear();
+    open();
+}
+
+/**
+ * @brief Maps the index file and collects the offsets of its directory records.
+ */
+void MetadataIndex::open()
+{
+    recordOffsets.clear();
+    recentPaths.clear();
+
+    if (!indexFile.open(QIODevice::ReadOnly) || indexFile.size() < headerSize)
+    {
+        close();
+        return;
+    }
+
+    mappedSize = indexFile.size();
+    mappedData = indexFile.map(0, mappedSize);
+    if (mappedData == nullptr || std::memcmp(mappedData, indexMagic, sizeof(indexMagic)) != 0
+        || qFromLittleEndian<quint32>(mappedData + 4) != indexVersion)
+    {
+        close();
+        return;
+    }
+
+    const quint32 directoryCount = qFromLittleEndian<quint32>(mappedData + 8);
+    qint64 offset = headerSize;
+
+    for (quint32 i = 0; i < directoryCount; ++i)
+    {
+        RecordReader reader(mappedData, mappedSize, offset);
+        quint32 recordSize = 0;
+        quint32 entryCount = 0;
+        qint64 modifiedNs = 0;
+        quint64 inode = 0;
+        quint16 pathLength = 0;
+        QString path;
+
+        if (!reader.read(recordSize) || recordSize < recordHeaderSize || offset + recordSize > mappedSize
+            || !reader.read(entryCount) || !reader.read(modifiedNs) || !reader.read(inode)
+            || !reader.read(pathLength) || !reader.readString(pathLength, path))
+        {
+            break;
+        }
+
+        recordOffsets.insert(path, offset);
+        recentPaths << path;
+        offset += recordSize;
+    }
+}
+
+/**
+ * @brief Unmaps and closes the index file.
+ */
+void MetadataIndex::close()
+{
+    if (mappedData != nullptr)
+    {
+        indexFile.unmap(const_cast<uchar*>(mappedData));
+        mappedData = nullptr;
+    }
+
+    mappedSize = 0;
+    recordOffsets.clear();
+    indexFile.close();
+}
+
+/**
+ * @brief Moves the path to the front of the most recently used list.
+ */
+void MetadataIndex::touch(const QString &path)
+{
+    if (!recentPaths.isEmpty() && recentPaths.first() == path)
+    {
+        return;
+    }
+
+    recentPaths.removeOne(path);
+    recentPaths.prepend(path);
+
+    if (recentPaths.size() > 4 * maxIndexedDirectories)
+    {
+        recentPaths.resize(4 * maxIndexedDirectories);
+    }
+}
+
+/**
+ * @brief Decodes one directory record from the mapped file.
+ */
+bool MetadataIndex::readRecord(qint64 offset, IndexedDirectory &directory) const
+{
+    if (mappedData == nullptr)
+    {
+        return false;
+    }
+
+    RecordReader reader(mappedData, mappedSize, offset);
+    quint32 recordSize = 0;
+    quint32 entryCount = 0;
+    quint16 pathLength = 0;
+    QString path;
+
+    if (!reader.read(recordSize) || !reader.read(entryCount) || !reader.read(directory.stamp.modifiedNs)
+        || !reader.read(directory.stamp.inode) || !reader.read(pathLength) || !reader.readString(pathLength, path)
+        || entryCount > recordSize / entryHeaderSize)
+    {
+        return false;
+    }
+
+    RecordReader entryReader(mappedData, offset + recordSize, offset + recordHeaderSize + pathLength);
+    directory.listing.clear();
+    directory.listing.reserve(entryCount);
+
+    for (quint32 i = 0; i < entryCount; ++i)
+    {
+        quint8 flags = 0;
+        quint16 nameLength = 0;
+        DirectoryEntry entry;
+
+        if (!entryReader.read(flags) || !entryReader.read(nameLength) || !entryReader.readString(nameLength, entry.name))
+        {
+            return false;
+        }
+
+        entry.isDir = flags & directoryFlag;
+        directory.listing.append(entry);
+    }
+
+    return true;
+}
@@ -0,0 +1,41 @@
+#ifndef METADATAINDEX_H
+#define METADATAINDEX_H
+
+#include "directorylistingcache.h"
+#include <QFile>
+#include <QHash>
+#include <QStringList>
+
+class MetadataIndex
+{
+public:
+    static MetadataIndex& instance();
+
+    bool lookup(const QString &path, DirectoryListing &listing, DirectoryStamp &stamp);
+    void record(const QString &path, const DirectoryStamp &stamp, const DirectoryListing &listing);
+    void save();
+
+private:
+    MetadataIndex();
+    ~MetadataIndex();
+
+    struct IndexedDirectory
+    {
+        DirectoryStamp stamp;
+        DirectoryListing listing;
+    };
+
+    QFile indexFile;
+    const uchar *mappedData = nullptr;
+    qint64 mappedSize = 0;
+    QHash<QString, qint64> recordOffsets;
+    QHash<QString, IndexedDirectory> pendingDirectories;
+    QStringList recentPaths;
+
+    void open();
+    void close();
+    void touch(const QString &path);
+    bool readRecord(qint64 offset, IndexedDirectory &directory) const;
+};
+
+#endif // METADATAINDEX_H
@@ -1,73 +1,444 @@
 #include "modifiedfilesystemmodel.h"
+#include "fileiconcache.h"
+#include "metadataindex.h"
+#include "archiveindex.h"
+#include "filestatusreader.h"
+#include "tagstore.h"
+#include "smartfolderindex.h"
+#include <QDateTime>
 #include <QDir>
-#include <QFileIconProvider>
+#include <algorithm>
 
 /**
  * @file modifiedfilesystemmodel.h
  * \brief The ModifiedFileSystemModel class represents a custom model for file data representation in a QListView.
  * This model inherits from QAbstractListModel and manages file data to be displayed in the QListView.
+ * Listings only carry names and types. Size, modification time, permissions, owner and inode are read on a worker
+ * thread in batches the first time a view asks for them: the rows that were asked for first, then the rest of the
+ * directory. Finished batches are announced with one dataChanged per contiguous run of rows.
+ * Tag queries such as "tag:A and tag:B" and smart folders are shown as virtual folders: their entries are named by
+ * their full path and the listing follows the TagStore or SmartFolderIndex, applied as row insertions and removals.
  */
-ModifiedFileSystemModel::ModifiedFileSystemModel(QObject *parent) : QAbstractListModel(parent) {}
+
+namespace
+{
+const int statusBatchSize = 256;
+
+bool isVirtualPath(const QString &path)
+{
+    return TagStore::isQueryPath(path) || SmartFolderIndex::isSmartFolderPath(path);
+}
+
+void readVirtualListing(const QString &path, DirectoryListing &listing)
+{
+    if (SmartFolderIndex::isSmartFolderPath(path))
+    {
+        SmartFolderIndex::instance().listing(path, listing);
+    }
+    else
+    {
+        TagStore::instance().query(path, listing);
+    }
+}
+}
+
+ModifiedFileSystemModel::ModifiedFileSystemModel(QObject *parent) : QAbstractListModel(parent)
+{
+    statusPool.setMaxThreadCount(1);
+    statusTimer.setSingleShot(true);
+    statusTimer.setInterval(0);
+    connect(&statusTimer, &QTimer::timeout, this, &ModifiedFileSystemModel::startStatusBatch);
+    connect(&TagStore::instance(), &TagStore::tagsChanged, this, &ModifiedFileSystemModel::reloadVirtualListing);
+    connect(&SmartFolderIndex::instance(), &SmartFolderIndex::resultsChanged, this, [this](const QString &path)
+            {
+                if (path == directoryPath)
+                {
+                    reloadVirtualListing();
+                }
+            });
+}
+
+ModifiedFileSystemModel::~ModifiedFileSystemModel()
+{
+    statusPool.waitForDone();
+}
 
 /**
  * \brief Sets file data from the specified directory path to the model.
+ * The listing is served by DirectoryListingCache, so revisiting a directory does not read it again.
+ * A directory that is not cached yet but was browsed in an earlier run is shown from the MetadataIndex
+ * without listing it; the caller is expected to revalidate() it in the background then.
+ * Paths inside an archive are listed from the ArchiveIndex, tag queries and smart folders from their indexes.
+ * An archive that is not cached yet is shown empty; the caller is expected to revalidate() it once a worker
+ * read it.
  *
  * \param path The directory path containing file data.
+ * \return True if the data came from the index, or the archive is still unread, and has to be revalidated.
  */
-void ModifiedFileSystemModel::setFileData(const QString &path)
+bool ModifiedFileSystemModel::setFileData(const QString &path)
 {
+    DirectoryListing listing;
+    bool provisional = false;
+    const bool isVirtual = isVirtualPath(path);
+    const bool isInArchive = !isVirtual && ArchiveIndex::isInsideArchive(path);
+
+    if (isVirtual)
+    {
+        directoryStamp = DirectoryStamp();
+        readVirtualListing(path, listing);
+    }
+    else if (isInArchive)
+    {
+        directoryStamp = DirectoryStamp();
+        if (ArchiveIndex::instance().isCached(path))
+        {
+            ArchiveIndex::instance().listing(path, listing);
+            // Members carry their size and time in the archive; there is nothing to stat.
+            for (DirectoryEntry &entry : listing)
+            {
+                entry.hasStatus = true;
+            }
+        }
+        else
+        {
+            provisional = true;
+        }
+    }
+    else if (!DirectoryListingCache::instance().lookup(path, listing, &directoryStamp))
+    {
+        DirectoryStamp indexedStamp;
+        if (MetadataIndex::instance().lookup(path, listing, indexedStamp))
+        {
+            provisional = true;
+        }
+        else
+        {
+            listing = DirectoryListingCache::instance().listing(path, &directoryStamp);
+            MetadataIndex::instance().record(path, directoryStamp, listing);
+        }
+    }
+
     beginResetModel();
 
-    QDir directory(path);
-    QFileInfoList fileInfoList;
+    directoryPath = path;
+    isVirtualListing = isVirtual;
+    isArchiveListing = isInArchive;
+    directoryPrefix = isVirtual ? QString() : QDir(path).path();
+    if (!isVirtual && !directoryPrefix.endsWith('/'))
+    {
+        directoryPrefix += '/';
+    }
+
+    fileData.clear();
+    fileData.reserve(listing.size());
+    resetStatus();
 
-    if (acceptsDirectories)
+    for (const DirectoryEntry &entry : std::as_const(listing))
     {
-        fileInfoList = sortFilesInsideModel(directory.entryInfoList(QDir::AllEntries | QDir::NoDotAndDotDot));
+        if (acceptsDirectories || !entry.isDir)
+        {
+            fileData.append(entry);
+        }
     }
-    else
+
+    endResetModel();
+    return provisional;
+}
+
+/**
+ * \brief Brings the model in line with the directory on disk, e.g. after it was shown from the index.
+ * Differences are applied as row removals and insertions, so the view keeps its scroll position. The other rows
+ * keep the metadata read before; it is read again in the background and only rows that changed are announced.
+ * Safe to call on the GUI thread once DirectoryListingCache holds a fresh listing, which then costs a single stat.
+ * A directory inside an archive is listed again once the ArchiveIndex holds the archive.
+ */
+void ModifiedFileSystemModel::revalidate()
+{
+    if (isArchiveListing)
     {
-        fileInfoList = sortFilesInsideModel(fileInfoList = directory.entryInfoList(QDir::Files));
+        setFileData(directoryPath);
+        return;
     }
 
-    fileData.clear();
+    if (directoryPath.isEmpty() || isVirtualListing)
+    {
+        return;
+    }
+
+    DirectoryStamp stamp;
+    const DirectoryListing listing = DirectoryListingCache::instance().listing(directoryPath, &stamp);
+    MetadataIndex::instance().record(directoryPath, stamp, listing);
 
-    for (const QFileInfo &fileInfo : fileInfoList)
+    QHash<QString, bool> shownEntries;
+    shownEntries.reserve(fileData.size());
+    for (const DirectoryEntry &entry : std::as_const(fileData))
     {
-        fileData.append(fileInfo);
+        shownEntries.insert(entry.name, entry.isDir);
+    }
+
+    QSet<QString> removedPaths;
+    QHash<QString, bool> addedPaths;
+    QSet<QString> currentNames;
+    currentNames.reserve(listing.size());
+
+    for (const DirectoryEntry &entry : listing)
+    {
+        if (!acceptsDirectories && entry.isDir)
+        {
+            continue;
+        }
+
+        currentNames.insert(entry.name);
+        const auto shown = shownEntries.constFind(entry.name);
+        if (shown == shownEntries.constEnd() || *shown != entry.isDir)
+        {
+            addedPaths.insert(directoryPrefix + entry.name, entry.isDir);
+            if (shown != shownEntries.constEnd())
+            {
+                removedPaths.insert(directoryPrefix + entry.name);
+            }
+        }
+    }
+
+    for (const DirectoryEntry &entry : std::as_const(fileData))
+    {
+        if (!currentNames.contains(entry.name))
+        {
+            removedPaths.insert(directoryPrefix + entry.name);
+        }
+    }
+
+    if (!removedPaths.isEmpty() || !addedPaths.isEmpty())
+    {
+        applyChanges(removedPaths, addedPaths);
+    }
+
+    // Files edited in place keep their name, so the rows with metadata are read again as well.
+    sweepRow = 0;
+    recheckRow = 0;
+    hasStatusRequests = true;
+    if (!isStatusBatchRunning && !statusTimer.isActive())
+    {
+        statusTimer.start();
+    }
+
+    directoryStamp = stamp;
+}
+
+/**
+ * \brief Captures the current model data so it can be restored later without listing the directory again.
+ *
+ * \return The snapshot of the model data.
+ */
+ModelSnapshot ModifiedFileSystemModel::snapshot() const
+{
+    ModelSnapshot snapshot;
+    snapshot.directoryPath = directoryPath;
+    snapshot.stamp = directoryStamp;
+    snapshot.fileData = fileData;
+    snapshot.acceptsDirectories = acceptsDirectories;
+    return snapshot;
+}
+
+/**
+ * \brief Restores model data from a snapshot if the directory did not change on disk in the meantime.
+ *
+ * \param snapshot The snapshot captured by snapshot().
+ * \return True if the snapshot was still valid and has been restored.
+ */
+bool ModifiedFileSystemModel::restoreSnapshot(const ModelSnapshot &snapshot)
+{
+    if (snapshot.directoryPath.isEmpty() || snapshot.acceptsDirectories != acceptsDirectories)
+    {
+        return false;
+    }
+
+    const DirectoryStamp stamp = DirectoryListingCache::stampForPath(snapshot.directoryPath);
+    if (!stamp.isValid() || stamp != snapshot.stamp)
+    {
+        return false;
+    }
+
+    beginResetModel();
+
+    directoryPath = snapshot.directoryPath;
+    isVirtualListing = false;
+    isArchiveListing = ArchiveIndex::isInsideArchive(directoryPath);
+    directoryPrefix = QDir(directoryPath).path();
+    if (!directoryPrefix.endsWith('/'))
+    {
+        directoryPrefix += '/';
+    }
+    directoryStamp = snapshot.stamp;
+    fileData = snapshot.fileData;
+
+    // Files may have changed without touching the directory, so their metadata is read again.
+    resetStatus();
+    for (DirectoryEntry &entry : fileData)
+    {
+        entry.hasStatus = entry.hasStatus && isArchiveListing;
     }
 
     endResetModel();
+    return true;
 }
 
 /**
- * @brief Sorts the given list of QFileInfo objects.
- * Directories are prioritized first, followed by files sorted by name in a case-insensitive manner.
+ * \brief Applies the result of a file operation to the model without listing the directory again.
+ * Removed rows are taken out in contiguous runs and added entries are merged into their sorted position,
+ * so the view keeps its scroll position and selection instead of being reset.
  *
- * @param fileInfoList The list of QFileInfo objects to be sorted.
- * @return The sorted QFileInfoList.
+ * \param removedPaths Full paths that no longer exist.
+ * \param addedPaths Full paths that were created, mapped to whether they are directories.
+ */
+void ModifiedFileSystemModel::applyChanges(const QSet<QString> &removedPaths, const QHash<QString, bool> &addedPaths)
+{
+    if (directoryPath.isEmpty())
+    {
+        return;
+    }
+
+    // A virtual folder lists full paths; removed files drop out, new ones only show up once its index lists them.
+    auto isInDirectory = [this](const QString &path)
+    {
+        return isVirtualListing || (path.startsWith(directoryPrefix) && path.indexOf('/', directoryPrefix.size()) < 0);
+    };
+
+    QSet<QString> removedNames;
+    for (const QString &path : removedPaths)
+    {
+        if (isInDirectory(path))
+        {
+            removedNames.insert(path.mid(directoryPrefix.size()));
+        }
+    }
+    removeEntries(removedNames);
+
+    DirectoryListing additions;
+    for (auto it = addedPaths.cbegin(); it != addedPaths.cend(); ++it)
+    {
+        if (!isVirtualListing && isInDirectory(it.key()) && (acceptsDirectories || !it.value()))
+        {
+            DirectoryEntry entry;
+            entry.name = it.key().mid(directoryPrefix.size());
+            entry.isDir = it.value();
+            additions.append(entry);
+        }
+    }
+    insertEntries(additions);
+
+    if (!isVirtualListing)
+    {
+        directoryStamp = DirectoryListingCache::stampForPath(directoryPath);
+    }
+}
+
+/**
+ * \brief Removes the entries with the given names, in contiguous runs of rows.
  */
-QFileInfoList ModifiedFileSystemModel::sortFilesInsideModel(const QFileInfoList &fileInfoList)
+void ModifiedFileSystemModel::removeEntries(const QSet<QString> &names)
 {
-    QFileInfoList sortedList = fileInfoList;
+    int row = fileData.size() - 1;
+    while (row >= 0 && !names.isEmpty())
+    {
+        if (!names.contains(fileData.at(row).name))
+        {
+            --row;
+            continue;
+        }
+
+        int first = row;
+        while (first > 0 && names.contains(fileData.at(first - 1).name))
+        {
+            --first;
+        }
+
+        beginRemoveRows(QModelIndex(), first, row);
+        fileData.remove(first, row - first + 1);
+        endRemoveRows();
+        row = first - 1;
+    }
+}
+
+/**
+ * \brief Merges new entries into their sorted position, inserting runs that land between the same rows together.
+ */
+void ModifiedFileSystemModel::insertEntries(DirectoryListing additions)
+{
+    std::sort(additions.begin(), additions.end(), DirectoryListingCache::entryLessThan);
+
+    int index = 0;
+    while (index < additions.size())
+    {
+        const int position = int(std::lower_bound(fileData.cbegin(), fileData.cend(), additions.at(index), DirectoryListingCache::entryLessThan) - fileData.cbegin());
+
+        int last = index + 1;
+        while (last < additions.size() && (position == fileData.size() || DirectoryListingCache::entryLessThan(additions.at(last), fileData.at(position))))
+        {
+            ++last;
+        }
+
+        beginInsertRows(QModelIndex(), position, position + last - index - 1);
+        for (int i = index; i < last; ++i)
+        {
+            fileData.insert(position + i - index, additions.at(i));
+        }
+        endInsertRows();
+        index = last;
+    }
+}
+
+/**
+ * \brief Brings a shown virtual folder in line with its index after tags or smart folder results changed.
+ */
+void ModifiedFileSystemModel::reloadVirtualListing()
+{
+    if (!isVirtualListing)
+    {
+        return;
+    }
+
+    DirectoryListing listing;
+    readVirtualListing(directoryPath, listing);
 
-    std::sort(sortedList.begin(), sortedList.end(), [](const QFileInfo &a, const QFileInfo &b)
-              {
-                  if (a.isDir() && !b.isDir())
-                  {
-                      return true;
-                  }
-                  else if (!a.isDir() && b.isDir())
-                  {
-                      return false;
-                  }
-                  else
-                  {
-                      return QString::compare(a.fileName(), b.fileName(), Qt::CaseInsensitive) < 0;
-                  }
-              });
+    QSet<QString> currentNames;
+    currentNames.reserve(listing.size());
+    for (const DirectoryEntry &entry : std::as_const(listing))
+    {
+        currentNames.insert(entry.name);
+    }
+
+    QSet<QString> removedNames;
+    QSet<QString> shownNames;
+    shownNames.reserve(fileData.size());
+    for (const DirectoryEntry &entry : std::as_const(fileData))
+    {
+        shownNames.insert(entry.name);
+        if (!currentNames.contains(entry.name))
+        {
+            removedNames.insert(entry.name);
+        }
+    }
 
-    return sortedList;
+    DirectoryListing additions;
+    for (const DirectoryEntry &entry : std::as_const(listing))
+    {
+        if (!shownNames.contains(entry.name) && (acceptsDirectories || !entry.isDir))
+        {
+            additions.append(entry);
+        }
+    }
+
+    removeEntries(removedNames);
+    insertEntries(additions);
+}
+
+/**
+ * \brief Returns the directory currently shown by the model.
+ */
+QString ModifiedFileSystemModel::currentDirectory() const
+{
+    return directoryPath;
 }
 
 /**
@@ -87,7 +458,7 @@ int ModifiedFileSystemModel::rowCount(const QModelIndex &parent) const
  * \brief Returns the data to be displayed at a specified model index and role.
  *
  * \param index The model index.
- * \param role The requested role (DisplayRole or DecorationRole).
+ * \param role The requested role: DisplayRole, DecorationRole or one of the metadata roles, which are empty until read.
  * \return QVariant The data associated with the specified index and role.
  */
 QVariant ModifiedFileSystemModel::data(const QModelIndex &index, int role) const
@@ -97,26 +468,201 @@ QVariant ModifiedFileSystemModel::data(const QModelIndex &index, int role) const
         return QVariant();
     }
 
-    const QFileInfo &fileInfo = fileData.at(index.row());
+    const DirectoryEntry &entry = fileData.at(index.row());
 
     if (role == Qt::DisplayRole)
     {
-        return fileInfo.fileName();
+        return isVirtualListing ? entry.name.mid(entry.name.lastIndexOf('/') + 1) : entry.name;
+    }
+    else if (role == Qt::ToolTipRole && isVirtualListing)
+    {
+        return entry.name;
     }
     else if (role == Qt::DecorationRole)
     {
-        QFileIconProvider iconProvider;
-        QIcon icon = iconProvider.icon(fileInfo);
-        return icon;
+        return FileIconCache::instance().icon(directoryPrefix + entry.name, entry.isDir);
     }
     else if (role == Qt::ItemIsEditable)
     {
         return isItemEditable(index.row());
     }
+    else if (role >= SizeRole && role <= InodeRole)
+    {
+        if (!entry.hasStatus)
+        {
+            requestStatus(index.row());
+            return QVariant();
+        }
+
+        switch (role)
+        {
+        case SizeRole:
+            return entry.isDir ? QVariant() : QVariant(entry.size);
+        case ModifiedRole:
+            return entry.modifiedMs > 0 ? QDateTime::fromMSecsSinceEpoch(entry.modifiedMs) : QVariant();
+        case PermissionsRole:
+            return entry.mode != 0 ? FileStatusReader::permissionsText(entry.mode, entry.isDir) : QVariant();
+        case OwnerRole:
+            return entry.mode != 0 ? FileStatusReader::ownerName(entry.ownerId) : QVariant();
+        default:
+            return entry.inode != 0 ? QVariant(entry.inode) : QVariant();
+        }
+    }
 
     return QVariant();
 }
 
+/**
+ * \brief Queues the row for the next metadata batch. Called from data(), so the rows a view paints are read first.
+ */
+void ModifiedFileSystemModel::requestStatus(int row) const
+{
+    if (isArchiveListing)
+    {
+        return;
+    }
+
+    requestedRows.insert(row);
+    hasStatusRequests = true;
+    if (!isStatusBatchRunning && !statusTimer.isActive())
+    {
+        statusTimer.start();
+    }
+}
+
+/**
+ * \brief Forgets requested rows and drops the running batch, e.g. because the rows were replaced.
+ */
+void ModifiedFileSystemModel::resetStatus()
+{
+    ++statusGeneration;
+    requestedRows.clear();
+    hasStatusRequests = false;
+    sweepRow = 0;
+    recheckRow = -1;
+    statusTimer.stop();
+}
+
+/**
+ * \brief Reads the next batch of metadata on the worker thread: the requested rows if there are any, otherwise
+ * the next rows without metadata, and after a revalidation the rows whose metadata may be outdated. Only one batch
+ * runs at a time; the next one starts when it is applied.
+ */
+void ModifiedFileSystemModel::startStatusBatch()
+{
+    if (isStatusBatchRunning || !hasStatusRequests)
+    {
+        return;
+    }
+
+    DirectoryListing batch;
+    for (auto it = requestedRows.begin(); it != requestedRows.end() && batch.size() < statusBatchSize;)
+    {
+        if (*it < fileData.size() && !fileData.at(*it).hasStatus)
+        {
+            batch.append(fileData.at(*it));
+        }
+        it = requestedRows.erase(it);
+    }
+
+    while (batch.isEmpty() && sweepRow < fileData.size())
+    {
+        const int last = std::min<int>(sweepRow + statusBatchSize, int(fileData.size()));
+        for (; sweepRow < last; ++sweepRow)
+        {
+            if (!fileData.at(sweepRow).hasStatus)
+            {
+                batch.append(fileData.at(sweepRow));
+            }
+        }
+    }
+
+    while (batch.isEmpty() && recheckRow >= 0 && recheckRow < fileData.size())
+    {
+        const int last = std::min<int>(recheckRow + statusBatchSize, int(fileData.size()));
+        for (; recheckRow < last; ++recheckRow)
+        {
+            if (fileData.at(recheckRow).hasStatus)
+            {
+                batch.append(fileData.at(recheckRow));
+            }
+        }
+    }
+
+    if (batch.isEmpty())
+    {
+        return;
+    }
+
+    isStatusBatchRunning = true;
+    const quint64 generation = statusGeneration;
+    const QString directory = isVirtualListing ? QString() : directoryPath;
+
+    statusPool.start([this, generation, directory, batch]() mutable
+                     {
+                         FileStatusReader::read(directory, batch);
+                         QMetaObject::invokeMethod(this, [this, generation, batch]()
+                                                   {
+                                                       isStatusBatchRunning = false;
+                                                       if (generation == statusGeneration)
+                                                       {
+                                                           applyStatus(batch);
+                                                       }
+                                                       startStatusBatch();
+                                                   }, Qt::QueuedConnection);
+                     });
+}
+
+/**
+ * \brief Stores the metadata of a finished batch and announces the rows whose metadata changed in contiguous ranges.
+ * Entries are found by binary search, so rows inserted or removed in the meantime do not matter.
+ */
+void ModifiedFileSystemModel::applyStatus(const DirectoryListing &batch)
+{
+    QList<int> changedRows;
+    changedRows.reserve(batch.size());
+
+    for (const DirectoryEntry &status : batch)
+    {
+        auto it = std::lower_bound(fileData.begin(), fileData.end(), status, DirectoryListingCache::entryLessThan);
+        while (it != fileData.end() && !DirectoryListingCache::entryLessThan(status, *it) && it->name != status.name)
+        {
+            ++it;
+        }
+        if (it == fileData.end() || it->name != status.name || it->isDir != status.isDir)
+        {
+            continue;
+        }
+
+        if (it->hasStatus && it->size == status.size && it->modifiedMs == status.modifiedMs && it->mode == status.mode
+            && it->ownerId == status.ownerId && it->inode == status.inode)
+        {
+            continue;
+        }
+
+        it->hasStatus = true;
+        it->size = status.size;
+        it->modifiedMs = status.modifiedMs;
+        it->mode = status.mode;
+        it->ownerId = status.ownerId;
+        it->inode = status.inode;
+        changedRows.append(int(it - fileData.begin()));
+    }
+
+    std::sort(changedRows.begin(), changedRows.end());
+    const QList<int> roles = { SizeRole, ModifiedRole, PermissionsRole, OwnerRole, InodeRole };
+    for (int i = 0; i < changedRows.size();)
+    {
+        int last = i;
+        while (last + 1 < changedRows.size() && changedRows.at(last + 1) == changedRows.at(last) + 1)
+        {
+            ++last;
+        }
+        emit dataChanged(index(changedRows.at(i)), index(changedRows.at(last)), roles);
+        i = last + 1;
+    }
+}
+
 /**
  * @brief Checks if the item at the specified row is editable.
  *
@@ -159,8 +705,15 @@ QString ModifiedFileSystemModel::getFilePathForIndex(const QModelIndex &index) c
         return QString();
     }
 
-    const QFileInfo &fileInfo = fileData.at(index.row());
-    return fileInfo.filePath();
+    return directoryPrefix + fileData.at(index.row()).name;
+}
+
+/**
+ * @brief Returns true if the item at the given model index is a directory, also inside an archive.
+ */
+bool ModifiedFileSystemModel::isDirectory(const QModelIndex &index) const
+{
+    return index.isValid() && index.row() < fileData.size() && fileData.at(index.row()).isDir;
 }
 
 /**
@@ -176,7 +729,7 @@ QFileInfo ModifiedFileSystemModel::getFileInfoForIndex(const QModelIndex &index)
         return QFileInfo();
     }
 
-    return fileData.at(index.row());
+    return QFileInfo(directoryPrefix + fileData.at(index.row()).name);
 }
 
 /**
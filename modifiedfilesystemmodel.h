@@ -1,29 +1,79 @@
 #ifndef MODIFIEDFILESYSTEMMODEL_H
 #define MODIFIEDFILESYSTEMMODEL_H
 
+#include "directorylistingcache.h"
 #include <QObject>
 #include <QAbstractListModel>
 #include <QFileInfoList>
+#include <QHash>
+#include <QSet>
+#include <QThreadPool>
+#include <QTimer>
+
+struct ModelSnapshot
+{
+    QString directoryPath;
+    DirectoryStamp stamp;
+    DirectoryListing fileData;
+    bool acceptsDirectories = true;
+};
 
 class ModifiedFileSystemModel : public QAbstractListModel
 {
     Q_OBJECT
 public:
+    enum Role
+    {
+        SizeRole = Qt::UserRole + 1,
+        ModifiedRole,
+        PermissionsRole,
+        OwnerRole,
+        InodeRole
+    };
+
     explicit ModifiedFileSystemModel(QObject *parent = nullptr);
-    void setFileData(const QString &path);
+    ~ModifiedFileSystemModel();
+    bool setFileData(const QString &path);
+    void revalidate();
+    ModelSnapshot snapshot() const;
+    bool restoreSnapshot(const ModelSnapshot &snapshot);
+    void applyChanges(const QSet<QString> &removedPaths, const QHash<QString, bool> &addedPaths);
+    QString currentDirectory() const;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
 
     bool isItemEditable(int row) const;
     void setItemEditable(int row, bool editable);
     QString getFilePathForIndex(const QModelIndex &index) const;
+    bool isDirectory(const QModelIndex &index) const;
     QFileInfo getFileInfoForIndex(const QModelIndex &index) const;
 
 private:
-    QFileInfoList fileData;
+    QString directoryPath;
+    QString directoryPrefix;
+    DirectoryStamp directoryStamp;
+    DirectoryListing fileData;
     QList<bool> editabilityFlags;
-    bool acceptsDirectories;
-    QFileInfoList sortFilesInsideModel(const QFileInfoList &fileInfoList);
+    bool acceptsDirectories = true;
+    bool isVirtualListing = false;
+    bool isArchiveListing = false;
+
+    QThreadPool statusPool;
+    mutable QTimer statusTimer;
+    quint64 statusGeneration = 0;
+    mutable QSet<int> requestedRows;
+    mutable bool hasStatusRequests = false;
+    int sweepRow = 0;
+    int recheckRow = -1;
+    bool isStatusBatchRunning = false;
+
+    void requestStatus(int row) const;
+    void resetStatus();
+    void startStatusBatch();
+    void applyStatus(const DirectoryListing &batch);
+    void removeEntries(const QSet<QString> &names);
+    void insertEntries(DirectoryListing additions);
+    void reloadVirtualListing();
 
 public slots:
     void shouldAcceptDirectories(bool acceptsDirectories);
@@ -0,0 +1,94 @@
+#include "navigationhistory.h"
+
+/**
+ * @file navigationhistory.h
+ * @brief The NavigationHistory class keeps back and forward stacks of visited directories.
+ * Every entry carries a snapshot of the list model and the view state, so stepping back restores the view without listing it again.
+ */
+
+namespace
+{
+const int maxHistoryEntries = 50;
+}
+
+NavigationHistory::NavigationHistory(QObject *parent) : QObject(parent) {}
+
+/**
+ * @brief Records the directory being left when navigating to a new one. Clears the forward stack.
+ *
+ * @param current The state of the directory being left.
+ */
+void NavigationHistory::visit(const NavigationEntry &current)
+{
+    pushBounded(backStack, current);
+    forwardStack.clear();
+
+    emit historyChanged(canGoBack(), canGoForward());
+}
+
+/**
+ * @brief Steps one entry back.
+ *
+ * @param current The state of the directory being left, moved onto the forward stack.
+ * @return The entry to restore, or an empty entry if there is no history.
+ */
+NavigationEntry NavigationHistory::back(const NavigationEntry &current)
+{
+    if (backStack.isEmpty())
+    {
+        return NavigationEntry();
+    }
+
+    pushBounded(forwardStack, current);
+    NavigationEntry entry = backStack.takeLast();
+
+    emit historyChanged(canGoBack(), canGoForward());
+    return entry;
+}
+
+/**
+ * @brief Steps one entry forward.
+ *
+ * @param current The state of the directory being left, moved onto the back stack.
+ * @return The entry to restore, or an empty entry if there is no forward history.
+ */
+NavigationEntry NavigationHistory::forward(const NavigationEntry &current)
+{
+    if (forwardStack.isEmpty())
+    {
+        return NavigationEntry();
+    }
+
+    pushBounded(backStack, current);
+    NavigationEntry entry = forwardStack.takeLast();
+
+    emit historyChanged(canGoBack(), canGoForward());
+    return entry;
+}
+
+bool NavigationHistory::canGoBack() const
+{
+    return !backStack.isEmpty();
+}
+
+bool NavigationHistory::canGoForward() const
+{
+    return !forwardStack.isEmpty();
+}
+
+/**
+ * @brief Pushes an entry and drops the oldest one when the stack is full.
+ */
+void NavigationHistory::pushBounded(QList<NavigationEntry> &stack, const NavigationEntry &entry)
+{
+    if (entry.path.isEmpty())
+    {
+        return;
+    }
+
+    stack.append(entry);
+    if (stack.size() > maxHistoryEntries)
+    {
+        stack.removeFirst();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef NAVIGATIONHISTORY_H
+#define NAVIGATIONHISTORY_H
+
+#include "modifiedfilesystemmodel.h"
+#include <QObject>
+#include <QList>
+#include <QStringList>
+
+struct NavigationEntry
+{
+    QString path;
+    ModelSnapshot snapshot;
+    int scrollPosition = 0;
+    QStringList selectedNames;
+    QString currentName;
+};
+
+class NavigationHistory : public QObject
+{
+    Q_OBJECT
+public:
+    explicit NavigationHistory(QObject *parent = nullptr);
+
+    void visit(const NavigationEntry &current);
+    NavigationEntry back(const NavigationEntry &current);
+    NavigationEntry forward(const NavigationEntry &current);
+    bool canGoBack() const;
+    bool canGoForward() const;
+
+private:
+    QList<NavigationEntry> backStack;
+    QList<NavigationEntry> forwardStack;
+
+    void pushBounded(QList<NavigationEntry> &stack, const NavigationEntry &entry);
+
+signals:
+    void historyChanged(bool canGoBack, bool canGoForward);
+};
+
+#endif // NAVIGATIONHISTORY_H
@@ -0,0 +1,420 @@
+#include "operationjournal.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QStorageInfo>
+#include <QThreadPool>
+
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+
+/**
+ * @file operationjournal.h
+ * @brief The OperationJournal class records file operations so they can be undone and redone, also after a restart.
+ * The journal is an append-only binary log: every batch is written as one block of records ending with a commit
+ * record, and undo/redo only append a small marker. A batch without its commit record (e.g. after a crash) is ignored.
+ * The log is rewritten with the live batches only when it grows too large; trashed files of batches dropped
+ * from the history are deleted at that point.
+ */
+
+namespace
+{
+const int maxUndoBatches = 100;
+const qint64 maxJournalBytes = 8 * 1024 * 1024;
+const char journalFileName[] = "journal.log";
+}
+
+OperationJournal::OperationJournal()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    logFile.setFileName(directory + '/' + journalFileName);
+
+    load();
+    compact();
+    openLog();
+}
+
+OperationJournal::~OperationJournal()
+{}
+
+OperationJournal& OperationJournal::instance()
+{
+    static OperationJournal instance;
+    return instance;
+}
+
+/**
+ * @brief Records a finished operation as a new batch. Clears the redo history.
+ *
+ * @param title The text shown for undo and redo.
+ * @param entries The single steps of the operation, in the order they were applied.
+ * @return The id of the batch, 0 if nothing was recorded.
+ */
+quint32 OperationJournal::commit(const QString &title, const QList<JournalEntry> &entries)
+{
+    if (entries.isEmpty())
+    {
+        return 0;
+    }
+
+    JournalBatch batch;
+    batch.id = nextBatchId++;
+    batch.title = title;
+    batch.entries = entries;
+
+    QByteArray records;
+    QDataStream stream(&records, QIODevice::WriteOnly);
+    writeBatch(stream, batch);
+    append(records);
+
+    undoStack.append(batch);
+    redoStack.clear();
+
+    // The log is rewritten by replacing the file, so it is reopened afterwards.
+    if (undoStack.size() > maxUndoBatches || logFile.size() > maxJournalBytes)
+    {
+        logFile.close();
+        compact();
+        openLog();
+    }
+
+    emit changed(canUndo(), canRedo());
+    return batch.id;
+}
+
+bool OperationJournal::canUndo() const
+{
+    return !undoStack.isEmpty();
+}
+
+bool OperationJournal::canRedo() const
+{
+    return !redoStack.isEmpty();
+}
+
+/**
+ * @brief Returns the most recent batch, which the next undo reverts.
+ */
+JournalBatch OperationJournal::undoBatch() const
+{
+    return undoStack.isEmpty() ? JournalBatch() : undoStack.last();
+}
+
+/**
+ * @brief Returns the most recently undone batch, which the next redo applies again.
+ */
+JournalBatch OperationJournal::redoBatch() const
+{
+    return redoStack.isEmpty() ? JournalBatch() : redoStack.last();
+}
+
+/**
+ * @brief Records that the most recent batch was undone completely. Called once the jobs reverting it succeeded.
+ *
+ * @param id The id of the batch returned by undoBatch().
+ */
+void OperationJournal::markUndone(quint32 id)
+{
+    if (undoStack.isEmpty() || undoStack.last().id != id)
+    {
+        return;
+    }
+
+    redoStack.append(undoStack.takeLast());
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream << quint8(UndoRecord) << id;
+    append(record);
+
+    emit changed(canUndo(), canRedo());
+}
+
+/**
+ * @brief Records that the most recently undone batch was applied again. Called once the jobs redoing it succeeded.
+ *
+ * @param id The id of the batch returned by redoBatch().
+ */
+void OperationJournal::markRedone(quint32 id)
+{
+    if (redoStack.isEmpty() || redoStack.last().id != id)
+    {
+        return;
+    }
+
+    undoStack.append(redoStack.takeLast());
+
+    QByteArray record;
+    QDataStream stream(&record, QIODevice::WriteOnly);
+    stream << quint8(RedoRecord) << id;
+    append(record);
+
+    emit changed(canUndo(), canRedo());
+}
+
+QString OperationJournal::undoTitle() const
+{
+    return undoStack.isEmpty() ? QString() : undoStack.last().title;
+}
+
+QString OperationJournal::redoTitle() const
+{
+    return redoStack.isEmpty() ? QString() : redoStack.last().title;
+}
+
+/**
+ * @brief Returns the trash directory on the same volume as the path, so trashing is a rename and not a copy.
+ * Falls back to the trash in the application data directory if the volume has no writable trash.
+ *
+ * @param path A directory on the volume.
+ * @return The existing trash directory.
+ */
+QString OperationJournal::trashDirectoryFor(const QString &path)
+{
+    const QString homeTrash = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/trash";
+    QDir().mkpath(homeTrash);
+
+    const QStorageInfo storage(path);
+    if (storage.isValid() && storage != QStorageInfo(homeTrash))
+    {
+#ifdef Q_OS_UNIX
+        const QString volumeTrash = QDir(storage.rootPath()).filePath(QString(".Trash-%1/fileexplorer").arg(::getuid()));
+#else
+        const QString volumeTrash = QDir(storage.rootPath()).filePath(".fileexplorer-trash");
+#endif
+        if (QDir().mkpath(volumeTrash) && QFileInfo(volumeTrash).isWritable())
+        {
+            return volumeTrash;
+        }
+    }
+
+    return homeTrash;
+}
+
+/**
+ * @brief Returns true if the path lies inside one of the trash directories returned by trashDirectoryFor().
+ */
+bool OperationJournal::isInTrash(const QString &path)
+{
+    const QString homeTrash = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/trash/";
+#ifdef Q_OS_UNIX
+    const QString volumeTrash = QString("/.Trash-%1/fileexplorer/").arg(::getuid());
+#else
+    const QString volumeTrash = "/.fileexplorer-trash/";
+#endif
+    return path.startsWith(homeTrash) || path.contains(volumeTrash);
+}
+
+/**
+ * @brief Replays the log into the undo and redo stacks. Reading stops at the first incomplete record, which is truncated.
+ */
+void OperationJournal::load()
+{
+    QFile file(logFile.fileName());
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return;
+    }
+
+    QDataStream stream(&file);
+    JournalBatch pending;
+    qint64 validSize = 0;
+
+    while (!stream.atEnd())
+    {
+        quint8 type = 0;
+        quint32 id = 0;
+        stream >> type >> id;
+
+        if (type == BeginRecord)
+        {
+            QByteArray title;
+            stream >> title;
+            pending = JournalBatch();
+            pending.id = id;
+            pending.title = QString::fromUtf8(title);
+        }
+        else if (type == EntryRecord)
+        {
+            quint8 kind = 0;
+            QByteArray source;
+            QByteArray target;
+            stream >> kind >> source >> target;
+
+            if (id == pending.id)
+            {
+                pending.entries.append({ JournalEntry::Kind(kind), QString::fromUtf8(source), QString::fromUtf8(target) });
+            }
+        }
+        else if (type == CommitRecord && id == pending.id && stream.status() == QDataStream::Ok)
+        {
+            undoStack.append(pending);
+            redoStack.clear();
+            pending = JournalBatch();
+        }
+        else if (type == UndoRecord && !undoStack.isEmpty() && undoStack.last().id == id)
+        {
+            redoStack.append(undoStack.takeLast());
+        }
+        else if (type == RedoRecord && !redoStack.isEmpty() && redoStack.last().id == id)
+        {
+            undoStack.append(redoStack.takeLast());
+        }
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        nextBatchId = qMax(nextBatchId, id + 1);
+        validSize = file.pos();
+    }
+
+    // Cut off a record torn by a crash, otherwise records appended later could not be read back.
+    if (validSize < file.size())
+    {
+        file.close();
+        QFile::resize(logFile.fileName(), validSize);
+    }
+}
+
+/**
+ * @brief Rewrites the log with the live batches only once it grew too large or holds too many batches.
+ */
+void OperationJournal::compact()
+{
+    if (undoStack.size() <= maxUndoBatches && QFileInfo(logFile.fileName()).size() <= maxJournalBytes)
+    {
+        return;
+    }
+
+    const qsizetype droppedCount = qMax<qsizetype>(0, undoStack.size() - maxUndoBatches);
+    const QList<JournalBatch> droppedBatches = undoStack.mid(0, droppedCount);
+    undoStack.remove(0, droppedCount);
+
+    QSaveFile file(logFile.fileName());
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        return;
+    }
+
+    QDataStream stream(&file);
+    for (const JournalBatch &batch : std::as_const(undoStack))
+    {
+        writeBatch(stream, batch);
+    }
+    for (auto it = redoStack.crbegin(); it != redoStack.crend(); ++it)
+    {
+        writeBatch(stream, *it);
+    }
+    for (const JournalBatch &batch : std::as_const(redoStack))
+    {
+        stream << quint8(UndoRecord) << batch.id;
+    }
+
+    if (file.commit())
+    {
+        purgeTrash(droppedBatches);
+    }
+}
+
+/**
+ * @brief Appends records to the log and flushes them. On Unix the log is synced as well, so a batch is on disk once
+ * commit() returns; elsewhere it has reached the operating system.
+ */
+void OperationJournal::append(const QByteArray &records)
+{
+    if (!logFile.isOpen())
+    {
+        return;
+    }
+
+    bool isWritten = logFile.write(records) == records.size() && logFile.flush();
+#ifdef Q_OS_UNIX
+    isWritten = isWritten && ::fsync(logFile.handle()) == 0;
+#endif
+    if (!isWritten)
+    {
+        journalError = tr("The undo history could not be written to %1: %2")
+                           .arg(QDir::toNativeSeparators(logFile.fileName()), logFile.errorString());
+        emit writeFailed(journalError);
+    }
+}
+
+/**
+ * @brief Opens the log for appending. A failure is kept in errorString() and reported through writeFailed().
+ */
+void OperationJournal::openLog()
+{
+    if (!logFile.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        journalError = tr("The undo history cannot be saved to %1: %2")
+                           .arg(QDir::toNativeSeparators(logFile.fileName()), logFile.errorString());
+        emit writeFailed(journalError);
+    }
+}
+
+/**
+ * @brief Returns the last error writing the log, empty if there was none.
+ */
+QString OperationJournal::errorString() const
+{
+    return journalError;
+}
+
+/**
+ * @brief Serializes a batch as begin, entry and commit records. Paths are stored as UTF-8.
+ */
+void OperationJournal::writeBatch(QDataStream &stream, const JournalBatch &batch)
+{
+    stream << quint8(BeginRecord) << batch.id << batch.title.toUtf8();
+
+    for (const JournalEntry &entry : batch.entries)
+    {
+        stream << quint8(EntryRecord) << batch.id << quint8(entry.kind) << entry.source.toUtf8() << entry.target.toUtf8();
+    }
+
+    stream << quint8(CommitRecord) << batch.id;
+}
+
+/**
+ * @brief Deletes, on a worker thread, the trashed files of batches that can no longer be undone.
+ */
+void OperationJournal::purgeTrash(const QList<JournalBatch> &batches)
+{
+    QStringList trashedPaths;
+    for (const JournalBatch &batch : batches)
+    {
+        for (const JournalEntry &entry : batch.entries)
+        {
+            if (entry.kind == JournalEntry::Trash)
+            {
+                trashedPaths << entry.target;
+            }
+        }
+    }
+
+    if (trashedPaths.isEmpty())
+    {
+        return;
+    }
+
+    QThreadPool::globalInstance()->start([trashedPaths]()
+                                         {
+                                             for (const QString &path : trashedPaths)
+                                             {
+                                                 const QFileInfo fileInfo(path);
+                                                 if (fileInfo.isDir() && !fileInfo.isSymLink())
+                                                 {
+                                                     QDir(path).removeRecursively();
+                                                 }
+                                                 else
+                                                 {
+                                                     QFile::remove(path);
+                                                 }
+                                             }
+                                         });
+}
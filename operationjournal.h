@@ -0,0 +1,83 @@
+#ifndef OPERATIONJOURNAL_H
+#define OPERATIONJOURNAL_H
+
+#include <QObject>
+#include <QFile>
+#include <QDataStream>
+#include <QList>
+#include <QString>
+
+struct JournalEntry
+{
+    enum Kind : quint8
+    {
+        Move = 1,
+        Trash,
+        Copy,
+        CreateFolder
+    };
+
+    Kind kind = Move;
+    QString source;
+    QString target;
+};
+
+struct JournalBatch
+{
+    quint32 id = 0;
+    QString title;
+    QList<JournalEntry> entries;
+};
+
+class OperationJournal : public QObject
+{
+    Q_OBJECT
+public:
+    static OperationJournal& instance();
+
+    quint32 commit(const QString &title, const QList<JournalEntry> &entries);
+    bool canUndo() const;
+    bool canRedo() const;
+    JournalBatch undoBatch() const;
+    JournalBatch redoBatch() const;
+    void markUndone(quint32 id);
+    void markRedone(quint32 id);
+    QString undoTitle() const;
+    QString redoTitle() const;
+    QString errorString() const;
+
+    static QString trashDirectoryFor(const QString &path);
+    static bool isInTrash(const QString &path);
+
+private:
+    OperationJournal();
+    ~OperationJournal();
+
+    enum RecordType : quint8
+    {
+        BeginRecord = 1,
+        EntryRecord,
+        CommitRecord,
+        UndoRecord,
+        RedoRecord
+    };
+
+    QFile logFile;
+    QList<JournalBatch> undoStack;
+    QList<JournalBatch> redoStack;
+    quint32 nextBatchId = 1;
+    QString journalError;
+
+    void load();
+    void compact();
+    void openLog();
+    void append(const QByteArray &records);
+    static void writeBatch(QDataStream &stream, const JournalBatch &batch);
+    static void purgeTrash(const QList<JournalBatch> &batches);
+
+signals:
+    void changed(bool canUndo, bool canRedo);
+    void writeFailed(const QString &message);
+};
+
+#endif // OPERATIONJOURNAL_H
@@ -0,0 +1,118 @@
+#include "pathcompleter.h"
+#include "pathcompletiontrie.h"
+#include "directorylistingcache.h"
+#include <QDir>
+
+/**
+ * @file pathcompleter.h
+ * @brief The PathCompleter class completes directory paths typed into a line edit.
+ * Completions come from the PathCompletionTrie only. A directory the trie does not know yet is listed on a worker
+ * thread and the completions are shown once it is read, so typing never waits for the disk or a network mount.
+ */
+
+namespace
+{
+const int maxCompletions = 200;
+const int maxVisibleCompletions = 12;
+}
+
+PathCompleter::PathCompleter(QLineEdit *lineEdit, QObject *parent)
+    : QCompleter(parent), lineEdit(lineEdit), readGeneration(0)
+{
+    completionModel = new QStringListModel(this);
+    setModel(completionModel);
+    setCompletionMode(QCompleter::PopupCompletion);
+    setMaxVisibleItems(maxVisibleCompletions);
+#ifdef Q_OS_WIN
+    setCaseSensitivity(Qt::CaseInsensitive);
+#else
+    setCaseSensitivity(Qt::CaseSensitive);
+#endif
+
+    readPool.setMaxThreadCount(1);
+
+    lineEdit->setCompleter(this);
+    connect(lineEdit, &QLineEdit::textEdited, this, &PathCompleter::updateCompletions);
+}
+
+PathCompleter::~PathCompleter()
+{
+    ++readGeneration;
+    readPool.clear();
+    readPool.waitForDone();
+}
+
+/**
+ * @brief Offers the known subdirectories of the typed directory that start with the typed name.
+ *
+ * @param text The text of the line edit.
+ */
+void PathCompleter::updateCompletions(const QString &text)
+{
+    const QString path = QDir::fromNativeSeparators(text);
+    const qsizetype separator = path.lastIndexOf('/');
+    if (separator < 0)
+    {
+        completionModel->setStringList({});
+        return;
+    }
+
+    const QString directory = path.left(separator + 1);
+    const QString prefix = path.mid(separator + 1);
+
+    QStringList names;
+    if (!PathCompletionTrie::instance().complete(directory, prefix, maxCompletions, names))
+    {
+        completionModel->setStringList({});
+        if (directory != requestedDirectory)
+        {
+            readInBackground(directory);
+        }
+        return;
+    }
+
+    QStringList completions;
+    completions.reserve(names.size());
+    for (const QString &name : std::as_const(names))
+    {
+        completions << QDir::toNativeSeparators(directory + name);
+    }
+
+    completionModel->setStringList(completions);
+    if (!completions.isEmpty() && lineEdit->hasFocus())
+    {
+        setCompletionPrefix(text);
+        complete();
+    }
+}
+
+/**
+ * @brief Lists the directory on the worker thread, which fills the trie, and completes again if the user is still
+ * typing in that directory. Each directory is only requested once in a row, also if it cannot be read.
+ */
+void PathCompleter::readInBackground(const QString &directory)
+{
+    requestedDirectory = directory;
+    const int generation = ++readGeneration;
+    readPool.clear();
+
+    readPool.start([this, directory, generation]()
+                   {
+                       if (generation != readGeneration)
+                       {
+                           return;
+                       }
+
+                       DirectoryListingCache::instance().listing(directory);
+
+                       QMetaObject::invokeMethod(this, [this, directory, generation]()
+                                                 {
+                                                     const QString text = lineEdit->text();
+                                                     if (generation == readGeneration
+                                                         && QDir::fromNativeSeparators(text).startsWith(directory))
+                                                     {
+                                                         updateCompletions(text);
+                                                     }
+                                                 }, Qt::QueuedConnection);
+                   });
+}
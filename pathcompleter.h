@@ -0,0 +1,30 @@
+#ifndef PATHCOMPLETER_H
+#define PATHCOMPLETER_H
+
+#include <QCompleter>
+#include <QLineEdit>
+#include <QStringListModel>
+#include <QThreadPool>
+#include <atomic>
+
+class PathCompleter : public QCompleter
+{
+    Q_OBJECT
+public:
+    explicit PathCompleter(QLineEdit *lineEdit, QObject *parent = nullptr);
+    ~PathCompleter();
+
+private slots:
+    void updateCompletions(const QString &text);
+
+private:
+    QLineEdit *lineEdit;
+    QStringListModel *completionModel;
+    QThreadPool readPool;
+    QString requestedDirectory;
+    std::atomic<int> readGeneration;
+
+    void readInBackground(const QString &directory);
+};
+
+#endif // PATHCOMPLETER_H
@@ -0,0 +1,140 @@
+#include "pathcompletiontrie.h"
+#include <QDir>
+
+/**
+ * @file pathcompletiontrie.h
+ * @brief The PathCompletionTrie class completes typed paths from the directory names the application already knows.
+ * Every path component is one level of the trie and the children of a level are kept sorted, so the names starting
+ * with a typed prefix are one contiguous range. The trie is filled from every listing read into the
+ * DirectoryListingCache and never reads the disk itself.
+ */
+
+namespace
+{
+const qsizetype maxNodeCount = 1000000;
+}
+
+PathCompletionTrie::PathCompletionTrie()
+{}
+
+PathCompletionTrie::~PathCompletionTrie()
+{}
+
+PathCompletionTrie& PathCompletionTrie::instance()
+{
+    static PathCompletionTrie instance;
+    return instance;
+}
+
+/**
+ * @brief Records the subdirectories of a freshly read directory. Safe to call from worker threads.
+ *
+ * @param directory The listed directory.
+ * @param listing Its complete listing.
+ */
+void PathCompletionTrie::insertListing(const QString &directory, const DirectoryListing &listing)
+{
+    const QStringList parts = components(directory);
+
+    QMutexLocker locker(&mutex);
+
+    if (nodeCount + listing.size() > maxNodeCount)
+    {
+        root.children.clear();
+        root.isListed = false;
+        nodeCount = 0;
+    }
+
+    Node *node = &root;
+    for (const QString &part : parts)
+    {
+        std::unique_ptr<Node> &child = node->children[part];
+        if (!child)
+        {
+            child = std::make_unique<Node>();
+            ++nodeCount;
+        }
+        node = child.get();
+    }
+
+    // Keep the subtrees of directories that still exist, drop the removed ones.
+    std::map<QString, std::unique_ptr<Node>> children;
+    for (const DirectoryEntry &entry : listing)
+    {
+        if (!entry.isDir)
+        {
+            continue;
+        }
+
+        auto existing = node->children.find(entry.name);
+        if (existing != node->children.end())
+        {
+            children.emplace(entry.name, std::move(existing->second));
+        }
+        else
+        {
+            children.emplace(entry.name, std::make_unique<Node>());
+            ++nodeCount;
+        }
+    }
+
+    node->children.swap(children);
+    node->isListed = true;
+}
+
+/**
+ * @brief Returns the known subdirectories of a directory whose names start with the prefix, in sorted order.
+ *
+ * @param directory The directory being completed.
+ * @param prefix The typed beginning of the name.
+ * @param maxCompletions The maximum number of names returned.
+ * @param names Receives the matching names.
+ * @return False if the directory was never listed, so its subdirectories are unknown.
+ */
+bool PathCompletionTrie::complete(const QString &directory, const QString &prefix, int maxCompletions, QStringList &names) const
+{
+    const QStringList parts = components(directory);
+
+    QMutexLocker locker(&mutex);
+
+    const Node *node = &root;
+    for (const QString &part : parts)
+    {
+        const auto child = node->children.find(part);
+        if (child == node->children.end())
+        {
+            return false;
+        }
+        node = child->second.get();
+    }
+
+    if (!node->isListed)
+    {
+        return false;
+    }
+
+    for (auto it = node->children.lower_bound(prefix); it != node->children.end() && names.size() < maxCompletions; ++it)
+    {
+        if (!it->first.startsWith(prefix))
+        {
+            break;
+        }
+        names << it->first;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Splits a directory path into the components used as trie levels. The root of an absolute Unix path is
+ * represented by an empty first component.
+ */
+QStringList PathCompletionTrie::components(const QString &path)
+{
+    QStringList parts = QDir::cleanPath(path).split('/');
+    if (parts.size() > 1 && parts.last().isEmpty())
+    {
+        parts.removeLast();
+    }
+    return parts;
+}
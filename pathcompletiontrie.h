@@ -0,0 +1,35 @@
+#ifndef PATHCOMPLETIONTRIE_H
+#define PATHCOMPLETIONTRIE_H
+
+#include "directorylistingcache.h"
+#include <QMutex>
+#include <QStringList>
+#include <map>
+#include <memory>
+
+class PathCompletionTrie
+{
+public:
+    static PathCompletionTrie& instance();
+
+    void insertListing(const QString &directory, const DirectoryListing &listing);
+    bool complete(const QString &directory, const QString &prefix, int maxCompletions, QStringList &names) const;
+
+private:
+    PathCompletionTrie();
+    ~PathCompletionTrie();
+
+    struct Node
+    {
+        std::map<QString, std::unique_ptr<Node>> children;
+        bool isListed = false;
+    };
+
+    Node root;
+    qsizetype nodeCount = 0;
+    mutable QMutex mutex;
+
+    static QStringList components(const QString &path);
+};
+
+#endif // PATHCOMPLETIONTRIE_H
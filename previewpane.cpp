@@ -0,0 +1,309 @@
+#include "previewpane.h"
+#include "archiveindex.h"
+#include "sourceview.h"
+#include <QBuffer>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QImageReader>
+#include <QLocale>
+#include <QPixmap>
+#include <QScrollBar>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <memory>
+
+/**
+ * @file previewpane.h
+ * @brief The PreviewPane class shows a quick look at the current item of the list view: images scaled to the pane,
+ * the beginning of text files and the size and date of everything else.
+ * Selection changes are debounced and loads run one at a time on a background thread. A load that is overtaken by
+ * a newer selection is dropped, and while one runs only the latest selection is remembered, so scrolling through a
+ * directory decodes at most the file being left and the file finally selected.
+ */
+
+namespace
+{
+const int debounceMs = 120;
+const qint64 previewTextSize = 64 * 1024;
+const qint64 binarySniffSize = 8192;
+const qint64 maxBufferedImageSize = 64 * 1024 * 1024;
+
+/**
+ * @brief Returns true if the suffix belongs to an image format Qt can decode.
+ */
+bool hasImageSuffix(const QString &path)
+{
+    static const QList<QByteArray> formats = QImageReader::supportedImageFormats();
+    return formats.contains(QFileInfo(path).suffix().toLower().toLatin1());
+}
+}
+
+PreviewPane::PreviewPane(QWidget *parent)
+    : QWidget(parent), loadGeneration(0)
+{
+    titleLabel = new QLabel(this);
+    titleLabel->setWordWrap(true);
+    titleLabel->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    imageLabel = new QLabel(this);
+    imageLabel->setAlignment(Qt::AlignCenter);
+    imageLabel->setSizePolicy(QSizePolicy::Ignored, QSizePolicy::Ignored);
+
+    sourceView = new SourceView(this);
+
+    detailsLabel = new QLabel(this);
+    detailsLabel->setWordWrap(true);
+
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(6, 6, 6, 6);
+    layout->addWidget(titleLabel);
+    layout->addWidget(imageLabel, 1);
+    layout->addWidget(sourceView, 1);
+    layout->addWidget(detailsLabel);
+    layout->addStretch();
+
+    imageLabel->hide();
+    sourceView->hide();
+
+    loadPool.setMaxThreadCount(1);
+    debounceTimer.setSingleShot(true);
+    debounceTimer.setInterval(debounceMs);
+    connect(&debounceTimer, &QTimer::timeout, this, &PreviewPane::startLoad);
+}
+
+PreviewPane::~PreviewPane()
+{
+    ++loadGeneration;
+    loadPool.waitForDone();
+}
+
+/**
+ * @brief Previews the item once the selection has rested for a moment. A load that is still running for an
+ * earlier item is abandoned. Nothing is loaded while the pane is hidden.
+ *
+ * @param path The item to preview, or an empty string to clear the pane.
+ */
+void PreviewPane::showPath(const QString &path)
+{
+    this->path = path;
+    ++loadGeneration;
+
+    if (isVisible())
+    {
+        debounceTimer.start();
+    }
+}
+
+void PreviewPane::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+    if (path != shownPath)
+    {
+        debounceTimer.start();
+    }
+}
+
+/**
+ * @brief Decodes a shown image again at the new size of the pane.
+ */
+void PreviewPane::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    if (imageLabel->isVisible() && path == shownPath)
+    {
+        showPath(path);
+    }
+}
+
+/**
+ * @brief Starts loading the current item, or remembers to do so when the running load finishes. At most one load
+ * runs and none is queued behind it.
+ */
+void PreviewPane::startLoad()
+{
+    if (isLoading)
+    {
+        isLoadPending = true;
+        return;
+    }
+
+    if (path.isEmpty())
+    {
+        applyPreview(Preview());
+        return;
+    }
+
+    isLoading = true;
+    const quint64 loadId = loadGeneration;
+    const QString loadedPath = path;
+    const QSize size = imageSize();
+
+    loadPool.start([this, loadId, loadedPath, size]()
+                   {
+                       const Preview preview = load(loadedPath, size, loadGeneration, loadId);
+                       QMetaObject::invokeMethod(this, [this, loadId, preview]()
+                                                 {
+                                                     isLoading = false;
+                                                     if (loadId == loadGeneration)
+                                                     {
+                                                         applyPreview(preview);
+                                                     }
+                                                     else if (isLoadPending)
+                                                     {
+                                                         isLoadPending = false;
+                                                         startLoad();
+                                                     }
+                                                 }, Qt::QueuedConnection);
+                   });
+}
+
+/**
+ * @brief Shows a finished load.
+ */
+void PreviewPane::applyPreview(const Preview &preview)
+{
+    shownPath = preview.path;
+    titleLabel->setText(QFileInfo(preview.path).fileName());
+    detailsLabel->setText(preview.details);
+
+    if (!preview.image.isNull())
+    {
+        QPixmap pixmap = QPixmap::fromImage(preview.image);
+        pixmap.setDevicePixelRatio(devicePixelRatioF());
+        imageLabel->setPixmap(pixmap);
+    }
+    else
+    {
+        imageLabel->clear();
+    }
+    imageLabel->setVisible(!preview.image.isNull());
+
+    sourceView->setData(preview.text, preview.path);
+    sourceView->verticalScrollBar()->setValue(0);
+    sourceView->horizontalScrollBar()->setValue(0);
+    sourceView->setVisible(!preview.text.isEmpty());
+}
+
+/**
+ * @brief Returns the size in device pixels images are decoded at.
+ */
+QSize PreviewPane::imageSize() const
+{
+    const QMargins margins = layout()->contentsMargins();
+    const int width = this->width() - margins.left() - margins.right();
+    const int height = this->height() - margins.top() - margins.bottom() - titleLabel->sizeHint().height()
+                       - detailsLabel->sizeHint().height() - 2 * layout()->spacing();
+    return QSize(std::max(width, 16), std::max(height, 16)) * devicePixelRatioF();
+}
+
+/**
+ * @brief Reads the preview of an item. Runs on the load thread and gives up early once the load is superseded.
+ *
+ * @param path The item to preview.
+ * @param imageSize The size images are scaled down to.
+ * @param generation The current load generation.
+ * @param loadId The generation of this load.
+ * @return The preview, incomplete if the load was superseded.
+ */
+PreviewPane::Preview PreviewPane::load(const QString &path, const QSize &imageSize,
+                                       const std::atomic<quint64> &generation, quint64 loadId)
+{
+    Preview preview;
+    preview.path = path;
+
+    const bool isInArchive = ArchiveIndex::isInsideArchive(path);
+    const QFileInfo fileInfo(path);
+    if (isInArchive ? ArchiveIndex::instance().isDirectory(path) : fileInfo.isDir())
+    {
+        if (isInArchive)
+        {
+            preview.details = tr("Folder in archive");
+        }
+        else
+        {
+            const qsizetype count = QDir(path).entryList(QDir::AllEntries | QDir::NoDotAndDotDot | QDir::Hidden).size();
+            preview.details = tr("Folder, %n item(s)", nullptr, int(count)) + "\n"
+                              + QLocale().toString(fileInfo.lastModified(), QLocale::ShortFormat);
+        }
+        return preview;
+    }
+
+    std::unique_ptr<QIODevice> device;
+    if (isInArchive)
+    {
+        device.reset(ArchiveIndex::instance().openMember(path));
+        preview.details = tr("File in archive");
+    }
+    else
+    {
+        auto file = std::make_unique<QFile>(path);
+        if (file->open(QIODevice::ReadOnly))
+        {
+            device = std::move(file);
+        }
+        preview.details = QLocale().formattedDataSize(fileInfo.size()) + "\n"
+                          + QLocale().toString(fileInfo.lastModified(), QLocale::ShortFormat);
+    }
+
+    if (!device || generation != loadId)
+    {
+        return preview;
+    }
+
+    if (hasImageSuffix(path))
+    {
+        // Members are streamed, the image reader needs to seek.
+        QBuffer memberBuffer;
+        if (device->isSequential())
+        {
+            memberBuffer.setData(device->read(maxBufferedImageSize));
+            memberBuffer.open(QIODevice::ReadOnly);
+        }
+
+        QImageReader reader(device->isSequential() ? static_cast<QIODevice*>(&memberBuffer) : device.get());
+        reader.setAutoTransform(true);
+        const QSize originalSize = reader.size();
+        if (originalSize.isValid())
+        {
+            if (originalSize.width() > imageSize.width() || originalSize.height() > imageSize.height())
+            {
+                reader.setScaledSize(originalSize.scaled(imageSize, Qt::KeepAspectRatio));
+            }
+            if (generation == loadId)
+            {
+                preview.image = reader.read();
+            }
+        }
+        if (!preview.image.isNull())
+        {
+            preview.details = QString("%1 × %2\n").arg(originalSize.width()).arg(originalSize.height()) + preview.details;
+            return preview;
+        }
+        if (device->isSequential())
+        {
+            return preview;
+        }
+        device->seek(0);
+    }
+
+    QByteArray head = device->read(previewTextSize);
+    if (head.left(binarySniffSize).contains('\0'))
+    {
+        preview.details = tr("Binary file") + "\n" + preview.details;
+        return preview;
+    }
+
+    // Cut at the last line break so no partial line or UTF-8 sequence is shown.
+    if (!device->atEnd())
+    {
+        const qsizetype lastBreak = head.lastIndexOf('\n');
+        if (lastBreak > 0)
+        {
+            head.truncate(lastBreak + 1);
+        }
+    }
+    preview.text = head;
+    return preview;
+}
@@ -0,0 +1,56 @@
+#ifndef PREVIEWPANE_H
+#define PREVIEWPANE_H
+
+#include <QWidget>
+#include <QLabel>
+#include <QImage>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+
+class SourceView;
+
+class PreviewPane : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit PreviewPane(QWidget *parent = nullptr);
+    ~PreviewPane();
+
+    void showPath(const QString &path);
+
+protected:
+    void showEvent(QShowEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    struct Preview
+    {
+        QString path;
+        QString details;
+        QImage image;
+        QByteArray text;
+    };
+
+    QLabel *titleLabel;
+    QLabel *imageLabel;
+    SourceView *sourceView;
+    QLabel *detailsLabel;
+
+    QString path;
+    QString shownPath;
+    QTimer debounceTimer;
+    QThreadPool loadPool;
+    std::atomic<quint64> loadGeneration;
+    bool isLoading = false;
+    bool isLoadPending = false;
+
+    void startLoad();
+    void applyPreview(const Preview &preview);
+    QSize imageSize() const;
+
+    static Preview load(const QString &path, const QSize &imageSize, const std::atomic<quint64> &generation,
+                        quint64 loadId);
+};
+
+#endif // PREVIEWPANE_H
@@ -0,0 +1,152 @@
+#include "quickopendialog.h"
+#include "ui_quickopendialog.h"
+#include "fileiconcache.h"
+#include <QKeyEvent>
+#include <QListWidgetItem>
+
+/**
+ * @file quickopendialog.h
+ * @brief The QuickOpenDialog class jumps to any indexed directory or file by typing a fuzzy query.
+ * Every keystroke starts a new ranking on the QuickOpenIndex threads; results of outdated queries are dropped.
+ */
+
+namespace
+{
+const int maxShownResults = 100;
+const int isDirRole = Qt::UserRole + 1;
+}
+
+QuickOpenDialog::QuickOpenDialog(const QStringList &roots, QWidget *parent)
+    : QDialog(parent), ui(new Ui::QuickOpenDialog)
+{
+    ui->setupUi(this);
+    setAttribute(Qt::WA_DeleteOnClose);
+
+    QuickOpenIndex &index = QuickOpenIndex::instance();
+    connect(&index, &QuickOpenIndex::resultsReady, this, &QuickOpenDialog::showResults);
+    connect(&index, &QuickOpenIndex::candidatesChanged, this, &QuickOpenDialog::updateResults);
+    connect(ui->QLineEdit_Query, &QLineEdit::textChanged, this, &QuickOpenDialog::updateResults);
+    connect(ui->QListWidget_Results, &QListWidget::itemActivated, this, &QuickOpenDialog::acceptItem);
+
+    ui->QLineEdit_Query->installEventFilter(this);
+    ui->QLineEdit_Query->setFocus();
+
+    index.refresh(roots);
+    updateStatus();
+}
+
+QuickOpenDialog::~QuickOpenDialog()
+{
+    delete ui;
+}
+
+/**
+ * \brief Ranks the indexed paths for the current query.
+ */
+void QuickOpenDialog::updateResults()
+{
+    const QString query = ui->QLineEdit_Query->text();
+    if (query.trimmed().isEmpty())
+    {
+        currentGeneration = 0;
+        shownResultCount = 0;
+        ui->QListWidget_Results->clear();
+        updateStatus();
+        return;
+    }
+
+    currentGeneration = QuickOpenIndex::instance().search(query, maxShownResults);
+}
+
+/**
+ * \brief Shows the best matches of a finished ranking unless the query changed in the meantime.
+ *
+ * \param generation The search the results belong to.
+ * \param results The best matches, best first.
+ */
+void QuickOpenDialog::showResults(int generation, const QList<QuickOpenResult> &results)
+{
+    if (generation != currentGeneration)
+    {
+        return;
+    }
+
+    QListWidget *list = ui->QListWidget_Results;
+    list->setUpdatesEnabled(false);
+    list->clear();
+
+    for (const QuickOpenResult &result : results)
+    {
+        QListWidgetItem *item = new QListWidgetItem(FileIconCache::instance().icon(result.path, result.isDir), result.path, list);
+        item->setData(Qt::UserRole, result.path);
+        item->setData(isDirRole, result.isDir);
+    }
+
+    list->setCurrentRow(0);
+    list->setUpdatesEnabled(true);
+
+    shownResultCount = int(results.size());
+    updateStatus();
+}
+
+/**
+ * \brief Shows how many paths are indexed and whether indexing is still running.
+ */
+void QuickOpenDialog::updateStatus()
+{
+    const QuickOpenIndex &index = QuickOpenIndex::instance();
+    QString status = tr("%n path(s) indexed", nullptr, int(index.candidateCount()));
+    if (index.isCrawling())
+    {
+        status += tr(", indexing...");
+    }
+    if (!ui->QLineEdit_Query->text().trimmed().isEmpty())
+    {
+        status = tr("%n match(es) shown, ", nullptr, shownResultCount) + status;
+    }
+    ui->QLabel_Status->setText(status);
+}
+
+/**
+ * \brief Hands the path of the item to the caller and closes the dialog.
+ *
+ * \param item The chosen result.
+ */
+void QuickOpenDialog::acceptItem(QListWidgetItem *item)
+{
+    if (item == nullptr)
+    {
+        return;
+    }
+
+    emit pathChosen(item->data(Qt::UserRole).toString(), item->data(isDirRole).toBool());
+    close();
+}
+
+/**
+ * \brief Lets the arrow and page keys move through the results and Enter choose one while typing.
+ */
+bool QuickOpenDialog::eventFilter(QObject *watched, QEvent *event)
+{
+    if (watched == ui->QLineEdit_Query && event->type() == QEvent::KeyPress)
+    {
+        QKeyEvent *keyEvent = static_cast<QKeyEvent*>(event);
+        switch (keyEvent->key())
+        {
+        case Qt::Key_Up:
+        case Qt::Key_Down:
+        case Qt::Key_PageUp:
+        case Qt::Key_PageDown:
+            QCoreApplication::sendEvent(ui->QListWidget_Results, event);
+            return true;
+        case Qt::Key_Return:
+        case Qt::Key_Enter:
+            acceptItem(ui->QListWidget_Results->currentItem());
+            return true;
+        default:
+            break;
+        }
+    }
+
+    return QDialog::eventFilter(watched, event);
+}
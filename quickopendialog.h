@@ -0,0 +1,38 @@
+#ifndef QUICKOPENDIALOG_H
+#define QUICKOPENDIALOG_H
+
+#include "quickopenindex.h"
+#include <QDialog>
+
+namespace Ui {
+class QuickOpenDialog;
+}
+
+class QListWidgetItem;
+
+class QuickOpenDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit QuickOpenDialog(const QStringList &roots, QWidget *parent = nullptr);
+    ~QuickOpenDialog();
+
+signals:
+    void pathChosen(const QString &path, bool isDir);
+
+private slots:
+    void updateResults();
+    void showResults(int generation, const QList<QuickOpenResult> &results);
+    void updateStatus();
+    void acceptItem(QListWidgetItem *item);
+
+private:
+    Ui::QuickOpenDialog *ui;
+    int currentGeneration = 0;
+    int shownResultCount = 0;
+
+    bool eventFilter(QObject *watched, QEvent *event) override;
+};
+
+#endif // QUICKOPENDIALOG_H
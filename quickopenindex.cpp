@@ -0,0 +1,592 @@
+#include "quickopenindex.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QThread>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * @file quickopenindex.h
+ * @brief The QuickOpenIndex class holds the paths offered by quick-open and ranks them for a fuzzy query.
+ * Paths are collected by a background crawl and stored in immutable blocks of contiguous arrays: the UTF-8 paths,
+ * an ASCII lower-cased copy and a 64 bit mask of the characters in every path. A query first rejects every path
+ * whose mask lacks one of the query characters, then scores the rest with an fzf-like scheme that rewards matches
+ * at word boundaries and consecutive matches. Every block is ranked on its own thread and the best matches are merged.
+ */
+
+namespace
+{
+const int blockCapacity = 65536;
+const qsizetype maxCandidates = 1000000;
+const qint64 recrawlIntervalMs = 10 * 60 * 1000;
+const quint8 directoryFlag = 0x01;
+
+const int scoreMatch = 16;
+const int scoreGapStart = -3;
+const int scoreGapExtension = -1;
+const int bonusBoundary = 8;
+const int bonusPathSeparator = 9;
+const int bonusCamelCase = 7;
+const int bonusConsecutive = 4;
+const int bonusFirstCharMultiplier = 2;
+const int bonusFileName = 2;
+
+enum CharClass
+{
+    ClassLower,
+    ClassUpper,
+    ClassDigit,
+    ClassSeparator,
+    ClassDelimiter,
+    ClassOther
+};
+
+inline char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c | 0x20) : c;
+}
+
+/**
+ * @brief Maps a folded character to one bit: letters and digits get their own bit, the rest share the remaining ones.
+ */
+inline quint64 characterBit(uchar c)
+{
+    if (c >= 'a' && c <= 'z')
+    {
+        return quint64(1) << (c - 'a');
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return quint64(1) << (26 + c - '0');
+    }
+    return quint64(1) << (36 + c % 28);
+}
+
+inline CharClass charClass(char c)
+{
+    if (c >= 'a' && c <= 'z')
+    {
+        return ClassLower;
+    }
+    if (c >= 'A' && c <= 'Z')
+    {
+        return ClassUpper;
+    }
+    if (c >= '0' && c <= '9')
+    {
+        return ClassDigit;
+    }
+    if (c == '/' || c == '\\')
+    {
+        return ClassSeparator;
+    }
+    if (c == '-' || c == '_' || c == '.' || c == ' ')
+    {
+        return ClassDelimiter;
+    }
+    return ClassOther;
+}
+
+/**
+ * @brief Returns the bonus for matching a character of class current that follows a character of class previous.
+ */
+inline int boundaryBonus(CharClass previous, CharClass current)
+{
+    if (current == ClassSeparator || current == ClassDelimiter)
+    {
+        return bonusBoundary;
+    }
+    if (previous == ClassSeparator)
+    {
+        return bonusPathSeparator;
+    }
+    if (previous == ClassDelimiter)
+    {
+        return bonusBoundary;
+    }
+    if ((previous == ClassLower && current == ClassUpper) || (previous != ClassDigit && current == ClassDigit))
+    {
+        return bonusCamelCase;
+    }
+    return 0;
+}
+
+/**
+ * @brief Scores one query term against one path.
+ * The term is located with memchr in a forward pass, the match is shrunk to the shortest window ending at the same
+ * position in a backward pass, and the window is scored from left to right.
+ *
+ * @param folded The lower-cased path.
+ * @param text The path.
+ * @param length The length of the path in bytes.
+ * @param nameStart The offset of the file name within the path.
+ * @param term The lower-cased query term.
+ * @return The score, or -1 if the term does not match.
+ */
+int scoreTerm(const char *folded, const char *text, int length, int nameStart, const QByteArray &term)
+{
+    const int termLength = int(term.size());
+    int start = -1;
+    int position = 0;
+
+    for (int i = 0; i < termLength; ++i)
+    {
+        const void *found = std::memchr(folded + position, term.at(i), length - position);
+        if (found == nullptr)
+        {
+            return -1;
+        }
+
+        const int index = int(static_cast<const char*>(found) - folded);
+        if (i == 0)
+        {
+            start = index;
+        }
+        position = index + 1;
+    }
+
+    const int end = position;
+    int termIndex = termLength - 1;
+    for (int i = end - 1; i >= start; --i)
+    {
+        if (folded[i] == term.at(termIndex) && --termIndex < 0)
+        {
+            start = i;
+            break;
+        }
+    }
+
+    int score = 0;
+    int consecutive = 0;
+    int firstBonus = 0;
+    bool inGap = false;
+    termIndex = 0;
+    CharClass previousClass = start > 0 ? charClass(text[start - 1]) : ClassSeparator;
+
+    for (int i = start; i < end && termIndex < termLength; ++i)
+    {
+        const CharClass currentClass = charClass(text[i]);
+
+        if (folded[i] == term.at(termIndex))
+        {
+            int bonus = boundaryBonus(previousClass, currentClass);
+            if (consecutive == 0)
+            {
+                firstBonus = bonus;
+            }
+            else
+            {
+                if (bonus >= bonusBoundary && bonus > firstBonus)
+                {
+                    firstBonus = bonus;
+                }
+                bonus = std::max({ bonus, firstBonus, bonusConsecutive });
+            }
+
+            score += scoreMatch + (termIndex == 0 ? bonus * bonusFirstCharMultiplier : bonus);
+            if (i >= nameStart)
+            {
+                score += bonusFileName;
+            }
+
+            ++consecutive;
+            ++termIndex;
+            inGap = false;
+        }
+        else
+        {
+            score += inGap ? scoreGapExtension : scoreGapStart;
+            consecutive = 0;
+            firstBonus = 0;
+            inGap = true;
+        }
+
+        previousClass = currentClass;
+    }
+
+    return score;
+}
+
+/**
+ * @brief Returns true if the path is one of the directories or lies below one of them.
+ */
+bool isUnderAny(const QString &path, const QStringList &directories)
+{
+    return std::any_of(directories.cbegin(), directories.cend(), [&path](const QString &directory)
+                       {
+                           return path == directory || path.startsWith(directory.endsWith('/') ? directory : directory + '/');
+                       });
+}
+
+struct RankedMatch
+{
+    int score;
+    int length;
+    int block;
+    int index;
+};
+
+/**
+ * @brief The ranking order: higher score first, then shorter path, then index order.
+ */
+bool isBetterMatch(const RankedMatch &a, const RankedMatch &b)
+{
+    if (a.score != b.score)
+    {
+        return a.score > b.score;
+    }
+    if (a.length != b.length)
+    {
+        return a.length < b.length;
+    }
+    if (a.block != b.block)
+    {
+        return a.block < b.block;
+    }
+    return a.index < b.index;
+}
+}
+
+QuickOpenIndex::QuickOpenIndex() : crawling(false), searchGeneration(0)
+{
+    crawlPool.setMaxThreadCount(1);
+    searchPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+QuickOpenIndex::~QuickOpenIndex()
+{
+    crawling = false;
+    ++searchGeneration;
+    crawlPool.waitForDone();
+    searchPool.waitForDone();
+}
+
+QuickOpenIndex& QuickOpenIndex::instance()
+{
+    static QuickOpenIndex instance;
+    return instance;
+}
+
+/**
+ * @brief Crawls the roots in the background, unless a crawl is running or a recent crawl already covered them.
+ * The first crawl publishes its paths while it runs; later crawls replace the index once they are complete.
+ *
+ * @param roots The directories to index recursively.
+ */
+void QuickOpenIndex::refresh(const QStringList &roots)
+{
+    if (crawling)
+    {
+        return;
+    }
+
+    QStringList cleanRoots;
+    for (const QString &root : roots)
+    {
+        if (!root.isEmpty())
+        {
+            cleanRoots << QDir::cleanPath(root);
+        }
+    }
+    cleanRoots.sort();
+    cleanRoots.removeDuplicates();
+
+    QStringList uniqueRoots;
+    for (const QString &root : std::as_const(cleanRoots))
+    {
+        if (!isUnderAny(root, uniqueRoots))
+        {
+            uniqueRoots << root;
+        }
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        bool isCovered = lastCrawl.isValid() && lastCrawl.elapsed() < recrawlIntervalMs;
+        for (const QString &root : std::as_const(uniqueRoots))
+        {
+            isCovered = isCovered && isUnderAny(root, crawledRoots);
+        }
+
+        if (isCovered)
+        {
+            return;
+        }
+
+        crawledRoots = uniqueRoots;
+        lastCrawl.start();
+    }
+
+    crawling = true;
+    crawlPool.start([this, uniqueRoots]()
+                    {
+                        crawl(uniqueRoots);
+                    });
+}
+
+/**
+ * @brief Ranks the indexed paths for a query on the search threads. A newer search cancels this one.
+ * The results are delivered by resultsReady() on the GUI thread.
+ *
+ * @param query Whitespace separated terms, each of which has to match.
+ * @param maxResults The number of best matches to deliver.
+ * @return The generation identifying this search in resultsReady().
+ */
+int QuickOpenIndex::search(const QString &query, int maxResults)
+{
+    const int generation = ++searchGeneration;
+
+    QList<QByteArray> terms;
+    quint64 queryMask = 0;
+    const QStringList words = query.split(' ', Qt::SkipEmptyParts);
+    for (const QString &word : words)
+    {
+        QByteArray term = word.toUtf8();
+        for (char &c : term)
+        {
+            c = fold(c);
+            queryMask |= characterBit(uchar(c));
+        }
+        terms << term;
+    }
+
+    struct SearchState
+    {
+        BlockList blocks;
+        std::vector<std::vector<RankedMatch>> partialMatches;
+        std::atomic<int> pendingBlocks;
+    };
+
+    auto state = std::make_shared<SearchState>();
+    {
+        QMutexLocker locker(&mutex);
+        state->blocks = blocks;
+    }
+
+    if (terms.isEmpty() || state->blocks.isEmpty())
+    {
+        QMetaObject::invokeMethod(this, [this, generation]()
+                                  {
+                                      emit resultsReady(generation, {});
+                                  }, Qt::QueuedConnection);
+        return generation;
+    }
+
+    state->partialMatches.resize(state->blocks.size());
+    state->pendingBlocks = int(state->blocks.size());
+
+    for (int b = 0; b < state->blocks.size(); ++b)
+    {
+        searchPool.start([this, state, terms, queryMask, maxResults, generation, b]()
+                         {
+                             const CandidateBlock &block = *state->blocks.at(b);
+                             std::vector<RankedMatch> &best = state->partialMatches[b];
+                             best.reserve(maxResults + 1);
+
+                             for (int i = 0; i < block.size(); ++i)
+                             {
+                                 if ((i & 0xFFF) == 0 && searchGeneration != generation)
+                                 {
+                                     break;
+                                 }
+
+                                 if ((block.masks[i] & queryMask) != queryMask)
+                                 {
+                                     continue;
+                                 }
+
+                                 const int offset = int(block.offsets[i]);
+                                 const int length = int(block.offsets[i + 1]) - offset;
+                                 int score = 0;
+                                 for (const QByteArray &term : terms)
+                                 {
+                                     const int termScore = scoreTerm(block.folded.constData() + offset, block.text.constData() + offset,
+                                                                     length, block.nameOffsets[i], term);
+                                     if (termScore < 0)
+                                     {
+                                         score = -1;
+                                         break;
+                                     }
+                                     score += termScore;
+                                 }
+
+                                 if (score < 0)
+                                 {
+                                     continue;
+                                 }
+
+                                 // The heap keeps the worst of the best matches on top.
+                                 best.push_back({ score, length, b, i });
+                                 std::push_heap(best.begin(), best.end(), isBetterMatch);
+                                 if (int(best.size()) > maxResults)
+                                 {
+                                     std::pop_heap(best.begin(), best.end(), isBetterMatch);
+                                     best.pop_back();
+                                 }
+                             }
+
+                             if (--state->pendingBlocks > 0 || searchGeneration != generation)
+                             {
+                                 return;
+                             }
+
+                             std::vector<RankedMatch> merged;
+                             for (const std::vector<RankedMatch> &matches : state->partialMatches)
+                             {
+                                 merged.insert(merged.end(), matches.begin(), matches.end());
+                             }
+                             std::sort(merged.begin(), merged.end(), isBetterMatch);
+                             if (int(merged.size()) > maxResults)
+                             {
+                                 merged.resize(maxResults);
+                             }
+
+                             QList<QuickOpenResult> results;
+                             results.reserve(qsizetype(merged.size()));
+                             for (const RankedMatch &match : merged)
+                             {
+                                 const CandidateBlock &matchBlock = *state->blocks.at(match.block);
+                                 QuickOpenResult result;
+                                 result.path = QString::fromUtf8(matchBlock.text.constData() + matchBlock.offsets[match.index], match.length);
+                                 result.isDir = matchBlock.flags[match.index] & directoryFlag;
+                                 result.score = match.score;
+                                 results << result;
+                             }
+
+                             QMetaObject::invokeMethod(this, [this, generation, results]()
+                                                       {
+                                                           if (generation == searchGeneration)
+                                                           {
+                                                               emit resultsReady(generation, results);
+                                                           }
+                                                       }, Qt::QueuedConnection);
+                         });
+    }
+
+    return generation;
+}
+
+/**
+ * @brief Returns the number of indexed paths.
+ */
+qsizetype QuickOpenIndex::candidateCount() const
+{
+    QMutexLocker locker(&mutex);
+    return blockCandidateCount;
+}
+
+bool QuickOpenIndex::isCrawling() const
+{
+    return crawling;
+}
+
+/**
+ * @brief Walks the roots breadth first, so the paths closest to the roots are indexed first if the limit is reached.
+ * Hidden entries are skipped and symbolic links to directories are not followed. Runs on the crawl thread.
+ */
+void QuickOpenIndex::crawl(const QStringList &roots)
+{
+    bool isInitialCrawl = false;
+    {
+        QMutexLocker locker(&mutex);
+        isInitialCrawl = blocks.isEmpty();
+    }
+
+    BlockList crawledBlocks;
+    std::shared_ptr<CandidateBlock> block;
+    qsizetype candidateTotal = 0;
+
+    auto append = [&](const QString &path, bool isDir)
+    {
+        if (!block)
+        {
+            block = std::make_shared<CandidateBlock>();
+            block->offsets.reserve(blockCapacity + 1);
+            block->offsets.push_back(0);
+        }
+
+        const QByteArray bytes = path.toUtf8();
+        quint64 mask = 0;
+        block->text.append(bytes);
+        for (const char c : bytes)
+        {
+            const char foldedChar = fold(c);
+            block->folded.append(foldedChar);
+            mask |= characterBit(uchar(foldedChar));
+        }
+
+        block->offsets.push_back(quint32(block->text.size()));
+        block->nameOffsets.push_back(quint16(qMin<qsizetype>(bytes.lastIndexOf('/') + 1, 0xFFFF)));
+        block->masks.push_back(mask);
+        block->flags.push_back(isDir ? directoryFlag : 0);
+        ++candidateTotal;
+
+        if (block->size() == blockCapacity)
+        {
+            crawledBlocks << block;
+            block.reset();
+            if (isInitialCrawl)
+            {
+                publish(crawledBlocks, false);
+            }
+        }
+    };
+
+    QStringList pendingDirectories = roots;
+    for (const QString &root : roots)
+    {
+        append(root, true);
+    }
+
+    for (qsizetype next = 0; next < pendingDirectories.size() && candidateTotal < maxCandidates && crawling; ++next)
+    {
+        QDirIterator iterator(pendingDirectories.at(next), QDir::AllEntries | QDir::NoDotAndDotDot);
+        while (iterator.hasNext() && candidateTotal < maxCandidates)
+        {
+            const QFileInfo fileInfo = iterator.nextFileInfo();
+            const bool isDir = fileInfo.isDir();
+            append(fileInfo.filePath(), isDir);
+
+            if (isDir && !fileInfo.isSymLink())
+            {
+                pendingDirectories << fileInfo.filePath();
+            }
+        }
+    }
+
+    if (block)
+    {
+        crawledBlocks << block;
+    }
+
+    publish(crawledBlocks, true);
+}
+
+/**
+ * @brief Makes the crawled blocks the searched ones and tells the GUI thread how many paths are indexed.
+ */
+void QuickOpenIndex::publish(const BlockList &crawledBlocks, bool isComplete)
+{
+    qsizetype count = 0;
+    for (const std::shared_ptr<const CandidateBlock> &block : crawledBlocks)
+    {
+        count += block->size();
+    }
+
+    {
+        QMutexLocker locker(&mutex);
+        blocks = crawledBlocks;
+        blockCandidateCount = count;
+    }
+
+    if (isComplete)
+    {
+        crawling = false;
+    }
+
+    QMetaObject::invokeMethod(this, [this, count]()
+                              {
+                                  emit candidatesChanged(count);
+                              }, Qt::QueuedConnection);
+}
@@ -0,0 +1,67 @@
+#ifndef QUICKOPENINDEX_H
+#define QUICKOPENINDEX_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+struct QuickOpenResult
+{
+    QString path;
+    bool isDir = false;
+    int score = 0;
+};
+
+class QuickOpenIndex : public QObject
+{
+    Q_OBJECT
+public:
+    static QuickOpenIndex& instance();
+
+    void refresh(const QStringList &roots);
+    int search(const QString &query, int maxResults);
+    qsizetype candidateCount() const;
+    bool isCrawling() const;
+
+private:
+    QuickOpenIndex();
+    ~QuickOpenIndex();
+
+    struct CandidateBlock
+    {
+        QByteArray text;
+        QByteArray folded;
+        std::vector<quint32> offsets;
+        std::vector<quint16> nameOffsets;
+        std::vector<quint64> masks;
+        std::vector<quint8> flags;
+
+        qsizetype size() const { return qsizetype(masks.size()); }
+    };
+
+    using BlockList = QList<std::shared_ptr<const CandidateBlock>>;
+
+    BlockList blocks;
+    qsizetype blockCandidateCount = 0;
+    mutable QMutex mutex;
+    QThreadPool crawlPool;
+    QThreadPool searchPool;
+    QElapsedTimer lastCrawl;
+    QStringList crawledRoots;
+    std::atomic<bool> crawling;
+    std::atomic<int> searchGeneration;
+
+    void crawl(const QStringList &roots);
+    void publish(const BlockList &crawledBlocks, bool isComplete);
+
+signals:
+    void resultsReady(int generation, const QList<QuickOpenResult> &results);
+    void candidatesChanged(qsizetype count);
+};
+
+#endif // QUICKOPENINDEX_H
@@ -0,0 +1,356 @@
+#include "renamepattern.h"
+#include <QHash>
+#include <QFileInfo>
+
+/**
+ * @file renamepattern.h
+ * @brief The RenamePattern class computes new file names from a find/replace rule with template tokens.
+ * The replacement may contain {name} (base name), {ext} (suffix), {n} and {n:width} (counter); with a regular
+ * expression it may also refer to captured groups as \1, \2, ...
+ * plan() validates a whole selection at once: it detects invalid names, duplicate targets and targets taken by
+ * files that are not renamed away, and orders the renames so chains and cycles apply without overwriting anything.
+ */
+
+namespace
+{
+const int cancellationCheckInterval = 4096;
+}
+
+RenamePattern::RenamePattern(const RenameRule &rule) : rule(rule)
+{
+    if (rule.useRegex)
+    {
+        expression.setPattern(rule.find);
+        expression.setPatternOptions(rule.caseSensitive ? QRegularExpression::NoPatternOption
+                                                        : QRegularExpression::CaseInsensitiveOption);
+        expression.optimize();
+    }
+}
+
+/**
+ * @brief Tells whether the rule can be applied, i.e. its regular expression compiles.
+ */
+bool RenamePattern::isValid() const
+{
+    return !rule.useRegex || expression.isValid();
+}
+
+/**
+ * @brief Returns the regular expression error, if any.
+ */
+QString RenamePattern::errorString() const
+{
+    return isValid() ? QString() : expression.errorString();
+}
+
+/**
+ * @brief Computes the new name of one file.
+ * With an empty find text the expanded replacement becomes the whole new name.
+ *
+ * @param fileName The current file name.
+ * @param index The position of the file in the selection, used by the counter.
+ * @return The new file name, or the current one if the rule does not change it.
+ */
+QString RenamePattern::apply(const QString &fileName, qsizetype index) const
+{
+    if (!isValid() || (rule.replace.isEmpty() && rule.find.isEmpty()))
+    {
+        return fileName;
+    }
+
+    const QString replacement = expandTemplate(fileName, index);
+    if (rule.find.isEmpty())
+    {
+        return replacement;
+    }
+
+    QString result = fileName;
+    if (rule.useRegex)
+    {
+        return result.replace(expression, replacement);
+    }
+
+    return result.replace(rule.find, replacement, rule.caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
+}
+
+/**
+ * @brief Expands the template tokens of the replacement for one file.
+ * Expanded values are escaped when the replacement is later interpreted by a regular expression.
+ */
+QString RenamePattern::expandTemplate(const QString &fileName, qsizetype index) const
+{
+    const QString &pattern = rule.replace;
+    if (!pattern.contains('{'))
+    {
+        return pattern;
+    }
+
+    auto escaped = [this](QString value)
+    {
+        return rule.useRegex ? value.replace('\\', "\\\\") : value;
+    };
+
+    QString result;
+    result.reserve(pattern.size() + fileName.size());
+
+    qsizetype position = 0;
+    while (position < pattern.size())
+    {
+        const qsizetype open = pattern.indexOf('{', position);
+        const qsizetype close = open < 0 ? -1 : pattern.indexOf('}', open);
+        if (open < 0 || close < 0)
+        {
+            result += QStringView(pattern).mid(position);
+            break;
+        }
+
+        result += QStringView(pattern).mid(position, open - position);
+        const QStringView token = QStringView(pattern).mid(open + 1, close - open - 1);
+
+        if (token == u"name")
+        {
+            const QFileInfo fileInfo(fileName);
+            result += escaped(fileInfo.completeBaseName().isEmpty() ? fileName : fileInfo.completeBaseName());
+        }
+        else if (token == u"ext")
+        {
+            const QFileInfo fileInfo(fileName);
+            result += escaped(fileInfo.completeBaseName().isEmpty() ? QString() : fileInfo.suffix());
+        }
+        else if (token == u"n" || token.startsWith(u"n:"))
+        {
+            const int width = token.size() > 2 ? token.mid(2).toInt() : rule.counterPadding;
+            const qint64 value = rule.counterStart + qint64(index) * rule.counterStep;
+            result += QString::number(value).rightJustified(width, '0');
+        }
+        else
+        {
+            result += QStringView(pattern).mid(open, close - open + 1);
+        }
+
+        position = close + 1;
+    }
+
+    return result;
+}
+
+/**
+ * @brief Plans the renames of a selection of files living in one directory.
+ *
+ * @param directory The directory containing the files.
+ * @param names The selected file names, in selection order.
+ * @param existingNames Every name currently present in the directory.
+ * @param isCancelled Polled regularly; when it returns true the plan is abandoned.
+ * @return The new names, the issue of every file and the renames in an order that never overwrites a file.
+ */
+RenamePlan RenamePattern::plan(const QString &directory, const QStringList &names, const QSet<QString> &existingNames,
+                               const std::function<bool()> &isCancelled) const
+{
+    RenamePlan result;
+    const qsizetype count = names.size();
+    result.newNames.reserve(count);
+    result.issues.fill(RenamePlan::NoIssue, count);
+
+    QList<bool> changed(count, false);
+    QHash<QString, qsizetype> sourceIndex;
+    QHash<QString, qsizetype> targetIndex;
+    sourceIndex.reserve(count);
+    targetIndex.reserve(count);
+
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        if (isCancelled && i % cancellationCheckInterval == 0 && isCancelled())
+        {
+            result.cancelled = true;
+            return result;
+        }
+
+        const QString newName = apply(names.at(i), i);
+        result.newNames << newName;
+
+        if (newName == names.at(i))
+        {
+            continue;
+        }
+
+        changed[i] = true;
+        sourceIndex.insert(nameKey(names.at(i)), i);
+        if (!isValidName(newName))
+        {
+            result.issues[i] = RenamePlan::InvalidName;
+        }
+    }
+
+    QSet<QString> existingKeys;
+    existingKeys.reserve(existingNames.size());
+    for (const QString &name : existingNames)
+    {
+        existingKeys.insert(nameKey(name));
+    }
+
+    QList<qsizetype> pending;
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        if (!changed.at(i))
+        {
+            continue;
+        }
+
+        if (result.issues.at(i) == RenamePlan::NoIssue)
+        {
+            const QString key = nameKey(result.newNames.at(i));
+            const auto duplicate = targetIndex.constFind(key);
+
+            if (duplicate != targetIndex.constEnd())
+            {
+                result.issues[i] = RenamePlan::DuplicateTarget;
+                if (result.issues.at(*duplicate) == RenamePlan::NoIssue)
+                {
+                    result.issues[*duplicate] = RenamePlan::DuplicateTarget;
+                    pending << *duplicate;
+                }
+            }
+            else
+            {
+                targetIndex.insert(key, i);
+
+                if (existingKeys.contains(key) && !sourceIndex.contains(key))
+                {
+                    result.issues[i] = RenamePlan::TargetExists;
+                }
+            }
+        }
+
+        if (result.issues.at(i) != RenamePlan::NoIssue)
+        {
+            pending << i;
+        }
+    }
+
+    // A file that stays in place blocks the rename targeting its name, which in turn blocks the next one in the chain.
+    while (!pending.isEmpty())
+    {
+        const qsizetype blocked = pending.takeLast();
+        const qsizetype dependent = targetIndex.value(nameKey(names.at(blocked)), -1);
+
+        if (dependent >= 0 && dependent != blocked && result.issues.at(dependent) == RenamePlan::NoIssue)
+        {
+            result.issues[dependent] = RenamePlan::TargetExists;
+            pending << dependent;
+        }
+    }
+
+    QList<qsizetype> next(count, -1);
+    for (qsizetype i = 0; i < count; ++i)
+    {
+        if (!changed.at(i))
+        {
+            continue;
+        }
+
+        if (result.issues.at(i) == RenamePlan::NoIssue)
+        {
+            next[i] = sourceIndex.value(nameKey(result.newNames.at(i)), -1);
+            ++result.changedCount;
+        }
+        else
+        {
+            ++result.conflictCount;
+        }
+    }
+
+    const QString prefix = directory.endsWith('/') ? directory : directory + '/';
+    auto rename = [&](const QString &from, const QString &to)
+    {
+        result.orderedRenames.append({ prefix + from, prefix + to });
+    };
+
+    // Every rename waits for the file occupying its target to move away first. Targets are unique, so the
+    // dependencies form simple chains and cycles; a cycle is broken by parking one file under a temporary name.
+    enum State : char { Unvisited, Visiting, Done };
+    QList<char> state(count, Unvisited);
+    int temporaryCounter = 0;
+
+    for (qsizetype start = 0; start < count; ++start)
+    {
+        if (!changed.at(start) || result.issues.at(start) != RenamePlan::NoIssue || state.at(start) != Unvisited)
+        {
+            continue;
+        }
+
+        QList<qsizetype> chain;
+        qsizetype current = start;
+        while (current >= 0 && state.at(current) == Unvisited)
+        {
+            state[current] = Visiting;
+            chain << current;
+            current = next.at(current);
+        }
+
+        qsizetype cycleStart = chain.size();
+        QString temporaryName;
+        if (current >= 0 && state.at(current) == Visiting)
+        {
+            cycleStart = chain.indexOf(current);
+            do
+            {
+                temporaryName = QString(".~rename-%1-%2").arg(++temporaryCounter).arg(names.at(current));
+            }
+            while (existingKeys.contains(nameKey(temporaryName)) || targetIndex.contains(nameKey(temporaryName)));
+
+            rename(names.at(current), temporaryName);
+        }
+
+        for (qsizetype i = chain.size() - 1; i >= 0; --i)
+        {
+            const qsizetype item = chain.at(i);
+            if (i == cycleStart)
+            {
+                rename(temporaryName, result.newNames.at(item));
+            }
+            else
+            {
+                rename(names.at(item), result.newNames.at(item));
+            }
+            state[item] = Done;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * @brief Returns the key under which the file system compares names.
+ */
+QString RenamePattern::nameKey(const QString &name)
+{
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS)
+    return name.toCaseFolded();
+#else
+    return name;
+#endif
+}
+
+/**
+ * @brief Tells whether the name can be used for a file.
+ */
+bool RenamePattern::isValidName(const QString &name)
+{
+    if (name.isEmpty() || name == "." || name == ".." || name.contains('/') || name.contains(QChar(0)))
+    {
+        return false;
+    }
+
+#ifdef Q_OS_WIN
+    static const QString forbiddenCharacters = QStringLiteral("\\:*?\"<>|");
+    for (const QChar character : name)
+    {
+        if (forbiddenCharacters.contains(character))
+        {
+            return false;
+        }
+    }
+#endif
+
+    return true;
+}
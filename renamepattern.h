@@ -0,0 +1,62 @@
+#ifndef RENAMEPATTERN_H
+#define RENAMEPATTERN_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <QRegularExpression>
+#include <functional>
+
+struct RenameRule
+{
+    QString find;
+    QString replace;
+    bool useRegex = false;
+    bool caseSensitive = false;
+    int counterStart = 1;
+    int counterStep = 1;
+    int counterPadding = 0;
+};
+
+struct RenamePlan
+{
+    enum Issue
+    {
+        NoIssue,
+        InvalidName,
+        DuplicateTarget,
+        TargetExists
+    };
+
+    QStringList newNames;
+    QList<Issue> issues;
+    QList<QPair<QString, QString>> orderedRenames;
+    qsizetype changedCount = 0;
+    qsizetype conflictCount = 0;
+    bool cancelled = false;
+};
+
+class RenamePattern
+{
+public:
+    explicit RenamePattern(const RenameRule &rule = RenameRule());
+
+    bool isValid() const;
+    QString errorString() const;
+    QString apply(const QString &fileName, qsizetype index) const;
+
+    RenamePlan plan(const QString &directory, const QStringList &names, const QSet<QString> &existingNames,
+                    const std::function<bool()> &isCancelled = nullptr) const;
+
+private:
+    RenameRule rule;
+    QRegularExpression expression;
+
+    QString expandTemplate(const QString &fileName, qsizetype index) const;
+    static QString nameKey(const QString &name);
+    static bool isValidName(const QString &name);
+};
+
+#endif // RENAMEPATTERN_H
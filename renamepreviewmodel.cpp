@@ -0,0 +1,97 @@
+#include "renamepreviewmodel.h"
+#include <QBrush>
+
+/**
+ * @file renamepreviewmodel.h
+ * @brief The RenamePreviewModel class shows the current and the planned name of every selected file.
+ * Rows that cannot be renamed are drawn in red with the reason as tooltip.
+ */
+
+RenamePreviewModel::RenamePreviewModel(const QStringList &names, QObject *parent)
+    : QAbstractTableModel(parent), originalNames(names)
+{
+}
+
+/**
+ * @brief Replaces the planned names. Only the data of the second column changes, so views keep their scroll position.
+ *
+ * @param plan The plan computed for originalNames.
+ */
+void RenamePreviewModel::setPlan(const RenamePlan &plan)
+{
+    renamePlan = plan;
+
+    if (!originalNames.isEmpty())
+    {
+        emit dataChanged(index(0, 1), index(int(originalNames.size()) - 1, 1));
+    }
+}
+
+const RenamePlan& RenamePreviewModel::plan() const
+{
+    return renamePlan;
+}
+
+int RenamePreviewModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(originalNames.size());
+}
+
+int RenamePreviewModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : 2;
+}
+
+/**
+ * @brief Returns the current name in the first column and the planned name in the second one.
+ */
+QVariant RenamePreviewModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= originalNames.size())
+    {
+        return QVariant();
+    }
+
+    const int row = index.row();
+    const bool planned = row < renamePlan.newNames.size();
+    const RenamePlan::Issue issue = row < renamePlan.issues.size() ? renamePlan.issues.at(row) : RenamePlan::NoIssue;
+
+    if (role == Qt::DisplayRole)
+    {
+        if (index.column() == 0)
+        {
+            return originalNames.at(row);
+        }
+        return planned ? renamePlan.newNames.at(row) : originalNames.at(row);
+    }
+    else if (role == Qt::ForegroundRole && index.column() == 1 && issue != RenamePlan::NoIssue)
+    {
+        return QBrush(Qt::red);
+    }
+    else if (role == Qt::ToolTipRole && issue != RenamePlan::NoIssue)
+    {
+        switch (issue)
+        {
+        case RenamePlan::InvalidName:
+            return tr("The new name is not a valid file name.");
+        case RenamePlan::DuplicateTarget:
+            return tr("Several files would get this name.");
+        case RenamePlan::TargetExists:
+            return tr("A file with this name already exists.");
+        default:
+            break;
+        }
+    }
+
+    return QVariant();
+}
+
+QVariant RenamePreviewModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole)
+    {
+        return section == 0 ? tr("Name") : tr("New name");
+    }
+
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
@@ -0,0 +1,26 @@
+#ifndef RENAMEPREVIEWMODEL_H
+#define RENAMEPREVIEWMODEL_H
+
+#include "renamepattern.h"
+#include <QAbstractTableModel>
+
+class RenamePreviewModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit RenamePreviewModel(const QStringList &names, QObject *parent = nullptr);
+
+    void setPlan(const RenamePlan &plan);
+    const RenamePlan& plan() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    QStringList originalNames;
+    RenamePlan renamePlan;
+};
+
+#endif // RENAMEPREVIEWMODEL_H
@@ -0,0 +1,964 @@
+#include "smartfolderindex.h"
+#include "filestatusreader.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+/**
+ * @file smartfolderindex.h
+ * @brief The SmartFolderIndex class keeps saved queries over a directory tree, e.g. "*.parquet size>100MB
+ * modified<24h" below /data, and shows their results as virtual folders.
+ * Every folder is crawled once. Per directory, the index keeps the directory stamp, its subdirectories and the
+ * files matching the name and size criteria. Afterwards the results are maintained incrementally: watched
+ * directories that change, and directories touched by the application's own file operations, are listed again on
+ * their own. New subdirectories are walked, removed ones are dropped. The time criteria are applied when the folder
+ * is listed, so the results age correctly without a rescan.
+ * The index is persisted. On the next start, and whenever a folder is opened, only the directories whose stamp
+ * changed are listed again.
+ */
+
+namespace
+{
+const char indexMagic[4] = { 'F', 'X', 'S', 'F' };
+const quint32 indexVersion = 1;
+const char pathPrefix[] = "smart:";
+const int maxWatchedDirectories = 8192;
+const int updateDelayMs = 500;
+
+template <typename T>
+void appendValue(QByteArray &buffer, T value)
+{
+    const T littleEndian = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char*>(&littleEndian), sizeof(T));
+}
+
+void appendString(QByteArray &buffer, const QString &text)
+{
+    const QByteArray bytes = text.toUtf8();
+    appendValue<quint32>(buffer, quint32(bytes.size()));
+    buffer.append(bytes);
+}
+
+class IndexReader
+{
+public:
+    IndexReader(const uchar *data, qint64 size) : data(data), size(size) {}
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (position + qint64(sizeof(T)) > size)
+        {
+            return false;
+        }
+
+        value = qFromLittleEndian<T>(data + position);
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readString(QString &value)
+    {
+        quint32 length = 0;
+        if (!read(length) || position + length > size)
+        {
+            return false;
+        }
+
+        value = QString::fromUtf8(reinterpret_cast<const char*>(data + position), length);
+        position += length;
+        return true;
+    }
+
+private:
+    const uchar *data;
+    qint64 size;
+    qint64 position = 0;
+};
+
+QString childPath(const QString &directory, const QString &name)
+{
+    return directory.endsWith('/') ? directory + name : directory + '/' + name;
+}
+
+/**
+ * @brief Returns true if both lists hold the same files with the same size and modification time.
+ */
+bool sameMatches(const DirectoryListing &a, const DirectoryListing &b)
+{
+    return std::equal(a.cbegin(), a.cend(), b.cbegin(), b.cend(), [](const DirectoryEntry &x, const DirectoryEntry &y)
+                      {
+                          return x.name == y.name && x.size == y.size && x.modifiedMs == y.modifiedMs;
+                      });
+}
+
+/**
+ * @brief Parses an amount with an optional unit, e.g. 100MB or 24h.
+ *
+ * @param units Unit names mapped to their factor; the empty unit must be included if a bare number is allowed.
+ */
+bool parseAmount(const QString &text, const QHash<QString, qint64> &units, qint64 &value)
+{
+    qsizetype unitStart = 0;
+    while (unitStart < text.size() && (text.at(unitStart).isDigit() || text.at(unitStart) == '.'))
+    {
+        ++unitStart;
+    }
+
+    bool isNumber = false;
+    const double number = text.left(unitStart).toDouble(&isNumber);
+    const auto factor = units.constFind(text.mid(unitStart).toLower());
+    if (!isNumber || factor == units.constEnd())
+    {
+        return false;
+    }
+
+    value = qint64(std::llround(number * double(*factor)));
+    return true;
+}
+}
+
+/**
+ * @brief Parses the criteria of a smart folder. Words are file name patterns (any of them has to match), plus
+ * size>N, size<N (units B, KB, MB, GB, TB), modified<N for files changed within, and modified>N for files not
+ * changed within the last N (units s, m or min, h, d, w), e.g. "*.parquet size>100MB modified<24h".
+ *
+ * @param root The directory whose tree is searched.
+ * @param criteria The criteria text.
+ * @param query Receives the parsed query.
+ * @param error Receives a description of malformed criteria.
+ * @return False if the criteria are malformed or the root is not a directory.
+ */
+bool SmartFolderQuery::parse(const QString &root, const QString &criteria, SmartFolderQuery &query, QString *error)
+{
+    static const QHash<QString, qint64> sizeUnits = {
+        { "", 1 }, { "b", 1 }, { "k", 1024 }, { "kb", 1024 }, { "m", 1024 * 1024 }, { "mb", 1024 * 1024 },
+        { "g", qint64(1) << 30 }, { "gb", qint64(1) << 30 }, { "t", qint64(1) << 40 }, { "tb", qint64(1) << 40 }
+    };
+    static const QHash<QString, qint64> timeUnits = {
+        { "s", 1000 }, { "m", 60 * 1000 }, { "min", 60 * 1000 }, { "h", 3600 * 1000 }, { "d", 24 * 3600 * 1000 }, { "w", 7 * 24 * 3600 * 1000 }
+    };
+
+    auto fail = [error](const QString &message)
+    {
+        if (error != nullptr)
+        {
+            *error = message;
+        }
+        return false;
+    };
+
+    query = SmartFolderQuery();
+    query.root = QDir::cleanPath(root);
+    query.criteria = criteria.simplified();
+    if (!QFileInfo(query.root).isDir())
+    {
+        return fail(QCoreApplication::translate("SmartFolderIndex", "%1 is not a directory").arg(root));
+    }
+
+    QString normalized = query.criteria;
+    normalized.replace(QRegularExpression("\\s*([<>])\\s*"), "\\1");
+    const QStringList words = normalized.split(' ', Qt::SkipEmptyParts);
+    for (const QString &word : words)
+    {
+        const qsizetype comparison = word.indexOf(QRegularExpression("[<>]"));
+        if (comparison < 0)
+        {
+            query.namePatterns << QRegularExpression::fromWildcard(word, Qt::CaseInsensitive);
+            continue;
+        }
+
+        const QString key = word.left(comparison).toLower();
+        const bool isGreater = word.at(comparison) == '>';
+        qint64 value = 0;
+        if (key == "size" && parseAmount(word.mid(comparison + 1), sizeUnits, value))
+        {
+            (isGreater ? query.minSize : query.maxSize) = isGreater ? value + 1 : std::max<qint64>(value - 1, 0);
+        }
+        else if (key == "modified" && parseAmount(word.mid(comparison + 1), timeUnits, value))
+        {
+            (isGreater ? query.modifiedBeforeMs : query.modifiedWithinMs) = value;
+        }
+        else
+        {
+            return fail(QCoreApplication::translate("SmartFolderIndex", "Cannot understand \"%1\"").arg(word));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Returns true if files have to be stat'ed to decide whether they match.
+ */
+bool SmartFolderQuery::needsStatus() const
+{
+    return minSize >= 0 || maxSize >= 0 || modifiedWithinMs > 0 || modifiedBeforeMs > 0;
+}
+
+bool SmartFolderQuery::matchesName(const QString &name) const
+{
+    if (namePatterns.isEmpty())
+    {
+        return true;
+    }
+
+    return std::any_of(namePatterns.cbegin(), namePatterns.cend(),
+                       [&name](const QRegularExpression &pattern) { return pattern.match(name).hasMatch(); });
+}
+
+/**
+ * @brief Checks the size and time criteria of a stat'ed file.
+ *
+ * @param nowMs The current time; time criteria are relative to it.
+ */
+bool SmartFolderQuery::matchesStatus(const DirectoryEntry &entry, qint64 nowMs) const
+{
+    return (minSize < 0 || entry.size >= minSize) && (maxSize < 0 || entry.size <= maxSize)
+           && (modifiedWithinMs <= 0 || nowMs - entry.modifiedMs <= modifiedWithinMs)
+           && (modifiedBeforeMs <= 0 || nowMs - entry.modifiedMs >= modifiedBeforeMs);
+}
+
+SmartFolderIndex::SmartFolderIndex()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    indexFilePath = directory + "/smartfolders.idx";
+
+    scanPool.setMaxThreadCount(1);
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(updateDelayMs);
+
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, this, &SmartFolderIndex::scheduleUpdate);
+    connect(&updateTimer, &QTimer::timeout, this, [this]()
+            {
+                const QStringList directories(pendingDirectories.cbegin(), pendingDirectories.cend());
+                pendingDirectories.clear();
+                scanPool.start([this, directories]() { update(directories); });
+            });
+
+    loadDefinitions();
+}
+
+SmartFolderIndex::~SmartFolderIndex()
+{
+    isShuttingDown = true;
+    scanPool.clear();
+    scanPool.waitForDone();
+}
+
+SmartFolderIndex& SmartFolderIndex::instance()
+{
+    static SmartFolderIndex instance;
+    return instance;
+}
+
+/**
+ * @brief Returns true if the path names a smart folder rather than a directory.
+ */
+bool SmartFolderIndex::isSmartFolderPath(const QString &path)
+{
+    return path.startsWith(QLatin1String(pathPrefix));
+}
+
+QString SmartFolderIndex::pathForFolder(const QString &name)
+{
+    return QLatin1String(pathPrefix) + name;
+}
+
+QStringList SmartFolderIndex::folderNames() const
+{
+    QReadLocker locker(&lock);
+    return folders.keys();
+}
+
+/**
+ * @brief Saves a smart folder, replacing one with the same name, and crawls its tree in the background.
+ *
+ * @return False if the name is empty.
+ */
+bool SmartFolderIndex::addFolder(const QString &name, const SmartFolderQuery &query)
+{
+    if (name.trimmed().isEmpty())
+    {
+        return false;
+    }
+
+    {
+        QWriteLocker locker(&lock);
+        Folder folder;
+        folder.query = query;
+        folder.generation = nextGeneration++;
+        folders.insert(name.trimmed(), folder);
+        dirty = true;
+    }
+
+    saveDefinitions();
+    emit foldersChanged();
+    emit resultsChanged(pathForFolder(name.trimmed()));
+    scanFolder(name.trimmed());
+    return true;
+}
+
+void SmartFolderIndex::removeFolder(const QString &name)
+{
+    {
+        QWriteLocker locker(&lock);
+        if (folders.remove(name) == 0)
+        {
+            return;
+        }
+        dirty = true;
+    }
+
+    saveDefinitions();
+    updateWatchedDirectories();
+    emit foldersChanged();
+    emit resultsChanged(pathForFolder(name));
+}
+
+/**
+ * @brief Lists the files of a smart folder that match its criteria now. Entry names are absolute paths.
+ *
+ * @return False if there is no such folder.
+ */
+bool SmartFolderIndex::listing(const QString &path, DirectoryListing &listing) const
+{
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+
+    QReadLocker locker(&lock);
+    const auto folder = folders.constFind(path.mid(int(std::strlen(pathPrefix))));
+    if (folder == folders.constEnd())
+    {
+        return false;
+    }
+
+    const bool checksStatus = folder->query.needsStatus();
+    for (auto directory = folder->directories.cbegin(); directory != folder->directories.cend(); ++directory)
+    {
+        for (const DirectoryEntry &match : directory->matches)
+        {
+            if (!checksStatus || folder->query.matchesStatus(match, nowMs))
+            {
+                DirectoryEntry entry = match;
+                entry.name = childPath(directory.key(), match.name);
+                listing.append(entry);
+            }
+        }
+    }
+    locker.unlock();
+
+    std::sort(listing.begin(), listing.end(), DirectoryListingCache::entryLessThan);
+    return true;
+}
+
+/**
+ * @brief Loads the persisted results in the background. Directories whose stamp changed since they were indexed
+ * are listed again, folders without results are crawled.
+ */
+void SmartFolderIndex::restore()
+{
+    scanPool.start([this]()
+                   {
+                       load();
+
+                       QStringList unscanned;
+                       QStringList scanned;
+                       {
+                           QReadLocker locker(&lock);
+                           for (auto folder = folders.cbegin(); folder != folders.cend(); ++folder)
+                           {
+                               (folder->isReady ? scanned : unscanned) << folder.key();
+                           }
+                       }
+
+                       for (const QString &name : std::as_const(scanned))
+                       {
+                           revalidate(pathForFolder(name));
+                       }
+                       for (const QString &name : std::as_const(unscanned))
+                       {
+                           scanFolder(name);
+                       }
+                       QMetaObject::invokeMethod(this, [this, scanned]() { finishUpdate(scanned); }, Qt::QueuedConnection);
+                   });
+}
+
+/**
+ * @brief Checks the stamps of all directories of a smart folder in the background and lists the changed ones
+ * again, e.g. when the folder is opened. Costs one stat per directory.
+ */
+void SmartFolderIndex::revalidate(const QString &path)
+{
+    const QString name = path.mid(int(std::strlen(pathPrefix)));
+    scanPool.start([this, name]()
+                   {
+                       QHash<QString, DirectoryStamp> stamps;
+                       {
+                           QReadLocker locker(&lock);
+                           const auto folder = folders.constFind(name);
+                           if (folder == folders.constEnd() || !folder->isReady)
+                           {
+                               return;
+                           }
+
+                           stamps.reserve(folder->directories.size());
+                           for (auto directory = folder->directories.cbegin(); directory != folder->directories.cend(); ++directory)
+                           {
+                               stamps.insert(directory.key(), directory->stamp);
+                           }
+                       }
+
+                       QStringList changed;
+                       for (auto stamp = stamps.cbegin(); stamp != stamps.cend() && !isShuttingDown; ++stamp)
+                       {
+                           if (DirectoryListingCache::stampForPath(stamp.key()) != *stamp)
+                           {
+                               changed << stamp.key();
+                           }
+                       }
+                       update(changed);
+                   });
+}
+
+/**
+ * @brief Crawls the tree of a smart folder again, e.g. to pick up files that were changed in place, which does not
+ * touch their directory.
+ */
+void SmartFolderIndex::rescan(const QString &path)
+{
+    scanFolder(path.mid(int(std::strlen(pathPrefix))));
+}
+
+/**
+ * @brief Lists a changed directory again shortly, changes arriving in the meantime are applied together.
+ */
+void SmartFolderIndex::scheduleUpdate(const QString &directory)
+{
+    const QString cleanDirectory = QDir::cleanPath(directory);
+    {
+        QReadLocker locker(&lock);
+        const bool isIndexed = std::any_of(folders.cbegin(), folders.cend(), [&cleanDirectory](const Folder &folder)
+                                           {
+                                               return folder.directories.contains(cleanDirectory);
+                                           });
+        if (!isIndexed)
+        {
+            return;
+        }
+    }
+
+    pendingDirectories.insert(cleanDirectory);
+    updateTimer.start();
+}
+
+/**
+ * @brief Stops crawling and writes the results to disk, e.g. before the application quits.
+ */
+void SmartFolderIndex::save()
+{
+    isShuttingDown = true;
+    updateTimer.stop();
+    scanPool.clear();
+    scanPool.waitForDone();
+    write();
+}
+
+/**
+ * @brief Reads the saved folder definitions from the settings.
+ */
+void SmartFolderIndex::loadDefinitions()
+{
+    QSettings settings("FileManager", "SmartFolders");
+    const int count = settings.beginReadArray("Folders");
+    for (int i = 0; i < count; ++i)
+    {
+        settings.setArrayIndex(i);
+        Folder folder;
+        if (SmartFolderQuery::parse(settings.value("Root").toString(), settings.value("Criteria").toString(), folder.query))
+        {
+            folder.generation = nextGeneration++;
+            folders.insert(settings.value("Name").toString(), folder);
+        }
+    }
+    settings.endArray();
+}
+
+void SmartFolderIndex::saveDefinitions() const
+{
+    QSettings settings("FileManager", "SmartFolders");
+    QReadLocker locker(&lock);
+    settings.beginWriteArray("Folders", int(folders.size()));
+    int i = 0;
+    for (auto folder = folders.cbegin(); folder != folders.cend(); ++folder)
+    {
+        settings.setArrayIndex(i++);
+        settings.setValue("Name", folder.key());
+        settings.setValue("Root", folder->query.root);
+        settings.setValue("Criteria", folder->query.criteria);
+    }
+    settings.endArray();
+}
+
+/**
+ * @brief Crawls the whole tree of a smart folder on the scan pool and replaces its results. Safe to call from
+ * any thread.
+ */
+void SmartFolderIndex::scanFolder(const QString &name)
+{
+    SmartFolderQuery query;
+    quint64 generation = 0;
+    {
+        QReadLocker locker(&lock);
+        const auto folder = folders.constFind(name);
+        if (folder == folders.constEnd())
+        {
+            return;
+        }
+        query = folder->query;
+        generation = folder->generation;
+    }
+
+    scanPool.start([this, name, query, generation]()
+                   {
+                       QHash<QString, ScannedDirectory> directories;
+                       walk(query.root, query, directories, isShuttingDown);
+                       if (isShuttingDown)
+                       {
+                           return;
+                       }
+
+                       {
+                           QWriteLocker locker(&lock);
+                           auto folder = folders.find(name);
+                           if (folder == folders.end() || folder->generation != generation)
+                           {
+                               return;
+                           }
+                           folder->directories.swap(directories);
+                           folder->isReady = true;
+                           dirty = true;
+                       }
+
+                       write();
+                       QMetaObject::invokeMethod(this, [this, name]() { finishUpdate({ name }); }, Qt::QueuedConnection);
+                   });
+}
+
+/**
+ * @brief Lists changed directories again for every folder that indexes them. New subdirectories are walked and
+ * removed ones are dropped with their subtrees. Runs on the scan pool.
+ */
+void SmartFolderIndex::update(const QStringList &directories)
+{
+    struct Target
+    {
+        QString name;
+        quint64 generation = 0;
+        SmartFolderQuery query;
+        QStringList subdirectories;
+    };
+
+    QSet<QString> changedFolders;
+    for (const QString &directory : directories)
+    {
+        QList<Target> targets;
+        {
+            QReadLocker locker(&lock);
+            for (auto folder = folders.cbegin(); folder != folders.cend(); ++folder)
+            {
+                const auto indexed = folder->directories.constFind(directory);
+                if (folder->isReady && indexed != folder->directories.constEnd())
+                {
+                    targets.append({ folder.key(), folder->generation, folder->query, indexed->subdirectories });
+                }
+            }
+        }
+
+        for (const Target &target : std::as_const(targets))
+        {
+            // A removed directory is dropped when its parent is listed again.
+            const ScannedDirectory scanned = scanDirectory(directory, target.query);
+            if (!scanned.stamp.isValid())
+            {
+                continue;
+            }
+
+            const QSet<QString> previous(target.subdirectories.cbegin(), target.subdirectories.cend());
+            const QSet<QString> current(scanned.subdirectories.cbegin(), scanned.subdirectories.cend());
+            QHash<QString, ScannedDirectory> added;
+            for (const QString &subdirectory : current)
+            {
+                if (!previous.contains(subdirectory))
+                {
+                    walk(childPath(directory, subdirectory), target.query, added, isShuttingDown);
+                }
+            }
+            if (isShuttingDown)
+            {
+                return;
+            }
+
+            QWriteLocker locker(&lock);
+            auto folder = folders.find(target.name);
+            if (folder == folders.end() || folder->generation != target.generation)
+            {
+                continue;
+            }
+
+            bool isChanged = !sameMatches(folder->directories.value(directory).matches, scanned.matches);
+            for (const QString &subdirectory : previous)
+            {
+                if (!current.contains(subdirectory))
+                {
+                    removeTree(folder->directories, childPath(directory, subdirectory));
+                    isChanged = true;
+                }
+            }
+            for (auto it = added.cbegin(); it != added.cend(); ++it)
+            {
+                isChanged = isChanged || !it->matches.isEmpty();
+                folder->directories.insert(it.key(), *it);
+            }
+            folder->directories.insert(directory, scanned);
+            dirty = true;
+
+            if (isChanged)
+            {
+                changedFolders.insert(target.name);
+            }
+        }
+    }
+
+    if (!directories.isEmpty())
+    {
+        const QStringList changed(changedFolders.cbegin(), changedFolders.cend());
+        QMetaObject::invokeMethod(this, [this, changed]() { finishUpdate(changed); }, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Announces changed results and follows the indexed directories with the watcher.
+ */
+void SmartFolderIndex::finishUpdate(const QStringList &changedFolders)
+{
+    updateWatchedDirectories();
+    for (const QString &name : changedFolders)
+    {
+        emit resultsChanged(pathForFolder(name));
+    }
+}
+
+/**
+ * @brief Watches the indexed directories of all folders, the shallowest first if there are more than the watcher
+ * limit. Changes below unwatched directories are picked up when the folder is opened.
+ */
+void SmartFolderIndex::updateWatchedDirectories()
+{
+    QSet<QString> wantedSet;
+    {
+        QReadLocker locker(&lock);
+        for (const Folder &folder : folders)
+        {
+            for (auto directory = folder.directories.cbegin(); directory != folder.directories.cend(); ++directory)
+            {
+                wantedSet.insert(directory.key());
+            }
+        }
+    }
+
+    QStringList wanted(wantedSet.cbegin(), wantedSet.cend());
+    if (wanted.size() > maxWatchedDirectories)
+    {
+        std::partial_sort(wanted.begin(), wanted.begin() + maxWatchedDirectories, wanted.end(),
+                          [](const QString &a, const QString &b) { return a.count('/') < b.count('/'); });
+        wanted.resize(maxWatchedDirectories);
+        wantedSet = QSet<QString>(wanted.cbegin(), wanted.cend());
+    }
+
+    const QStringList watched = watcher.directories();
+    const QSet<QString> watchedSet(watched.cbegin(), watched.cend());
+
+    QStringList unwanted;
+    for (const QString &path : watched)
+    {
+        if (!wantedSet.contains(path))
+        {
+            unwanted << path;
+        }
+    }
+    if (!unwanted.isEmpty())
+    {
+        watcher.removePaths(unwanted);
+    }
+
+    QStringList added;
+    for (const QString &path : std::as_const(wanted))
+    {
+        if (!watchedSet.contains(path))
+        {
+            added << path;
+        }
+    }
+    if (!added.isEmpty())
+    {
+        watcher.addPaths(added);
+    }
+}
+
+/**
+ * @brief Writes the results of all crawled folders to disk if they changed.
+ */
+void SmartFolderIndex::write()
+{
+    QByteArray buffer;
+    {
+        QReadLocker locker(&lock);
+        if (!dirty)
+        {
+            return;
+        }
+
+        quint32 readyCount = 0;
+        for (const Folder &folder : folders)
+        {
+            readyCount += folder.isReady ? 1 : 0;
+        }
+
+        buffer.append(indexMagic, sizeof(indexMagic));
+        appendValue<quint32>(buffer, indexVersion);
+        appendValue<quint32>(buffer, readyCount);
+        for (auto folder = folders.cbegin(); folder != folders.cend(); ++folder)
+        {
+            if (!folder->isReady)
+            {
+                continue;
+            }
+
+            appendString(buffer, folder.key());
+            appendString(buffer, folder->query.root);
+            appendString(buffer, folder->query.criteria);
+            appendValue<quint32>(buffer, quint32(folder->directories.size()));
+            for (auto directory = folder->directories.cbegin(); directory != folder->directories.cend(); ++directory)
+            {
+                appendString(buffer, directory.key());
+                appendValue<qint64>(buffer, directory->stamp.modifiedNs);
+                appendValue<quint64>(buffer, directory->stamp.inode);
+                appendValue<quint32>(buffer, quint32(directory->subdirectories.size()));
+                for (const QString &subdirectory : directory->subdirectories)
+                {
+                    appendString(buffer, subdirectory);
+                }
+                appendValue<quint32>(buffer, quint32(directory->matches.size()));
+                for (const DirectoryEntry &match : directory->matches)
+                {
+                    appendString(buffer, match.name);
+                    appendValue<qint64>(buffer, match.size);
+                    appendValue<qint64>(buffer, match.modifiedMs);
+                }
+            }
+        }
+    }
+
+    QSaveFile file(indexFilePath);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(buffer);
+        if (file.commit())
+        {
+            QWriteLocker locker(&lock);
+            dirty = false;
+        }
+    }
+}
+
+/**
+ * @brief Reads the persisted results into the folders whose definition did not change. Runs on the scan pool.
+ *
+ * @return True if results were loaded.
+ */
+bool SmartFolderIndex::load()
+{
+    QFile file(indexFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (data == nullptr || size < qint64(sizeof(indexMagic)) || std::memcmp(data, indexMagic, sizeof(indexMagic)) != 0)
+    {
+        return false;
+    }
+
+    IndexReader reader(data + sizeof(indexMagic), size - qint64(sizeof(indexMagic)));
+    quint32 version = 0;
+    quint32 folderTotal = 0;
+    if (!reader.read(version) || version != indexVersion || !reader.read(folderTotal))
+    {
+        return false;
+    }
+
+    QHash<QString, Folder> loadedFolders;
+    for (quint32 i = 0; i < folderTotal; ++i)
+    {
+        QString name;
+        Folder folder;
+        quint32 directoryTotal = 0;
+        if (!reader.readString(name) || !reader.readString(folder.query.root) || !reader.readString(folder.query.criteria)
+            || !reader.read(directoryTotal))
+        {
+            return false;
+        }
+
+        for (quint32 j = 0; j < directoryTotal; ++j)
+        {
+            QString path;
+            ScannedDirectory directory;
+            quint32 subdirectoryTotal = 0;
+            quint32 matchTotal = 0;
+            if (!reader.readString(path) || !reader.read(directory.stamp.modifiedNs) || !reader.read(directory.stamp.inode)
+                || !reader.read(subdirectoryTotal))
+            {
+                return false;
+            }
+
+            for (quint32 k = 0; k < subdirectoryTotal; ++k)
+            {
+                QString subdirectory;
+                if (!reader.readString(subdirectory))
+                {
+                    return false;
+                }
+                directory.subdirectories << subdirectory;
+            }
+
+            if (!reader.read(matchTotal))
+            {
+                return false;
+            }
+            for (quint32 k = 0; k < matchTotal; ++k)
+            {
+                DirectoryEntry match;
+                if (!reader.readString(match.name) || !reader.read(match.size) || !reader.read(match.modifiedMs))
+                {
+                    return false;
+                }
+                match.hasStatus = false;
+                directory.matches.append(match);
+            }
+            folder.directories.insert(path, directory);
+        }
+        loadedFolders.insert(name, std::move(folder));
+    }
+
+    QWriteLocker locker(&lock);
+    for (auto folder = folders.begin(); folder != folders.end(); ++folder)
+    {
+        const auto loaded = loadedFolders.constFind(folder.key());
+        if (!folder->isReady && loaded != loadedFolders.constEnd() && loaded->query.root == folder->query.root
+            && loaded->query.criteria == folder->query.criteria)
+        {
+            folder->directories = loaded->directories;
+            folder->isReady = true;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Lists one directory and keeps its subdirectories and the files matching the name and size criteria.
+ * Symbolic links to directories are not followed. Files are only stat'ed if the query has size or time criteria.
+ */
+SmartFolderIndex::ScannedDirectory SmartFolderIndex::scanDirectory(const QString &directory, const SmartFolderQuery &query)
+{
+    ScannedDirectory scanned;
+    scanned.stamp = DirectoryListingCache::stampForPath(directory);
+    if (!scanned.stamp.isValid())
+    {
+        return scanned;
+    }
+
+    const DirectoryListing entries = DirectoryListingCache::readDirectory(directory);
+    DirectoryListing candidates;
+    for (const DirectoryEntry &entry : entries)
+    {
+        if (entry.isDir)
+        {
+            if (!QFileInfo(childPath(directory, entry.name)).isSymLink())
+            {
+                scanned.subdirectories << entry.name;
+            }
+        }
+        else if (query.matchesName(entry.name))
+        {
+            candidates.append(entry);
+        }
+    }
+
+    if (!query.needsStatus())
+    {
+        scanned.matches = candidates;
+        return scanned;
+    }
+
+    // Time criteria are relative to when the folder is listed, so only the size is decided here.
+    FileStatusReader::read(directory, candidates);
+    for (DirectoryEntry &candidate : candidates)
+    {
+        if (candidate.mode != 0 && (query.minSize < 0 || candidate.size >= query.minSize)
+            && (query.maxSize < 0 || candidate.size <= query.maxSize))
+        {
+            candidate.hasStatus = false;
+            scanned.matches.append(candidate);
+        }
+    }
+    return scanned;
+}
+
+/**
+ * @brief Scans a directory and everything below it.
+ *
+ * @param isCancelled Stops the walk when set; the collected directories are incomplete then.
+ */
+void SmartFolderIndex::walk(const QString &directory, const SmartFolderQuery &query, QHash<QString, ScannedDirectory> &directories,
+                            const std::atomic<bool> &isCancelled)
+{
+    QStringList pending = { directory };
+    while (!pending.isEmpty() && !isCancelled)
+    {
+        const QString path = pending.takeLast();
+        ScannedDirectory scanned = scanDirectory(path, query);
+        if (!scanned.stamp.isValid())
+        {
+            continue;
+        }
+
+        for (const QString &subdirectory : std::as_const(scanned.subdirectories))
+        {
+            pending << childPath(path, subdirectory);
+        }
+        directories.insert(path, std::move(scanned));
+    }
+}
+
+/**
+ * @brief Drops a directory and its indexed subdirectories.
+ */
+void SmartFolderIndex::removeTree(QHash<QString, ScannedDirectory> &directories, const QString &directory)
+{
+    const ScannedDirectory removed = directories.take(directory);
+    for (const QString &subdirectory : removed.subdirectories)
+    {
+        removeTree(directories, childPath(directory, subdirectory));
+    }
+}
@@ -0,0 +1,103 @@
+#ifndef SMARTFOLDERINDEX_H
+#define SMARTFOLDERINDEX_H
+
+#include "directorylistingcache.h"
+#include <QObject>
+#include <QFileSystemWatcher>
+#include <QRegularExpression>
+#include <QHash>
+#include <QMap>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+
+struct SmartFolderQuery
+{
+    QString root;
+    QString criteria;
+    QList<QRegularExpression> namePatterns;
+    qint64 minSize = -1;
+    qint64 maxSize = -1;
+    qint64 modifiedWithinMs = 0;
+    qint64 modifiedBeforeMs = 0;
+
+    static bool parse(const QString &root, const QString &criteria, SmartFolderQuery &query, QString *error = nullptr);
+    bool needsStatus() const;
+    bool matchesName(const QString &name) const;
+    bool matchesStatus(const DirectoryEntry &entry, qint64 nowMs) const;
+};
+
+class SmartFolderIndex : public QObject
+{
+    Q_OBJECT
+public:
+    static SmartFolderIndex& instance();
+
+    static bool isSmartFolderPath(const QString &path);
+    static QString pathForFolder(const QString &name);
+
+    QStringList folderNames() const;
+    bool addFolder(const QString &name, const SmartFolderQuery &query);
+    void removeFolder(const QString &name);
+    bool listing(const QString &path, DirectoryListing &listing) const;
+
+    void restore();
+    void revalidate(const QString &path);
+    void rescan(const QString &path);
+    void scheduleUpdate(const QString &directory);
+    void save();
+
+private:
+    SmartFolderIndex();
+    ~SmartFolderIndex();
+
+    struct ScannedDirectory
+    {
+        DirectoryStamp stamp;
+        QStringList subdirectories;
+        DirectoryListing matches;
+    };
+
+    struct Folder
+    {
+        SmartFolderQuery query;
+        quint64 generation = 0;
+        bool isReady = false;
+        QHash<QString, ScannedDirectory> directories;
+    };
+
+    mutable QReadWriteLock lock;
+    QMap<QString, Folder> folders;
+    quint64 nextGeneration = 1;
+    bool dirty = false;
+
+    QString indexFilePath;
+    QThreadPool scanPool;
+    std::atomic<bool> isShuttingDown { false };
+    QFileSystemWatcher watcher;
+    QTimer updateTimer;
+    QSet<QString> pendingDirectories;
+
+    void loadDefinitions();
+    void saveDefinitions() const;
+    void scanFolder(const QString &name);
+    void update(const QStringList &directories);
+    void finishUpdate(const QStringList &changedFolders);
+    void updateWatchedDirectories();
+    void write();
+    bool load();
+
+    static ScannedDirectory scanDirectory(const QString &directory, const SmartFolderQuery &query);
+    static void walk(const QString &directory, const SmartFolderQuery &query, QHash<QString, ScannedDirectory> &directories,
+                     const std::atomic<bool> &isCancelled);
+    static void removeTree(QHash<QString, ScannedDirectory> &directories, const QString &directory);
+
+signals:
+    void foldersChanged();
+    void resultsChanged(const QString &path);
+};
+
+#endif // SMARTFOLDERINDEX_H
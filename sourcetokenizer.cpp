@@ -0,0 +1,269 @@
+#include "sourcetokenizer.h"
+#include <QFileInfo>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @file sourcetokenizer.h
+ * @brief The SourceTokenizer class splits lines of source code into keywords, comments, strings, numbers and
+ * preprocessor lines for a few common languages, chosen by file suffix.
+ * Lines are tokenized one at a time on their UTF-8 bytes. The only thing carried from one line to the next is a
+ * small integer state, open block comments and triple-quoted strings, so a highlighter can resume anywhere it
+ * saved the state of an earlier line.
+ */
+
+namespace
+{
+inline bool isIdentifierByte(uchar c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c >= 0x80;
+}
+
+inline bool isDigit(uchar c)
+{
+    return c >= '0' && c <= '9';
+}
+
+inline bool startsWithAt(const char *line, qsizetype length, qsizetype position, const QByteArray &text)
+{
+    return !text.isEmpty() && position + text.size() <= length && std::memcmp(line + position, text.constData(), text.size()) == 0;
+}
+
+/**
+ * @brief Returns the position of text in [from, length) of the line, or -1.
+ */
+qsizetype findIn(const char *line, qsizetype length, qsizetype from, const QByteArray &text)
+{
+    for (qsizetype position = from; position + text.size() <= length; ++position)
+    {
+        if (std::memcmp(line + position, text.constData(), text.size()) == 0)
+        {
+            return position;
+        }
+    }
+    return -1;
+}
+
+void addToken(QList<SourceToken> *tokens, qsizetype start, qsizetype end, SourceTokenizer::Kind kind)
+{
+    if (tokens != nullptr && end > start)
+    {
+        tokens->append({ int(start), int(end - start), kind });
+    }
+}
+
+const char *cKeywords = "auto break case char const constexpr continue default do double else enum extern float for goto if inline "
+                        "int long register return short signed sizeof static struct switch typedef union unsigned void volatile "
+                        "while bool true false nullptr class namespace template typename public private protected virtual "
+                        "override final new delete this operator friend using try catch throw noexcept explicit mutable "
+                        "static_cast dynamic_cast reinterpret_cast const_cast decltype concept requires co_await co_return "
+                        "co_yield signals slots emit";
+const char *javaKeywords = "abstract assert boolean break byte case catch char class const continue default do double else enum "
+                           "extends final finally float for if implements import instanceof int interface long native new "
+                           "package private protected public return short static super switch synchronized this throw throws "
+                           "try void volatile while true false null var record sealed permits yield fun val when object "
+                           "companion data internal override open lateinit by in is";
+const char *csKeywords = "abstract as base bool break byte case catch char checked class const continue decimal default delegate do "
+                         "double else enum event explicit extern false finally fixed float for foreach goto if implicit in int "
+                         "interface internal is lock long namespace new null object operator out override params private "
+                         "protected public readonly ref return sbyte sealed short sizeof static string struct switch this "
+                         "throw true try typeof uint ulong unchecked unsafe ushort using var virtual void volatile while async "
+                         "await get set value record";
+const char *jsKeywords = "break case catch class const continue debugger default delete do else export extends finally for "
+                         "function if import in instanceof let new return super switch this throw try typeof var void while "
+                         "with yield async await of true false null undefined static get set interface type enum implements "
+                         "private protected public readonly namespace declare abstract as from";
+const char *goKeywords = "break case chan const continue default defer else fallthrough for func go goto if import interface map "
+                         "package range return select struct switch type var true false nil iota";
+const char *rustKeywords = "as async await break const continue crate dyn else enum extern false fn for if impl in let loop match "
+                           "mod move mut pub ref return self Self static struct super trait true type unsafe use where while";
+const char *pythonKeywords = "False None True and as assert async await break class continue def del elif else except finally for "
+                             "from global if import in is lambda nonlocal not or pass raise return try while with yield match case "
+                             "self";
+const char *shellKeywords = "if then else elif fi case esac for while until do done in function select time return local export "
+                            "readonly declare unset shift exit break continue source alias echo";
+const char *cmakeKeywords = "if elseif else endif foreach endforeach while endwhile function endfunction macro endmacro set unset "
+                            "option project add_executable add_library target_link_libraries target_include_directories "
+                            "target_compile_definitions find_package include install message return";
+}
+
+SourceTokenizer::SourceTokenizer(const char *name, const char *suffixes, const char *keywords, const char *lineComment,
+                                 const char *blockStart, const char *blockEnd, const char *quotes, bool hasTripleQuotes,
+                                 bool hasPreprocessor)
+    : name(QString::fromLatin1(name)), fileSuffixes(QString::fromLatin1(suffixes).split(' ')), lineCommentStart(lineComment),
+      blockCommentStart(blockStart), blockCommentEnd(blockEnd), quoteCharacters(quotes), tripleQuotes(hasTripleQuotes),
+      preprocessor(hasPreprocessor)
+{
+    const QList<QByteArray> words = QByteArray(keywords).split(' ');
+    for (const QByteArray &word : words)
+    {
+        keywordSet.insert(word);
+    }
+}
+
+const QList<SourceTokenizer>& SourceTokenizer::languages()
+{
+    static const QList<SourceTokenizer> table = {
+        SourceTokenizer("C/C++", "c cc cpp cxx c++ h hh hpp hxx ino", cKeywords, "//", "/*", "*/", "\"'", false, true),
+        SourceTokenizer("C#", "cs", csKeywords, "//", "/*", "*/", "\"'", false, true),
+        SourceTokenizer("Java/Kotlin", "java kt kts scala groovy", javaKeywords, "//", "/*", "*/", "\"'", false, false),
+        SourceTokenizer("JavaScript/TypeScript", "js mjs cjs jsx ts tsx", jsKeywords, "//", "/*", "*/", "\"'`", false, false),
+        SourceTokenizer("Go", "go", goKeywords, "//", "/*", "*/", "\"'`", false, false),
+        SourceTokenizer("Rust", "rs", rustKeywords, "//", "/*", "*/", "\"", false, false),
+        SourceTokenizer("Python", "py pyw pyi", pythonKeywords, "#", "", "", "\"'", true, false),
+        SourceTokenizer("Shell", "sh bash zsh", shellKeywords, "#", "", "", "\"'", false, false),
+        SourceTokenizer("CMake", "cmake", cmakeKeywords, "#", "", "", "\"", false, false),
+    };
+    return table;
+}
+
+/**
+ * @brief Returns the tokenizer for a file name, or nullptr for files that are shown as plain text.
+ */
+const SourceTokenizer* SourceTokenizer::forFileName(const QString &fileName)
+{
+    const QFileInfo fileInfo(fileName);
+    const QString suffix = fileInfo.suffix().toLower();
+    const bool isCMakeLists = fileInfo.fileName().compare("CMakeLists.txt", Qt::CaseInsensitive) == 0;
+
+    for (const SourceTokenizer &language : languages())
+    {
+        if ((isCMakeLists && language.name == "CMake") || (!isCMakeLists && language.fileSuffixes.contains(suffix)))
+        {
+            return &language;
+        }
+    }
+    return nullptr;
+}
+
+QString SourceTokenizer::languageName() const
+{
+    return name;
+}
+
+/**
+ * @brief Tokenizes one line.
+ *
+ * @param line The bytes of the line, without the line break.
+ * @param length The length of the line.
+ * @param state The state at the end of the previous line, Normal for the first line.
+ * @param tokens Receives the tokens that are not plain text, in order; may be nullptr to only advance the state.
+ * @return The state at the end of the line.
+ */
+int SourceTokenizer::tokenizeLine(const char *line, qsizetype length, int state, QList<SourceToken> *tokens) const
+{
+    qsizetype position = 0;
+
+    if (state == InBlockComment || state == InTripleDoubleQuote || state == InTripleSingleQuote)
+    {
+        const QByteArray &end = state == InBlockComment ? blockCommentEnd : state == InTripleDoubleQuote ? QByteArray("\"\"\"") : QByteArray("'''");
+        const qsizetype found = findIn(line, length, 0, end);
+        const Kind kind = state == InBlockComment ? Comment : String;
+        if (found < 0)
+        {
+            addToken(tokens, 0, length, kind);
+            return state;
+        }
+        position = found + end.size();
+        addToken(tokens, 0, position, kind);
+    }
+
+    if (preprocessor && position == 0)
+    {
+        qsizetype first = 0;
+        while (first < length && (line[first] == ' ' || line[first] == '\t'))
+        {
+            ++first;
+        }
+        if (first < length && line[first] == '#')
+        {
+            const qsizetype comment = findIn(line, length, first, lineCommentStart);
+            addToken(tokens, first, comment < 0 ? length : comment, Preprocessor);
+            addToken(tokens, comment < 0 ? length : comment, length, Comment);
+            return Normal;
+        }
+    }
+
+    while (position < length)
+    {
+        const uchar c = uchar(line[position]);
+
+        if (startsWithAt(line, length, position, lineCommentStart))
+        {
+            addToken(tokens, position, length, Comment);
+            return Normal;
+        }
+
+        if (startsWithAt(line, length, position, blockCommentStart))
+        {
+            const qsizetype found = findIn(line, length, position + blockCommentStart.size(), blockCommentEnd);
+            if (found < 0)
+            {
+                addToken(tokens, position, length, Comment);
+                return InBlockComment;
+            }
+            addToken(tokens, position, found + blockCommentEnd.size(), Comment);
+            position = found + blockCommentEnd.size();
+            continue;
+        }
+
+        if (tripleQuotes && (c == '"' || c == '\'') && position + 2 < length && uchar(line[position + 1]) == c
+            && uchar(line[position + 2]) == c)
+        {
+            const QByteArray delimiter(3, char(c));
+            const qsizetype found = findIn(line, length, position + 3, delimiter);
+            if (found < 0)
+            {
+                addToken(tokens, position, length, String);
+                return c == '"' ? InTripleDoubleQuote : InTripleSingleQuote;
+            }
+            addToken(tokens, position, found + 3, String);
+            position = found + 3;
+            continue;
+        }
+
+        if (quoteCharacters.contains(char(c)))
+        {
+            qsizetype end = position + 1;
+            while (end < length && uchar(line[end]) != c)
+            {
+                end += line[end] == '\\' ? 2 : 1;
+            }
+            end = std::min(end + 1, length);
+            addToken(tokens, position, end, String);
+            position = end;
+            continue;
+        }
+
+        if (isDigit(c) || (c == '.' && position + 1 < length && isDigit(uchar(line[position + 1]))))
+        {
+            qsizetype end = position + 1;
+            while (end < length && (isIdentifierByte(uchar(line[end])) || line[end] == '.'))
+            {
+                ++end;
+            }
+            addToken(tokens, position, end, Number);
+            position = end;
+            continue;
+        }
+
+        if (isIdentifierByte(c))
+        {
+            qsizetype end = position + 1;
+            while (end < length && isIdentifierByte(uchar(line[end])))
+            {
+                ++end;
+            }
+            if (keywordSet.contains(QByteArray::fromRawData(line + position, end - position)))
+            {
+                addToken(tokens, position, end, Keyword);
+            }
+            position = end;
+            continue;
+        }
+
+        ++position;
+    }
+
+    return Normal;
+}
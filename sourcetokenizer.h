@@ -0,0 +1,61 @@
+#ifndef SOURCETOKENIZER_H
+#define SOURCETOKENIZER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+struct SourceToken
+{
+    int start = 0;
+    int length = 0;
+    quint8 kind = 0;
+};
+
+class SourceTokenizer
+{
+public:
+    enum Kind : quint8
+    {
+        Plain,
+        Keyword,
+        Comment,
+        String,
+        Number,
+        Preprocessor
+    };
+
+    enum State
+    {
+        Normal,
+        InBlockComment,
+        InTripleDoubleQuote,
+        InTripleSingleQuote
+    };
+
+    static const SourceTokenizer* forFileName(const QString &fileName);
+
+    QString languageName() const;
+    int tokenizeLine(const char *line, qsizetype length, int state, QList<SourceToken> *tokens) const;
+
+private:
+    SourceTokenizer(const char *name, const char *suffixes, const char *keywords, const char *lineComment,
+                    const char *blockStart, const char *blockEnd, const char *quotes, bool hasTripleQuotes,
+                    bool hasPreprocessor);
+
+    QString name;
+    QStringList fileSuffixes;
+    QSet<QByteArray> keywordSet;
+    QByteArray lineCommentStart;
+    QByteArray blockCommentStart;
+    QByteArray blockCommentEnd;
+    QByteArray quoteCharacters;
+    bool tripleQuotes;
+    bool preprocessor;
+
+    static const QList<SourceTokenizer>& languages();
+};
+
+#endif // SOURCETOKENIZER_H
@@ -0,0 +1,590 @@
+#include "sourceview.h"
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QPainter>
+#include <QScrollBar>
+#include <algorithm>
+#include <cstring>
+
+/**
+ * @file sourceview.h
+ * @brief The SourceView class shows a text file with line numbers and syntax highlighting.
+ * The file is memory-mapped and indexed by line starts; only the visible lines are painted. Highlighting runs on
+ * a background thread for the visible lines plus a lookahead, and the tokenizer state is saved every few hundred
+ * lines, so highlighting any part of the file resumes from the nearest saved state instead of from the top. Until
+ * their tokens arrive, lines are painted as plain text.
+ * In follow mode (tail -f) the file is watched for writes; the mapping is extended and only the appended bytes are
+ * scanned for line breaks. The line index then keeps the most recent lines only, and the mapping starts at the
+ * oldest of them, so memory stays bounded however long the log grows.
+ */
+
+namespace
+{
+const qint64 maxTextSize = 512 * 1024 * 1024;
+const qint64 checkpointInterval = 256;
+const qint64 lookaheadLines = 200;
+const qint64 lookbehindLines = 50;
+const int maxCachedLines = 20000;
+const qsizetype maxPaintedLineLength = 4096;
+const int tabWidth = 4;
+const int stateCheckInterval = 1024;
+const qint64 mapAlignment = 64 * 1024;
+const size_t maxFollowedLines = 1000000;
+const int appendIntervalMs = 30;
+
+QColor tokenColor(SourceTokenizer::Kind kind, bool isDark, const QColor &plain)
+{
+    switch (kind)
+    {
+    case SourceTokenizer::Keyword:
+        return isDark ? QColor(0x56, 0x9c, 0xd6) : QColor(0x00, 0x33, 0xb3);
+    case SourceTokenizer::Comment:
+        return isDark ? QColor(0x6a, 0x99, 0x55) : QColor(0x8c, 0x8c, 0x8c);
+    case SourceTokenizer::String:
+        return isDark ? QColor(0xce, 0x91, 0x78) : QColor(0x06, 0x7d, 0x17);
+    case SourceTokenizer::Number:
+        return isDark ? QColor(0xb5, 0xce, 0xa8) : QColor(0x17, 0x50, 0xeb);
+    case SourceTokenizer::Preprocessor:
+        return isDark ? QColor(0xc5, 0x86, 0xc0) : QColor(0x9e, 0x88, 0x0d);
+    case SourceTokenizer::Plain:
+        break;
+    }
+    return plain;
+}
+}
+
+SourceView::SourceView(QWidget *parent)
+    : QAbstractScrollArea(parent), highlightGeneration(0)
+{
+    const QFont fixedFont = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    setFont(fixedFont);
+    // The viewer dialog styles every child with a proportional font.
+    setStyleSheet(QString("font-family: \"%1\";").arg(fixedFont.family()));
+    highlightPool.setMaxThreadCount(1);
+    setFocusPolicy(Qt::StrongFocus);
+
+    // Writes are coalesced, a fast writer triggers one append per interval instead of one per write.
+    appendTimer.setSingleShot(true);
+    appendTimer.setInterval(appendIntervalMs);
+    connect(&appendTimer, &QTimer::timeout, this, &SourceView::appendFromFile);
+    connect(&watcher, &QFileSystemWatcher::fileChanged, this, [this]()
+            {
+                if (!appendTimer.isActive())
+                {
+                    appendTimer.start();
+                }
+            });
+}
+
+SourceView::~SourceView()
+{
+    stopHighlighting();
+}
+
+/**
+ * @brief Shows a text file on disk, highlighted if its suffix names a known language.
+ *
+ * @return False if the file cannot be opened or mapped, or is too large to be shown as text.
+ */
+bool SourceView::openFile(const QString &filePath)
+{
+    reset();
+    file.setFileName(filePath);
+    if (!file.open(QIODevice::ReadOnly) || file.size() > maxTextSize)
+    {
+        return false;
+    }
+
+    if (!mapFile(file.size()))
+    {
+        buffer = file.readAll();
+        text = buffer.constData();
+        textSize = buffer.size();
+    }
+
+    tokenizer = SourceTokenizer::forFileName(filePath);
+    indexLines(0);
+    return true;
+}
+
+/**
+ * @brief Shows text held in memory, used for members of archives.
+ *
+ * @param data The text.
+ * @param fileName The name of the file, which selects the language.
+ */
+void SourceView::setData(const QByteArray &data, const QString &fileName)
+{
+    reset();
+    buffer = data;
+    text = buffer.constData();
+    textSize = buffer.size();
+    tokenizer = SourceTokenizer::forFileName(fileName);
+    indexLines(0);
+}
+
+/**
+ * @brief Returns the number of the line after the last one. In follow mode the oldest lines are dropped from the
+ * index but keep their numbers.
+ */
+qint64 SourceView::lineCount() const
+{
+    return droppedLines + qint64(lineStarts.size());
+}
+
+/**
+ * @brief Returns the name of the highlighted language, or an empty string for plain text.
+ */
+QString SourceView::languageName() const
+{
+    return tokenizer ? tokenizer->languageName() : QString();
+}
+
+bool SourceView::isFollowing() const
+{
+    return following;
+}
+
+/**
+ * @brief Turns follow mode on or off. While following, appended lines are shown as they are written and the view
+ * stays at the end unless it was scrolled up. Only files on disk that could be mapped can be followed.
+ */
+void SourceView::setFollowing(bool isFollowing)
+{
+    following = isFollowing && file.isOpen() && buffer.isEmpty();
+    if (!following)
+    {
+        watcher.removePaths(watcher.files());
+        appendTimer.stop();
+        return;
+    }
+
+    watcher.addPath(file.fileName());
+    appendFromFile();
+    verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+}
+
+void SourceView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(viewport());
+    painter.setFont(font());
+
+    const QFontMetrics metrics(font());
+    const int lineHeight = metrics.height();
+    const int charWidth = metrics.horizontalAdvance(' ');
+    const int gutter = gutterWidth();
+    const QColor plainColor = palette().color(QPalette::WindowText);
+    const QColor lineNumberColor = palette().color(QPalette::PlaceholderText);
+    const bool isDark = palette().color(QPalette::Base).lightness() < 128;
+
+    const qint64 firstLine = topLine();
+    const qint64 lastLine = std::min(lineCount(), firstLine + visibleLineCount());
+    const int scrollX = horizontalScrollBar()->value();
+
+    for (qint64 line = firstLine; line < lastLine; ++line)
+    {
+        const int y = int(line - firstLine) * lineHeight;
+        const int baseline = y + metrics.ascent();
+
+        const char *data = nullptr;
+        qsizetype length = 0;
+        lineAt(line, data, length);
+        length = std::min(length, maxPaintedLineLength);
+
+        painter.save();
+        painter.setClipRect(gutter, y, viewport()->width() - gutter, lineHeight);
+
+        // Tokens split lines at ASCII bytes, so every segment is valid UTF-8 on its own.
+        int column = 0;
+        int x = gutter - scrollX;
+        auto drawSegment = [&](qsizetype start, qsizetype end, const QColor &color)
+        {
+            if (end <= start)
+            {
+                return;
+            }
+
+            const QString segment = QString::fromUtf8(data + start, end - start);
+            QString expanded;
+            expanded.reserve(segment.size());
+            for (const QChar c : segment)
+            {
+                if (c == '\t')
+                {
+                    const int spaces = tabWidth - column % tabWidth;
+                    expanded += QString(spaces, ' ');
+                    column += spaces;
+                }
+                else
+                {
+                    expanded += c;
+                    ++column;
+                }
+            }
+
+            painter.setPen(color);
+            painter.drawText(x, baseline, expanded);
+            x += metrics.horizontalAdvance(expanded);
+        };
+
+        const auto tokens = highlightedLines.constFind(line);
+        qsizetype position = 0;
+        if (tokens != highlightedLines.constEnd())
+        {
+            for (const SourceToken &token : *tokens)
+            {
+                if (token.start >= length)
+                {
+                    break;
+                }
+                drawSegment(position, token.start, plainColor);
+                drawSegment(token.start, std::min<qsizetype>(token.start + token.length, length),
+                            tokenColor(SourceTokenizer::Kind(token.kind), isDark, plainColor));
+                position = std::min<qsizetype>(token.start + token.length, length);
+            }
+        }
+        drawSegment(position, length, plainColor);
+        painter.restore();
+
+        painter.setPen(lineNumberColor);
+        painter.drawText(QRect(0, y, gutter - charWidth, lineHeight), Qt::AlignRight | Qt::AlignVCenter, QString::number(line + 1));
+    }
+}
+
+void SourceView::resizeEvent(QResizeEvent *event)
+{
+    const bool isAtEnd = following && verticalScrollBar()->value() >= verticalScrollBar()->maximum();
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+    if (isAtEnd)
+    {
+        verticalScrollBar()->setValue(verticalScrollBar()->maximum());
+    }
+    requestHighlighting();
+}
+
+void SourceView::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    requestHighlighting();
+    viewport()->update();
+}
+
+void SourceView::reset()
+{
+    stopHighlighting();
+    ++documentGeneration;
+
+    watcher.removePaths(watcher.files());
+    appendTimer.stop();
+    file.close();
+    buffer.clear();
+    text = nullptr;
+    textSize = 0;
+    mapped = nullptr;
+    mapOffset = 0;
+    lineStarts.clear();
+    droppedLines = 0;
+    isLineStartPending = false;
+    longestLine = 0;
+    tokenizer = nullptr;
+    highlightedLines.clear();
+    checkpointStates.clear();
+}
+
+/**
+ * @brief Maps the file up to size, starting at the oldest indexed line, and releases the previous mapping.
+ */
+bool SourceView::mapFile(qint64 size)
+{
+    const qint64 offset = lineStarts.empty() ? 0 : lineStarts.front() / mapAlignment * mapAlignment;
+    if (size <= offset)
+    {
+        return size == 0;
+    }
+
+    uchar *newMapping = file.map(offset, size - offset);
+    if (newMapping == nullptr)
+    {
+        return false;
+    }
+
+    if (mapped != nullptr)
+    {
+        file.unmap(mapped);
+    }
+    mapped = newMapping;
+    mapOffset = offset;
+    text = reinterpret_cast<const char*>(mapped);
+    textSize = size;
+    return true;
+}
+
+/**
+ * @brief Records where the lines in the text from a position on start, locating the line breaks with memchr.
+ * A line break at the very end starts a line only once more text follows it.
+ */
+void SourceView::indexLines(qint64 from)
+{
+    if (lineStarts.empty())
+    {
+        lineStarts.push_back(0);
+        checkpointStates.push_back(SourceTokenizer::Normal);
+    }
+    else if (isLineStartPending && from < textSize)
+    {
+        lineStarts.push_back(from);
+        isLineStartPending = false;
+    }
+
+    qint64 position = lineStarts.back();
+    qint64 searchFrom = from;
+    while (searchFrom < textSize)
+    {
+        const char *lineBreak = static_cast<const char*>(std::memchr(text + (searchFrom - mapOffset), '\n', size_t(textSize - searchFrom)));
+        const qint64 end = lineBreak ? mapOffset + (lineBreak - text) : textSize;
+        longestLine = std::max(longestLine, end - position);
+        if (lineBreak == nullptr)
+        {
+            break;
+        }
+        if (end + 1 == textSize)
+        {
+            isLineStartPending = true;
+            break;
+        }
+        position = end + 1;
+        searchFrom = position;
+        lineStarts.push_back(position);
+    }
+
+    updateScrollBars();
+    requestHighlighting();
+    viewport()->update();
+}
+
+/**
+ * @brief Shows what was appended to the followed file since the last call. Only the new bytes are scanned. A file
+ * that shrank was truncated or replaced by log rotation and is opened again.
+ */
+void SourceView::appendFromFile()
+{
+    if (!following)
+    {
+        return;
+    }
+
+    const QString path = file.fileName();
+    if (!watcher.files().contains(path) && QFileInfo::exists(path))
+    {
+        watcher.addPath(path);
+    }
+
+    const qint64 size = QFileInfo(path).size();
+    if (size < textSize)
+    {
+        openFile(path);
+        setFollowing(true);
+        return;
+    }
+
+    const qint64 oldSize = textSize;
+    if (file.size() <= oldSize)
+    {
+        return;
+    }
+
+    const QScrollBar *scrollBar = verticalScrollBar();
+    const bool isAtEnd = scrollBar->value() >= scrollBar->maximum();
+    const qint64 oldTopLine = topLine();
+
+    stopHighlighting();
+    // The last line may have been incomplete.
+    highlightedLines.remove(lineCount() - 1);
+
+    dropOldestLines();
+    if (!mapFile(std::min(file.size(), mapOffset + maxTextSize)))
+    {
+        setFollowing(false);
+        return;
+    }
+    indexLines(oldSize);
+
+    verticalScrollBar()->setValue(isAtEnd ? verticalScrollBar()->maximum() : int(std::max<qint64>(0, oldTopLine - droppedLines)));
+    requestHighlighting();
+}
+
+/**
+ * @brief Drops the oldest lines from the index of a followed file, keeping a bounded number of lines and bytes.
+ */
+void SourceView::dropOldestLines()
+{
+    const qint64 size = file.size();
+    while (lineStarts.size() > maxFollowedLines || (lineStarts.size() > 1 && size - lineStarts.front() > maxTextSize))
+    {
+        lineStarts.pop_front();
+        ++droppedLines;
+    }
+}
+
+/**
+ * @brief Supersedes the running highlight request and waits for it, before the line index changes.
+ */
+void SourceView::stopHighlighting()
+{
+    ++highlightGeneration;
+    highlightPool.waitForDone();
+}
+
+/**
+ * @brief Starts highlighting the visible lines and the lookahead unless all of them are highlighted already.
+ * A newer request supersedes the running one, which stops at its next check.
+ */
+void SourceView::requestHighlighting()
+{
+    if (tokenizer == nullptr || lineStarts.empty())
+    {
+        return;
+    }
+
+    const qint64 firstLine = std::max<qint64>(droppedLines, topLine() - lookbehindLines);
+    const qint64 lastLine = std::min(lineCount(), topLine() + visibleLineCount() + lookaheadLines);
+
+    bool isComplete = true;
+    for (qint64 line = topLine(); line < std::min(lineCount(), topLine() + visibleLineCount()) && isComplete; ++line)
+    {
+        isComplete = highlightedLines.contains(line);
+    }
+    if (isComplete)
+    {
+        return;
+    }
+
+    const quint64 generation = ++highlightGeneration;
+    const quint64 document = documentGeneration;
+    highlightPool.start([this, generation, document, firstLine, lastLine]()
+                        {
+                            highlight(generation, document, firstLine, lastLine);
+                        });
+}
+
+/**
+ * @brief Tokenizes a range of lines. Runs on the highlight pool, which owns the checkpoint states.
+ * The lines before the range are only scanned for their state, starting at the nearest checkpoint, and every
+ * checkpoint passed on the way is saved for later requests.
+ */
+void SourceView::highlight(quint64 generation, quint64 document, qint64 firstLine, qint64 lastLine)
+{
+    qint64 checkpoint = std::min<qint64>(firstLine / checkpointInterval, qint64(checkpointStates.size()) - 1);
+    while (checkpoint > 0 && checkpointStates.at(size_t(checkpoint)) < 0 && checkpoint * checkpointInterval > droppedLines)
+    {
+        --checkpoint;
+    }
+
+    // Lines dropped by follow mode cannot be scanned, an unknown state is assumed to be Normal.
+    qint64 line = std::max(checkpoint * checkpointInterval, droppedLines);
+    int state = std::max(checkpointStates.at(size_t(checkpoint)), int(SourceTokenizer::Normal));
+
+    QHash<qint64, QList<SourceToken>> result;
+    for (; line < lastLine; ++line)
+    {
+        if (line % checkpointInterval == 0)
+        {
+            const size_t index = size_t(line / checkpointInterval);
+            if (index >= checkpointStates.size())
+            {
+                checkpointStates.resize(index + 1, -1);
+            }
+            checkpointStates[index] = state;
+        }
+        if (line % stateCheckInterval == 0 && generation != highlightGeneration)
+        {
+            return;
+        }
+
+        const char *data = nullptr;
+        qsizetype length = 0;
+        lineAt(line, data, length);
+
+        if (line < firstLine)
+        {
+            state = tokenizer->tokenizeLine(data, length, state, nullptr);
+        }
+        else
+        {
+            QList<SourceToken> tokens;
+            state = tokenizer->tokenizeLine(data, length, state, &tokens);
+            result.insert(line, tokens);
+        }
+    }
+
+    QMetaObject::invokeMethod(this, [this, document, result]()
+                              {
+                                  if (document != documentGeneration)
+                                  {
+                                      return;
+                                  }
+                                  if (highlightedLines.size() + result.size() > maxCachedLines)
+                                  {
+                                      highlightedLines.clear();
+                                  }
+                                  highlightedLines.insert(result);
+                                  viewport()->update();
+                              }, Qt::QueuedConnection);
+}
+
+/**
+ * @brief Returns the bytes of a line without its line break.
+ */
+void SourceView::lineAt(qint64 line, const char *&data, qsizetype &length) const
+{
+    const size_t index = size_t(line - droppedLines);
+    const qint64 start = lineStarts.at(index);
+    qint64 end = index + 1 < lineStarts.size() ? lineStarts.at(index + 1) - 1 : textSize;
+    if (end > start && end == textSize && text[end - 1 - mapOffset] == '\n')
+    {
+        --end;
+    }
+    if (end > start && text[end - 1 - mapOffset] == '\r')
+    {
+        --end;
+    }
+
+    data = text + (start - mapOffset);
+    length = qsizetype(end - start);
+}
+
+void SourceView::updateScrollBars()
+{
+    const QFontMetrics metrics(font());
+    verticalScrollBar()->setRange(0, int(std::max<qint64>(0, qint64(lineStarts.size()) - visibleLineCount() + 1)));
+    verticalScrollBar()->setPageStep(std::max(1, visibleLineCount() - 1));
+    verticalScrollBar()->setSingleStep(1);
+
+    const int contentWidth = gutterWidth() + metrics.horizontalAdvance(' ') * int(std::min<qint64>(longestLine, maxPaintedLineLength) + 1);
+    horizontalScrollBar()->setRange(0, std::max(0, contentWidth - viewport()->width()));
+    horizontalScrollBar()->setPageStep(viewport()->width());
+    horizontalScrollBar()->setSingleStep(metrics.horizontalAdvance(' ') * 4);
+}
+
+qint64 SourceView::topLine() const
+{
+    return droppedLines + verticalScrollBar()->value();
+}
+
+/**
+ * @brief Returns how many lines fit the viewport, counting a partly visible last line.
+ */
+int SourceView::visibleLineCount() const
+{
+    const int lineHeight = QFontMetrics(font()).height();
+    return std::max(1, (viewport()->height() + lineHeight - 1) / lineHeight);
+}
+
+int SourceView::gutterWidth() const
+{
+    const int digits = int(QString::number(std::max<qint64>(lineCount(), 1)).size());
+    return QFontMetrics(font()).horizontalAdvance(' ') * (digits + 2);
+}
@@ -0,0 +1,72 @@
+#ifndef SOURCEVIEW_H
+#define SOURCEVIEW_H
+
+#include "sourcetokenizer.h"
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QThreadPool>
+#include <QTimer>
+#include <atomic>
+#include <deque>
+#include <vector>
+
+class SourceView : public QAbstractScrollArea
+{
+    Q_OBJECT
+public:
+    explicit SourceView(QWidget *parent = nullptr);
+    ~SourceView();
+
+    bool openFile(const QString &filePath);
+    void setData(const QByteArray &data, const QString &fileName);
+    qint64 lineCount() const;
+    QString languageName() const;
+    bool isFollowing() const;
+    void setFollowing(bool isFollowing);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void scrollContentsBy(int dx, int dy) override;
+
+private:
+    QFile file;
+    QByteArray buffer;
+    const char *text = nullptr;
+    qint64 textSize = 0;
+    uchar *mapped = nullptr;
+    qint64 mapOffset = 0;
+    std::deque<qint64> lineStarts;
+    qint64 droppedLines = 0;
+    bool isLineStartPending = false;
+    qint64 longestLine = 0;
+    const SourceTokenizer *tokenizer = nullptr;
+
+    QHash<qint64, QList<SourceToken>> highlightedLines;
+    std::vector<int> checkpointStates;
+    QThreadPool highlightPool;
+    std::atomic<quint64> highlightGeneration;
+    quint64 documentGeneration = 0;
+
+    bool following = false;
+    QFileSystemWatcher watcher;
+    QTimer appendTimer;
+
+    void reset();
+    bool mapFile(qint64 size);
+    void indexLines(qint64 from);
+    void appendFromFile();
+    void dropOldestLines();
+    void stopHighlighting();
+    void requestHighlighting();
+    void highlight(quint64 generation, quint64 document, qint64 firstLine, qint64 lastLine);
+    void lineAt(qint64 line, const char *&data, qsizetype &length) const;
+    void updateScrollBars();
+    qint64 topLine() const;
+    int visibleLineCount() const;
+    int gutterWidth() const;
+};
+
+#endif // SOURCEVIEW_H
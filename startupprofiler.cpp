@@ -0,0 +1,80 @@
+#include "startupprofiler.h"
+#include <QDebug>
+
+/**
+ * @file startupprofiler.h
+ * @brief The StartupProfiler class measures the phases of application startup.
+ * The clock starts with the first call to instance() at the top of main(); every phase records the time it ended.
+ * Marks are always recorded since they are cheap, the report is only printed when started with --profile-startup.
+ */
+
+namespace
+{
+const double nsPerMs = 1000000.0;
+}
+
+StartupProfiler::StartupProfiler()
+{
+    timer.start();
+}
+
+StartupProfiler::~StartupProfiler()
+{}
+
+StartupProfiler& StartupProfiler::instance()
+{
+    static StartupProfiler instance;
+    return instance;
+}
+
+void StartupProfiler::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+bool StartupProfiler::isEnabled() const
+{
+    return enabled;
+}
+
+/**
+ * @brief Records the end of a startup phase. Marks after the report was printed are ignored.
+ *
+ * @param phase The name of the phase that just finished.
+ */
+void StartupProfiler::mark(const QString &phase)
+{
+    if (!reported)
+    {
+        phases.append({ phase, timer.nsecsElapsed() });
+    }
+}
+
+/**
+ * @brief Prints the duration of every phase and the time since startup it ended at. Only prints once.
+ */
+void StartupProfiler::report()
+{
+    if (reported)
+    {
+        return;
+    }
+    reported = true;
+
+    if (!enabled)
+    {
+        return;
+    }
+
+    qInfo().noquote() << QString("%1 %2  %3").arg("phase [ms]", 10).arg("at [ms]", 10).arg("name");
+
+    qint64 previousNs = 0;
+    for (const Phase &phase : std::as_const(phases))
+    {
+        qInfo().noquote() << QString("%1 %2  %3")
+                                 .arg((phase.elapsedNs - previousNs) / nsPerMs, 10, 'f', 2)
+                                 .arg(phase.elapsedNs / nsPerMs, 10, 'f', 2)
+                                 .arg(phase.name);
+        previousNs = phase.elapsedNs;
+    }
+}
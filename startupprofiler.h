@@ -0,0 +1,34 @@
+#ifndef STARTUPPROFILER_H
+#define STARTUPPROFILER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+class StartupProfiler
+{
+public:
+    static StartupProfiler& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void mark(const QString &phase);
+    void report();
+
+private:
+    StartupProfiler();
+    ~StartupProfiler();
+
+    struct Phase
+    {
+        QString name;
+        qint64 elapsedNs;
+    };
+
+    QElapsedTimer timer;
+    QList<Phase> phases;
+    bool enabled = false;
+    bool reported = false;
+};
+
+#endif // STARTUPPROFILER_H
@@ -0,0 +1,913 @@
+#include "tagstore.h"
+#include "operationjournal.h"
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/stat.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <cerrno>
+#include <sys/xattr.h>
+#endif
+
+/**
+ * @file tagstore.h
+ * @brief The TagStore class tags files. Tags live in the user.xdg.tags extended attribute of the file, a comma
+ * separated list shared with other desktop tools, and are mirrored into an index for searching.
+ * Every tagged file gets a small dense id and every tag a compressed IdBitmap of the ids carrying it, so a query
+ * such as "tag:A and tag:B or not tag:C" is evaluated with bitmap operations, without touching the disk. Files are
+ * also known by device and inode, so a file moved behind the application's back is recognised when it is tagged
+ * again. On file systems without extended attributes, or when the attribute cannot be written, the tags are kept in
+ * the index only. Files moved to the trash stay in the index, so undoing the move brings their tags back, but are
+ * left out of queries.
+ * A path that is a query, e.g. "tag:photos and tag:2024", is shown by the list view as a virtual folder of the
+ * matching files. The index is persisted and loaded in the background on the next start.
+ */
+
+namespace
+{
+const char storeMagic[4] = { 'F', 'X', 'T', 'G' };
+const quint32 storeVersion = 1;
+const int saveDelayMs = 2000;
+const quint8 dirFlag = 0x1;
+const quint8 indexOnlyFlag = 0x2;
+const quint8 trashedFlag = 0x4;
+const char tagAttribute[] = "user.xdg.tags";
+
+template <typename T>
+void appendValue(QByteArray &buffer, T value)
+{
+    const T littleEndian = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char*>(&littleEndian), sizeof(T));
+}
+
+void appendString(QByteArray &buffer, const QString &text)
+{
+    const QByteArray bytes = text.toUtf8();
+    appendValue<quint32>(buffer, quint32(bytes.size()));
+    buffer.append(bytes);
+}
+
+class StoreReader
+{
+public:
+    StoreReader(const uchar *data, qint64 size) : data(data), size(size) {}
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (position + qint64(sizeof(T)) > size)
+        {
+            return false;
+        }
+
+        value = qFromLittleEndian<T>(data + position);
+        position += sizeof(T);
+        return true;
+    }
+
+    bool readString(QString &value)
+    {
+        quint32 length = 0;
+        if (!read(length) || position + length > size)
+        {
+            return false;
+        }
+
+        value = QString::fromUtf8(reinterpret_cast<const char*>(data + position), length);
+        position += length;
+        return true;
+    }
+
+private:
+    const uchar *data;
+    qint64 size;
+    qint64 position = 0;
+};
+
+/**
+ * @brief Splits a query into "(", ")", "and", "or", "not" and "tag:<name>" tokens. Names containing spaces or
+ * parentheses are written in double quotes, e.g. tag:"to do".
+ */
+bool tokenizeQuery(const QString &expression, QStringList &tokens, QString &error)
+{
+    qsizetype position = 0;
+    while (position < expression.size())
+    {
+        const QChar c = expression.at(position);
+        if (c.isSpace())
+        {
+            ++position;
+            continue;
+        }
+
+        if (c == '(' || c == ')')
+        {
+            tokens << QString(c);
+            ++position;
+            continue;
+        }
+
+        if (expression.mid(position, 4).compare("tag:", Qt::CaseInsensitive) == 0)
+        {
+            position += 4;
+            QString name;
+            if (position < expression.size() && expression.at(position) == '"')
+            {
+                const qsizetype end = expression.indexOf('"', position + 1);
+                if (end < 0)
+                {
+                    error = QCoreApplication::translate("TagStore", "Missing closing quote");
+                    return false;
+                }
+                name = expression.mid(position + 1, end - position - 1);
+                position = end + 1;
+            }
+            else
+            {
+                const qsizetype start = position;
+                while (position < expression.size() && !expression.at(position).isSpace()
+                       && expression.at(position) != '(' && expression.at(position) != ')')
+                {
+                    ++position;
+                }
+                name = expression.mid(start, position - start);
+            }
+
+            if (name.isEmpty())
+            {
+                error = QCoreApplication::translate("TagStore", "Missing tag name after tag:");
+                return false;
+            }
+            tokens << "tag:" + name;
+            continue;
+        }
+
+        const qsizetype start = position;
+        while (position < expression.size() && !expression.at(position).isSpace()
+               && expression.at(position) != '(' && expression.at(position) != ')')
+        {
+            ++position;
+        }
+        const QString word = expression.mid(start, position - start).toLower();
+        if (word != "and" && word != "or" && word != "not")
+        {
+            error = QCoreApplication::translate("TagStore", "Unexpected \"%1\"").arg(expression.mid(start, position - start));
+            return false;
+        }
+        tokens << word;
+    }
+    return true;
+}
+
+/**
+ * @brief Evaluates a tokenized query to the bitmap of matching file ids.
+ * Grammar: or := and ("or" and)*, and := not ("and" not)*, not := "not" not | "(" or ")" | tag.
+ */
+class QueryEvaluator
+{
+public:
+    QueryEvaluator(const QStringList &tokens, const QHash<QString, IdBitmap> &bitmaps, const IdBitmap &allFiles)
+        : tokens(tokens), bitmaps(bitmaps), allFiles(allFiles) {}
+
+    bool evaluate(IdBitmap &result, QString &message)
+    {
+        if (tokens.isEmpty())
+        {
+            message = QCoreApplication::translate("TagStore", "Empty query");
+            return false;
+        }
+
+        result = parseOr();
+        if (error.isEmpty() && position < tokens.size())
+        {
+            error = QCoreApplication::translate("TagStore", "Unexpected \"%1\"").arg(tokens.at(position));
+        }
+        message = error;
+        return error.isEmpty();
+    }
+
+private:
+    const QStringList &tokens;
+    const QHash<QString, IdBitmap> &bitmaps;
+    const IdBitmap &allFiles;
+    qsizetype position = 0;
+    QString error;
+
+    bool accept(const char *token)
+    {
+        if (position < tokens.size() && tokens.at(position) == QLatin1String(token))
+        {
+            ++position;
+            return true;
+        }
+        return false;
+    }
+
+    IdBitmap parseOr()
+    {
+        IdBitmap result = parseAnd();
+        while (error.isEmpty() && accept("or"))
+        {
+            result = result | parseAnd();
+        }
+        return result;
+    }
+
+    IdBitmap parseAnd()
+    {
+        IdBitmap result = parseNot();
+        while (error.isEmpty() && accept("and"))
+        {
+            result = result & parseNot();
+        }
+        return result;
+    }
+
+    IdBitmap parseNot()
+    {
+        if (accept("not"))
+        {
+            return allFiles - parseNot();
+        }
+
+        if (accept("("))
+        {
+            IdBitmap result = parseOr();
+            if (error.isEmpty() && !accept(")"))
+            {
+                error = QCoreApplication::translate("TagStore", "Missing closing parenthesis");
+            }
+            return result;
+        }
+
+        if (position < tokens.size() && tokens.at(position).startsWith("tag:"))
+        {
+            return bitmaps.value(tokens.at(position++).mid(4));
+        }
+
+        error = position < tokens.size() ? QCoreApplication::translate("TagStore", "Unexpected \"%1\"").arg(tokens.at(position))
+                                         : QCoreApplication::translate("TagStore", "Incomplete query");
+        return IdBitmap();
+    }
+};
+}
+
+TagStore& TagStore::instance()
+{
+    static TagStore instance;
+    return instance;
+}
+
+TagStore::TagStore()
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    QDir().mkpath(directory);
+    storeFilePath = directory + "/tags.idx";
+
+    storePool.setMaxThreadCount(1);
+    saveTimer.setSingleShot(true);
+    saveTimer.setInterval(saveDelayMs);
+    connect(&saveTimer, &QTimer::timeout, this, [this]()
+            {
+                storePool.start([this]() { write(); });
+            });
+}
+
+TagStore::~TagStore()
+{
+    storePool.waitForDone();
+}
+
+/**
+ * @brief Returns true if the path is a tag query shown as a virtual folder rather than a directory.
+ */
+bool TagStore::isQueryPath(const QString &path)
+{
+    return path.startsWith("tag:", Qt::CaseInsensitive) || path.startsWith('(') || path.startsWith("not ", Qt::CaseInsensitive);
+}
+
+/**
+ * @brief Returns the query path listing the files with the tag.
+ */
+QString TagStore::queryPathForTag(const QString &tag)
+{
+    const bool needsQuotes = std::any_of(tag.cbegin(), tag.cend(), [](QChar c) { return c.isSpace() || c == '(' || c == ')'; });
+    return needsQuotes ? QString("tag:\"%1\"").arg(tag) : "tag:" + tag;
+}
+
+/**
+ * @brief Splits a comma separated tag list into trimmed, unique tags in their original order.
+ */
+QStringList TagStore::parseTags(const QString &text)
+{
+    QStringList tags;
+    const QStringList parts = text.split(',', Qt::SkipEmptyParts);
+    for (const QString &part : parts)
+    {
+        QString tag = part.trimmed();
+        tag.remove('"');
+        if (!tag.isEmpty() && !tags.contains(tag))
+        {
+            tags << tag;
+        }
+    }
+    return tags;
+}
+
+/**
+ * @brief Loads the persisted index in the background.
+ */
+void TagStore::restore()
+{
+    storePool.start([this]()
+                    {
+                        if (load())
+                        {
+                            QMetaObject::invokeMethod(this, [this]() { emit tagsChanged(); }, Qt::QueuedConnection);
+                        }
+                    });
+}
+
+/**
+ * @brief Returns the tags of a file, read from its extended attribute. A difference to the index, e.g. because
+ * another program tagged the file, is mirrored into the index. A missing attribute only untags the file if the
+ * tags were written to the attribute before, not if they are kept in the index only.
+ */
+QStringList TagStore::tags(const QString &path)
+{
+    bool isSupported = false;
+    const QStringList attributeTags = readAttribute(path, isSupported);
+
+    QStringList indexedTags;
+    bool isIndexOnly = false;
+    {
+        QReadLocker locker(&lock);
+        const auto id = idsByPath.constFind(path);
+        if (id != idsByPath.constEnd())
+        {
+            indexedTags = files[*id].tags;
+            isIndexOnly = files[*id].isIndexOnly;
+        }
+    }
+
+    if (!isSupported || (isIndexOnly && attributeTags.isEmpty()))
+    {
+        return indexedTags;
+    }
+
+    if (attributeTags != indexedTags)
+    {
+        record(path, attributeTags);
+    }
+    return attributeTags;
+}
+
+/**
+ * @brief Replaces the tags of a file, in its extended attribute if it can be written and in the index. Tags whose
+ * attribute could not be written are kept in the index only.
+ *
+ * @param path The file or directory.
+ * @param tags The new tags; an empty list untags the file.
+ * @return False if the file does not exist or its attribute still carries tags that could not be removed.
+ */
+bool TagStore::setTags(const QString &path, const QStringList &tags)
+{
+    if (!QFileInfo::exists(path))
+    {
+        return false;
+    }
+
+    const QStringList cleanTags = parseTags(tags.join(','));
+    const bool isWritten = writeAttribute(path, cleanTags);
+    if (!isWritten && cleanTags.isEmpty())
+    {
+        // tags() would mirror the tags left in the attribute back into the index.
+        bool isSupported = false;
+        if (!readAttribute(path, isSupported).isEmpty())
+        {
+            return false;
+        }
+    }
+
+    record(path, cleanTags, !isWritten);
+    return true;
+}
+
+/**
+ * @brief Returns every tag with the number of files carrying it, sorted by name.
+ */
+QList<QPair<QString, quint64>> TagStore::tagCounts() const
+{
+    QList<QPair<QString, quint64>> counts;
+    {
+        QReadLocker locker(&lock);
+        counts.reserve(bitmaps.size());
+        for (auto it = bitmaps.cbegin(); it != bitmaps.cend(); ++it)
+        {
+            counts.append({ it.key(), it->count() });
+        }
+    }
+
+    std::sort(counts.begin(), counts.end(), [](const QPair<QString, quint64> &a, const QPair<QString, quint64> &b)
+              {
+                  return QString::compare(a.first, b.first, Qt::CaseInsensitive) < 0;
+              });
+    return counts;
+}
+
+/**
+ * @brief Lists the files matching a tag query. Entry names are absolute paths.
+ *
+ * @param expression The query, e.g. tag:A and (tag:B or not tag:C).
+ * @param listing Receives the matching files in listing order.
+ * @param error Receives a description of a malformed query.
+ * @return False if the query is malformed.
+ */
+bool TagStore::query(const QString &expression, DirectoryListing &listing, QString *error) const
+{
+    QStringList tokens;
+    QString message;
+    if (!tokenizeQuery(expression, tokens, message))
+    {
+        if (error != nullptr)
+        {
+            *error = message;
+        }
+        return false;
+    }
+
+    QReadLocker locker(&lock);
+    IdBitmap matches;
+    if (!QueryEvaluator(tokens, bitmaps, taggedFiles).evaluate(matches, message))
+    {
+        if (error != nullptr)
+        {
+            *error = message;
+        }
+        return false;
+    }
+
+    listing.reserve(listing.size() + qsizetype(matches.count()));
+    matches.forEach([this, &listing](quint32 id)
+                    {
+                        DirectoryEntry entry;
+                        entry.name = files[id].path;
+                        entry.isDir = files[id].isDir;
+                        listing.append(entry);
+                    });
+    locker.unlock();
+
+    std::sort(listing.begin(), listing.end(), DirectoryListingCache::entryLessThan);
+    return true;
+}
+
+/**
+ * @brief Follows files that were moved or renamed, including tagged files inside moved directories. Files moved
+ * into the trash are left out of queries until they are moved out again.
+ *
+ * @param moves Pairs of old and new paths.
+ */
+void TagStore::movePaths(const QList<QPair<QString, QString>> &moves)
+{
+    bool isChanged = false;
+    {
+        QWriteLocker locker(&lock);
+
+        // All new paths are computed first, so a file is moved once even if a later move targets its new path.
+        QList<QPair<quint32, QString>> relocations;
+        QSet<quint32> relocatedIds;
+        for (const QPair<QString, QString> &move : moves)
+        {
+            const QList<quint32> ids = idsUnder(move.first);
+            for (quint32 id : ids)
+            {
+                if (!relocatedIds.contains(id))
+                {
+                    relocatedIds.insert(id);
+                    relocations.append({ id, move.second + files[id].path.mid(move.first.size()) });
+                }
+            }
+        }
+
+        for (const QPair<quint32, QString> &relocation : std::as_const(relocations))
+        {
+            idsByPath.remove(files[relocation.first].path);
+        }
+        for (const QPair<quint32, QString> &relocation : std::as_const(relocations))
+        {
+            TaggedFile &file = files[relocation.first];
+            file.path = relocation.second;
+            idsByPath.insert(file.path, relocation.first);
+
+            const bool isTrashed = OperationJournal::isInTrash(file.path);
+            if (isTrashed != file.isTrashed)
+            {
+                file.isTrashed = isTrashed;
+                if (isTrashed)
+                {
+                    removeFromBitmaps(relocation.first);
+                }
+                else
+                {
+                    addToBitmaps(relocation.first);
+                }
+            }
+        }
+
+        isChanged = !relocations.isEmpty();
+        changeCount += isChanged ? 1 : 0;
+    }
+
+    if (isChanged)
+    {
+        saveTimer.start();
+        emit tagsChanged();
+    }
+}
+
+/**
+ * @brief Forgets files that were deleted, including tagged files inside deleted directories.
+ */
+void TagStore::removePaths(const QStringList &paths)
+{
+    bool isChanged = false;
+    {
+        QWriteLocker locker(&lock);
+        QSet<quint32> removedIds;
+        for (const QString &path : paths)
+        {
+            const QList<quint32> ids = idsUnder(path);
+            for (quint32 id : ids)
+            {
+                removedIds.insert(id);
+            }
+        }
+
+        for (quint32 id : std::as_const(removedIds))
+        {
+            unindexFile(id);
+        }
+
+        isChanged = !removedIds.isEmpty();
+        changeCount += isChanged ? 1 : 0;
+    }
+
+    if (isChanged)
+    {
+        saveTimer.start();
+        emit tagsChanged();
+    }
+}
+
+/**
+ * @brief Writes pending changes to disk right away, e.g. before the application quits.
+ */
+void TagStore::save()
+{
+    saveTimer.stop();
+    storePool.waitForDone();
+    write();
+}
+
+/**
+ * @brief Puts the tags of a file into the index, replacing what was indexed for its path or its inode before.
+ */
+void TagStore::record(const QString &path, const QStringList &tags, bool isIndexOnly)
+{
+    TaggedFile file;
+    file.path = path;
+    file.tags = tags;
+    file.isIndexOnly = isIndexOnly;
+    file.isTrashed = OperationJournal::isInTrash(path);
+#ifdef Q_OS_UNIX
+    struct stat status;
+    if (::stat(QFile::encodeName(path).constData(), &status) == 0)
+    {
+        file.device = status.st_dev;
+        file.inode = status.st_ino;
+        file.isDir = S_ISDIR(status.st_mode);
+    }
+#else
+    file.isDir = QFileInfo(path).isDir();
+#endif
+
+    {
+        QWriteLocker locker(&lock);
+        auto id = idsByPath.constFind(path);
+        if (id != idsByPath.constEnd())
+        {
+            unindexFile(*id);
+        }
+        else if (file.inode != 0)
+        {
+            const auto moved = idsByInode.constFind({ file.device, file.inode });
+            if (moved != idsByInode.constEnd())
+            {
+                unindexFile(*moved);
+            }
+        }
+
+        if (!tags.isEmpty())
+        {
+            quint32 newId = quint32(files.size());
+            if (!freeIds.empty())
+            {
+                newId = freeIds.back();
+                freeIds.pop_back();
+            }
+            indexFile(newId, file);
+        }
+        ++changeCount;
+    }
+
+    saveTimer.start();
+    emit tagsChanged();
+}
+
+/**
+ * @brief Adds a file under the id to the bitmaps and lookup tables. The caller holds the write lock.
+ */
+void TagStore::indexFile(quint32 id, const TaggedFile &file)
+{
+    if (id >= files.size())
+    {
+        files.resize(size_t(id) + 1);
+    }
+    files[id] = file;
+
+    if (!file.isTrashed)
+    {
+        addToBitmaps(id);
+    }
+    idsByPath.insert(file.path, id);
+    if (file.inode != 0)
+    {
+        idsByInode.insert({ file.device, file.inode }, id);
+    }
+}
+
+/**
+ * @brief Removes the file with the id from the bitmaps and lookup tables and frees the id. The caller holds the
+ * write lock.
+ */
+void TagStore::unindexFile(quint32 id)
+{
+    removeFromBitmaps(id);
+
+    TaggedFile &file = files[id];
+    idsByPath.remove(file.path);
+    if (file.inode != 0)
+    {
+        idsByInode.remove({ file.device, file.inode });
+    }
+
+    file = TaggedFile();
+    freeIds.push_back(id);
+}
+
+/**
+ * @brief Makes the file with the id match the queries for its tags. The caller holds the write lock.
+ */
+void TagStore::addToBitmaps(quint32 id)
+{
+    for (const QString &tag : std::as_const(files[id].tags))
+    {
+        bitmaps[tag].add(id);
+    }
+    taggedFiles.add(id);
+}
+
+/**
+ * @brief Takes the file with the id out of the bitmaps, so no query matches it. The caller holds the write lock.
+ */
+void TagStore::removeFromBitmaps(quint32 id)
+{
+    for (const QString &tag : std::as_const(files[id].tags))
+    {
+        auto bitmap = bitmaps.find(tag);
+        if (bitmap != bitmaps.end())
+        {
+            bitmap->remove(id);
+            if (bitmap->isEmpty())
+            {
+                bitmaps.erase(bitmap);
+            }
+        }
+    }
+    taggedFiles.remove(id);
+}
+
+/**
+ * @brief Returns the ids of the file at the path and of the files below it, found as one range of the sorted path
+ * table. The caller holds the lock.
+ */
+QList<quint32> TagStore::idsUnder(const QString &path) const
+{
+    QList<quint32> ids;
+    const auto exact = idsByPath.constFind(path);
+    if (exact != idsByPath.constEnd())
+    {
+        ids << *exact;
+    }
+
+    const QString prefix = path.endsWith('/') ? path : path + '/';
+    for (auto it = idsByPath.lowerBound(prefix); it != idsByPath.constEnd() && it.key().startsWith(prefix); ++it)
+    {
+        ids << *it;
+    }
+    return ids;
+}
+
+/**
+ * @brief Writes the index to disk if it changed since it was last written. Only files and their tags are stored;
+ * the bitmaps are rebuilt when the index is loaded.
+ */
+void TagStore::write()
+{
+    QByteArray buffer;
+    quint64 writtenChangeCount = 0;
+    {
+        QReadLocker locker(&lock);
+        if (changeCount == savedChangeCount)
+        {
+            return;
+        }
+        writtenChangeCount = changeCount;
+
+        buffer.append(storeMagic, sizeof(storeMagic));
+        appendValue<quint32>(buffer, storeVersion);
+        appendValue<quint32>(buffer, quint32(idsByPath.size()));
+        for (const TaggedFile &file : files)
+        {
+            if (file.path.isEmpty())
+            {
+                continue;
+            }
+
+            appendString(buffer, file.path);
+            appendValue<quint64>(buffer, file.device);
+            appendValue<quint64>(buffer, file.inode);
+            appendValue<quint8>(buffer, (file.isDir ? dirFlag : 0) | (file.isIndexOnly ? indexOnlyFlag : 0)
+                                            | (file.isTrashed ? trashedFlag : 0));
+            appendValue<quint16>(buffer, quint16(file.tags.size()));
+            for (const QString &tag : file.tags)
+            {
+                appendString(buffer, tag);
+            }
+        }
+    }
+
+    QSaveFile file(storeFilePath);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        file.write(buffer);
+        if (file.commit())
+        {
+            QWriteLocker locker(&lock);
+            savedChangeCount = std::max(savedChangeCount, writtenChangeCount);
+        }
+    }
+}
+
+/**
+ * @brief Reads the persisted index and merges it with files tagged since the start. Runs on the store pool.
+ *
+ * @return True if an index was loaded.
+ */
+bool TagStore::load()
+{
+    QFile file(storeFilePath);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    const qint64 size = file.size();
+    const uchar *data = file.map(0, size);
+    if (data == nullptr || size < qint64(sizeof(storeMagic)) || std::memcmp(data, storeMagic, sizeof(storeMagic)) != 0)
+    {
+        return false;
+    }
+
+    StoreReader reader(data + sizeof(storeMagic), size - qint64(sizeof(storeMagic)));
+    quint32 version = 0;
+    quint32 fileTotal = 0;
+    if (!reader.read(version) || version != storeVersion || !reader.read(fileTotal))
+    {
+        return false;
+    }
+
+    std::vector<TaggedFile> loadedFiles;
+    loadedFiles.reserve(std::min<quint32>(fileTotal, quint32(size / 24)));
+    for (quint32 i = 0; i < fileTotal; ++i)
+    {
+        TaggedFile taggedFile;
+        quint8 flags = 0;
+        quint16 tagTotal = 0;
+        if (!reader.readString(taggedFile.path) || !reader.read(taggedFile.device) || !reader.read(taggedFile.inode)
+            || !reader.read(flags) || !reader.read(tagTotal))
+        {
+            return false;
+        }
+
+        taggedFile.isDir = (flags & dirFlag) != 0;
+        taggedFile.isIndexOnly = (flags & indexOnlyFlag) != 0;
+        taggedFile.isTrashed = (flags & trashedFlag) != 0;
+        for (quint16 j = 0; j < tagTotal; ++j)
+        {
+            QString tag;
+            if (!reader.readString(tag))
+            {
+                return false;
+            }
+            taggedFile.tags << tag;
+        }
+
+        // Trashed files are gone once the journal purged them from the trash.
+        if (!taggedFile.isTrashed || QFileInfo::exists(taggedFile.path))
+        {
+            loadedFiles.push_back(std::move(taggedFile));
+        }
+    }
+
+    QWriteLocker locker(&lock);
+    for (const TaggedFile &taggedFile : loadedFiles)
+    {
+        if (!taggedFile.tags.isEmpty() && !idsByPath.contains(taggedFile.path))
+        {
+            quint32 id = quint32(files.size());
+            if (!freeIds.empty())
+            {
+                id = freeIds.back();
+                freeIds.pop_back();
+            }
+            indexFile(id, taggedFile);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reads the tags attribute of a file.
+ *
+ * @param isSupported Set to false if the file system has no extended attributes.
+ */
+QStringList TagStore::readAttribute(const QString &path, bool &isSupported)
+{
+    isSupported = false;
+#ifdef Q_OS_LINUX
+    const QByteArray encodedPath = QFile::encodeName(path);
+    const ssize_t length = ::getxattr(encodedPath.constData(), tagAttribute, nullptr, 0);
+    if (length < 0)
+    {
+        isSupported = errno == ENODATA;
+        return QStringList();
+    }
+
+    QByteArray value(length, '\0');
+    const ssize_t read = ::getxattr(encodedPath.constData(), tagAttribute, value.data(), value.size());
+    if (read < 0)
+    {
+        return QStringList();
+    }
+    isSupported = true;
+    value.truncate(read);
+    return parseTags(QString::fromUtf8(value));
+#else
+    Q_UNUSED(path)
+    return QStringList();
+#endif
+}
+
+/**
+ * @brief Writes the tags attribute of a file; an empty list removes it.
+ *
+ * @return False if the attribute could not be written, e.g. because the file system has no extended attributes.
+ */
+bool TagStore::writeAttribute(const QString &path, const QStringList &tags)
+{
+#ifdef Q_OS_LINUX
+    const QByteArray encodedPath = QFile::encodeName(path);
+    if (tags.isEmpty())
+    {
+        return ::removexattr(encodedPath.constData(), tagAttribute) == 0 || errno == ENODATA;
+    }
+
+    const QByteArray value = tags.join(',').toUtf8();
+    return ::setxattr(encodedPath.constData(), tagAttribute, value.constData(), value.size(), 0) == 0;
+#else
+    Q_UNUSED(path)
+    Q_UNUSED(tags)
+    return false;
+#endif
+}
@@ -0,0 +1,80 @@
+#ifndef TAGSTORE_H
+#define TAGSTORE_H
+
+#include "directorylistingcache.h"
+#include "idbitmap.h"
+#include <QObject>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+#include <QReadWriteLock>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+#include <vector>
+
+class TagStore : public QObject
+{
+    Q_OBJECT
+public:
+    static TagStore& instance();
+
+    static bool isQueryPath(const QString &path);
+    static QString queryPathForTag(const QString &tag);
+    static QStringList parseTags(const QString &text);
+
+    void restore();
+    QStringList tags(const QString &path);
+    bool setTags(const QString &path, const QStringList &tags);
+    QList<QPair<QString, quint64>> tagCounts() const;
+    bool query(const QString &expression, DirectoryListing &listing, QString *error = nullptr) const;
+    void movePaths(const QList<QPair<QString, QString>> &moves);
+    void removePaths(const QStringList &paths);
+    void save();
+
+private:
+    TagStore();
+    ~TagStore();
+
+    struct TaggedFile
+    {
+        QString path;
+        quint64 device = 0;
+        quint64 inode = 0;
+        bool isDir = false;
+        bool isIndexOnly = false;
+        bool isTrashed = false;
+        QStringList tags;
+    };
+
+    mutable QReadWriteLock lock;
+    std::vector<TaggedFile> files;
+    std::vector<quint32> freeIds;
+    QMap<QString, quint32> idsByPath;
+    QHash<QPair<quint64, quint64>, quint32> idsByInode;
+    QHash<QString, IdBitmap> bitmaps;
+    IdBitmap taggedFiles;
+
+    QString storeFilePath;
+    QThreadPool storePool;
+    QTimer saveTimer;
+    quint64 changeCount = 0;
+    quint64 savedChangeCount = 0;
+
+    void record(const QString &path, const QStringList &tags, bool isIndexOnly = false);
+    void indexFile(quint32 id, const TaggedFile &file);
+    void unindexFile(quint32 id);
+    void addToBitmaps(quint32 id);
+    void removeFromBitmaps(quint32 id);
+    QList<quint32> idsUnder(const QString &path) const;
+    void write();
+    bool load();
+
+    static QStringList readAttribute(const QString &path, bool &isSupported);
+    static bool writeAttribute(const QString &path, const QStringList &tags);
+
+signals:
+    void tagsChanged();
+};
+
+#endif // TAGSTORE_H
@@ -1,5 +1,6 @@
 #include "treeviewmanager.h"
 #include "treemodelfilters.h"
+#include "archiveindex.h"
 #include <QTreeView>
 #include <QModelIndex>
 #include <QHeaderView>
@@ -10,41 +11,32 @@
 * @brief Manages the interaction and behavior of the QListView component within the application.
 */
 
-TreeViewManager::TreeViewManager()
+TreeViewManager::TreeViewManager(QTreeView *treeView, QObject *parent) : QObject(parent), treeView(treeView)
 {
-
-}
-
-void TreeViewManager::initialize(QTreeView* treeView)
-{
-    this -> treeView = treeView;
+    modelWithTreeModelFilters = new TreeModelFilters(this);
+    modelWithTreeModelFilters->setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
 }
 
 TreeViewManager::~TreeViewManager()
 {}
 
-TreeViewManager& TreeViewManager::instance()
-{
-    static TreeViewManager instance;
-
-    if (instance.modelWithTreeModelFilters == nullptr)
-    {
-        instance.modelWithTreeModelFilters = new TreeModelFilters;
-        instance.modelWithTreeModelFilters->setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
-        instance.modelWithTreeModelFilters->setRootPath("");
-    }
-
-    return instance;
-}
-
 /**
-     * @brief Sets the model for the specified QTreeView.
+     * @brief Starts the file system model and sets it for the specified QTreeView.
+     * Deferred until after the first paint, since starting the model enumerates the drives.
+     * The path selected before, if any, is expanded afterwards.
      *
      * @param treeView The QTreeView for which to set the model.
      */
 void TreeViewManager::setModelForTreeView(QTreeView *treeView)
 {
+    modelWithTreeModelFilters->setRootPath("");
     treeView->setModel(modelWithTreeModelFilters);
+
+    if (!pendingPath.isEmpty())
+    {
+        updateModelForTreeView(pendingPath);
+        pendingPath.clear();
+    }
 }
 
 /**
@@ -60,9 +52,16 @@ void TreeViewManager::updateModelForTreeView(const QString &path)
         return;
     }
 
+    if (treeView->model() != modelWithTreeModelFilters)
+    {
+        pendingPath = path;
+        return;
+    }
+
     treeView->collapseAll();
 
-    QModelIndex index = modelWithTreeModelFilters->index(path);
+    // A directory inside an archive is shown as the directory holding the archive.
+    QModelIndex index = modelWithTreeModelFilters->index(ArchiveIndex::diskDirectory(path));
     if (index.isValid())
     {
         treeView->expand(index);
@@ -10,17 +10,18 @@ class TreeViewManager : public QObject
     Q_OBJECT
 
 public:
-    static TreeViewManager& instance();
+    explicit TreeViewManager(QTreeView *treeView, QObject *parent = nullptr);
+    ~TreeViewManager();
     void setModelForTreeView(QTreeView *treeView);
-    void initialize(QTreeView* treeView);
 
-    TreeViewManager();
-    ~TreeViewManager();
     QTreeView *treeView;
 
     TreeModelFilters *modelWithTreeModelFilters;
     bool hasChildren(const QModelIndex &parent) const;
 
+private:
+    QString pendingPath;
+
 signals:
     void updateViewData(const QString &path);
 
@@ -0,0 +1,114 @@
+#include "virtualfoldertree.h"
+#include "tagstore.h"
+#include "smartfolderindex.h"
+#include <QMenu>
+
+/**
+ * @file virtualfoldertree.h
+ * @brief The VirtualFolderTree class lists folders that do not exist on disk below the directory tree.
+ * Every tag known to the TagStore is shown with the number of files carrying it, followed by the saved smart
+ * folders; activating one shows its files in the active pane. The list follows both indexes.
+ */
+
+VirtualFolderTree::VirtualFolderTree(QWidget *parent) : QTreeWidget(parent)
+{
+    setHeaderHidden(true);
+    setColumnCount(1);
+    setRootIsDecorated(true);
+
+    tagsItem = new QTreeWidgetItem(this, { tr("Tags") });
+    tagsItem->setFlags(Qt::ItemIsEnabled);
+    smartFoldersItem = new QTreeWidgetItem(this, { tr("Smart folders") });
+    smartFoldersItem->setFlags(Qt::ItemIsEnabled);
+
+    setContextMenuPolicy(Qt::CustomContextMenu);
+    connect(this, &QWidget::customContextMenuRequested, this, &VirtualFolderTree::showContextMenu);
+    connect(this, &QTreeWidget::itemClicked, this, &VirtualFolderTree::onItemActivated);
+    connect(this, &QTreeWidget::itemActivated, this, &VirtualFolderTree::onItemActivated);
+    connect(&TagStore::instance(), &TagStore::tagsChanged, this, &VirtualFolderTree::rebuildTags);
+    connect(&SmartFolderIndex::instance(), &SmartFolderIndex::foldersChanged, this, &VirtualFolderTree::rebuildSmartFolders);
+    rebuildTags();
+    rebuildSmartFolders();
+}
+
+/**
+ * @brief Shows one child of the tags item per tag, keeping the selected tag selected.
+ */
+void VirtualFolderTree::rebuildTags()
+{
+    const QString currentPath = currentItem() != nullptr ? currentItem()->data(0, Qt::UserRole).toString() : QString();
+
+    qDeleteAll(tagsItem->takeChildren());
+    const QList<QPair<QString, quint64>> counts = TagStore::instance().tagCounts();
+    for (const QPair<QString, quint64> &count : counts)
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(tagsItem, { QString("%1 (%2)").arg(count.first).arg(count.second) });
+        item->setData(0, Qt::UserRole, TagStore::queryPathForTag(count.first));
+        item->setToolTip(0, TagStore::queryPathForTag(count.first));
+        if (item->data(0, Qt::UserRole).toString() == currentPath)
+        {
+            setCurrentItem(item);
+        }
+    }
+
+    tagsItem->setExpanded(true);
+    updateVisibility();
+}
+
+/**
+ * @brief Shows one child of the smart folders item per saved folder.
+ */
+void VirtualFolderTree::rebuildSmartFolders()
+{
+    qDeleteAll(smartFoldersItem->takeChildren());
+    const QStringList names = SmartFolderIndex::instance().folderNames();
+    for (const QString &name : names)
+    {
+        QTreeWidgetItem *item = new QTreeWidgetItem(smartFoldersItem, { name });
+        item->setData(0, Qt::UserRole, SmartFolderIndex::pathForFolder(name));
+    }
+
+    smartFoldersItem->setExpanded(true);
+    updateVisibility();
+}
+
+/**
+ * @brief Hides empty sections, and the whole list while there is nothing to show.
+ */
+void VirtualFolderTree::updateVisibility()
+{
+    tagsItem->setHidden(tagsItem->childCount() == 0);
+    smartFoldersItem->setHidden(smartFoldersItem->childCount() == 0);
+    setVisible(tagsItem->childCount() != 0 || smartFoldersItem->childCount() != 0);
+}
+
+/**
+ * @brief Offers to rescan or remove a smart folder.
+ */
+void VirtualFolderTree::showContextMenu(const QPoint &position)
+{
+    QTreeWidgetItem *item = itemAt(position);
+    if (item == nullptr || item->parent() != smartFoldersItem)
+    {
+        return;
+    }
+
+    const QString path = item->data(0, Qt::UserRole).toString();
+    const QString name = item->text(0);
+    QMenu menu(this);
+    menu.addAction(tr("Rescan"), this, [path]() { SmartFolderIndex::instance().rescan(path); });
+    menu.addAction(tr("Remove smart folder"), this, [name]() { SmartFolderIndex::instance().removeFolder(name); });
+    menu.exec(viewport()->mapToGlobal(position));
+}
+
+/**
+ * @brief Emits the query path of an activated tag.
+ */
+void VirtualFolderTree::onItemActivated(QTreeWidgetItem *item)
+{
+    const QString path = item != nullptr ? item->data(0, Qt::UserRole).toString() : QString();
+    if (!path.isEmpty())
+    {
+        emit folderActivated(path);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef VIRTUALFOLDERTREE_H
+#define VIRTUALFOLDERTREE_H
+
+#include <QTreeWidget>
+
+class VirtualFolderTree : public QTreeWidget
+{
+    Q_OBJECT
+public:
+    explicit VirtualFolderTree(QWidget *parent = nullptr);
+
+private:
+    QTreeWidgetItem *tagsItem;
+    QTreeWidgetItem *smartFoldersItem;
+
+    void onItemActivated(QTreeWidgetItem *item);
+    void showContextMenu(const QPoint &position);
+    void updateVisibility();
+
+private slots:
+    void rebuildTags();
+    void rebuildSmartFolders();
+
+signals:
+    void folderActivated(const QString &path);
+};
+
+#endif // VIRTUALFOLDERTREE_H
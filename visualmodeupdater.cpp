@@ -3,17 +3,22 @@
 #include <QListView>
 #include <QTreeView>
 #include <QPushButton>
-#include <QPushButton>
 #include <QFileInfo>
 #include <QWidget>
 #include <QCheckBox>
+#include <QFile>
 
 /**
  * @file visualmodeupdater.h
  * @brief The VisualModeUpdater class manages the visual aspects of the application based on selected modes.
  */
 
-VisualModeUpdater::VisualModeUpdater()
+namespace
+{
+const QStringList iconNames = { "copy", "drive", "edit", "trash", "folder", "mode", "grid", "list", "eye", "eye_off" };
+}
+
+VisualModeUpdater::VisualModeUpdater(QObject *parent) : QObject(parent)
 {
 
 }
@@ -21,12 +26,6 @@ VisualModeUpdater::VisualModeUpdater()
 VisualModeUpdater::~VisualModeUpdater()
 {}
 
-VisualModeUpdater& VisualModeUpdater::instance()
-{
-    static VisualModeUpdater instance;
-    return instance;
-}
-
 /**
      * @brief Updates boolean data related to light mode, layout grid, and file visibility.
      * @param isLightModeActivated Whether light mode is activated.
@@ -65,88 +64,74 @@ QString VisualModeUpdater::updateIconColorName(const QString &filePath)
 }
 
 /**
- * \brief Updates the icons of buttons based on the selected light/dark mode.
+ * \brief Returns the palette, view style sheet and icons of the current mode. They are built on first use and
+ * kept, so switching modes does not reload any resource.
  */
-void VisualModeUpdater::updateIconsToMode(QPushButton &copyButton, QPushButton &driveButton, QPushButton &editButton, QPushButton &trashButton, QPushButton &folderButton
-                                          ,QPushButton &mode, QPushButton &layout, QPushButton &hide)
+const VisualModeUpdater::Theme& VisualModeUpdater::currentTheme()
 {
-    QString updatedIcon = updateIconColorName("copy.png");
-    QIcon icon(updatedIcon);
-    copyButton.setIcon(icon);
-
-    updatedIcon = updateIconColorName("drive.png");
-    icon.addFile(updatedIcon);
-    driveButton.setIcon(icon);
-
-    updatedIcon = updateIconColorName("edit.png");
-    icon.addFile(updatedIcon);
-    editButton.setIcon(icon);
-
-    updatedIcon = updateIconColorName("trash.png");
-    icon.addFile(updatedIcon);
-    trashButton.setIcon(icon);
+    Theme &theme = themes[isLightModeActivated ? 1 : 0];
+    if (theme.isBuilt)
+    {
+        return theme;
+    }
 
-    updatedIcon = updateIconColorName("folder.png");
-    icon.addFile(updatedIcon);
-    folderButton.setIcon(icon);
+    // Light icons are drawn on the dark background.
+    const QColor windowColor = isLightModeActivated ? QColor("#1e1e1e") : QColor("#ffebc3");
+    const QColor textColor = isLightModeActivated ? QColor("#b8b8b8") : QColor("#412a0d");
+    const QString viewColor = isLightModeActivated ? "#2a2a2a" : "#f7ead0";
 
-    updatedIcon = updateIconColorName("mode.png");
-    icon = QIcon();
-    icon.addFile(updatedIcon);
-    mode.setIcon(icon);
+    theme.palette.setColor(QPalette::Window, windowColor);
+    theme.palette.setColor(QPalette::WindowText, textColor);
+    theme.palette.setColor(QPalette::Text, textColor);
+    theme.palette.setColor(QPalette::ButtonText, textColor);
+    theme.viewStyleSheet = QString("background-color: %1;").arg(viewColor);
 
-    if(isLayoutGrid)
-    {
-        updatedIcon = updateIconColorName("grid.png");
-    }
-    else
+    for (const QString &name : iconNames)
     {
-        updatedIcon = updateIconColorName("list.png");
+        theme.icons.insert(name, QIcon(updateIconColorName(name + ".png")));
     }
-    icon.addFile(updatedIcon);
-    layout.setIcon(icon);
 
-    if(isShowFiles)
-    {
-        updatedIcon = updateIconColorName("eye.png");
-    }
-    else
-    {
-        updatedIcon = updateIconColorName("eye_off.png");
-    }
-    icon.addFile(updatedIcon);
-    hide.setIcon(icon);
+    theme.isBuilt = true;
+    return theme;
 }
 
 /**
- * \brief Updates UI elements, background colors and style sheets based on the selected mode (light or dark).
+ * \brief Updates the icons of buttons based on the selected light/dark mode.
  */
-void VisualModeUpdater::loadStyleSheet(QWidget &centralwidget, QListView &listView, QTreeView &treeView)
+void VisualModeUpdater::updateIconsToMode(QPushButton &copyButton, QPushButton &driveButton, QPushButton &editButton, QPushButton &trashButton, QPushButton &folderButton
+                                          ,QPushButton &mode, QPushButton &layout, QPushButton &hide)
 {
-    QString resourcePath;
-    QString styleSheet;
-    if (isLightModeActivated)
-    {
-        resourcePath = ":/StyleSheet/StyleSheet_Light.txt";
-        styleSheet = "background-color: #f7ead0;";
-    }
-    else
-    {
-        resourcePath = ":/StyleSheet/StyleSheet_Dark.txt";
-        styleSheet = "background-color: #2a2a2a;";
-    }
+    const QHash<QString, QIcon> &icons = currentTheme().icons;
+
+    copyButton.setIcon(icons.value("copy"));
+    driveButton.setIcon(icons.value("drive"));
+    editButton.setIcon(icons.value("edit"));
+    trashButton.setIcon(icons.value("trash"));
+    folderButton.setIcon(icons.value("folder"));
+    mode.setIcon(icons.value("mode"));
+    layout.setIcon(icons.value(isLayoutGrid ? "grid" : "list"));
+    hide.setIcon(icons.value(isShowFiles ? "eye" : "eye_off"));
+}
 
-    treeView.setStyleSheet(styleSheet);
-    listView.setStyleSheet(styleSheet);
+/**
+ * \brief Applies the colors of the selected mode (light or dark) to the window and the background of the item views.
+ * The layout style sheet of the central widget holds no colors, so it is never re-parsed: the colors come from the
+ * window palette, which a mode switch swaps in one step.
+ *
+ * @param window The main window.
+ * @param views The item views, whose background is set by their own style sheet.
+ */
+void VisualModeUpdater::applyTheme(QWidget &window, const QList<QAbstractItemView*> &views)
+{
+    const Theme &theme = currentTheme();
+
+    window.setPalette(theme.palette);
 
-    QFile file(resourcePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    for (QAbstractItemView *view : views)
     {
-        return;
+        if (view->styleSheet() != theme.viewStyleSheet)
+        {
+            view->setStyleSheet(theme.viewStyleSheet);
+        }
     }
-
-    QString styleSheetContent = file.readAll();
-    file.close();
-
-    centralwidget.setStyleSheet(styleSheetContent);
 }
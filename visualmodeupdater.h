@@ -9,13 +9,15 @@
 #include <QFileInfo>
 #include <QWidget>
 #include <QCheckBox>
+#include <QPalette>
+#include <QIcon>
+#include <QHash>
 
 class VisualModeUpdater : public QObject
 {
     Q_OBJECT
 public:
-    static VisualModeUpdater& instance();
-    VisualModeUpdater();
+    explicit VisualModeUpdater(QObject *parent = nullptr);
     ~VisualModeUpdater();
 
     void updateLightModeBooleanData(bool isLightModeActivated, bool isLayoutGrid, bool isShowFiles);
@@ -28,8 +30,20 @@ private:
     bool isLayoutGrid;
     bool isShowFiles;
 
+    struct Theme
+    {
+        bool isBuilt = false;
+        QPalette palette;
+        QString viewStyleSheet;
+        QHash<QString, QIcon> icons;
+    };
+
+    Theme themes[2];
+
+    const Theme& currentTheme();
+
 public slots:
-    void loadStyleSheet(QWidget &centralwidget, QListView &listView, QTreeView &treeView);
+    void applyTheme(QWidget &window, const QList<QAbstractItemView*> &views);
     void updateIconsToMode(QPushButton &copyButton, QPushButton &driveButton, QPushButton &editButton, QPushButton &trashButton, QPushButton &folderButton,QPushButton &mode, QPushButton &layout, QPushButton &hide);
     QString updateIconColorName(const QString &filePath);
 
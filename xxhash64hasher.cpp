@@ -0,0 +1,131 @@
+#include "xxhash64hasher.h"
+#include <QtEndian>
+#include <algorithm>
+
+/**
+ * @file xxhash64hasher.h
+ * @brief The XxHash64Hasher class is a streaming implementation of the 64 bit xxHash (XXH64). result() returns the hash in
+ * its canonical big-endian form, which is what xxhsum prints.
+ */
+
+namespace
+{
+const quint64 prime1 = 0x9E3779B185EBCA87ULL;
+const quint64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+const quint64 prime3 = 0x165667B19E3779F9ULL;
+const quint64 prime4 = 0x85EBCA77C2B2AE63ULL;
+const quint64 prime5 = 0x27D4EB2F165667C5ULL;
+
+inline quint64 rotateLeft(quint64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+inline quint64 round(quint64 accumulator, quint64 input)
+{
+    accumulator += input * prime2;
+    return rotateLeft(accumulator, 31) * prime1;
+}
+
+inline quint64 mergeRound(quint64 hash, quint64 accumulator)
+{
+    hash ^= round(0, accumulator);
+    return hash * prime1 + prime4;
+}
+}
+
+XxHash64Hasher::XxHash64Hasher(quint64 seed) : seed(seed)
+{
+    accumulators[0] = seed + prime1 + prime2;
+    accumulators[1] = seed + prime2;
+    accumulators[2] = seed;
+    accumulators[3] = seed - prime1;
+}
+
+void XxHash64Hasher::addData(const char *data, qint64 length)
+{
+    const quint8 *input = reinterpret_cast<const quint8*>(data);
+    totalLength += quint64(length);
+
+    if (bufferLength > 0)
+    {
+        const quint32 take = quint32(std::min<qint64>(length, 32 - bufferLength));
+        std::copy(input, input + take, buffer + bufferLength);
+        bufferLength += take;
+        input += take;
+        length -= take;
+        if (bufferLength < 32)
+        {
+            return;
+        }
+        consumeStripe(buffer);
+        bufferLength = 0;
+    }
+
+    for (; length >= 32; input += 32, length -= 32)
+    {
+        consumeStripe(input);
+    }
+
+    std::copy(input, input + length, buffer);
+    bufferLength = quint32(length);
+}
+
+/**
+ * @brief Returns the 8 byte hash of all data added.
+ */
+QByteArray XxHash64Hasher::result() const
+{
+    quint64 hash;
+    if (totalLength >= 32)
+    {
+        hash = rotateLeft(accumulators[0], 1) + rotateLeft(accumulators[1], 7) + rotateLeft(accumulators[2], 12)
+               + rotateLeft(accumulators[3], 18);
+        for (quint64 accumulator : accumulators)
+        {
+            hash = mergeRound(hash, accumulator);
+        }
+    }
+    else
+    {
+        hash = seed + prime5;
+    }
+    hash += totalLength;
+
+    const quint8 *tail = buffer;
+    const quint8 *end = buffer + bufferLength;
+    for (; end - tail >= 8; tail += 8)
+    {
+        hash ^= round(0, qFromLittleEndian<quint64>(tail));
+        hash = rotateLeft(hash, 27) * prime1 + prime4;
+    }
+    if (end - tail >= 4)
+    {
+        hash ^= quint64(qFromLittleEndian<quint32>(tail)) * prime1;
+        hash = rotateLeft(hash, 23) * prime2 + prime3;
+        tail += 4;
+    }
+    for (; tail < end; ++tail)
+    {
+        hash ^= *tail * prime5;
+        hash = rotateLeft(hash, 11) * prime1;
+    }
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+
+    QByteArray bytes(8, Qt::Uninitialized);
+    qToBigEndian<quint64>(hash, bytes.data());
+    return bytes;
+}
+
+void XxHash64Hasher::consumeStripe(const quint8 *stripe)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        accumulators[i] = round(accumulators[i], qFromLittleEndian<quint64>(stripe + 8 * i));
+    }
+}
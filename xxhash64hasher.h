@@ -0,0 +1,25 @@
+#ifndef XXHASH64HASHER_H
+#define XXHASH64HASHER_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+class XxHash64Hasher
+{
+public:
+    explicit XxHash64Hasher(quint64 seed = 0);
+
+    void addData(const char *data, qint64 length);
+    QByteArray result() const;
+
+private:
+    quint64 seed;
+    quint64 accumulators[4];
+    quint8 buffer[32];
+    quint32 bufferLength = 0;
+    quint64 totalLength = 0;
+
+    void consumeStripe(const quint8 *stripe);
+};
+
+#endif // XXHASH64HASHER_H